@@ -30,8 +30,12 @@
 #include <QString>
 #include <QVector>
 
+#include <array>
 #include <cstddef>
+#include <map>
+#include <memory>
 #include <stdlib.h>
+#include <vector>
 
 #include "qstringprep.h"
 
@@ -44,8 +48,74 @@ static int _compare_table_element(const uint32_t *c, const Stringprep_table_elem
     return 0;
 }
 
+namespace {
+/* Two-level lookup built from a range table: the code point's page (ucs4 >> 8)
+   selects a block of 256 entries holding the table element index + 1, or 0 if
+   the code point is not in the table.  Identical blocks are stored once, so
+   most pages share the empty block. */
+class TableLookup {
+public:
+    TableLookup(const Stringprep_table_element *table, size_t table_size)
+    {
+        using Block = std::array<uint16_t, 256>;
+        std::map<uint32_t, Block> pages;
+        for (size_t i = 0; i < table_size; i++) {
+            uint32_t end = table[i].end ? table[i].end : table[i].start;
+            for (uint32_t c = table[i].start; c <= end && c <= MaxCodePoint; c++) {
+                auto it = pages.find(c >> 8);
+                if (it == pages.end())
+                    it = pages.emplace(c >> 8, Block {}).first;
+                if (!it->second[c & 0xFF]) // the first element wins, like bsearch on sorted tables
+                    it->second[c & 0xFF] = uint16_t(i + 1);
+            }
+        }
+
+        std::map<Block, uint16_t> unique;
+        values.resize(256); // block 0 is empty
+        unique.emplace(Block {}, 0);
+        index.fill(0);
+        for (const auto &[page, block] : pages) {
+            auto it = unique.find(block);
+            if (it == unique.end()) {
+                it = unique.emplace(block, uint16_t(values.size() >> 8)).first;
+                values.insert(values.end(), block.begin(), block.end());
+            }
+            index[page] = it->second;
+        }
+    }
+
+    std::ptrdiff_t find(uint32_t ucs4) const
+    {
+        if (ucs4 > MaxCodePoint)
+            return -1;
+        return std::ptrdiff_t(values[(size_t(index[ucs4 >> 8]) << 8) | (ucs4 & 0xFF)]) - 1;
+    }
+
+    /* returns nullptr for tables which are not part of a known profile */
+    static const TableLookup *forTable(const Stringprep_table_element *table)
+    {
+        static const auto lookups = []() {
+            std::map<const Stringprep_table_element *, std::unique_ptr<TableLookup>> ret;
+            for (const Stringprep_profiles *p = stringprep_profiles; p->name; p++)
+                for (const Stringprep_profile *step = p->tables; step->operation; step++)
+                    if (step->table && !ret.count(step->table))
+                        ret.emplace(step->table, std::make_unique<TableLookup>(step->table, step->table_size));
+            return ret;
+        }();
+        auto it = lookups.find(table);
+        return it == lookups.end() ? nullptr : it->second.get();
+    }
+
+private:
+    static constexpr uint32_t MaxCodePoint = 0x10FFFF;
+
+    std::array<uint16_t, (MaxCodePoint >> 8) + 1> index;
+    std::vector<uint16_t>                          values;
+};
+} // namespace
+
 static std::ptrdiff_t stringprep_find_character_in_table(uint32_t ucs4, const Stringprep_table_element *table,
-                                                         size_t table_size)
+                                                         size_t table_size, const TableLookup *lookup = nullptr)
 {
     /* This is where typical uses of Libidn spends very close to all CPU
        time and causes most cache misses.  One could easily do a binary
@@ -73,6 +143,11 @@ static std::ptrdiff_t stringprep_find_character_in_table(uint32_t ucs4, const St
         return i;
     */
 
+    /* Tables of the built-in profiles have a two-level lookup, see TableLookup.
+       bsearch() is left for custom tables only. */
+    if (lookup || (lookup = TableLookup::forTable(table)))
+        return lookup->find(ucs4);
+
     const Stringprep_table_element *p = static_cast<const Stringprep_table_element *>(
         bsearch(&ucs4, table, table_size, sizeof(Stringprep_table_element),
                 (int (*)(const void *, const void *))_compare_table_element));
@@ -83,11 +158,12 @@ static std::ptrdiff_t stringprep_find_character_in_table(uint32_t ucs4, const St
 static std::ptrdiff_t stringprep_find_string_in_table(uint *ucs4, size_t len, size_t *tablepos,
                                                       const Stringprep_table_element *table, size_t table_size)
 {
-    size_t         j;
-    std::ptrdiff_t pos;
+    size_t             j;
+    std::ptrdiff_t     pos;
+    const TableLookup *lookup = TableLookup::forTable(table);
 
     for (j = 0; j < len; j++)
-        if ((pos = stringprep_find_character_in_table(ucs4[j], table, table_size)) != -1) {
+        if ((pos = stringprep_find_character_in_table(ucs4[j], table, table_size, lookup)) != -1) {
             if (tablepos)
                 *tablepos = pos;
             return j;
@@ -126,38 +202,7 @@ static int stringprep_apply_table_to_string(QVector<uint> &ucs4, const Stringpre
     ((!INVERTED(profileflags) && !(profileflags & flags) && profileflags)                                              \
      || (INVERTED(profileflags) && (profileflags & flags)))
 
-/**
- * stringprep_4i:
- * @ucs4: input/output array with string to prepare.
- * @len: on input, length of input array with Unicode code points,
- *   on exit, length of output array with Unicode code points.
- * @maxucs4len: maximum length of input/output array.
- * @flags: a #Stringprep_profile_flags value, or 0.
- * @profile: pointer to #Stringprep_profile to use.
- *
- * Prepare the input UCS-4 string according to the stringprep profile,
- * and write back the result to the input string.
- *
- * The input is not required to be zero terminated (@ucs4[@len] = 0).
- * The output will not be zero terminated unless @ucs4[@len] = 0.
- * Instead, see stringprep_4zi() if your input is zero terminated or
- * if you want the output to be.
- *
- * Since the stringprep operation can expand the string, @maxucs4len
- * indicate how large the buffer holding the string is.  This function
- * will not read or write to code points outside that size.
- *
- * The @flags are one of #Stringprep_profile_flags values, or 0.
- *
- * The @profile contain the #Stringprep_profile instructions to
- * perform.  Your application can define new profiles, possibly
- * re-using the generic stringprep tables that always will be part of
- * the library, or use one of the currently supported profiles.
- *
- * Return value: Returns %STRINGPREP_OK iff successful, or an
- *   #Stringprep_rc error code.
- **/
-int stringprep_4i(QString &input, Stringprep_profile_flags flags, const Stringprep_profile *profile)
+static int stringprep_4i_full(QString &input, Stringprep_profile_flags flags, const Stringprep_profile *profile)
 {
     size_t         i, j;
     std::ptrdiff_t k;
@@ -271,6 +316,135 @@ int stringprep_4i(QString &input, Stringprep_profile_flags flags, const Stringpr
     return STRINGPREP_OK;
 }
 
+namespace {
+/* What a profile does to every ASCII character.  NFKC leaves ASCII alone and the
+   built-in tables map ASCII to ASCII, so a pure ASCII string - almost every jid -
+   is prepared character by character without conversion to UCS-4. */
+class AsciiProfile {
+public:
+    enum { NotAscii = -1 };
+
+    explicit AsciiProfile(const Stringprep_profile *profile)
+    {
+        for (ushort c = 0; c < 128; c++) {
+            QString s(1, QChar(c));
+            rc[c] = stringprep_4i_full(s, Stringprep_profile_flags(0), profile);
+            if (rc[c] != STRINGPREP_OK)
+                map[c] = 0;
+            else if (s.isEmpty())
+                map[c] = Deleted;
+            else if (s.size() == 1 && s[0].unicode() < 128)
+                map[c] = s[0].unicode();
+            else
+                usable = false;
+        }
+
+        /* bidi rules work on the whole string, but can't fail without a RAL character */
+        for (const Stringprep_profile *step = profile; step->operation; step++)
+            if (step->operation == STRINGPREP_BIDI_RAL_TABLE)
+                for (uint32_t c = 0; c < 128; c++)
+                    if (stringprep_find_character_in_table(c, step->table, step->table_size) != -1)
+                        usable = false;
+    }
+
+    int prepare(QString &input) const
+    {
+        const QChar *p       = input.constData();
+        const auto   n       = input.size();
+        bool         changed = false;
+        for (qsizetype i = 0; i < n; i++) {
+            ushort c = p[i].unicode();
+            if (c >= 128)
+                return NotAscii;
+            changed = changed || map[c] != c;
+        }
+
+        for (qsizetype i = 0; i < n; i++)
+            if (rc[p[i].unicode()] != STRINGPREP_OK)
+                return rc[p[i].unicode()];
+
+        if (changed) {
+            QString out;
+            out.reserve(n);
+            for (qsizetype i = 0; i < n; i++)
+                if (map[p[i].unicode()] != Deleted)
+                    out += QChar(map[p[i].unicode()]);
+            input = out;
+        }
+        return STRINGPREP_OK;
+    }
+
+    /* returns nullptr for custom profiles and those which can't use the fast path */
+    static const AsciiProfile *forProfile(const Stringprep_profile *profile)
+    {
+        static const auto profiles = []() {
+            std::map<const Stringprep_profile *, std::unique_ptr<AsciiProfile>> ret;
+            for (const Stringprep_profiles *p = stringprep_profiles; p->name; p++) {
+                if (ret.count(p->tables))
+                    continue;
+                auto ascii = std::make_unique<AsciiProfile>(p->tables);
+                if (ascii->usable)
+                    ret.emplace(p->tables, std::move(ascii));
+            }
+            return ret;
+        }();
+        auto it = profiles.find(profile);
+        return it == profiles.end() ? nullptr : it->second.get();
+    }
+
+private:
+    static constexpr ushort Deleted = 0xFFFF;
+
+    bool   usable = true;
+    int    rc[128];
+    ushort map[128];
+};
+} // namespace
+
+/**
+ * stringprep_4i:
+ * @ucs4: input/output array with string to prepare.
+ * @len: on input, length of input array with Unicode code points,
+ *   on exit, length of output array with Unicode code points.
+ * @maxucs4len: maximum length of input/output array.
+ * @flags: a #Stringprep_profile_flags value, or 0.
+ * @profile: pointer to #Stringprep_profile to use.
+ *
+ * Prepare the input UCS-4 string according to the stringprep profile,
+ * and write back the result to the input string.
+ *
+ * The input is not required to be zero terminated (@ucs4[@len] = 0).
+ * The output will not be zero terminated unless @ucs4[@len] = 0.
+ * Instead, see stringprep_4zi() if your input is zero terminated or
+ * if you want the output to be.
+ *
+ * Since the stringprep operation can expand the string, @maxucs4len
+ * indicate how large the buffer holding the string is.  This function
+ * will not read or write to code points outside that size.
+ *
+ * The @flags are one of #Stringprep_profile_flags values, or 0.
+ *
+ * The @profile contain the #Stringprep_profile instructions to
+ * perform.  Your application can define new profiles, possibly
+ * re-using the generic stringprep tables that always will be part of
+ * the library, or use one of the currently supported profiles.
+ *
+ * Return value: Returns %STRINGPREP_OK iff successful, or an
+ *   #Stringprep_rc error code.
+ **/
+int stringprep_4i(QString &input, Stringprep_profile_flags flags, const Stringprep_profile *profile)
+{
+    if (!flags) {
+        const AsciiProfile *ascii = AsciiProfile::forProfile(profile);
+        if (ascii) {
+            int rc = ascii->prepare(input);
+            if (rc != AsciiProfile::NotAscii)
+                return rc;
+        }
+    }
+    return stringprep_4i_full(input, flags, profile);
+}
+
 /**
  * stringprep:
  * @in: input/ouput array with string to prepare.
@@ -0,0 +1 @@
+#include <iris/xmpp-im/xmpp_rosterchanges.h>
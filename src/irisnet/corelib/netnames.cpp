@@ -413,11 +413,15 @@ static NameManager *g_nman = nullptr;
 
 class NameResolver::Private {
 public:
-    NameResolver *q;
+    NameResolver *q; // nullptr for a background refresh of the cache
 
-    int  type;
-    bool longLived;
-    int  id;
+    int              type;
+    bool             longLived;
+    int              id;
+    QByteArray       name;
+    NameRecord::Type recordType;
+    bool             cached = false; // answered from NameCache, NameManager doesn't know about it
+    QObject          cacheContext;   // delivery of the cached answer dies with it
 
     Private(NameResolver *_q) : q(_q) { }
 };
@@ -668,6 +672,8 @@ public:
     QHash<int, ServiceResolver::Private *>       sres_instances;
     QHash<int, ServiceLocalPublisher::Private *> slp_instances;
 
+    QSet<QByteArray> refreshing; // stale cache entries being looked up again
+
     NameManager(QObject *parent = nullptr) : QObject(parent)
     {
         p_net   = nullptr;
@@ -723,9 +729,12 @@ public:
                     [this](int id, const QList<XMPP::NameRecord> &results) {
                         NameResolver::Private *np = res_instances.value(id);
                         NameResolver          *q  = np->q; // resolve_cleanup deletes np
-                        if (!np->longLived)
+                        if (!np->longLived) {
+                            NameCache::instance()->insert(np->name, np->recordType, results);
                             resolve_cleanup(np);
-                        emit q->resultsReady(results);
+                        }
+                        if (q)
+                            emit q->resultsReady(results);
                     });
             connect(p_net, SIGNAL(resolve_error(int, XMPP::NameResolver::Error)),
                     SLOT(provider_resolve_error(int, XMPP::NameResolver::Error)));
@@ -738,6 +747,22 @@ public:
         res_instances.insert(np->id, np);
     }
 
+    // looks up an expired cache entry again. nobody waits for the result, it just goes to the cache
+    void resolve_refresh(const QByteArray &name, NameRecord::Type type, int qType)
+    {
+        QByteArray key = refreshKey(name, qType);
+        if (refreshing.contains(key))
+            return;
+        refreshing.insert(key);
+
+        auto np        = new NameResolver::Private(nullptr);
+        np->name       = name;
+        np->recordType = type;
+        resolve_start(np, name, qType, false);
+    }
+
+    static QByteArray refreshKey(const QByteArray &name, int qType) { return QByteArray::number(qType) + ' ' + name; }
+
     void resolve_stop(NameResolver::Private *np)
     {
         // FIXME: stop sub instances?
@@ -766,6 +791,11 @@ public:
 
         res_instances.remove(np->id);
         NameResolver *q = np->q;
+        if (!q) {
+            refreshing.remove(refreshKey(np->name, np->type));
+            delete np;
+            return;
+        }
         delete q->d;
         q->d = nullptr;
     }
@@ -883,7 +913,8 @@ private slots:
         NameResolver::Private *np = res_instances.value(id);
         NameResolver          *q  = np->q; // resolve_cleanup deletes np
         resolve_cleanup(np);
-        emit q->error(e);
+        if (q) // a failed refresh leaves the stale entry as is
+            emit q->error(e);
     }
 
     void provider_local_resolve_resultsReady(int id, const QList<XMPP::NameRecord> &results)
@@ -1039,13 +1070,33 @@ void NameResolver::start(const QByteArray &name, NameRecord::Type type, Mode mod
     int qType = recordType2Rtype(type);
     if (qType == -1)
         qType = JDNS_RTYPE_A;
+    d->name       = name;
+    d->recordType = type;
+
+    if (mode == Single) {
+        bool stale   = false;
+        auto records = NameCache::instance()->lookup(name, type, &stale);
+        if (!records.isEmpty()) {
+            d->cached = true;
+            // still asynchronous, like a real lookup
+            QTimer::singleShot(0, &d->cacheContext, [this, records]() {
+                auto results = records;
+                stop();
+                emit resultsReady(results);
+            });
+            if (stale)
+                NameManager::instance()->resolve_refresh(name, type, qType);
+            return;
+        }
+    }
     NameManager::instance()->resolve_start(d, name, qType, mode == NameResolver::LongLived);
 }
 
 void NameResolver::stop()
 {
     if (d) {
-        NameManager::instance()->resolve_stop(d);
+        if (!d->cached)
+            NameManager::instance()->resolve_stop(d);
         delete d;
         d = nullptr;
     }
@@ -1137,6 +1188,17 @@ void ServiceResolver::setProtocol(ServiceResolver::Protocol p) { d->requestedPro
 /* DNS-SD lookup */
 void ServiceResolver::start(const QByteArray &name) { NameManager::instance()->resolve_instance_start(d, name); }
 
+/* compare domain names ignoring case and the trailing dot */
+static bool sameHost(const QByteArray &name, const QString &other)
+{
+    auto strip = [](QString s) {
+        if (s.endsWith('.'))
+            s.chop(1);
+        return s;
+    };
+    return !other.isEmpty() && strip(QString::fromLatin1(name)).compare(strip(other), Qt::CaseInsensitive) == 0;
+}
+
 /* normal host lookup */
 void ServiceResolver::start(const QString &host, quint16 port, const QString &service)
 {
@@ -1210,17 +1272,24 @@ void ServiceResolver::start(const QStringList &services, const QString &transpor
         },
         services.size());
 
+    /* the target which accepted the last connection goes first */
+    auto preferred = NameCache::instance()->preferred(domain);
+
     for (auto const &service : services) {
         QString srv_request("_" + service + "._" + transport + "." + domain + ".");
 
         /* initiate the SRV lookup */
         auto resolver = new XMPP::NameResolver;
         connect(resolver, &XMPP::NameResolver::resultsReady, this,
-                [this, resolver, stats, service](const QList<XMPP::NameRecord> &r) {
+                [this, resolver, stats, service, preferred](const QList<XMPP::NameRecord> &r) {
                     NNLOG(NNDEBUG << "sl:" << r);
                     QList<ServiceBoundRecord> sbr;
                     std::transform(r.begin(), r.end(), std::back_inserter(sbr),
                                    [service](auto const &r) { return ServiceBoundRecord { service, r }; });
+                    for (auto &b : sbr) {
+                        if (b.record.port() == preferred.port && sameHost(b.record.name(), preferred.target))
+                            b.record.setSrv(b.record.name(), b.record.port(), -1, b.record.weight());
+                    }
                     d->srvList << sbr;
                     stats->finishOne(true);
                     cleanup_resolver(resolver);
@@ -1400,6 +1469,300 @@ void ServiceLocalPublisher::addRecord(const NameRecord &rec) { NameManager::inst
 
 void ServiceLocalPublisher::cancel() { }
 
+//----------------------------------------------------------------------------
+// NameCache
+//----------------------------------------------------------------------------
+#define NAMECACHE_MAGIC 0x49524e43 // "IRNC"
+#define NAMECACHE_VERSION 1
+#define NAMECACHE_PRUNE_SIZE 4096
+
+class NameCache::Private {
+public:
+    struct Entry {
+        QList<NameRecord> records;
+        qint64            expires; // seconds since epoch
+    };
+
+    mutable QMutex             mutex;
+    bool                       enabled   = true;
+    int                        staleTime = 24 * 3600;
+    int                        minTtl    = 30;
+    int                        maxTtl    = 24 * 3600;
+    QHash<QByteArray, Entry>   entries; // see key()
+    QHash<QString, Preference> preferences;
+
+    static bool cacheable(NameRecord::Type type)
+    {
+        return type == NameRecord::A || type == NameRecord::Aaaa || type == NameRecord::Srv;
+    }
+
+    static QByteArray key(const QByteArray &name, NameRecord::Type type)
+    {
+        QByteArray n = name.toLower();
+        if (!n.endsWith('.'))
+            n += '.';
+        return QByteArray::number(int(type)) + ' ' + n;
+    }
+
+    static QString domainKey(const QString &domain)
+    {
+        QString n = domain.toLower();
+        if (n.endsWith('.'))
+            n.chop(1);
+        return n;
+    }
+
+    static qint64 now() { return QDateTime::currentSecsSinceEpoch(); }
+
+    bool isDead(const Entry &e, qint64 time) const { return e.expires + staleTime <= time; }
+
+    void prune()
+    {
+        qint64 time = now();
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (isDead(*it, time))
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    static void writeRecord(QDataStream &ds, const NameRecord &r)
+    {
+        ds << quint8(r.type()) << r.owner() << qint32(r.ttl());
+        if (r.type() == NameRecord::Srv)
+            ds << r.name() << quint16(r.port()) << qint32(r.priority()) << qint32(r.weight());
+        else
+            ds << r.address();
+    }
+
+    static NameRecord readRecord(QDataStream &ds)
+    {
+        quint8  type;
+        QString owner;
+        qint32  ttl;
+        ds >> type >> owner >> ttl;
+        NameRecord r(owner, ttl);
+        if (type == NameRecord::Srv) {
+            QByteArray name;
+            quint16    port;
+            qint32     priority, weight;
+            ds >> name >> port >> priority >> weight;
+            r.setSrv(name, port, priority, weight);
+        } else {
+            QHostAddress address;
+            ds >> address;
+            r.setAddress(address);
+        }
+        return r;
+    }
+};
+
+NameCache::NameCache() : d(new Private) { }
+
+NameCache::~NameCache() { }
+
+NameCache *NameCache::instance()
+{
+    static NameCache cache;
+    return &cache;
+}
+
+bool NameCache::isEnabled() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->enabled;
+}
+
+void NameCache::setEnabled(bool enabled)
+{
+    QMutexLocker locker(&d->mutex);
+    d->enabled = enabled;
+    if (!enabled) {
+        d->entries.clear();
+        d->preferences.clear();
+    }
+}
+
+int NameCache::staleTime() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->staleTime;
+}
+
+void NameCache::setStaleTime(int seconds)
+{
+    QMutexLocker locker(&d->mutex);
+    d->staleTime = seconds;
+}
+
+void NameCache::setTtlLimits(int minSeconds, int maxSeconds)
+{
+    QMutexLocker locker(&d->mutex);
+    d->minTtl = minSeconds;
+    d->maxTtl = maxSeconds;
+}
+
+void NameCache::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->entries.clear();
+    d->preferences.clear();
+}
+
+QList<NameRecord> NameCache::lookup(const QByteArray &name, NameRecord::Type type, bool *stale) const
+{
+    if (stale)
+        *stale = false;
+    if (!Private::cacheable(type))
+        return {};
+
+    QMutexLocker locker(&d->mutex);
+    auto         it = d->entries.constFind(Private::key(name, type));
+    if (it == d->entries.constEnd())
+        return {};
+    qint64 time = Private::now();
+    if (d->isDead(*it, time))
+        return {};
+
+    qint64 left = it->expires - time;
+    if (stale)
+        *stale = left <= 0;
+    QList<NameRecord> ret = it->records;
+    for (auto &r : ret)
+        r.setTtl(int(std::max<qint64>(left, 0)));
+    return ret;
+}
+
+void NameCache::insert(const QByteArray &name, NameRecord::Type type, const QList<NameRecord> &records)
+{
+    if (!Private::cacheable(type))
+        return;
+
+    Private::Entry e;
+    int            ttl = std::numeric_limits<int>::max();
+    for (const auto &r : records) {
+        if (r.type() != type) // CNAMEs and alike
+            continue;
+        e.records += r;
+        ttl = std::min(ttl, r.ttl());
+    }
+    if (e.records.isEmpty())
+        return;
+
+    QMutexLocker locker(&d->mutex);
+    if (!d->enabled)
+        return;
+    e.expires = Private::now() + qBound(d->minTtl, ttl, d->maxTtl);
+    if (d->entries.size() >= NAMECACHE_PRUNE_SIZE)
+        d->prune();
+    d->entries.insert(Private::key(name, type), e);
+}
+
+NameCache::Preference NameCache::preferred(const QString &domain) const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->preferences.value(Private::domainKey(domain));
+}
+
+void NameCache::setPreferred(const QString &domain, const Preference &preference)
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->enabled)
+        return;
+    if (preference.isNull())
+        d->preferences.remove(Private::domainKey(domain));
+    else
+        d->preferences.insert(Private::domainKey(domain), preference);
+}
+
+bool NameCache::save(const QString &fileName) const
+{
+    QByteArray data;
+    {
+        QMutexLocker locker(&d->mutex);
+        QDataStream  ds(&data, QIODevice::WriteOnly);
+        ds.setVersion(QDataStream::Qt_5_12);
+        qint64 time = Private::now();
+
+        quint32 count = 0;
+        for (const auto &e : std::as_const(d->entries))
+            count += d->isDead(e, time) ? 0 : 1;
+        ds << quint32(NAMECACHE_MAGIC) << quint8(NAMECACHE_VERSION) << count;
+        for (auto it = d->entries.constBegin(); it != d->entries.constEnd(); ++it) {
+            if (d->isDead(*it, time))
+                continue;
+            ds << it.key() << it->expires << quint32(it->records.size());
+            for (const auto &r : it->records)
+                Private::writeRecord(ds, r);
+        }
+
+        ds << quint32(d->preferences.size());
+        for (auto it = d->preferences.constBegin(); it != d->preferences.constEnd(); ++it)
+            ds << it.key() << it->target << it->port << qint32(it->protocol);
+    }
+
+    QSaveFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly) || f.write(data) != data.size())
+        return false;
+    return f.commit();
+}
+
+bool NameCache::load(const QString &fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream ds(&f);
+    ds.setVersion(QDataStream::Qt_5_12);
+    quint32 magic   = 0;
+    quint8  version = 0;
+    quint32 count   = 0;
+    ds >> magic >> version >> count;
+    if (magic != NAMECACHE_MAGIC || version != NAMECACHE_VERSION)
+        return false;
+
+    QHash<QByteArray, Private::Entry> entries;
+    for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        QByteArray     key;
+        Private::Entry e;
+        quint32        n = 0;
+        ds >> key >> e.expires >> n;
+        for (quint32 j = 0; j < n && ds.status() == QDataStream::Ok; ++j)
+            e.records += Private::readRecord(ds);
+        entries.insert(key, e);
+    }
+
+    QHash<QString, Preference> preferences;
+    ds >> count;
+    for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        QString    domain;
+        Preference p;
+        qint32     protocol;
+        ds >> domain >> p.target >> p.port >> protocol;
+        p.protocol = QAbstractSocket::NetworkLayerProtocol(protocol);
+        preferences.insert(domain, p);
+    }
+    if (ds.status() != QDataStream::Ok)
+        return false;
+
+    // what was looked up since the start is fresher than the snapshot
+    QMutexLocker locker(&d->mutex);
+    if (!d->enabled)
+        return true;
+    qint64 time = Private::now();
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (!d->isDead(*it, time) && !d->entries.contains(it.key()))
+            d->entries.insert(it.key(), *it);
+    }
+    for (auto it = preferences.constBegin(); it != preferences.constEnd(); ++it) {
+        if (!d->preferences.contains(it.key()))
+            d->preferences.insert(it.key(), *it);
+    }
+    return true;
+}
+
 //----------------------------------------------------------------------------
 // NetNames
 //----------------------------------------------------------------------------
@@ -689,6 +689,56 @@ private:
     friend class NameManager;
 };
 
+/*!
+ * Process-wide cache of DNS answers.
+ *
+ * NameResolver consults it for single (not long-lived) A, AAAA and SRV queries. Answers are kept as long as their TTL
+ * says. An expired answer is still served for staleTime() seconds while a fresh lookup runs in the background, so a
+ * reconnect doesn't wait for DNS. The cache also remembers which SRV target and address family of a domain accepted
+ * the last connection, so the next attempt can start with it.
+ *
+ * The content can be saved to a file and loaded back on the next start.
+ */
+class IRISNET_EXPORT NameCache {
+public:
+    struct Preference {
+        QString                               target; //!< SRV target (or the host itself without SRV)
+        quint16                               port     = 0;
+        QAbstractSocket::NetworkLayerProtocol protocol = QAbstractSocket::UnknownNetworkLayerProtocol;
+
+        bool isNull() const { return target.isEmpty(); }
+    };
+
+    static NameCache *instance();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled); //!< Disabling also clears the cache
+    int  staleTime() const;
+    void setStaleTime(int seconds);
+    void setTtlLimits(int minSeconds, int maxSeconds); //!< TTLs from DNS are clamped to these
+    void clear();
+
+    /*!
+     * Cached records of \a type for \a name, with the TTL decreased by the time spent in the cache.
+     * Empty if nothing usable is cached. \a stale is set when the records are expired but still may be served.
+     */
+    QList<NameRecord> lookup(const QByteArray &name, NameRecord::Type type, bool *stale = nullptr) const;
+    void              insert(const QByteArray &name, NameRecord::Type type, const QList<NameRecord> &records);
+
+    Preference preferred(const QString &domain) const;
+    void       setPreferred(const QString &domain, const Preference &preference);
+
+    bool save(const QString &fileName) const;
+    bool load(const QString &fileName);
+
+private:
+    NameCache();
+    ~NameCache();
+
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
 class IRISNET_EXPORT ServiceLocalPublisher : public QObject {
     Q_OBJECT
 public:
@@ -161,6 +161,7 @@ public:
 
         QHostAddress addr(host);
         if (addr.isNull()) {
+            preferLastProtocol();
             sd.resolver = new XMPP::ServiceResolver;
             initResolver(sd.resolver);
             sd.resolver->setProtocol(protocol == QAbstractSocket::UnknownNetworkLayerProtocol
@@ -190,8 +191,9 @@ public:
         this->transport = transport;
         this->domain    = domain;
         this->port      = port;
-        SockData &sd    = addSocket();
-        sd.resolver     = new XMPP::ServiceResolver(this);
+        preferLastProtocol();
+        SockData &sd = addSocket();
+        sd.resolver  = new XMPP::ServiceResolver(this);
         sd.resolver->setProtocol(XMPP::ServiceResolver::HappyEyeballs);
         connect(sd.resolver, &XMPP::ServiceResolver::srvReady, this, &HappyEyeballsConnector::splitSrvResolvers);
         // we don't care about special handling of fail. we have fallback host there anyway
@@ -214,6 +216,27 @@ public:
     }
 
 private:
+    /* the address family which worked last time for the domain goes first */
+    void preferLastProtocol()
+    {
+        auto p = XMPP::NameCache::instance()->preferred(domain).protocol;
+        if (p == QAbstractSocket::IPv4Protocol)
+            fallbackProtocol = QAbstractSocket::IPv6Protocol;
+        else if (p == QAbstractSocket::IPv6Protocol)
+            fallbackProtocol = QAbstractSocket::IPv4Protocol;
+    }
+
+    void rememberSuccess(const SockData &sd)
+    {
+        if (!sd.resolver) // connected by address
+            return;
+        XMPP::NameCache::Preference p;
+        p.target   = sd.hostname;
+        p.port     = sd.sock->peerPort();
+        p.protocol = sd.sock->peerAddress().protocol();
+        XMPP::NameCache::instance()->setPreferred(domain, p);
+    }
+
     void abortSocket(SockData &sd)
     {
         sd.relay->disconnect(this);
@@ -267,6 +290,8 @@ private slots:
         BSLOG(BSDEBUG);
         QPointer<HappyEyeballsConnector> valid(this);
         setCurrentByRelay(static_cast<QTcpSocketSignalRelay *>(sender()));
+        if (lastIndex >= 0)
+            rememberSuccess(sockets[lastIndex]);
         for (int i = 0; i < sockets.count(); i++) {
             if (i != lastIndex) {
                 abortSocket(sockets[i]);
@@ -21,6 +21,8 @@
 
 #include <QByteArray>
 
+#include <deque>
+
 // CS_NAMESPACE_BEGIN
 
 //! \class ByteStream bytestream.h
@@ -55,13 +57,136 @@
 //! Also available are the static convenience functions ByteStream::appendArray()
 //! and ByteStream::takeArray(), which make dealing with byte queues very easy.
 
+// FIFO of byte chunks. Consuming from the head never moves the rest of the data:
+// a partially consumed head chunk just advances an offset and a chunk taken as a
+// whole is handed out as is (QByteArray is implicitly shared, so no copy either).
+class ByteQueue {
+public:
+    qint64 size() const
+    {
+        // readBuf()/writeBuf() may have changed the only chunk behind our back
+        return exposed_ ? chunks_.front().size() : size_;
+    }
+
+    void clear()
+    {
+        chunks_.clear();
+        head_    = 0;
+        size_    = 0;
+        exposed_ = false;
+    }
+
+    void append(const QByteArray &block)
+    {
+        sync();
+        if (block.isEmpty())
+            return;
+        // don't let a stream of tiny writes turn into as many chunks
+        if (!chunks_.empty() && block.size() < SmallBlock && chunks_.back().size() < SmallBlock)
+            chunks_.back() += block;
+        else
+            chunks_.push_back(block);
+        size_ += block.size();
+    }
+
+    QByteArray take(qint64 size, bool del)
+    {
+        sync();
+        if (size <= 0 || size > size_)
+            size = size_;
+        if (!size)
+            return {};
+
+        QByteArray &front = chunks_.front();
+        QByteArray  result;
+        if (head_ == 0 && front.size() == size) {
+            result = front; // the most common case with a transport writing what was written to it
+        } else if (front.size() - head_ >= size) {
+            result = front.mid(int(head_), int(size));
+        } else {
+            result.reserve(int(size));
+            qint64 left = size;
+            for (auto it = chunks_.cbegin(); left; ++it) {
+                const qsizetype offset = it == chunks_.cbegin() ? head_ : 0;
+                const qsizetype n      = qsizetype(qMin(qint64(it->size() - offset), left));
+                result.append(it->constData() + offset, int(n));
+                left -= n;
+            }
+        }
+        if (del)
+            consume(size);
+        return result;
+    }
+
+    qint64 read(char *data, qint64 maxSize)
+    {
+        sync();
+        const qint64 size = qMin(maxSize, size_);
+        qint64       done = 0;
+        for (auto it = chunks_.cbegin(); done < size; ++it) {
+            const qsizetype offset = it == chunks_.cbegin() ? head_ : 0;
+            const qint64    n      = qMin(qint64(it->size() - offset), size - done);
+            memcpy(data + done, it->constData() + offset, size_t(n));
+            done += n;
+        }
+        consume(size);
+        return size;
+    }
+
+    // everything in one chunk, for readBuf()/writeBuf()
+    QByteArray &flatten()
+    {
+        sync();
+        if (chunks_.size() != 1 || head_ != 0) {
+            QByteArray all = take(0, true);
+            clear();
+            chunks_.push_back(all);
+        }
+        exposed_ = true;
+        return chunks_.front();
+    }
+
+private:
+    static constexpr qsizetype SmallBlock = 4096;
+
+    void sync()
+    {
+        if (!exposed_)
+            return;
+        exposed_ = false;
+        size_    = chunks_.front().size();
+        if (!size_)
+            chunks_.clear();
+    }
+
+    void consume(qint64 size)
+    {
+        size_ -= size;
+        while (size) {
+            QByteArray  &front = chunks_.front();
+            const qint64 n     = qMin(qint64(front.size() - head_), size);
+            head_ += qsizetype(n);
+            size -= n;
+            if (head_ == front.size()) {
+                chunks_.pop_front();
+                head_ = 0;
+            }
+        }
+    }
+
+    std::deque<QByteArray> chunks_;
+    qsizetype              head_    = 0; // consumed bytes of the first chunk
+    qint64                 size_    = 0;
+    bool                   exposed_ = false;
+};
+
 class ByteStream::Private {
 public:
     Private() { }
 
-    QByteArray readBuf, writeBuf;
-    int        errorCode;
-    QString    errorText;
+    ByteQueue readBuf, writeBuf;
+    int       errorCode;
+    QString   errorText;
 };
 
 //!
@@ -80,7 +205,7 @@ qint64 ByteStream::writeData(const char *data, qint64 maxSize)
         return -1;
 
     bool doWrite = bytesToWrite() == 0;
-    d->writeBuf.append(data, int(maxSize));
+    d->writeBuf.append(QByteArray(data, int(maxSize)));
     if (doWrite)
         tryWrite();
     return maxSize;
@@ -89,13 +214,7 @@ qint64 ByteStream::writeData(const char *data, qint64 maxSize)
 //!
 //! Reads bytes \a bytes of data from the stream and returns them as an array.  If \a bytes is 0, then
 //! \a read will return all available data.
-qint64 ByteStream::readData(char *data, qint64 maxSize)
-{
-    maxSize = maxSize > d->readBuf.size() ? d->readBuf.size() : maxSize;
-    memcpy(data, d->readBuf.constData(), size_t(maxSize));
-    d->readBuf.remove(0, int(maxSize));
-    return maxSize;
-}
+qint64 ByteStream::readData(char *data, qint64 maxSize) { return d->readBuf.read(data, maxSize); }
 
 //!
 //! Returns the number of bytes available for reading.
@@ -107,39 +226,43 @@ qint64 ByteStream::bytesToWrite() const { return d->writeBuf.size(); }
 
 //!
 //! Clears the read buffer.
-void ByteStream::clearReadBuffer() { d->readBuf.resize(0); }
+void ByteStream::clearReadBuffer() { d->readBuf.clear(); }
 
 //!
 //! Clears the write buffer.
-void ByteStream::clearWriteBuffer() { d->writeBuf.resize(0); }
+void ByteStream::clearWriteBuffer() { d->writeBuf.clear(); }
 
 //!
 //! Appends \a block to the end of the read buffer.
-void ByteStream::appendRead(const QByteArray &block) { d->readBuf += block; }
+//! The block is kept by reference (implicitly shared), so it must not come from QByteArray::fromRawData().
+void ByteStream::appendRead(const QByteArray &block) { d->readBuf.append(block); }
 
 //!
 //! Appends \a block to the end of the write buffer.
-void ByteStream::appendWrite(const QByteArray &block) { d->writeBuf += block; }
+//! The block is kept by reference (implicitly shared), so it must not come from QByteArray::fromRawData().
+void ByteStream::appendWrite(const QByteArray &block) { d->writeBuf.append(block); }
 
 //!
 //! Returns \a size bytes from the start of the read buffer.
 //! If \a size is 0, then all available data will be returned.
 //! If \a del is TRUE, then the bytes are also removed.
-QByteArray ByteStream::takeRead(int size, bool del) { return takeArray(d->readBuf, size, del); }
+QByteArray ByteStream::takeRead(int size, bool del) { return d->readBuf.take(size, del); }
 
 //!
 //! Returns \a size bytes from the start of the write buffer.
 //! If \a size is 0, then all available data will be returned.
 //! If \a del is TRUE, then the bytes are also removed.
-QByteArray ByteStream::takeWrite(int size, bool del) { return takeArray(d->writeBuf, size, del); }
+QByteArray ByteStream::takeWrite(int size, bool del) { return d->writeBuf.take(size, del); }
 
 //!
 //! Returns a reference to the read buffer.
-QByteArray &ByteStream::readBuf() { return d->readBuf; }
+//! The buffer is made contiguous for that, which copies it. Prefer takeRead().
+QByteArray &ByteStream::readBuf() { return d->readBuf.flatten(); }
 
 //!
 //! Returns a reference to the write buffer.
-QByteArray &ByteStream::writeBuf() { return d->writeBuf; }
+//! The buffer is made contiguous for that, which copies it. Prefer takeWrite().
+QByteArray &ByteStream::writeBuf() { return d->writeBuf.flatten(); }
 
 //!
 //! Attempts to try and write some bytes from the write buffer, and returns the number
@@ -1490,15 +1490,21 @@ private slots:
 
             // iceDebug("port %d: received packet (%d bytes)", lt->sock->localPort(), buf.size());
 
-            QString    requser = localUser + ':' + peerUser;
-            QByteArray reqkey  = localPass.toUtf8();
+            // media fails the 3-field check right away, only stun pays for validation
+            StunMessageView msg(buf);
+            bool            validRequest  = false;
+            bool            validResponse = false;
+            if (!msg.isNull() && msg.checkFingerprint()) {
+                if (msg.mclass() == StunMessage::Request || msg.mclass() == StunMessage::Indication)
+                    validRequest = msg.checkMessageIntegrity(localPass.toUtf8());
+                else
+                    validResponse = msg.checkMessageIntegrity(peerPass.toUtf8());
+            }
 
-            StunMessage::ConvertResult result;
-            StunMessage                msg = StunMessage::fromBinary(buf, &result,
-                                                                     StunMessage::MessageIntegrity | StunMessage::Fingerprint, reqkey);
-            if (!msg.isNull() && (msg.mclass() == StunMessage::Request || msg.mclass() == StunMessage::Indication)) {
+            if (validRequest) {
                 iceDebug("received validated request or indication from %s", qPrintable(fromAddr));
-                QString user = QString::fromUtf8(msg.attribute(StunTypes::USERNAME));
+                QString requser = localUser + ':' + peerUser;
+                QString user    = QString::fromUtf8(msg.attribute(StunTypes::USERNAME).value());
                 if (requser != user) {
                     iceDebug("user [%s] is wrong.  it should be [%s].  skipping", qPrintable(user),
                              qPrintable(requser));
@@ -1523,7 +1529,8 @@ private slots:
 
                 response.setAttributes(list);
 
-                QByteArray packet = response.toBinary(StunMessage::MessageIntegrity | StunMessage::Fingerprint, reqkey);
+                QByteArray packet
+                    = response.toBinary(StunMessage::MessageIntegrity | StunMessage::Fingerprint, localPass.toUtf8());
                 sock->writeDatagram(path, packet, fromAddr);
 
                 if (state != Started) // only in started state we do triggered checks
@@ -1540,7 +1547,7 @@ private slots:
                     // RFC8445 7.3.1.3.  Learning Peer-Reflexive Candidates
                     iceDebug("found NEW remote prflx! %s", qPrintable(fromAddr));
                     quint32 priority;
-                    StunTypes::parsePriority(msg.attribute(StunTypes::PRIORITY), &priority);
+                    StunTypes::parsePriority(msg.attribute(StunTypes::PRIORITY).value(), &priority);
                     auto remCand
                         = IceComponent::CandidateInfo::makeRemotePrflx(locCand.info->componentId, fromAddr, priority);
                     remoteCandidates += remCand;
@@ -1548,52 +1555,47 @@ private slots:
                 } else {
                     doTriggeredCheck(locCand, *it, nominated);
                 }
+            } else if (validResponse) {
+                iceDebug("received validated response from %s to %s", qPrintable(fromAddr),
+                         qPrintable(locCand.info->addr));
+
+                StunMessage response = msg.toMessage(true);
+                // FIXME: this is so gross and completely defeats the point of having pools
+                for (int n = 0; n < checkList.pairs.count(); ++n) {
+                    CandidatePair &pair = *checkList.pairs[n];
+                    if (pair.state == PInProgress && pair.local->addr.addr == locCand.info->addr.addr
+                        && pair.local->addr.port == locCand.info->addr.port)
+                        pair.pool->writeIncomingMessage(response);
+                }
             } else {
-                QByteArray  reskey = peerPass.toUtf8();
-                StunMessage msg    = StunMessage::fromBinary(
-                    buf, &result, StunMessage::MessageIntegrity | StunMessage::Fingerprint, reskey);
-                if (!msg.isNull()
-                    && (msg.mclass() == StunMessage::SuccessResponse || msg.mclass() == StunMessage::ErrorResponse)) {
-                    iceDebug("received validated response from %s to %s", qPrintable(fromAddr),
-                             qPrintable(locCand.info->addr));
-
-                    // FIXME: this is so gross and completely defeats the point of having pools
-                    for (int n = 0; n < checkList.pairs.count(); ++n) {
-                        CandidatePair &pair = *checkList.pairs[n];
-                        if (pair.state == PInProgress && pair.local->addr.addr == locCand.info->addr.addr
-                            && pair.local->addr.port == locCand.info->addr.port)
-                            pair.pool->writeIncomingMessage(msg);
-                    }
-                } else {
-                    // iceDebug("received some non-stun or invalid stun packet");
+                // iceDebug("received some non-stun or invalid stun packet");
 
-                    // FIXME: i don't know if this is good enough
-                    if (StunMessage::isProbablyStun(buf)) {
-                        iceDebug("unexpected stun packet (loopback?), skipping.");
-                        continue;
-                    }
+                // FIXME: i don't know if this is good enough
+                if (!msg.isNull()) {
+                    iceDebug("unexpected stun packet (loopback?), skipping.");
+                    continue;
+                }
 
-                    int at = -1;
-                    for (int n = 0; n < checkList.pairs.count(); ++n) {
-                        CandidatePair &pair = *checkList.pairs[n];
-                        if (pair.local->addr.addr == locCand.info->addr.addr
-                            && pair.local->addr.port == locCand.info->addr.port) {
-                            at = n;
-                            break;
-                        }
-                    }
-                    if (at == -1) {
-                        iceDebug("the local transport does not seem to be associated with a candidate?!");
-                        continue;
+                int at = -1;
+                for (int n = 0; n < checkList.pairs.count(); ++n) {
+                    CandidatePair &pair = *checkList.pairs[n];
+                    if (pair.local->addr.addr == locCand.info->addr.addr
+                        && pair.local->addr.port == locCand.info->addr.port) {
+                        at = n;
+                        break;
                     }
+                }
+                if (at == -1) {
+                    iceDebug("the local transport does not seem to be associated with a candidate?!");
+                    continue;
+                }
 
-                    int componentIndex = checkList.pairs[at]->local->componentId - 1;
-                    // iceDebug("packet is considered to be application data for component index %d", componentIndex);
+                int componentIndex = checkList.pairs[at]->local->componentId - 1;
+                // iceDebug("packet is considered to be application data for component index %d", componentIndex);
 
-                    // FIXME: this assumes components are ordered by id in our local arrays
-                    in[componentIndex] += buf;
-                    emit q->readyRead(componentIndex);
-                }
+                // FIXME: this assumes components are ordered by id in our local arrays
+                in[componentIndex] += buf;
+                emit q->readyRead(componentIndex);
             }
         }
     }
@@ -24,6 +24,7 @@
 #include "stunmessage.h"
 #include "stuntransaction.h"
 #include "turnclient.h"
+#include "udpbatch.h"
 
 #include <QHostAddress>
 #include <QUdpSocket>
@@ -39,6 +40,8 @@ enum { Direct, Relayed };
 // SafeUdpSocket
 //----------------------------------------------------------------------------
 // DOR-safe wrapper for QUdpSocket
+// where UdpBatch is supported, bursts of incoming datagrams are taken with one
+//   syscall and writes made in one event loop pass go out together
 class SafeUdpSocket : public QObject {
     Q_OBJECT
 
@@ -47,6 +50,10 @@ private:
     QUdpSocket   *sock;
     int           writtenCount;
 
+    std::unique_ptr<UdpBatch> batch;
+    QList<UdpBatch::Datagram> received; // taken from the socket but not read yet
+    QList<UdpBatch::Datagram> toSend;
+
 public:
     SafeUdpSocket(QUdpSocket *_sock, QObject *parent = nullptr) : QObject(parent), sess(this), sock(_sock)
     {
@@ -55,6 +62,8 @@ public:
         connect(sock, &QUdpSocket::bytesWritten, this, &SafeUdpSocket::sock_bytesWritten);
 
         writtenCount = 0;
+        if (UdpBatch::isSupported())
+            batch.reset(new UdpBatch(sock));
     }
 
     ~SafeUdpSocket()
@@ -67,6 +76,10 @@ public:
 
     QUdpSocket *release()
     {
+        flushWrites();
+        batch.reset();
+        received.clear();
+
         sock->disconnect(this);
         sock->setParent(nullptr);
         QUdpSocket *out = sock;
@@ -80,22 +93,43 @@ public:
 
     quint16 localPort() const { return sock->localPort(); }
 
-    bool hasPendingDatagrams() const { return sock->hasPendingDatagrams(); }
+    bool hasPendingDatagrams() const { return !received.isEmpty() || sock->hasPendingDatagrams(); }
 
     QByteArray readDatagram(TransportAddress &address)
     {
+        if (!received.isEmpty()) {
+            UdpBatch::Datagram dg = received.takeFirst();
+            address               = dg.addr;
+            return dg.buf;
+        }
+
         if (!sock->hasPendingDatagrams())
             return QByteArray();
 
+        // the first one goes through QUdpSocket, it re-arms the read notifier
         QByteArray buf;
         buf.resize(int(sock->pendingDatagramSize()));
         sock->readDatagram(buf.data(), buf.size(), &address.addr, &address.port);
+        if (batch) {
+            batch->receive(received);
+            if (buf.isEmpty() && !received.isEmpty()) // an empty buffer would stop the reader
+                return readDatagram(address);
+        }
         return buf;
     }
 
     void writeDatagram(const QByteArray &buf, const TransportAddress &address)
     {
-        sock->writeDatagram(buf, address.addr, address.port);
+        if (!batch) {
+            sock->writeDatagram(buf, address.addr, address.port);
+            return;
+        }
+
+        toSend += UdpBatch::Datagram { address, buf };
+        if (toSend.size() >= UdpBatch::Slots)
+            flushWrites();
+        else
+            sess.deferExclusive(this, "flushWrites");
     }
 
 signals:
@@ -113,6 +147,26 @@ private slots:
         sess.deferExclusive(this, "processWritten");
     }
 
+    void flushWrites()
+    {
+        if (toSend.isEmpty())
+            return;
+
+        int sent = 0;
+        int done = batch->send(toSend.constData(), int(toSend.size()), &sent);
+        // the socket buffer is full. let QUdpSocket deal with the rest like it always did
+        for (qsizetype n = done; n < toSend.size(); ++n)
+            sock->writeDatagram(toSend[n].buf, toSend[n].addr.addr, toSend[n].addr.port);
+        toSend.clear();
+
+        // QUdpSocket didn't see these, so no bytesWritten() for them. the dropped
+        //   ones aren't written, same as when QUdpSocket fails to write one
+        if (sent) {
+            writtenCount += sent;
+            sess.deferExclusive(this, "processWritten");
+        }
+    }
+
     void processWritten()
     {
         int count    = writtenCount;
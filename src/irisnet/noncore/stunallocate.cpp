@@ -1223,6 +1223,21 @@ QByteArray StunAllocate::decode(const StunMessage &encoded, TransportAddress &ad
     return data;
 }
 
+QByteArray StunAllocate::decode(const StunMessageView &encoded, TransportAddress &addr)
+{
+    TransportAddress paddr;
+
+    if (!encoded.xorAddress(StunTypes::XOR_PEER_ADDRESS, paddr))
+        return QByteArray();
+
+    StunMessageView::Attribute data = encoded.attribute(StunTypes::DATA);
+    if (data.isNull())
+        return QByteArray();
+
+    addr = paddr;
+    return QByteArray((const char *)data.data, data.size);
+}
+
 QString StunAllocate::errorString() const { return d->errorString; }
 
 bool StunAllocate::containsChannelData(const quint8 *data, int size) { return check_channelData(data, size) != -1; }
@@ -29,6 +29,7 @@ class QByteArray;
 
 namespace XMPP {
 class StunMessage;
+class StunMessageView;
 class StunTransactionPool;
 class TransportAddress;
 
@@ -73,6 +74,7 @@ public:
     QByteArray encode(const QByteArray &datagram, const TransportAddress &addr);
     QByteArray decode(const QByteArray &encoded, TransportAddress &addr);
     QByteArray decode(const StunMessage &encoded, TransportAddress &addr);
+    QByteArray decode(const StunMessageView &encoded, TransportAddress &addr);
 
     QString errorString() const;
 
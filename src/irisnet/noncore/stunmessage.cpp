@@ -19,6 +19,7 @@
 #include "stunmessage.h"
 
 #include "stunutil.h"
+#include "transportaddress.h"
 
 #include <QSharedData>
 #include <QtCrypto>
@@ -97,26 +98,25 @@ static quint8 magic_cookie[4] = { 0x21, 0x12, 0xA4, 0x42 };
 
 // do 3-field check of stun packet
 // returns length of packet not counting the header, or -1 on error
-static int check_and_get_length(const QByteArray &buf)
+static int check_and_get_length(const quint8 *p, int size)
 {
     // stun packets are at least 20 bytes
-    if (buf.size() < 20)
+    if (size < 20)
         return -1;
 
     // minimal 3-field check
 
-    if (buf[0] < 0 || buf[0] > 3) // rfc7983 p.7
+    if (p[0] > 3) // rfc7983 p.7
         return -1;
 
-    const quint8 *p    = (const quint8 *)buf.data();
-    quint16       mlen = read16(p + 2);
+    quint16 mlen = read16(p + 2);
 
     // bottom 2 bits of message length field must be 0
     if (mlen & 0x03)
         return -1;
 
     // (also, the message length should be a reasonable size)
-    if (mlen + 20 > buf.size())
+    if (mlen + 20 > size)
         return -1;
 
     // magic cookie must be set
@@ -145,19 +145,18 @@ static quint16 round_up_length(quint16 in)
     return out;
 }
 
-// buf    = entire stun packet
+// p      = entire stun packet
+// size   = size of the packet
 // offset = byte index of current attribute (first is offset=20)
 // type   = take attribute type
 // len    = take attribute value length (value is at offset + 4)
 // returns offset of next attribute, -1 if no more
-static int get_attribute_props(const QByteArray &buf, int offset, quint16 *type, int *len)
+static int get_attribute_props(const quint8 *p, int size, int offset, quint16 *type, int *len)
 {
     Q_ASSERT(offset >= ATTRIBUTE_AREA_START);
 
-    const quint8 *p = (const quint8 *)buf.data();
-
     // need at least 4 bytes for an attribute
-    if (offset + 4 > buf.size())
+    if (offset + 4 > size)
         return -1;
 
     quint16 _type = read16(p + offset);
@@ -165,10 +164,14 @@ static int get_attribute_props(const QByteArray &buf, int offset, quint16 *type,
     quint16 _alen = read16(p + offset);
     offset += 2;
 
+    // can't fit in the attribute area anyway
+    if (_alen > ATTRIBUTE_VALUE_MAX)
+        return -1;
+
     // get physical length.  stun attributes are 4-byte aligned, and may
     //   contain 0-3 bytes of padding.
     quint16 plen = round_up_length(_alen);
-    if (offset + plen > buf.size())
+    if (offset + plen > size)
         return -1;
 
     *type = _type;
@@ -176,12 +179,13 @@ static int get_attribute_props(const QByteArray &buf, int offset, quint16 *type,
     return offset + plen;
 }
 
-// buf    = entire stun packet
+// p      = entire stun packet
+// size   = size of the packet
 // type   = attribute type to find
 // len    = take attribute value length (value is at offset + 4)
 // next   = take offset of next attribute
 // returns offset of found attribute, -1 if not found
-static int find_attribute(const QByteArray &buf, quint16 type, int *len, int *next = nullptr)
+static int find_attribute(const quint8 *p, int size, quint16 type, int *len, int *next = nullptr)
 {
     int     at = ATTRIBUTE_AREA_START;
     quint16 _type;
@@ -189,7 +193,7 @@ static int find_attribute(const QByteArray &buf, quint16 type, int *len, int *ne
     int     _next;
 
     while (1) {
-        _next = get_attribute_props(buf, at, &_type, &_len);
+        _next = get_attribute_props(p, size, at, &_type, &_len);
         if (_next == -1)
             break;
         if (_type == type) {
@@ -250,66 +254,38 @@ static QByteArray message_integrity_calc(const quint8 *buf, int size, const QByt
     return result;
 }
 
-// look for fingerprint attribute and confirm it
-// buf = entire stun packet
-// returns true if fingerprint attribute exists and is correct
-static bool fingerprint_check(const QByteArray &buf)
+static StunMessage::Class class_from_header(const quint8 *p)
 {
-    int at, len;
-    at = find_attribute(buf, AttribFingerprint, &len);
-    if (at == -1 || len != 4) // value must be 4 bytes
-        return false;
-
-    const quint8 *p      = (const quint8 *)buf.data();
-    quint32       fpval  = read32(p + at + 4);
-    quint32       fpcalc = fingerprint_calc(p, at);
-    return fpval == fpcalc;
-}
-
-// copy the input buffer and prepare for message integrity checking.  the
-//   packet is truncated after the message-integrity attribute (since nothing
-//   after it is protected), and the packet length is adjusted in the header
-//   accordingly.
-// buf    = input stun packet
-// out    = take output stun packet
-// offset = take offset of message-integrity attribute
-// returns true if message-integrity attribute exists and packet is prepared
-// note: message-integrity value is at offset + 4 and is exactly 20 bytes
-static bool message_integrity_prep(const QByteArray &buf, QByteArray *out, int *offset)
-{
-    int at, len, next;
-    at = find_attribute(buf, AttribMessageIntegrity, &len, &next);
-    if (at == -1 || len != 20) // value must be 20 bytes
-        return false;
-
-    // prepare new attribute area size
-    int i = next - ATTRIBUTE_AREA_START;
-
-    // new value must be divisible by 4
-    if (i % 4 != 0)
-        return false;
-
-    // copy truncated packet
-    *out = buf.mid(0, next);
+    // class bits are split into 2 sections
+    quint8 c1, c2;
+    c1 = quint8(p[0] & 0x01); // C1
+    c1 <<= 1;
+    c2 = quint8(p[1] & 0x10); // C0
+    c2 >>= 4;
 
-    // set new length in header
-    quint16 newlen = (quint16)i;
-    write16((quint8 *)out->data() + 2, newlen);
+    quint8 classbits = c1 | c2;
 
-    *offset = at;
-    return true;
+    if (classbits == 0) // 00
+        return StunMessage::Request;
+    else if (classbits == 1) // 01
+        return StunMessage::Indication;
+    else if (classbits == 2) // 10
+        return StunMessage::SuccessResponse;
+    else // 11
+        return StunMessage::ErrorResponse;
 }
 
-// confirm message integrity
-// buf    = prepared stun packet (from message_integrity_prep())
-// offset = offset of message-integrity attribute
-// key    = the HMAC key
-// returns true if correct
-static bool message_integrity_check(const QByteArray &buf, int offset, const QByteArray &key)
+static quint16 method_from_header(const quint8 *p)
 {
-    QByteArray mival  = QByteArray::fromRawData(buf.data() + offset + 4, 20);
-    QByteArray micalc = message_integrity_calc((const quint8 *)buf.data(), offset, key);
-    return mival == micalc;
+    // method bits are split into 3 sections
+    quint16 m1, m2, m3;
+    m1 = quint16(p[0] & 0x3e); // M7-11
+    m1 <<= 6;
+    m2 = quint16(p[1] & 0xe0); // M4-6
+    m2 >>= 1;
+    m3 = quint16(p[1] & 0x0f); // M0-3
+
+    return m1 | m2 | m3;
 }
 
 class StunMessage::Private : public QSharedData {
@@ -518,143 +494,198 @@ QByteArray StunMessage::toBinary(int validationFlags, const QByteArray &key) con
 StunMessage StunMessage::fromBinary(const QByteArray &a, ConvertResult *result, int validationFlags,
                                     const QByteArray &key)
 {
-    int mlen = check_and_get_length(a);
-    if (mlen == -1) {
+    StunMessageView view(a);
+    if (view.isNull()) {
         if (result)
             *result = ErrorFormat;
         return StunMessage();
     }
 
     if (validationFlags & Fingerprint) {
-        if (!fingerprint_check(a)) {
+        if (!view.checkFingerprint()) {
             if (result)
                 *result = ErrorFingerprint;
             return StunMessage();
         }
     }
 
-    QByteArray in;
-
     if (validationFlags & MessageIntegrity) {
-        int offset;
-        if (!message_integrity_prep(a, &in, &offset)) {
+        if (!view.checkMessageIntegrity(key)) {
             if (result)
                 *result = ErrorMessageIntegrity;
             return StunMessage();
         }
-
-        if (!message_integrity_check(in, offset, key)) {
-            if (result)
-                *result = ErrorMessageIntegrity;
-            return StunMessage();
-        }
-    } else
-        in = a;
+    }
 
     // all validating complete, now just parse the packet
+    if (result)
+        *result = ConvertGood;
+    return view.toMessage(validationFlags & MessageIntegrity);
+}
 
-    const quint8 *p = (const quint8 *)in.data();
+bool StunMessage::isProbablyStun(const QByteArray &a)
+{
+    return check_and_get_length((const quint8 *)a.constData(), int(a.size())) != -1;
+}
 
-    // method bits are split into 3 sections
-    quint16 m1, m2, m3;
-    m1 = quint16(p[0] & 0x3e); // M7-11
-    m1 <<= 6;
-    m2 = quint16(p[1] & 0xe0); // M4-6
-    m2 >>= 1;
-    m3 = quint16(p[1] & 0x0f); // M0-3
+StunMessage::Class StunMessage::extractClass(const QByteArray &in)
+{
+    return class_from_header((const quint8 *)in.data());
+}
 
-    // class bits are split into 2 sections
-    quint8 c1, c2;
-    c1 = quint8(p[0] & 0x01); // C1
-    c1 <<= 1;
-    c2 = quint8(p[1] & 0x10); // C0
-    c2 >>= 4;
+bool StunMessage::containsStun(const quint8 *data, int size)
+{
+    // check_and_get_length does a full packet check so it works even on a stream
+    return check_and_get_length(data, size) != -1;
+}
 
-    quint16 method    = m1 | m2 | m3;
-    quint8  classbits = c1 | c2;
+QByteArray StunMessage::readStun(const quint8 *data, int size)
+{
+    int mlen = check_and_get_length(data, size);
+    if (mlen != -1)
+        return QByteArray((const char *)data, mlen + 20);
+    else
+        return QByteArray();
+}
 
-    Class mclass;
-    if (classbits == 0) // 00
-        mclass = Request;
-    else if (classbits == 1) // 01
-        mclass = Indication;
-    else if (classbits == 2) // 10
-        mclass = SuccessResponse;
-    else // 11
-        mclass = ErrorResponse;
+void StunMessageView::AttributeIterator::load(int offset)
+{
+    offset_ = -1;
+    if (offset == -1)
+        return;
+
+    int len;
+    int next = get_attribute_props(packet_, size_, offset, &attr_.type, &len);
+    if (next == -1)
+        return;
+
+    attr_.data = packet_ + offset + 4;
+    attr_.size = len;
+    offset_    = offset;
+    next_      = next;
+}
 
-    StunMessage out;
-    out.setClass(mclass);
-    out.setMethod(method);
-    out.setMagic(p + 4);
-    out.setId(p + 8);
+StunMessageView::StunMessageView(const QByteArray &packet) :
+    StunMessageView((const quint8 *)packet.constData(), int(packet.size()))
+{
+}
 
-    QList<Attribute> list;
-    int              at = ATTRIBUTE_AREA_START;
-    while (1) {
-        quint16 type;
-        int     len;
-        int     next;
+StunMessageView::StunMessageView(const quint8 *data, int size)
+{
+    int mlen = check_and_get_length(data, size);
+    if (mlen != -1) {
+        data_ = data;
+        size_ = ATTRIBUTE_AREA_START + mlen;
+    }
+}
 
-        next = get_attribute_props(in, at, &type, &len);
-        if (next == -1)
-            break;
+StunMessage::Class StunMessageView::mclass() const
+{
+    Q_ASSERT(data_);
+    return class_from_header(data_);
+}
 
-        Attribute attrib;
-        attrib.type  = type;
-        attrib.value = in.mid(at + 4, len);
-        list += attrib;
+quint16 StunMessageView::method() const
+{
+    Q_ASSERT(data_);
+    return method_from_header(data_);
+}
 
-        at = next;
+StunMessageView::Attribute StunMessageView::attribute(quint16 type) const
+{
+    for (const Attribute &a : *this) {
+        if (a.type == type)
+            return a;
     }
-    out.setAttributes(list);
-
-    if (result)
-        *result = ConvertGood;
-    return out;
+    return Attribute();
 }
 
-bool StunMessage::isProbablyStun(const QByteArray &a) { return check_and_get_length(a) != -1; }
+bool StunMessageView::hasAttribute(quint16 type) const { return !attribute(type).isNull(); }
 
-StunMessage::Class StunMessage::extractClass(const QByteArray &in)
+bool StunMessageView::xorAddress(quint16 type, TransportAddress &addr) const
 {
-    const quint8 *p = (const quint8 *)in.data();
+    Attribute a = attribute(type);
+    if (a.size < 4)
+        return false;
 
-    // class bits are split into 2 sections
-    quint8 c1, c2;
-    c1 = quint8(p[0] & 0x01); // C1
-    c1 <<= 1;
-    c2 = quint8(p[1] & 0x10); // C0
-    c2 >>= 4;
+    const quint8 *v     = a.data;
+    const quint8 *magic = data_ + 4;
+    const quint8 *id    = data_ + 8;
+    if (v[1] == 0x01 && a.size == 8) { // IPv4
+        addr.addr = QHostAddress(read32(v + 4) ^ read32(magic));
+    } else if (v[1] == 0x02 && a.size == 20) { // IPv6
+        Q_IPV6ADDR ip;
+        for (int n = 0; n < 4; ++n)
+            ip[n] = v[n + 4] ^ magic[n];
+        for (int n = 0; n < 12; ++n)
+            ip[n + 4] = v[n + 8] ^ id[n];
+        addr.addr = QHostAddress(ip);
+    } else
+        return false;
 
-    quint8 classbits = c1 | c2;
+    addr.port = read16(v + 2) ^ read16(magic);
+    return true;
+}
 
-    Class mclass;
-    if (classbits == 0) // 00
-        mclass = Request;
-    else if (classbits == 1) // 01
-        mclass = Indication;
-    else if (classbits == 2) // 10
-        mclass = SuccessResponse;
-    else // 11
-        mclass = ErrorResponse;
+bool StunMessageView::checkFingerprint() const
+{
+    if (!data_)
+        return false;
 
-    return mclass;
+    int len;
+    int at = find_attribute(data_, size_, AttribFingerprint, &len);
+    if (at == -1 || len != 4) // value must be 4 bytes
+        return false;
+
+    return read32(data_ + at + 4) == fingerprint_calc(data_, at);
 }
 
-bool StunMessage::containsStun(const quint8 *data, int size)
+bool StunMessageView::checkMessageIntegrity(const QByteArray &key) const
 {
-    // check_and_get_length does a full packet check so it works even on a stream
-    return check_and_get_length(QByteArray::fromRawData((const char *)data, size)) != -1;
+    if (!data_)
+        return false;
+
+    int len, next;
+    int at = find_attribute(data_, size_, AttribMessageIntegrity, &len, &next);
+    if (at == -1 || len != 20) // value must be 20 bytes
+        return false;
+
+    // the hmac covers everything up to the attribute, with the length in
+    //   the header set as if message-integrity was the last attribute.
+    //   feed it in pieces instead of making a truncated copy of the packet
+    quint8 header[4];
+    memcpy(header, data_, 2);
+    write16(header + 2, quint16(next - ATTRIBUTE_AREA_START));
+
+    QCA::MessageAuthenticationCode hmac("hmac(sha1)", key);
+    hmac.update(QByteArray::fromRawData((const char *)header, 4));
+    hmac.update(QByteArray::fromRawData((const char *)data_ + 4, at - 4));
+    QByteArray micalc = hmac.final().toByteArray();
+    return micalc.size() == 20 && memcmp(micalc.constData(), data_ + at + 4, 20) == 0;
 }
 
-QByteArray StunMessage::readStun(const quint8 *data, int size)
+StunMessage StunMessageView::toMessage(bool integrityProtectedOnly) const
 {
-    QByteArray in   = QByteArray::fromRawData((const char *)data, size);
-    int        mlen = check_and_get_length(in);
-    if (mlen != -1)
-        return QByteArray((const char *)data, mlen + 20);
-    else
-        return QByteArray();
+    if (!data_)
+        return StunMessage();
+
+    StunMessage out;
+    out.setClass(mclass());
+    out.setMethod(method());
+    out.setMagic(magic());
+    out.setId(id());
+
+    QList<StunMessage::Attribute> list;
+    for (const Attribute &a : *this) {
+        StunMessage::Attribute attrib;
+        attrib.type  = a.type;
+        attrib.value = QByteArray((const char *)a.data, a.size);
+        list += attrib;
+
+        if (integrityProtectedOnly && a.type == AttribMessageIntegrity)
+            break;
+    }
+    out.setAttributes(list);
+    return out;
 }
 } // namespace XMPP
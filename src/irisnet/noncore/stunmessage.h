@@ -24,6 +24,8 @@
 #include <QSharedDataPointer>
 
 namespace XMPP {
+class TransportAddress;
+
 class StunMessage {
 public:
     enum Class { Request, SuccessResponse, ErrorResponse, Indication };
@@ -88,6 +90,82 @@ private:
     class Private;
     QSharedDataPointer<Private> d;
 };
+
+// Read-only view of a received stun packet.  Nothing is copied: the header,
+//   the attributes and the validation work on the packet memory directly, so
+//   the packet must outlive the view.  Use toMessage() to keep the message.
+class StunMessageView {
+public:
+    class Attribute {
+    public:
+        quint16       type = 0;
+        const quint8 *data = nullptr;
+        int           size = 0;
+
+        bool isNull() const { return data == nullptr; }
+
+        // shares the packet memory
+        QByteArray value() const { return data ? QByteArray::fromRawData((const char *)data, size) : QByteArray(); }
+    };
+
+    class AttributeIterator {
+    public:
+        const Attribute   &operator*() const { return attr_; }
+        const Attribute   *operator->() const { return &attr_; }
+        AttributeIterator &operator++()
+        {
+            load(next_);
+            return *this;
+        }
+        bool operator==(const AttributeIterator &other) const { return offset_ == other.offset_; }
+        bool operator!=(const AttributeIterator &other) const { return offset_ != other.offset_; }
+
+    private:
+        friend class StunMessageView;
+        AttributeIterator(const quint8 *packet, int size, int offset) : packet_(packet), size_(size) { load(offset); }
+        void load(int offset);
+
+        const quint8 *packet_;
+        int           size_;
+        int           offset_ = -1; // -1 is the end
+        int           next_   = -1;
+        Attribute     attr_;
+    };
+
+    StunMessageView() = default;
+    // null if 'packet' doesn't pass the 3-field check
+    explicit StunMessageView(const QByteArray &packet);
+    StunMessageView(const quint8 *data, int size);
+    StunMessageView(QByteArray &&) = delete; // would dangle
+
+    bool               isNull() const { return data_ == nullptr; }
+    StunMessage::Class mclass() const;
+    quint16            method() const;
+    const quint8      *magic() const { return data_ + 4; } // 4 bytes
+    const quint8      *id() const { return data_ + 8; }    // 12 bytes
+
+    AttributeIterator begin() const { return AttributeIterator(data_, size_, data_ ? 20 : -1); }
+    AttributeIterator end() const { return AttributeIterator(data_, size_, -1); }
+
+    // returns the first instance or null
+    Attribute attribute(quint16 type) const;
+    bool      hasAttribute(quint16 type) const;
+
+    // decodes an XOR-MAPPED-ADDRESS, XOR-PEER-ADDRESS or XOR-RELAYED-ADDRESS attribute
+    bool xorAddress(quint16 type, TransportAddress &addr) const;
+
+    // true if the attribute exists and is correct
+    bool checkFingerprint() const;
+    bool checkMessageIntegrity(const QByteArray &key) const;
+
+    // deep copy.  with 'integrityProtectedOnly' attributes following
+    //   MESSAGE-INTEGRITY (not covered by it) are left out
+    StunMessage toMessage(bool integrityProtectedOnly = false) const;
+
+private:
+    const quint8 *data_ = nullptr;
+    int           size_ = 0; // header + attribute area, as declared in the header
+};
 } // namespace XMPP
 
 #endif // STUNMESSAGE_H
@@ -35,55 +35,22 @@
 Q_DECLARE_METATYPE(XMPP::StunTransaction::Error)
 
 namespace XMPP {
-// parse a stun message, optionally performing validity checks.  the
-//   StunMessage class itself provides parsing with validity or parsing
-//   without validity, but it does not provide a way to do both together,
-//   so we attempt to do that here.
-// TODO: consider moving this code into StunMessage
+// parse a stun message, performing the validity checks it is able to pass.
+//   the checks run on the raw packet and the packet is parsed only once
 static StunMessage parse_stun_message(const QByteArray &packet, int *validationFlags, const QByteArray &key)
 {
-    // ideally we shouldn't fully parse the packet more than once.  the
-    //   integrity checks performed by fromBinary do not require fully
-    //   parsing the packet, so we should be able to avoid most redundant
-    //   processing.  fromBinary checks the fingerprint first, and we
-    //   can use that knowledge to avoid duplicating integrity checks.
-    int                        flags = 0;
-    StunMessage::ConvertResult result;
-    StunMessage                msg
-        = StunMessage::fromBinary(packet, &result, StunMessage::MessageIntegrity | StunMessage::Fingerprint, key);
-    if (result == StunMessage::ErrorFingerprint) {
-        // if fingerprint fails, then it is the only thing that was
-        //   performed and we can skip it now.
-        msg = StunMessage::fromBinary(packet, &result, StunMessage::MessageIntegrity, key);
-        if (result == StunMessage::ErrorMessageIntegrity) {
-            // if message-integrity fails, then it is the only
-            //   thing that was performed and we can skip it now
-            msg = StunMessage::fromBinary(packet, &result);
-            if (result == StunMessage::ConvertGood)
-                flags = 0;
-            else
-                return msg; // null
-        } else if (result == StunMessage::ConvertGood)
-            flags = StunMessage::MessageIntegrity;
-        else
-            return msg; // null
-    } else if (result == StunMessage::ErrorMessageIntegrity) {
-        // fingerprint succeeded, but message-integrity failed.  parse
-        //   without validation now (to skip redundant
-        //   fingerprint/message-integrity checks), and assume correct
-        //   fingerprint
-        msg = StunMessage::fromBinary(packet, &result);
-        if (result == StunMessage::ConvertGood)
-            flags = StunMessage::Fingerprint;
-        else
-            return msg; // null
-    } else if (result == StunMessage::ConvertGood)
-        flags = StunMessage::MessageIntegrity | StunMessage::Fingerprint;
-    else
-        return msg; // null
+    StunMessageView view(packet);
+    if (view.isNull())
+        return StunMessage();
+
+    int flags = 0;
+    if (view.checkFingerprint())
+        flags |= StunMessage::Fingerprint;
+    if (view.checkMessageIntegrity(key))
+        flags |= StunMessage::MessageIntegrity;
 
     *validationFlags = flags;
-    return msg;
+    return view.toMessage(flags & StunMessage::MessageIntegrity);
 }
 
 class StunTransactionPoolPrivate : public QObject {
@@ -563,7 +530,8 @@ bool StunTransactionPool::writeIncomingMessage(const StunMessage &msg, const Tra
 
 bool StunTransactionPool::writeIncomingMessage(const QByteArray &packet, bool *notStun, const TransportAddress &addr)
 {
-    if (!StunMessage::isProbablyStun(packet)) {
+    StunMessageView view(packet);
+    if (view.isNull()) {
         // basic stun check failed?  surely not STUN
         if (notStun)
             *notStun = true;
@@ -571,19 +539,18 @@ bool StunTransactionPool::writeIncomingMessage(const QByteArray &packet, bool *n
     }
 
     if (d->debugLevel >= DL_Packet) {
-        StunMessage msg = StunMessage::fromBinary(packet);
-        QString     str = "STUN RECV";
+        QString str = "STUN RECV";
         if (addr.isValid())
             str += QString(" from=(%1)").arg(addr);
         emit debugLine(str);
-        emit debugLine(StunTypes::print_packet_str(msg));
+        emit debugLine(StunTypes::print_packet_str(view.toMessage()));
     }
 
-    // isProbablyStun ensures the packet is 20 bytes long, so we can safely
-    //   safely extract out the transaction id from the raw packet
-    QByteArray id = QByteArray((const char *)packet.data() + 8, 12);
+    // a non-null view ensures the packet is 20 bytes long, so we can safely
+    //   look up the transaction id right in the raw packet
+    QByteArray id = QByteArray::fromRawData((const char *)view.id(), 12);
 
-    StunMessage::Class mclass = StunMessage::extractClass(packet);
+    StunMessage::Class mclass = view.mclass();
 
     if (mclass != StunMessage::SuccessResponse && mclass != StunMessage::ErrorResponse) {
         // could be STUN, don't really know for sure
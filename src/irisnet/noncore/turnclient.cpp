@@ -357,7 +357,7 @@ public:
         } else {
             // packet might be stun not owned by pool.
             //   let's see
-            StunMessage message = StunMessage::fromBinary(buf);
+            StunMessageView message(buf);
             if (!message.isNull()) {
                 QByteArray data = allocate->decode(message, addr);
 
@@ -0,0 +1,246 @@
+/*
+ * udpbatch.cpp - datagram bursts with one syscall
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "udpbatch.h"
+
+#include <QNetworkInterface>
+#include <QUdpSocket>
+
+#ifdef Q_OS_LINUX
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace XMPP {
+
+#ifdef Q_OS_LINUX
+class UdpBatch::Private {
+public:
+    QUdpSocket *sock;
+    int         family = AF_UNSPEC; // of the socket, looked up on first send
+
+    // receive side. the kernel writes straight into the slab. it's 2 MiB, but
+    //   left uninitialized, so small datagrams only commit a page per slot
+    std::unique_ptr<char[]> slab;
+    mmsghdr                 recvMsgs[Slots];
+    iovec                   recvIov[Slots];
+    sockaddr_storage        recvAddrs[Slots];
+
+    // send side. the iovecs point into the caller's buffers
+    mmsghdr          sendMsgs[Slots];
+    iovec            sendIov[Slots];
+    sockaddr_storage sendAddrs[Slots];
+
+    Private(QUdpSocket *_sock) : sock(_sock), slab(new char[Slots * SlotSize])
+    {
+        std::memset(recvMsgs, 0, sizeof(recvMsgs));
+        for (int n = 0; n < Slots; ++n) {
+            recvIov[n].iov_base            = slab.get() + n * SlotSize;
+            recvIov[n].iov_len             = SlotSize;
+            recvMsgs[n].msg_hdr.msg_iov    = &recvIov[n];
+            recvMsgs[n].msg_hdr.msg_iovlen = 1;
+            recvMsgs[n].msg_hdr.msg_name   = &recvAddrs[n];
+        }
+    }
+
+    // same conversion QNativeSocketEngine does, so addresses compare equal to
+    //   the ones QUdpSocket reports
+    static TransportAddress fromSockaddr(const sockaddr_storage &ss)
+    {
+        TransportAddress ta;
+        if (ss.ss_family == AF_INET) {
+            auto sa = reinterpret_cast<const sockaddr_in *>(&ss);
+            ta.addr.setAddress(ntohl(sa->sin_addr.s_addr));
+            ta.port = ntohs(sa->sin_port);
+        } else if (ss.ss_family == AF_INET6) {
+            auto sa = reinterpret_cast<const sockaddr_in6 *>(&ss);
+            ta.addr.setAddress(sa->sin6_addr.s6_addr);
+            if (sa->sin6_scope_id) {
+                QString scopeId = QNetworkInterface::interfaceNameFromIndex(int(sa->sin6_scope_id));
+                if (scopeId.isEmpty())
+                    scopeId = QString::number(sa->sin6_scope_id);
+                ta.addr.setScopeId(scopeId);
+            }
+            ta.port = ntohs(sa->sin6_port);
+        }
+        return ta;
+    }
+
+    // returns 0 if the address can't be reached from our socket
+    socklen_t toSockaddr(const TransportAddress &ta, sockaddr_storage *ss)
+    {
+        if (family == AF_UNSPEC) {
+            sockaddr_storage local;
+            socklen_t        len = sizeof(local);
+            if (::getsockname(int(sock->socketDescriptor()), reinterpret_cast<sockaddr *>(&local), &len) != 0)
+                return 0;
+            family = local.ss_family;
+        }
+
+        std::memset(ss, 0, sizeof(*ss));
+        if (family == AF_INET) {
+            bool    ok;
+            quint32 ip4 = ta.addr.toIPv4Address(&ok);
+            if (!ok)
+                return 0;
+            auto sa             = reinterpret_cast<sockaddr_in *>(ss);
+            sa->sin_family      = AF_INET;
+            sa->sin_port        = htons(ta.port);
+            sa->sin_addr.s_addr = htonl(ip4);
+            return sizeof(sockaddr_in);
+        }
+        if (family == AF_INET6) {
+            if (ta.addr.isNull())
+                return 0;
+            // v4 addresses come out mapped, as dual-stack sockets want them
+            Q_IPV6ADDR ip6  = ta.addr.toIPv6Address();
+            auto       sa   = reinterpret_cast<sockaddr_in6 *>(ss);
+            sa->sin6_family = AF_INET6;
+            sa->sin6_port   = htons(ta.port);
+            std::memcpy(sa->sin6_addr.s6_addr, &ip6, sizeof(ip6));
+            QString scopeId = ta.addr.scopeId();
+            if (!scopeId.isEmpty()) {
+                int index         = QNetworkInterface::interfaceIndexFromName(scopeId);
+                sa->sin6_scope_id = index > 0 ? uint(index) : scopeId.toUInt();
+            }
+            return sizeof(sockaddr_in6);
+        }
+        return 0;
+    }
+};
+
+UdpBatch::UdpBatch(QUdpSocket *sock) : d(new Private(sock)) { }
+
+UdpBatch::~UdpBatch() = default;
+
+bool UdpBatch::isSupported() { return true; }
+
+int UdpBatch::receive(QList<Datagram> &out)
+{
+    for (int n = 0; n < Slots; ++n) {
+        d->recvMsgs[n].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        d->recvMsgs[n].msg_hdr.msg_flags   = 0;
+    }
+
+    int fd = int(d->sock->socketDescriptor());
+    int ret;
+    do {
+        ret = ::recvmmsg(fd, d->recvMsgs, Slots, MSG_DONTWAIT, nullptr);
+    } while (ret < 0 && errno == EINTR);
+    if (ret <= 0)
+        return 0;
+
+    int taken = 0;
+    for (int n = 0; n < ret; ++n) {
+        const msghdr &h = d->recvMsgs[n].msg_hdr;
+        if (h.msg_flags & MSG_TRUNC) {
+            qDebug("UdpBatch: dropping datagram larger than %d bytes", int(SlotSize)); // jumbograms only
+            continue;
+        }
+        // empty datagrams carry nothing and readers take an empty buffer for "no more"
+        if (d->recvMsgs[n].msg_len == 0)
+            continue;
+
+        Datagram dg;
+        dg.addr = Private::fromSockaddr(d->recvAddrs[n]);
+        dg.buf  = QByteArray(d->slab.get() + n * SlotSize, int(d->recvMsgs[n].msg_len));
+        out += dg;
+        ++taken;
+    }
+    return taken;
+}
+
+int UdpBatch::send(const Datagram *items, int count, int *sent)
+{
+    int fd       = int(d->sock->socketDescriptor());
+    int done     = 0;
+    int accepted = 0;
+    while (done < count) {
+        int n = 0;
+        for (; n < Slots && done + n < count; ++n) {
+            const Datagram &dg  = items[done + n];
+            socklen_t       len = d->toSockaddr(dg.addr, &d->sendAddrs[n]);
+            if (!len)
+                break;
+
+            d->sendIov[n].iov_base = const_cast<char *>(dg.buf.constData());
+            d->sendIov[n].iov_len  = size_t(dg.buf.size());
+
+            msghdr &h = d->sendMsgs[n].msg_hdr;
+            std::memset(&h, 0, sizeof(h));
+            h.msg_name    = &d->sendAddrs[n];
+            h.msg_namelen = len;
+            h.msg_iov     = &d->sendIov[n];
+            h.msg_iovlen  = 1;
+        }
+        if (n == 0) {
+            // unreachable with this socket
+            ++done;
+            continue;
+        }
+
+        int ret = ::sendmmsg(fd, d->sendMsgs, uint(n), MSG_DONTWAIT);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+                break;
+            // this one will never go (EMSGSIZE, EACCES..), but the next ones may
+            ++done;
+            continue;
+        }
+        done += ret;
+        accepted += ret;
+    }
+    if (sent)
+        *sent = accepted;
+    return done;
+}
+
+#else
+
+class UdpBatch::Private { };
+
+UdpBatch::UdpBatch(QUdpSocket *sock) { Q_UNUSED(sock); }
+
+UdpBatch::~UdpBatch() = default;
+
+bool UdpBatch::isSupported() { return false; }
+
+int UdpBatch::receive(QList<Datagram> &out)
+{
+    Q_UNUSED(out);
+    return 0;
+}
+
+int UdpBatch::send(const Datagram *items, int count, int *sent)
+{
+    Q_UNUSED(items);
+    Q_UNUSED(count);
+    if (sent)
+        *sent = 0;
+    return 0;
+}
+
+#endif
+
+} // namespace XMPP
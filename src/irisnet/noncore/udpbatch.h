@@ -0,0 +1,75 @@
+/*
+ * udpbatch.h - datagram bursts with one syscall
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef UDPBATCH_H
+#define UDPBATCH_H
+
+#include "transportaddress.h"
+
+#include <QByteArray>
+#include <QList>
+
+#include <memory>
+
+class QUdpSocket;
+
+namespace XMPP {
+// reads and writes bursts of datagrams of a bound QUdpSocket with a single
+//   recvmmsg()/sendmmsg() call, going around QUdpSocket which does a few
+//   syscalls per datagram.  the receive buffers are allocated once.
+// this is Linux only. elsewhere isSupported() is false, receive() and send()
+//   do nothing and the socket should be used as usual.
+// note: QUdpSocket won't re-arm its read notifier unless a datagram is read
+//   through it. read the first datagram of each readyRead() with QUdpSocket
+//   and the rest of the burst with receive().
+class UdpBatch {
+public:
+    enum {
+        Slots    = 32,   // datagrams per syscall
+        SlotSize = 65536 // any UDP payload fits. only the pages written to get memory
+    };
+
+    class Datagram {
+    public:
+        TransportAddress addr;
+        QByteArray       buf;
+    };
+
+    explicit UdpBatch(QUdpSocket *sock);
+    ~UdpBatch();
+
+    static bool isSupported();
+
+    // appends the datagrams waiting in the socket to 'out', at most Slots of
+    //   them.  never blocks.  returns how many were appended
+    int receive(QList<Datagram> &out);
+
+    // returns how many datagrams from the start of 'items' are done with,
+    //   either sent or dropped because they can't ever be (bad address, too big).
+    //   less than 'count' means the socket buffer is full.  'sent', if given,
+    //   is set to how many of those the kernel took
+    int send(const Datagram *items, int count, int *sent = nullptr);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+} // namespace XMPP
+
+#endif // UDPBATCH_H
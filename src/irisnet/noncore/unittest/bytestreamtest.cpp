@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "irisnet/noncore/cutestuff/bytestream.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QRandomGenerator>
+#include <QtTest/QtTest>
+
+// Half of a pair of streams passing data to each other in fixed blocks,
+// the way IBBConnection does with takeWrite(blockSize).
+class LoopbackStream : public ByteStream {
+    Q_OBJECT
+public:
+    LoopbackStream(int blockSize) : blockSize(blockSize) { setOpenMode(QIODevice::ReadWrite); }
+
+    LoopbackStream *peer = nullptr;
+    int             blockSize;
+
+protected:
+    int tryWrite() override
+    {
+        int        written = 0;
+        QByteArray block;
+        while (!(block = takeWrite(blockSize)).isEmpty()) {
+            peer->appendRead(block);
+            written += int(block.size());
+        }
+        return written;
+    }
+};
+
+class ByteStreamTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testOrder()
+    {
+        LoopbackStream a(4096), b(4096);
+        a.peer = &b;
+        b.peer = &a;
+
+        QByteArray sent, received;
+        auto       rng = QRandomGenerator(42);
+        for (int i = 0; i < 2000; ++i) {
+            QByteArray chunk(rng.bounded(1, i % 10 ? 300 : 20000), Qt::Uninitialized);
+            for (auto &c : chunk)
+                c = char(rng.generate());
+            a.write(chunk);
+            sent += chunk;
+            if (i % 3 == 0)
+                received += b.read(rng.bounded(1, 10000));
+        }
+        received += b.readAll();
+        QCOMPARE(received, sent);
+        QCOMPARE(b.bytesAvailable(), qint64(0));
+        QCOMPARE(a.bytesToWrite(), qint64(0));
+    }
+
+    // 1 GiB written in 1 MiB pieces and drained in IBB blocks on both ends
+    void benchmarkIbbLoopback()
+    {
+        const qint64   total = qint64(1) << 30;
+        LoopbackStream a(4096), b(4096);
+        a.peer = &b;
+        b.peer = &a;
+
+        QByteArray chunk(1024 * 1024, 'x');
+        char       buf[4096];
+        qint64     received = 0;
+        QBENCHMARK_ONCE
+        {
+            for (qint64 sent = 0; sent < total; sent += chunk.size()) {
+                a.write(chunk);
+                qint64 n;
+                while ((n = b.read(buf, sizeof(buf))) > 0)
+                    received += n;
+            }
+        }
+        QCOMPARE(received, total);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(ByteStreamTest);
+#include "bytestreamtest.moc"
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "irisnet/corelib/netnames.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static NameRecord addressRecord(const char *ip, int ttl)
+{
+    NameRecord r("xmpp.example.com.", ttl);
+    r.setAddress(QHostAddress(QString::fromLatin1(ip)));
+    return r;
+}
+
+static NameRecord srvRecord(const char *target, int port, int ttl)
+{
+    NameRecord r("_xmpp-client._tcp.example.com.", ttl);
+    r.setSrv(target, port, 10, 0);
+    return r;
+}
+
+class NameCacheTest : public QObject {
+    Q_OBJECT
+
+    NameCache *cache = NameCache::instance();
+
+private slots:
+    void initTestCase() { qRegisterMetaType<QList<XMPP::NameRecord>>("QList<XMPP::NameRecord>"); }
+
+    void init()
+    {
+        cache->setEnabled(true);
+        cache->clear();
+        cache->setTtlLimits(30, 24 * 3600);
+        cache->setStaleTime(3600);
+    }
+
+    void testTtl()
+    {
+        cache->insert("xmpp.example.com", NameRecord::A, { addressRecord("192.0.2.1", 300) });
+        bool stale  = true;
+        auto cached = cache->lookup("XMPP.example.com.", NameRecord::A, &stale);
+        QCOMPARE(cached.size(), 1);
+        QCOMPARE(cached[0].address(), QHostAddress("192.0.2.1"));
+        QVERIFY(cached[0].ttl() <= 300 && cached[0].ttl() >= 299);
+        QVERIFY(!stale);
+        QVERIFY(cache->lookup("xmpp.example.com", NameRecord::Aaaa).isEmpty());
+
+        // too short TTLs are raised to the minimum
+        cache->insert("short.example.com", NameRecord::A, { addressRecord("192.0.2.2", 1) });
+        QVERIFY(cache->lookup("short.example.com", NameRecord::A).at(0).ttl() >= 29);
+
+        // not cacheable
+        cache->insert("xmpp.example.com", NameRecord::Txt, { addressRecord("192.0.2.1", 300) });
+        QVERIFY(cache->lookup("xmpp.example.com", NameRecord::Txt).isEmpty());
+    }
+
+    void testStale()
+    {
+        cache->setTtlLimits(0, 0); // everything expires right away
+        cache->insert("xmpp.example.com", NameRecord::Aaaa, { addressRecord("2001:db8::1", 300) });
+        bool stale  = false;
+        auto cached = cache->lookup("xmpp.example.com", NameRecord::Aaaa, &stale);
+        QCOMPARE(cached.size(), 1);
+        QVERIFY(stale);
+        QCOMPARE(cached[0].ttl(), 0);
+
+        cache->setStaleTime(0);
+        QVERIFY(cache->lookup("xmpp.example.com", NameRecord::Aaaa).isEmpty());
+    }
+
+    void testResolverUsesCache()
+    {
+        cache->insert("_xmpp-client._tcp.example.com.", NameRecord::Srv, { srvRecord("xmpp.example.com", 5222, 300) });
+
+        NameResolver resolver;
+        QSignalSpy   spy(&resolver, &NameResolver::resultsReady);
+        resolver.start("_xmpp-client._tcp.example.com.", NameRecord::Srv);
+        QCOMPARE(spy.count(), 0); // asynchronous like a real lookup
+        QVERIFY(spy.wait(1000));
+        auto records = spy.at(0).at(0).value<QList<NameRecord>>();
+        QCOMPARE(records.size(), 1);
+        QCOMPARE(records[0].name(), QByteArray("xmpp.example.com"));
+        QCOMPARE(records[0].port(), 5222);
+
+        // stopped before delivery
+        resolver.start("_xmpp-client._tcp.example.com.", NameRecord::Srv);
+        resolver.stop();
+        QVERIFY(!spy.wait(100));
+    }
+
+    void testSnapshot()
+    {
+        QTemporaryDir dir;
+        QString       fileName = dir.filePath("dns.cache");
+
+        cache->insert("xmpp.example.com", NameRecord::A, { addressRecord("192.0.2.1", 300) });
+        cache->insert("_xmpp-client._tcp.example.com", NameRecord::Srv,
+                      { srvRecord("a.example.com", 5222, 600), srvRecord("b.example.com", 5223, 600) });
+        cache->setPreferred("example.com", { "b.example.com", 5223, QAbstractSocket::IPv4Protocol });
+        QVERIFY(cache->save(fileName));
+
+        cache->clear();
+        QVERIFY(cache->preferred("example.com").isNull());
+        QVERIFY(cache->load(fileName));
+
+        QCOMPARE(cache->lookup("xmpp.example.com", NameRecord::A).at(0).address(), QHostAddress("192.0.2.1"));
+        auto srv = cache->lookup("_xmpp-client._tcp.example.com", NameRecord::Srv);
+        QCOMPARE(srv.size(), 2);
+        QCOMPARE(srv[1].name(), QByteArray("b.example.com"));
+        QCOMPARE(srv[1].port(), 5223);
+        auto p = cache->preferred("Example.com.");
+        QCOMPARE(p.target, QString("b.example.com"));
+        QCOMPARE(p.port, quint16(5223));
+        QCOMPARE(p.protocol, QAbstractSocket::IPv4Protocol);
+
+        QFile f(fileName);
+        QVERIFY(f.open(QIODevice::ReadWrite));
+        f.resize(f.size() - 5);
+        f.close();
+        cache->clear();
+        QVERIFY(!cache->load(fileName));
+        QVERIFY(cache->lookup("xmpp.example.com", NameRecord::A).isEmpty());
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(NameCacheTest);
+#include "namecachetest.moc"
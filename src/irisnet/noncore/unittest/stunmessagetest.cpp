@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "irisnet/noncore/stunmessage.h"
+#include "irisnet/noncore/stuntypes.h"
+#include "irisnet/noncore/transportaddress.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+class StunMessageTest : public QObject {
+    Q_OBJECT
+
+    static QByteArray dataIndication(const TransportAddress &peer, const QByteArray &payload, int flags,
+                                     const QByteArray &key = QByteArray())
+    {
+        static const quint8 id[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+
+        StunMessage msg;
+        msg.setClass(StunMessage::Indication);
+        msg.setMethod(StunTypes::Data);
+        msg.setId(id);
+
+        QList<StunMessage::Attribute> list;
+        StunMessage::Attribute        a;
+        a.type  = StunTypes::XOR_PEER_ADDRESS;
+        a.value = StunTypes::createXorPeerAddress(peer, msg.magic(), msg.id());
+        list += a;
+        a.type  = StunTypes::DATA;
+        a.value = payload;
+        list += a;
+        msg.setAttributes(list);
+        return msg.toBinary(flags, key);
+    }
+
+private slots:
+    void testView()
+    {
+        TransportAddress peer(QHostAddress("192.0.2.7"), 40123);
+        QByteArray       packet = dataIndication(peer, "hello", StunMessage::Fingerprint);
+
+        StunMessageView view(packet);
+        QVERIFY(!view.isNull());
+        QCOMPARE(view.mclass(), StunMessage::Indication);
+        QCOMPARE(view.method(), quint16(StunTypes::Data));
+        QCOMPARE(view.id()[11], quint8(12));
+        QCOMPARE(view.attribute(StunTypes::DATA).value(), QByteArray("hello"));
+        QVERIFY(view.attribute(StunTypes::USERNAME).isNull());
+        QVERIFY(view.checkFingerprint());
+
+        QList<quint16> types;
+        for (const auto &a : view)
+            types += a.type;
+        QCOMPARE(types, QList<quint16>({ StunTypes::XOR_PEER_ADDRESS, StunTypes::DATA, StunTypes::FINGERPRINT }));
+
+        TransportAddress addr;
+        QVERIFY(view.xorAddress(StunTypes::XOR_PEER_ADDRESS, addr));
+        QCOMPARE(addr, peer);
+
+        TransportAddress peer6(QHostAddress("2001:db8::1"), 3478);
+        QByteArray       packet6 = dataIndication(peer6, "x", 0);
+        QVERIFY(StunMessageView(packet6).xorAddress(StunTypes::XOR_PEER_ADDRESS, addr));
+        QCOMPARE(addr, peer6);
+
+        packet[packet.size() - 1] = char(packet[packet.size() - 1] ^ 0x1);
+        QVERIFY(!StunMessageView(packet).checkFingerprint());
+        QByteArray rtp("\x80\x01 definitely rtp, not stun");
+        QVERIFY(StunMessageView(rtp).isNull());
+    }
+
+    void testMessageIntegrity()
+    {
+        TransportAddress peer(QHostAddress("192.0.2.7"), 40123);
+        QByteArray       packet
+            = dataIndication(peer, "hello", StunMessage::MessageIntegrity | StunMessage::Fingerprint, "secret");
+
+        StunMessageView view(packet);
+        QVERIFY(view.checkMessageIntegrity("secret"));
+        QVERIFY(!view.checkMessageIntegrity("wrong"));
+
+        // the same as what the copying parser produces
+        StunMessage::ConvertResult result;
+        StunMessage                msg = StunMessage::fromBinary(
+            packet, &result, StunMessage::MessageIntegrity | StunMessage::Fingerprint, "secret");
+        QCOMPARE(result, StunMessage::ConvertGood);
+        QVERIFY(!msg.hasAttribute(StunTypes::FINGERPRINT)); // follows message-integrity
+        QCOMPARE(view.toMessage(true).attributes().size(), msg.attributes().size());
+        QVERIFY(view.toMessage().hasAttribute(StunTypes::FINGERPRINT));
+    }
+
+private:
+    QCA::Initializer initializer;
+};
+
+QTTESTUTIL_REGISTER_TEST(StunMessageTest);
+#include "stunmessagetest.moc"
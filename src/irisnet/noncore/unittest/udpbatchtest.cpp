@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "irisnet/noncore/udpbatch.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+// datagrams per benchmark round. small enough for the default receive buffer
+static const int burst = 64;
+
+class UdpBatchTest : public QObject {
+    Q_OBJECT
+
+    QUdpSocket       sender;
+    QUdpSocket       receiver;
+    TransportAddress senderAddr;
+    TransportAddress receiverAddr;
+
+    QList<UdpBatch::Datagram> makeBurst(int size) const
+    {
+        QList<UdpBatch::Datagram> out;
+        for (int n = 0; n < burst; ++n)
+            out += UdpBatch::Datagram { receiverAddr, QByteArray(size, char('a' + n % 26)) };
+        return out;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(sender.bind(QHostAddress::LocalHost, 0));
+        QVERIFY(receiver.bind(QHostAddress::LocalHost, 0));
+        senderAddr   = { QHostAddress(QHostAddress::LocalHost), sender.localPort() };
+        receiverAddr = { QHostAddress(QHostAddress::LocalHost), receiver.localPort() };
+    }
+
+    void testLoopback()
+    {
+        if (!UdpBatch::isSupported())
+            QSKIP("no batched socket calls on this platform");
+
+        UdpBatch out(&sender);
+        UdpBatch in(&receiver);
+        auto     dgs = makeBurst(200);
+        dgs += UdpBatch::Datagram { TransportAddress(), "nowhere" }; // dropped, doesn't stop the batch
+        dgs += UdpBatch::Datagram { receiverAddr, "last" };
+        int sent = 0;
+        QCOMPARE(out.send(dgs.constData(), int(dgs.size()), &sent), int(dgs.size()));
+        QCOMPARE(sent, int(dgs.size()) - 1);
+
+        QList<UdpBatch::Datagram> got;
+        while (in.receive(got))
+            ;
+        QCOMPARE(got.size(), burst + 1);
+        QCOMPARE(got[0].addr, senderAddr);
+        QCOMPARE(got[1].buf, dgs[1].buf);
+        QCOMPARE(got.last().buf, QByteArray("last"));
+
+        // larger than a path MTU, still comes through whole
+        UdpBatch::Datagram big { receiverAddr, QByteArray(60000, 'x') };
+        QCOMPARE(out.send(&big, 1, &sent), 1);
+        QCOMPARE(sent, 1);
+        got.clear();
+        QCOMPARE(in.receive(got), 1);
+        QCOMPARE(got[0].buf, big.buf);
+    }
+
+    // the old path: a few syscalls for every datagram
+    void benchmarkQUdpSocket()
+    {
+        const auto dgs = makeBurst(200);
+        QByteArray buf;
+        QBENCHMARK
+        {
+            for (const auto &dg : dgs)
+                sender.writeDatagram(dg.buf, dg.addr.addr, dg.addr.port);
+            int got = 0;
+            while (receiver.hasPendingDatagrams()) {
+                TransportAddress from;
+                buf.resize(int(receiver.pendingDatagramSize()));
+                receiver.readDatagram(buf.data(), buf.size(), &from.addr, &from.port);
+                ++got;
+            }
+            QCOMPARE(got, burst);
+        }
+    }
+
+    void benchmarkUdpBatch()
+    {
+        if (!UdpBatch::isSupported())
+            QSKIP("no batched socket calls on this platform");
+
+        UdpBatch   out(&sender);
+        UdpBatch   in(&receiver);
+        const auto dgs = makeBurst(200);
+        QBENCHMARK
+        {
+            QCOMPARE(out.send(dgs.constData(), burst), burst);
+            QList<UdpBatch::Datagram> got;
+            while (in.receive(got))
+                ;
+            QCOMPARE(got.size(), burst);
+        }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(UdpBatchTest);
+#include "udpbatchtest.moc"
@@ -0,0 +1,45 @@
+/*
+ * blake2-dispatch.h - runtime selection of BLAKE2b compression function
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BLAKE2_DISPATCH_H
+#define BLAKE2_DISPATCH_H
+
+#include "blake2.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum { BLAKE2_BACKEND_REF, BLAKE2_BACKEND_SSE41, BLAKE2_BACKEND_AVX2 } blake2_backend;
+
+/* The best one the CPU has is taken on the first use */
+blake2_backend blake2b_backend(void);
+int            blake2b_backend_supported(blake2_backend backend);
+/* -1 if the CPU can't do it. Meant for tests and benchmarks */
+int blake2b_set_backend(blake2_backend backend);
+
+/* What blake2b-ref.c calls for each block */
+void blake2b_compress(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES]);
+void blake2b_compress_ref(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BLAKE2_DISPATCH_H
@@ -13,6 +13,7 @@
    https://blake2.net.
 */
 
+#include "blake2-dispatch.h"
 #include "blake2-impl.h"
 #include "blake2.h"
 
@@ -159,7 +160,8 @@ int blake2b_init_key(blake2b_state *S, size_t outlen, const void *key, size_t ke
         G(r, 7, v[3], v[4], v[9], v[14]);                                                                              \
     } while (0)
 
-static void blake2b_compress(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES])
+/* iris: the calls go through blake2b_compress() of blake2b-simd.c */
+void blake2b_compress_ref(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES])
 {
     uint64_t m[16];
     uint64_t v[16];
@@ -0,0 +1,312 @@
+/*
+ * blake2b-simd.c - SSE4.1 and AVX2 BLAKE2b compression with runtime dispatch
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "blake2-dispatch.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || (defined(_M_IX86) && !defined(_M_ARM64EC))
+#define BLAKE2_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define BLAKE2_TARGET(x)
+#else
+#include <cpuid.h>
+#define BLAKE2_TARGET(x) __attribute__((target(x)))
+#endif
+#include <immintrin.h>
+#endif
+
+/* 0 until the first use, the backend + 1 after. Hashing threads may select it at the same time */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+static atomic_int blake2b_selected = 0;
+#define BLAKE2_SELECTED_LOAD() atomic_load_explicit(&blake2b_selected, memory_order_relaxed)
+#define BLAKE2_SELECTED_STORE(v) atomic_store_explicit(&blake2b_selected, (v), memory_order_relaxed)
+#elif defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static volatile long blake2b_selected = 0;
+#define BLAKE2_SELECTED_LOAD() ((int)_InterlockedCompareExchange(&blake2b_selected, 0, 0))
+#define BLAKE2_SELECTED_STORE(v) _InterlockedExchange(&blake2b_selected, (long)(v))
+#else
+static int blake2b_selected = 0;
+#define BLAKE2_SELECTED_LOAD() __atomic_load_n(&blake2b_selected, __ATOMIC_RELAXED)
+#define BLAKE2_SELECTED_STORE(v) __atomic_store_n(&blake2b_selected, (v), __ATOMIC_RELAXED)
+#endif
+
+#ifdef BLAKE2_X86
+static const uint64_t blake2b_IV[8]
+    = { 0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL };
+
+static const uint8_t blake2b_sigma[12][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 }, { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+    { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 }, { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+    { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 }, { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+    { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 }, { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+    { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 }, { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 }, { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+
+/* x86 is little endian, so the message words are just copied */
+#define LOAD_MSG(m, block) memcpy(m, block, BLAKE2B_BLOCKBYTES)
+
+/*
+ * SSE4.1. Each row of the 4x4 state is split in two registers, low and high.
+ * The G function runs on two columns of a half at once.
+ */
+#define SSE_ROTR32(x) _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define SSE_ROTR24(x) _mm_shuffle_epi8(x, r24)
+#define SSE_ROTR16(x) _mm_shuffle_epi8(x, r16)
+#define SSE_ROTR63(x) _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x))
+
+#define SSE_G(ml, mh, rot1, rot2)                                                                                      \
+    do {                                                                                                               \
+        a0 = _mm_add_epi64(_mm_add_epi64(a0, b0), ml);                                                                 \
+        a1 = _mm_add_epi64(_mm_add_epi64(a1, b1), mh);                                                                 \
+        d0 = rot1(_mm_xor_si128(d0, a0));                                                                              \
+        d1 = rot1(_mm_xor_si128(d1, a1));                                                                              \
+        c0 = _mm_add_epi64(c0, d0);                                                                                    \
+        c1 = _mm_add_epi64(c1, d1);                                                                                    \
+        b0 = rot2(_mm_xor_si128(b0, c0));                                                                              \
+        b1 = rot2(_mm_xor_si128(b1, c1));                                                                              \
+    } while (0)
+
+/* rotate rows 1, 2 and 3 left by 1, 2 and 3 lanes so the diagonals become columns */
+#define SSE_DIAGONALIZE()                                                                                              \
+    do {                                                                                                               \
+        t0 = _mm_alignr_epi8(b1, b0, 8);                                                                               \
+        t1 = _mm_alignr_epi8(b0, b1, 8);                                                                               \
+        b0 = t0;                                                                                                       \
+        b1 = t1;                                                                                                       \
+        t0 = c0;                                                                                                       \
+        c0 = c1;                                                                                                       \
+        c1 = t0;                                                                                                       \
+        t0 = _mm_alignr_epi8(d1, d0, 8);                                                                               \
+        t1 = _mm_alignr_epi8(d0, d1, 8);                                                                               \
+        d0 = t1;                                                                                                       \
+        d1 = t0;                                                                                                       \
+    } while (0)
+
+#define SSE_UNDIAGONALIZE()                                                                                            \
+    do {                                                                                                               \
+        t0 = _mm_alignr_epi8(b0, b1, 8);                                                                               \
+        t1 = _mm_alignr_epi8(b1, b0, 8);                                                                               \
+        b0 = t0;                                                                                                       \
+        b1 = t1;                                                                                                       \
+        t0 = c0;                                                                                                       \
+        c0 = c1;                                                                                                       \
+        c1 = t0;                                                                                                       \
+        t0 = _mm_alignr_epi8(d1, d0, 8);                                                                               \
+        t1 = _mm_alignr_epi8(d0, d1, 8);                                                                               \
+        d0 = t0;                                                                                                       \
+        d1 = t1;                                                                                                       \
+    } while (0)
+
+#define SSE_MSG(i0, i1) _mm_set_epi64x((long long)m[s[i1]], (long long)m[s[i0]])
+
+BLAKE2_TARGET("sse4.1")
+static void blake2b_compress_sse41(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES])
+{
+    const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    const __m128i r24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    uint64_t      m[16];
+    __m128i       a0, a1, b0, b1, c0, c1, d0, d1, t0, t1;
+    int           r;
+
+    LOAD_MSG(m, block);
+
+    a0 = _mm_loadu_si128((const __m128i *)&S->h[0]);
+    a1 = _mm_loadu_si128((const __m128i *)&S->h[2]);
+    b0 = _mm_loadu_si128((const __m128i *)&S->h[4]);
+    b1 = _mm_loadu_si128((const __m128i *)&S->h[6]);
+    c0 = _mm_loadu_si128((const __m128i *)&blake2b_IV[0]);
+    c1 = _mm_loadu_si128((const __m128i *)&blake2b_IV[2]);
+    d0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&blake2b_IV[4]), _mm_loadu_si128((const __m128i *)&S->t[0]));
+    d1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&blake2b_IV[6]), _mm_loadu_si128((const __m128i *)&S->f[0]));
+
+    for (r = 0; r < 12; ++r) {
+        const uint8_t *s = blake2b_sigma[r];
+        SSE_G(SSE_MSG(0, 2), SSE_MSG(4, 6), SSE_ROTR32, SSE_ROTR24);
+        SSE_G(SSE_MSG(1, 3), SSE_MSG(5, 7), SSE_ROTR16, SSE_ROTR63);
+        SSE_DIAGONALIZE();
+        SSE_G(SSE_MSG(8, 10), SSE_MSG(12, 14), SSE_ROTR32, SSE_ROTR24);
+        SSE_G(SSE_MSG(9, 11), SSE_MSG(13, 15), SSE_ROTR16, SSE_ROTR63);
+        SSE_UNDIAGONALIZE();
+    }
+
+    a0 = _mm_xor_si128(a0, c0);
+    a1 = _mm_xor_si128(a1, c1);
+    b0 = _mm_xor_si128(b0, d0);
+    b1 = _mm_xor_si128(b1, d1);
+    _mm_storeu_si128((__m128i *)&S->h[0], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&S->h[0]), a0));
+    _mm_storeu_si128((__m128i *)&S->h[2], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&S->h[2]), a1));
+    _mm_storeu_si128((__m128i *)&S->h[4], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&S->h[4]), b0));
+    _mm_storeu_si128((__m128i *)&S->h[6], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&S->h[6]), b1));
+}
+
+/*
+ * AVX2. A whole row fits a register, so G runs on all four columns and then on
+ * all four diagonals at once.
+ */
+#define AVX_ROTR32(x) _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define AVX_ROTR24(x) _mm256_shuffle_epi8(x, r24)
+#define AVX_ROTR16(x) _mm256_shuffle_epi8(x, r16)
+#define AVX_ROTR63(x) _mm256_xor_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x))
+
+#define AVX_G(msg, rot1, rot2)                                                                                         \
+    do {                                                                                                               \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), msg);                                                             \
+        d = rot1(_mm256_xor_si256(d, a));                                                                              \
+        c = _mm256_add_epi64(c, d);                                                                                    \
+        b = rot2(_mm256_xor_si256(b, c));                                                                              \
+    } while (0)
+
+#define AVX_MSG(i0, i1, i2, i3)                                                                                        \
+    _mm256_set_epi64x((long long)m[s[i3]], (long long)m[s[i2]], (long long)m[s[i1]], (long long)m[s[i0]])
+
+BLAKE2_TARGET("avx2")
+static void blake2b_compress_avx2(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES])
+{
+    const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1,
+                                         10, 11, 12, 13, 14, 15, 8, 9);
+    const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2,
+                                         11, 12, 13, 14, 15, 8, 9, 10);
+    uint64_t      m[16];
+    __m256i       a, b, c, d;
+    int           r;
+
+    LOAD_MSG(m, block);
+
+    a = _mm256_loadu_si256((const __m256i *)&S->h[0]);
+    b = _mm256_loadu_si256((const __m256i *)&S->h[4]);
+    c = _mm256_loadu_si256((const __m256i *)&blake2b_IV[0]);
+    d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&blake2b_IV[4]),
+                         _mm256_set_epi64x((long long)S->f[1], (long long)S->f[0], (long long)S->t[1],
+                                           (long long)S->t[0]));
+
+    for (r = 0; r < 12; ++r) {
+        const uint8_t *s = blake2b_sigma[r];
+        AVX_G(AVX_MSG(0, 2, 4, 6), AVX_ROTR32, AVX_ROTR24);
+        AVX_G(AVX_MSG(1, 3, 5, 7), AVX_ROTR16, AVX_ROTR63);
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));
+        AVX_G(AVX_MSG(8, 10, 12, 14), AVX_ROTR32, AVX_ROTR24);
+        AVX_G(AVX_MSG(9, 11, 13, 15), AVX_ROTR16, AVX_ROTR63);
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));
+    }
+
+    a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&S->h[0]), _mm256_xor_si256(a, c));
+    b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&S->h[4]), _mm256_xor_si256(b, d));
+    _mm256_storeu_si256((__m256i *)&S->h[0], a);
+    _mm256_storeu_si256((__m256i *)&S->h[4], b);
+}
+
+static void blake2_cpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    __cpuidex((int *)regs, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* AVX registers have to be saved by the OS too, not only be in the CPU */
+static int blake2_os_saves_avx(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (_xgetbv(0) & 6) == 6;
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (eax & 6) == 6;
+#endif
+}
+#endif // BLAKE2_X86
+
+int blake2b_backend_supported(blake2_backend backend)
+{
+#ifdef BLAKE2_X86
+    unsigned int regs[4];
+
+    blake2_cpuid(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+    blake2_cpuid(1, 0, regs);
+    const int sse41 = (regs[2] & (1u << 19)) != 0;
+    const int avx   = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && blake2_os_saves_avx(); /* OSXSAVE, AVX */
+
+    switch (backend) {
+    case BLAKE2_BACKEND_REF:
+        return 1;
+    case BLAKE2_BACKEND_SSE41:
+        return sse41;
+    case BLAKE2_BACKEND_AVX2:
+        if (!avx || maxLeaf < 7)
+            return 0;
+        blake2_cpuid(7, 0, regs);
+        return (regs[1] & (1u << 5)) != 0;
+    }
+    return 0;
+#else
+    return backend == BLAKE2_BACKEND_REF;
+#endif
+}
+
+int blake2b_set_backend(blake2_backend backend)
+{
+    if (!blake2b_backend_supported(backend))
+        return -1;
+    BLAKE2_SELECTED_STORE((int)backend + 1);
+    return 0;
+}
+
+blake2_backend blake2b_backend(void)
+{
+    const int selected = BLAKE2_SELECTED_LOAD();
+    if (selected)
+        return (blake2_backend)(selected - 1);
+
+    /* the first hashing threads may all get here, but they pick the same */
+    if (blake2b_set_backend(BLAKE2_BACKEND_AVX2) == 0)
+        return BLAKE2_BACKEND_AVX2;
+    if (blake2b_set_backend(BLAKE2_BACKEND_SSE41) == 0)
+        return BLAKE2_BACKEND_SSE41;
+    blake2b_set_backend(BLAKE2_BACKEND_REF);
+    return BLAKE2_BACKEND_REF;
+}
+
+void blake2b_compress(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES])
+{
+    switch (blake2b_backend()) {
+#ifdef BLAKE2_X86
+    case BLAKE2_BACKEND_AVX2:
+        blake2b_compress_avx2(S, block);
+        return;
+    case BLAKE2_BACKEND_SSE41:
+        blake2b_compress_sse41(S, block);
+        return;
+#endif
+    default:
+        blake2b_compress_ref(S, block);
+        return;
+    }
+}
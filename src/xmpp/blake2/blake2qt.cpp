@@ -4,6 +4,11 @@
 
 #include <QIODevice>
 
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
 namespace XMPP {
 /* Padded structs result in a compile-time error */
 static_assert(sizeof(blake2s_param) == BLAKE2S_OUTBYTES, "sizeof(blake2s_param) != BLAKE2S_OUTBYTES");
@@ -14,6 +19,79 @@ public:
     blake2b_state state;
 };
 
+namespace {
+    // hashes the blocks it's given one by one on a thread of its own, so the
+    // caller can read the next block meanwhile
+    class BlockHasher {
+    public:
+        explicit BlockHasher(Blake2Hash *hash) : hash(hash) { }
+        ~BlockHasher() { finish(); }
+
+        // false if no thread could be started
+        bool start()
+        {
+            try {
+                worker = std::thread([this]() { run(); });
+            } catch (const std::system_error &) {
+                return false;
+            }
+            return true;
+        }
+
+        // waits for the previous block to be hashed. false if that failed
+        bool add(QByteArray &&data)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            idle.wait(lock, [this]() { return block.isNull(); });
+            if (!ok)
+                return false;
+            block = std::move(data);
+            busy.notify_one();
+            return true;
+        }
+
+        bool finish()
+        {
+            if (worker.joinable()) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    idle.wait(lock, [this]() { return block.isNull(); });
+                    stop = true;
+                }
+                busy.notify_one();
+                worker.join();
+            }
+            return ok;
+        }
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                busy.wait(lock, [this]() { return stop || !block.isNull(); });
+                if (block.isNull())
+                    return;
+                lock.unlock();
+                bool hashed = hash->addData(block); // the caller doesn't touch the block meanwhile
+                lock.lock();
+                ok    = ok && hashed;
+                block = QByteArray();
+                idle.notify_one();
+            }
+        }
+
+        Blake2Hash             *hash;
+        std::thread             worker;
+        std::mutex              mutex;
+        std::condition_variable busy; // a block to hash or time to stop
+        std::condition_variable idle; // done with the block
+        QByteArray              block;
+        bool                    stop = false;
+        bool                    ok   = true;
+    };
+}
+
 Blake2Hash::Blake2Hash(DigestSize digestSize) : d(new Private)
 {
     size_t digestSizeBytes = digestSize == Digest256 ? 32 : 64;
@@ -41,14 +119,23 @@ bool Blake2Hash::addData(QIODevice *dev)
         return false;
     }
 
-    bool       ret = true;
-    QByteArray buf;
-    // reading by 1Mb should work well with disk caches
-    while ((buf = dev->read(1024 * 1024)).size() > 0)
-        if (!addData(buf)) {
-            ret = false;
-            break;
+    bool        ret      = true;
+    bool        threaded = false;
+    bool        tried    = false;
+    BlockHasher hasher(this);
+    QByteArray  buf;
+    // reading by 1Mb should work well with disk caches. the next block is read
+    // while the previous one is hashed on another core. a single block isn't
+    // worth a thread, and without one the blocks are hashed as they are read
+    while (ret && (buf = dev->read(1024 * 1024)).size() > 0) {
+        if (!tried && !dev->atEnd()) {
+            tried    = true;
+            threaded = hasher.start();
         }
+        ret = threaded ? hasher.add(std::move(buf)) : addData(buf);
+    }
+    if (!hasher.finish())
+        ret = false;
 
     if (!isOpen)
         dev->close();
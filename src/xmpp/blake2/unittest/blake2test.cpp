@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/blake2/blake2qt.h"
+#ifdef IRIS_BUNDLED_BLAKE2
+#include "xmpp/blake2/blake2-dispatch.h"
+#endif
+
+#include <QBuffer>
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static QByteArray pattern(int size)
+{
+    QByteArray ret(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i)
+        ret[i] = char(i * 131 + 7);
+    return ret;
+}
+
+class Blake2Test : public QObject {
+    Q_OBJECT
+
+#ifdef IRIS_BUNDLED_BLAKE2
+    blake2_backend defaultBackend;
+
+    void addBackends()
+    {
+        QTest::addColumn<int>("backend");
+        QTest::newRow("ref") << int(BLAKE2_BACKEND_REF);
+        QTest::newRow("sse4.1") << int(BLAKE2_BACKEND_SSE41);
+        QTest::newRow("avx2") << int(BLAKE2_BACKEND_AVX2);
+    }
+
+    void selectBackend()
+    {
+        QFETCH(int, backend);
+        if (blake2b_set_backend(blake2_backend(backend)) != 0)
+            QSKIP("not supported by this CPU");
+    }
+#else
+    // libb2 picks its code on its own
+    void addBackends()
+    {
+        QTest::addColumn<int>("backend");
+        QTest::newRow("libb2") << 0;
+    }
+
+    void selectBackend() { }
+#endif
+
+private slots:
+#ifdef IRIS_BUNDLED_BLAKE2
+    void initTestCase() { defaultBackend = blake2b_backend(); }
+
+    void cleanup() { blake2b_set_backend(defaultBackend); }
+#endif
+
+    void testVectors_data() { addBackends(); }
+
+    void testVectors()
+    {
+        selectBackend();
+        QCOMPARE(Blake2Hash::compute(QByteArray(), Blake2Hash::Digest512).toHex(),
+                 QByteArray("786a02f742015903c6c6fd852552d272912f4740e15847618a86e217f71f5419"
+                            "d25e1031afee585313896444934eb04b903a685b1448b755d56f701afe9be2ce"));
+        QCOMPARE(Blake2Hash::compute("abc", Blake2Hash::Digest512).toHex(),
+                 QByteArray("ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+                            "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923"));
+        QCOMPARE(Blake2Hash::compute("abc", Blake2Hash::Digest256).toHex(),
+                 QByteArray("bddd813c634239723171ef3fee98579b94964e3bb1cb3e427262c8c068d52319"));
+    }
+
+    void testSameAsReference_data() { addBackends(); }
+
+    void testSameAsReference()
+    {
+#ifndef IRIS_BUNDLED_BLAKE2
+        QSKIP("no reference code to compare with in libb2");
+#else
+        QList<QByteArray> expected;
+        blake2b_set_backend(BLAKE2_BACKEND_REF);
+        for (int size : { 1, 127, 128, 129, 1000, 65536 + 3 })
+            expected += Blake2Hash::compute(pattern(size), Blake2Hash::Digest512);
+
+        selectBackend();
+        int n = 0;
+        for (int size : { 1, 127, 128, 129, 1000, 65536 + 3 })
+            QCOMPARE(Blake2Hash::compute(pattern(size), Blake2Hash::Digest512), expected[n++]);
+#endif
+    }
+
+    void testDevice()
+    {
+        // a few blocks, so reading and hashing go in parallel
+        QByteArray data = pattern(3 * 1024 * 1024 + 17);
+        QBuffer    buffer(&data);
+        QByteArray hash = Blake2Hash::compute(&buffer, Blake2Hash::Digest256);
+        QCOMPARE(hash.toHex(), QByteArray("0936b363e36c3ac8a742415cd6de9318841fadaeaab64a64ddac25186d2bea07"));
+        QCOMPARE(hash, Blake2Hash::compute(data, Blake2Hash::Digest256));
+        QVERIFY(!buffer.isOpen());
+    }
+
+    void benchmarkThroughput_data() { addBackends(); }
+
+    // 64 MiB per iteration, so MiB/s is 64000 / msecs
+    void benchmarkThroughput()
+    {
+        selectBackend();
+        const QByteArray data = pattern(64 * 1024 * 1024);
+        QBENCHMARK
+        {
+            QCOMPARE(Blake2Hash::compute(data, Blake2Hash::Digest512).size(), 64);
+        }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(Blake2Test);
+#include "blake2test.moc"
@@ -25,96 +25,166 @@
 
 #include "qstringprep.h"
 #include <QCoreApplication>
+#include <QMutex>
+
+#include <utility>
+#include <vector>
 
 using namespace XMPP;
 
 //----------------------------------------------------------------------------
 // StringPrepCache
 //----------------------------------------------------------------------------
-std::unique_ptr<StringPrepCache> StringPrepCache::_instance;
-
-bool StringPrepCache::nameprep(const QString &in, int maxbytes, QString &out)
-{
-    if (in.trimmed().isEmpty()) {
-        out = QString();
-        return false; // empty names or just spaces are disallowed (rfc5892+rfc6122)
-    }
-
-    StringPrepCache *that = instance();
-
-    auto it = that->nameprep_table.constFind(in);
-    if (it != that->nameprep_table.constEnd()) {
-        if (it.value().isNull()) {
+namespace {
+// A bounded map with the CLOCK replacement: a lookup marks the entry referenced,
+// and the hand looking for a victim clears the marks it passes by.
+template <typename Key> class ClockTable {
+public:
+    explicit ClockTable(int limit) : limit(limit) { }
+
+    bool lookup(const Key &key, QString &value)
+    {
+        QMutexLocker locker(&mutex);
+        auto         it = index.constFind(key);
+        if (it == index.constEnd()) {
+            ++stats.misses;
             return false;
         }
-        out = it.value();
+        ++stats.hits;
+        Slot &slot      = slots[it.value()];
+        slot.referenced = true;
+        value           = slot.value;
         return true;
     }
 
-    out = in;
-    if (stringprep(out, (Stringprep_profile_flags)0, stringprep_nameprep) != 0 || out.size() > maxbytes) {
-        that->nameprep_table.insert(in, QString());
-        return false;
+    // returns the value in the table, which is 'value' unless another thread was faster
+    QString insert(const Key &key, const QString &value)
+    {
+        QMutexLocker locker(&mutex);
+        if (limit <= 0)
+            return value;
+        auto it = index.constFind(key);
+        if (it != index.constEnd())
+            return slots[it.value()].value;
+
+        if (int(slots.size()) < limit) {
+            index.insert(key, int(slots.size()));
+            slots.push_back({ key, value, false });
+            return value;
+        }
+
+        while (slots[hand].referenced) {
+            slots[hand].referenced = false;
+            hand                   = (hand + 1) % slots.size();
+        }
+        Slot &victim = slots[hand];
+        index.remove(victim.key);
+        index.insert(key, int(hand));
+        victim = { key, value, false };
+        hand   = (hand + 1) % slots.size();
+        ++stats.evictions;
+        return value;
     }
 
-    that->nameprep_table.insert(in, out);
-    return true;
-}
+    void setLimit(int entries)
+    {
+        QMutexLocker locker(&mutex);
+        limit = entries;
+        index.clear();
+        slots.clear();
+        slots.shrink_to_fit();
+        hand  = 0;
+        stats = {};
+    }
 
-bool StringPrepCache::nodeprep(const QString &in, int maxbytes, QString &out)
-{
-    if (in.isEmpty()) {
-        out = QString();
-        return true;
+    StringPrepCache::Stats statistics()
+    {
+        QMutexLocker locker(&mutex);
+        auto         ret = stats;
+        ret.size         = int(slots.size());
+        ret.limit        = limit;
+        return ret;
     }
 
-    StringPrepCache *that = instance();
+private:
+    struct Slot {
+        Key     key;
+        QString value; // null if the input is not valid for the profile
+        bool    referenced;
+    };
+
+    QMutex                 mutex;
+    QHash<Key, int>        index; // key => position in slots
+    std::vector<Slot>      slots;
+    size_t                 hand = 0;
+    int                    limit;
+    StringPrepCache::Stats stats;
+};
+} // namespace
+
+class StringPrepCache::Table : public ClockTable<QString> {
+public:
+    using ClockTable::ClockTable;
+};
+
+class StringPrepCache::BareTable : public ClockTable<std::pair<QString, QString>> {
+public:
+    using ClockTable::ClockTable;
+};
+
+std::shared_ptr<StringPrepCache> StringPrepCache::_instance;
+static QBasicMutex               instanceMutex;
+
+bool StringPrepCache::prep(Profile profile, const QString &in, int maxbytes, QString &out)
+{
+    static const Stringprep_profile *profiles[ProfileCount]
+        = { stringprep_nameprep, stringprep_xmpp_nodeprep, stringprep_xmpp_resourceprep, stringprep_saslprep };
 
-    auto it = that->nodeprep_table.constFind(in);
-    if (it != that->nodeprep_table.constEnd()) {
-        if (it.value().isNull()) {
-            return false;
-        }
-        out = it.value();
-        return true;
-    }
+    const auto cache = instance();
+    Table     &table = *cache->tables[profile];
+    if (table.lookup(in, out))
+        return !out.isNull();
 
     out = in;
-    if (stringprep(out, (Stringprep_profile_flags)0, stringprep_xmpp_nodeprep) != 0 || out.size() > maxbytes) {
-        that->nodeprep_table.insert(in, QString());
+    if (stringprep(out, (Stringprep_profile_flags)0, profiles[profile]) != 0 || out.size() > maxbytes) {
+        out = QString();
+        table.insert(in, out);
         return false;
     }
 
-    that->nodeprep_table.insert(in, out);
+    // share the data with the table, so equal names in many jids are stored once.
+    // stringprep is idempotent, so the result maps to itself
+    if (out != in)
+        out = table.insert(out, out);
+    out = table.insert(in, out);
     return true;
 }
 
-bool StringPrepCache::resourceprep(const QString &in, int maxbytes, QString &out)
+bool StringPrepCache::nameprep(const QString &in, int maxbytes, QString &out)
 {
-    if (in.isEmpty()) {
+    if (in.trimmed().isEmpty()) {
         out = QString();
-        return true;
+        return false; // empty names or just spaces are disallowed (rfc5892+rfc6122)
     }
+    return prep(Nameprep, in, maxbytes, out);
+}
 
-    StringPrepCache *that = instance();
-
-    auto it = that->resourceprep_table.constFind(in);
-    if (it != that->resourceprep_table.constEnd()) {
-        if (it.value().isNull()) {
-            return false;
-        }
-        out = it.value();
+bool StringPrepCache::nodeprep(const QString &in, int maxbytes, QString &out)
+{
+    if (in.isEmpty()) {
+        out = QString();
         return true;
     }
+    return prep(Nodeprep, in, maxbytes, out);
+}
 
-    out = in;
-    if (stringprep(out, (Stringprep_profile_flags)0, stringprep_xmpp_resourceprep) != 0 || out.size() > maxbytes) {
-        that->resourceprep_table.insert(in, QString());
-        return false;
+bool StringPrepCache::resourceprep(const QString &in, int maxbytes, QString &out)
+{
+    if (in.isEmpty()) {
+        out = QString();
+        return true;
     }
-
-    that->resourceprep_table.insert(in, out);
-    return true;
+    return prep(Resourceprep, in, maxbytes, out);
 }
 
 bool StringPrepCache::saslprep(const QString &in, int maxbytes, QString &out)
@@ -123,42 +193,53 @@ bool StringPrepCache::saslprep(const QString &in, int maxbytes, QString &out)
         out = QString();
         return true;
     }
+    return prep(Saslprep, in, maxbytes, out);
+}
 
-    StringPrepCache *that = instance();
+QString StringPrepCache::internBare(const QString &node, const QString &domain)
+{
+    const auto cache = instance();
+    BareTable &table = *cache->bareTable;
+    auto       key   = std::make_pair(node, domain);
+    QString    bare;
+    if (table.lookup(key, bare))
+        return bare;
+    return table.insert(key, node + QLatin1Char('@') + domain);
+}
 
-    auto it = that->saslprep_table.constFind(in);
-    if (it != that->saslprep_table.constEnd()) {
-        if (it.value().isNull()) {
-            return false;
-        }
-        out = it.value();
-        return true;
-    }
+void StringPrepCache::setLimit(Profile profile, int entries) { instance()->tables[profile]->setLimit(entries); }
 
-    out = in;
-    if (stringprep(out, (Stringprep_profile_flags)0, stringprep_saslprep) != 0 || out.size() > maxbytes) {
-        that->saslprep_table.insert(in, QString());
-        return false;
-    }
+StringPrepCache::Stats StringPrepCache::stats(Profile profile) { return instance()->tables[profile]->statistics(); }
 
-    that->saslprep_table.insert(in, out);
-    return true;
+void StringPrepCache::cleanup()
+{
+    QMutexLocker locker(&instanceMutex);
+    _instance.reset();
 }
 
-void StringPrepCache::cleanup() { _instance.reset(nullptr); }
-
-StringPrepCache *StringPrepCache::instance()
+std::shared_ptr<StringPrepCache> StringPrepCache::instance()
 {
+    QMutexLocker locker(&instanceMutex);
     if (!_instance) {
-        _instance.reset(new StringPrepCache);
+        _instance.reset(new StringPrepCache); // the constructor is private, no make_shared
 #ifndef NO_IRISNET
         irisNetAddPostRoutine(cleanup); // REVIEW probably not necessary since heap will be deallocated with destructors
 #endif
     }
-    return _instance.get();
+    return _instance;
+}
+
+StringPrepCache::StringPrepCache()
+{
+    // domains are few, while a server may see lots of distinct resources
+    tables[Nameprep]     = std::make_unique<Table>(4096);
+    tables[Nodeprep]     = std::make_unique<Table>(32768);
+    tables[Resourceprep] = std::make_unique<Table>(32768);
+    tables[Saslprep]     = std::make_unique<Table>(64);
+    bareTable            = std::make_unique<BareTable>(32768);
 }
 
-StringPrepCache::StringPrepCache() { }
+StringPrepCache::~StringPrepCache() { }
 
 //----------------------------------------------------------------------------
 // Jid
@@ -216,7 +297,7 @@ void Jid::update()
     if (n.isEmpty())
         b = d;
     else
-        b = n + '@' + d;
+        b = StringPrepCache::internBare(n, d);
     if (r.isEmpty())
         f = b;
     else
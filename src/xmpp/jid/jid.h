@@ -26,23 +26,49 @@
 #include <memory>
 
 namespace XMPP {
+// Process-wide cache of stringprep results. Every profile keeps a bounded
+// number of entries, evicting with the CLOCK (second chance) algorithm.
+// All the methods are thread-safe.
 class StringPrepCache {
 public:
+    enum Profile { Nameprep, Nodeprep, Resourceprep, Saslprep, ProfileCount };
+
+    struct Stats {
+        quint64 hits      = 0;
+        quint64 misses    = 0;
+        quint64 evictions = 0;
+        int     size      = 0;
+        int     limit     = 0;
+    };
+
+    ~StringPrepCache();
+
     static bool nameprep(const QString &in, int maxbytes, QString &out);
     static bool nodeprep(const QString &in, int maxbytes, QString &out);
     static bool resourceprep(const QString &in, int maxbytes, QString &out);
     static bool saslprep(const QString &in, int maxbytes, QString &out);
 
+    // returns "node@domain" sharing the data with other jids having the same bare part
+    static QString internBare(const QString &node, const QString &domain);
+
+    // 0 disables caching for the profile. The current entries and statistics are dropped
+    static void  setLimit(Profile profile, int entries);
+    static Stats stats(Profile profile);
+
     static void cleanup();
 
 private:
-    QHash<QString, QString> nameprep_table;
-    QHash<QString, QString> nodeprep_table;
-    QHash<QString, QString> resourceprep_table;
-    QHash<QString, QString> saslprep_table;
+    class Table;
+    class BareTable;
+
+    std::unique_ptr<Table>     tables[ProfileCount];
+    std::unique_ptr<BareTable> bareTable;
+
+    // callers keep the cache alive for as long as they use it, cleanup() may run meanwhile
+    static std::shared_ptr<StringPrepCache> _instance;
+    static std::shared_ptr<StringPrepCache> instance();
 
-    static std::unique_ptr<StringPrepCache> _instance;
-    static StringPrepCache                 *instance();
+    static bool prep(Profile profile, const QString &in, int maxbytes, QString &out);
 
     StringPrepCache();
 };
@@ -24,6 +24,10 @@
 #include <QObject>
 #include <QtTest/QtTest>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 using namespace XMPP;
 
 class JidTest : public QObject {
@@ -38,6 +42,64 @@ private slots:
         QCOMPARE(testling.domain(), QString("bar"));
         QCOMPARE(testling.resource(), QString("baz"));
     }
+
+    void testPrep()
+    {
+        Jid ascii("Foo.Bar@Example.COM/Desk Top");
+        QCOMPARE(ascii.full(), QString("foo.bar@example.com/Desk Top"));
+        QVERIFY(!Jid("foo bar@example.com").isValid());
+        QVERIFY(!Jid("foo\"bar@example.com").isValid());
+
+        Jid unicode(QString::fromUtf8("\xc3\x84rger@B\xc3\xbccher.example/\xef\xbc\xa1"));
+        QCOMPARE(unicode.full(), QString::fromUtf8("\xc3\xa4rger@b\xc3\xbccher.example/A"));
+    }
+
+    void testSharedStorage()
+    {
+        Jid a("Foo@Bar/phone");
+        Jid b("foo@bar/desktop");
+
+        QCOMPARE(a.bare(), QString("foo@bar"));
+        QCOMPARE(a.bare().constData(), b.bare().constData());
+        QCOMPARE(a.domain().constData(), b.domain().constData());
+    }
+
+    void testCacheLimit()
+    {
+        StringPrepCache::setLimit(StringPrepCache::Resourceprep, 2);
+        QString out;
+        for (int i = 0; i < 10; ++i)
+            QVERIFY(StringPrepCache::resourceprep(QString("res%1").arg(i), 1024, out));
+        QVERIFY(StringPrepCache::resourceprep("res9", 1024, out));
+        QCOMPARE(out, QString("res9"));
+
+        auto stats = StringPrepCache::stats(StringPrepCache::Resourceprep);
+        QCOMPARE(stats.size, 2);
+        QCOMPARE(stats.limit, 2);
+        QCOMPARE(stats.evictions, quint64(8));
+        QVERIFY(stats.hits >= 1);
+        StringPrepCache::setLimit(StringPrepCache::Resourceprep, 32768);
+    }
+
+    void testConcurrentAccess()
+    {
+        StringPrepCache::setLimit(StringPrepCache::Nodeprep, 64);
+        std::vector<std::thread> threads;
+        std::atomic<int>         failures { 0 };
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&failures]() {
+                for (int i = 0; i < 5000; ++i) {
+                    Jid j(QString("User%1@example.com/r").arg(i % 200));
+                    if (j.node() != QString("user%1").arg(i % 200))
+                        ++failures;
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        QCOMPARE(failures.load(), 0);
+        StringPrepCache::setLimit(StringPrepCache::Nodeprep, 32768);
+    }
 };
 
 QTTESTUTIL_REGISTER_TEST(JidTest);
@@ -0,0 +1,221 @@
+/*
+ * scramresponse.cpp - SCRAM client-final-message for any hash
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp/sasl/scramresponse.h"
+
+#include "xmpp/jid/jid.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtDebug>
+
+namespace XMPP {
+namespace {
+    class SCRAMKeys {
+    public:
+        QCA::SecureArray saltedPassword;
+        QCA::SecureArray clientKey;
+        QCA::SecureArray storedKey;
+        QCA::SecureArray serverKey;
+    };
+
+    class SCRAMKeyCache {
+    public:
+        QMutex                        mutex;
+        QCache<QByteArray, SCRAMKeys> keys { 32 };
+    };
+
+    Q_GLOBAL_STATIC(SCRAMKeyCache, keyCache)
+
+    QString macType(const QString &hash) { return QLatin1String("hmac(") + hash + QLatin1Char(')'); }
+
+    QCA::SecureArray hmac(const QString &hash, const QCA::SecureArray &key, const QCA::SecureArray &data)
+    {
+        return QCA::MessageAuthenticationCode(macType(hash), key).process(data);
+    }
+
+    // Hi() of RFC 5802, which is PBKDF2 with a single block. QCA providers usually
+    //   have PBKDF2 with sha1 only, so the rest is done with their hmac
+    QCA::SecureArray hi(const QString &hash, const QCA::SecureArray &password, const QByteArray &salt,
+                        int iterations, int size)
+    {
+        if (QCA::isSupported(QLatin1String("pbkdf2(") + hash + QLatin1Char(')')))
+            return QCA::PBKDF2(hash).makeKey(password, QCA::InitializationVector(salt), uint(size), uint(iterations));
+
+        QCA::MessageAuthenticationCode mac(macType(hash), QCA::SymmetricKey(password));
+        mac.update(salt + QByteArray("\0\0\0\1", 4));
+        QCA::SecureArray u      = mac.final();
+        QCA::SecureArray result = u;
+        for (int n = 1; n < iterations; ++n) {
+            mac.clear();
+            mac.update(u);
+            u = mac.final();
+            for (int i = 0; i < result.size(); ++i)
+                result[i] = result[i] ^ u[i];
+        }
+        return result;
+    }
+
+    // the value of attribute 'name' in a comma separated SCRAM message
+    QByteArray attribute(const QByteArray &message, char name)
+    {
+        const auto attrs = message.split(',');
+        for (const QByteArray &attr : attrs) {
+            if (attr.size() > 1 && attr[0] == name && attr[1] == '=')
+                return attr.mid(2);
+        }
+        return QByteArray();
+    }
+} // namespace
+
+SCRAMResponse::SCRAMResponse(const QString &hash, const QByteArray &server_first_message, const QByteArray &password,
+                             const QByteArray &client_first_message, const QString &salted_password_base64,
+                             const QByteArray &cbind_data)
+{
+    if (!QCA::isSupported(macType(hash))) {
+        qWarning("SASL/SCRAM: %s is not supported by qca.", qPrintable(macType(hash)));
+        return;
+    }
+
+    QByteArray nonce      = attribute(server_first_message, 'r');
+    QByteArray salt       = QByteArray::fromBase64(attribute(server_first_message, 's'));
+    int        iterations = attribute(server_first_message, 'i').toInt();
+    if (nonce.isEmpty() || salt.isEmpty() || iterations <= 0 || !attribute(server_first_message, 'm').isEmpty()) {
+        qWarning("SASL/SCRAM: Failed to parse server-first-message.");
+        return;
+    }
+
+    // gs2 header is everything up to the second comma
+    int gs2_end = client_first_message.indexOf(',');
+    if (gs2_end != -1)
+        gs2_end = client_first_message.indexOf(',', gs2_end + 1);
+    if (gs2_end == -1)
+        return;
+    QByteArray gs2_header                = client_first_message.left(gs2_end + 1);
+    QByteArray client_first_message_bare = client_first_message.mid(gs2_end + 1);
+    if (gs2_header.startsWith("p=") != !cbind_data.isEmpty()) {
+        qWarning("SASL/SCRAM: Channel binding data has to come with a \"p=\" gs2 header and only with it.");
+        return;
+    }
+
+    // the server appends its part to our nonce. anything else is an attack or a bug
+    QByteArray cnonce = attribute(client_first_message_bare, 'r');
+    if (cnonce.isEmpty() || nonce.size() <= cnonce.size() || !nonce.startsWith(cnonce)) {
+        qWarning("SASL/SCRAM: Server nonce doesn't start with the client one.");
+        return;
+    }
+
+    int       dkLen = QCA::Hash(hash).final().size();
+    SCRAMKeys keys;
+    if (!salted_password_base64.isEmpty()) {
+        // stored by the application for some hash. might be not this one
+        keys.saltedPassword = QByteArray::fromBase64(salted_password_base64.toLatin1());
+        if (keys.saltedPassword.size() != dkLen)
+            keys.saltedPassword.clear();
+        cached_ = !keys.saltedPassword.isEmpty();
+    }
+
+    QByteArray cacheKey;
+    if (keys.saltedPassword.isEmpty()) {
+        QString pass_out;
+        if (!StringPrepCache::saslprep(QString::fromUtf8(password), 1023, pass_out))
+            return;
+        QByteArray pass = pass_out.toUtf8();
+
+        // the password goes into the key hashed, so it isn't kept around as is
+        cacheKey = hash.toLatin1() + ',' + salt.toBase64() + ',' + QByteArray::number(iterations) + ','
+            + QCA::Hash(hash).process(salt + pass).toByteArray();
+        {
+            QMutexLocker locker(&keyCache()->mutex);
+            if (SCRAMKeys *cached = keyCache()->keys.object(cacheKey)) {
+                keys    = *cached;
+                cached_ = true;
+            }
+        }
+
+        // SaltedPassword  := Hi(Normalize(password), salt, i)
+        if (!cached_)
+            keys.saltedPassword = hi(hash, QCA::SecureArray(pass), salt, iterations, dkLen);
+    }
+
+    if (keys.clientKey.isEmpty()) {
+        // ClientKey       := HMAC(SaltedPassword, "Client Key")
+        // StoredKey       := H(ClientKey)
+        // ServerKey       := HMAC(SaltedPassword, "Server Key")
+        keys.clientKey = hmac(hash, keys.saltedPassword, QByteArray("Client Key"));
+        keys.storedKey = QCA::Hash(hash).process(keys.clientKey);
+        keys.serverKey = hmac(hash, keys.saltedPassword, QByteArray("Server Key"));
+        if (!cacheKey.isEmpty()) {
+            QMutexLocker locker(&keyCache()->mutex);
+            keyCache()->keys.insert(cacheKey, new SCRAMKeys(keys));
+        }
+    }
+
+    // AuthMessage     := client-first-message-bare + "," + server-first-message + "," +
+    // client-final-message-without-proof
+    QByteArray client_final_message = "c=" + (gs2_header + cbind_data).toBase64() + ",r=" + nonce;
+    QByteArray auth_message
+        = client_first_message_bare + ',' + server_first_message + ',' + client_final_message;
+
+    // ClientSignature := HMAC(StoredKey, AuthMessage)
+    // ClientProof     := ClientKey XOR ClientSignature
+    QCA::SecureArray client_signature = hmac(hash, keys.storedKey, auth_message);
+    QCA::SecureArray client_proof(keys.clientKey.size());
+    for (int i = 0; i < client_proof.size(); ++i)
+        client_proof[i] = keys.clientKey[i] ^ client_signature[i];
+
+    // ServerSignature := HMAC(ServerKey, AuthMessage)
+    server_signature_ = hmac(hash, keys.serverKey, auth_message);
+    salted_password_  = keys.saltedPassword;
+
+    value_   = client_final_message + ",p=" + client_proof.toByteArray().toBase64();
+    isValid_ = true;
+}
+
+const QString SCRAMResponse::getSaltedPassword() const { return QCA::Base64().arrayToString(salted_password_); }
+
+QString SCRAMResponse::hashForMechanism(const QString &mechanism)
+{
+    static const QStringList known { "SHA-1", "SHA-256", "SHA-384", "SHA-512" };
+
+    if (!mechanism.startsWith(QLatin1String("SCRAM-")))
+        return QString();
+    QString name = mechanism.mid(6);
+    if (name.endsWith(QLatin1String("-PLUS")))
+        name.chop(5);
+    if (!known.contains(name))
+        return QString();
+
+    QString hash = name.toLower().remove(QLatin1Char('-'));
+    return QCA::isSupported(macType(hash)) ? hash : QString();
+}
+
+void SCRAMResponse::setKeyCacheSize(int entries)
+{
+    QMutexLocker locker(&keyCache()->mutex);
+    keyCache()->keys.setMaxCost(qMax(0, entries));
+}
+
+void SCRAMResponse::clearKeyCache()
+{
+    QMutexLocker locker(&keyCache()->mutex);
+    keyCache()->keys.clear();
+}
+} // namespace XMPP
@@ -0,0 +1,68 @@
+/*
+ * scramresponse.h - SCRAM client-final-message for any hash
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRAMRESPONSE_H
+#define SCRAMRESPONSE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtCrypto>
+
+namespace XMPP {
+// Answers a server-first-message of SCRAM (RFC 5802, RFC 7677) with any hash QCA
+// has an hmac for. The keys derived from the password are cached for the process
+// by hash, salt and iteration count, so logging in again with the same password
+// doesn't run the key derivation, which servers make slow on purpose.
+class SCRAMResponse {
+public:
+    // hash is a QCA name like "sha256". cbind_data is the channel binding data of a
+    // -PLUS mechanism, its type is in the gs2 header of client_first_message.
+    // salted_password_base64 is used instead of the password if it's of the right size
+    SCRAMResponse(const QString &hash, const QByteArray &server_first_message, const QByteArray &password,
+                  const QByteArray &client_first_message, const QString &salted_password_base64,
+                  const QByteArray &cbind_data = QByteArray());
+
+    const QByteArray &getValue() const { return value_; }
+
+    const QCA::SecureArray getServerSignature() const { return server_signature_; }
+
+    const QString getSaltedPassword() const;
+
+    bool isValid() const { return isValid_; }
+
+    // the keys came from the cache or the stored salted password, no KDF was run
+    bool isCached() const { return cached_; }
+
+    // "SCRAM-SHA-256-PLUS" => "sha256". empty if it's not SCRAM or QCA lacks the hash
+    static QString hashForMechanism(const QString &mechanism);
+
+    // how many passwords the key cache holds, 32 by default. 0 turns it off
+    static void setKeyCacheSize(int entries);
+    static void clearKeyCache();
+
+private:
+    bool             isValid_ = false;
+    bool             cached_  = false;
+    QByteArray       value_;
+    QCA::SecureArray server_signature_;
+    QCA::SecureArray salted_password_;
+};
+} // namespace XMPP
+
+#endif // SCRAMRESPONSE_H
@@ -40,7 +40,8 @@ bool Normalize(const QString &username_in, QString &username_out)
     }
 }
 
-SCRAMSHA1Message::SCRAMSHA1Message(const QString &authzid, const QString &authcid, const QByteArray &cnonce) :
+SCRAMSHA1Message::SCRAMSHA1Message(const QString &authzid, const QString &authcid, const QByteArray &cnonce,
+                                   const QByteArray &cbind_flag) :
     isValid_(true)
 {
     QString    result;
@@ -63,7 +64,7 @@ SCRAMSHA1Message::SCRAMSHA1Message(const QString &authzid, const QString &authci
     } else
         clientnonce = cnonce;
 
-    QTextStream(&result) << "n,";
+    QTextStream(&result) << cbind_flag << ",";
     if (authzid.size() > 0) {
         QTextStream(&result) << authzid.toUtf8();
     }
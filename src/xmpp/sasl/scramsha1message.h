@@ -25,7 +25,10 @@
 namespace XMPP {
 class SCRAMSHA1Message {
 public:
-    SCRAMSHA1Message(const QString &authzid, const QString &authcid, const QByteArray &cnonce);
+    // the message is the same for every SCRAM hash. cbind_flag is the gs2 one: "n",
+    //   "y" or "p=" and the channel binding type
+    SCRAMSHA1Message(const QString &authzid, const QString &authcid, const QByteArray &cnonce,
+                     const QByteArray &cbind_flag = "n");
 
     const QByteArray &getValue() { return value_; }
 
@@ -19,30 +19,17 @@
 #ifndef SCRAMSHA1RESPONSE_H
 #define SCRAMSHA1RESPONSE_H
 
-#include <QByteArray>
-#include <QString>
-#include <QtCrypto>
+#include "xmpp/sasl/scramresponse.h"
 
 namespace XMPP {
 
-class SCRAMSHA1Response {
+class SCRAMSHA1Response : public SCRAMResponse {
 public:
     SCRAMSHA1Response(const QByteArray &server_first_message, const QByteArray &password,
-                      const QByteArray &client_first_message, const QString &salted_password_base64);
-
-    const QByteArray &getValue() const { return value_; }
-
-    const QCA::SecureArray getServerSignature() const { return server_signature_; }
-
-    const QString getSaltedPassword();
-
-    bool isValid() const { return isValid_; }
-
-private:
-    bool              isValid_;
-    QByteArray        value_;
-    QCA::SecureArray  server_signature_;
-    QCA::SymmetricKey salted_password_;
+                      const QByteArray &client_first_message, const QString &salted_password_base64) :
+        SCRAMResponse("sha1", server_first_message, password, client_first_message, salted_password_base64)
+    {
+    }
 };
 } // namespace XMPP
 
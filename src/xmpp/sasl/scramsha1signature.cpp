@@ -38,7 +38,7 @@ SCRAMSHA1Signature::SCRAMSHA1Signature(const QByteArray       &server_final_mess
         if (server_sig != server_signature_should)
             isValid_ = false;
     } else {
-        qWarning("SASL/SCRAM-SHA-1: Failed to match pattern for server-final-message.");
+        qWarning("SASL/SCRAM: Failed to match pattern for server-final-message.");
     }
 }
 } // namespace XMPP
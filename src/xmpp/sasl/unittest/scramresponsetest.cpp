@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp/sasl/scramresponse.h"
+#include "qttestutil/qttestutil.h"
+#include "xmpp/sasl/scramsha1signature.h"
+
+#include <QObject>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+// RFC 7677
+static const QByteArray clientFirst256 = "n,,n=user,r=rOprNGfwEbeRWgbNEkqO";
+static const QByteArray serverFirst256
+    = "r=rOprNGfwEbeRWgbNEkqO%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096";
+
+class SCRAMResponseTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init()
+    {
+        if (!QCA::isSupported("hmac(sha256)") || !QCA::isSupported("hmac(sha512)"))
+            QSKIP("hmac(sha256) or hmac(sha512) not supported in QCA");
+        SCRAMResponse::setKeyCacheSize(32);
+        SCRAMResponse::clearKeyCache();
+    }
+
+    void testSHA256()
+    {
+        SCRAMResponse resp("sha256", serverFirst256, "pencil", clientFirst256, "");
+        QVERIFY(resp.isValid());
+        QVERIFY(!resp.isCached());
+        QCOMPARE(resp.getValue(),
+                 QByteArray("c=biws,r=rOprNGfwEbeRWgbNEkqO%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0,"
+                            "p=dHzbZapWIk4jUhN+Ute9ytag9zjfMHgsqmmiz7AndVQ="));
+        SCRAMSHA1Signature sig("v=6rriTRBi23WpRR/wtup+mMhUZUn/dB5nLTJRsjl95G4=", resp.getServerSignature());
+        QVERIFY(sig.isValid());
+    }
+
+    void testSHA512Plus()
+    {
+        QByteArray cbind(32, 0);
+        for (int i = 0; i < cbind.size(); ++i)
+            cbind[i] = char(i);
+        SCRAMResponse resp("sha512", "r=clientnonceSERVER,s=c2FsdHNhbHRzYWx0,i=4096", "pencil",
+                           "p=tls-exporter,,n=user,r=clientnonce", "", cbind);
+        QVERIFY(resp.isValid());
+        QCOMPARE(resp.getValue(),
+                 QByteArray("c=cD10bHMtZXhwb3J0ZXIsLAABAgMEBQYHCAkKCwwNDg8QERITFBUWFxgZGhscHR4f,"
+                            "r=clientnonceSERVER,p=zwbFzWnKRAMMKJNG89Qj8LWijh25KfPjLA336pzIM/MK4fEuDwjUjXBKBxYpTBCX"
+                            "TFDMHi4/94WoaYA24XE1/g=="));
+        SCRAMSHA1Signature sig("v=njUQa5GhOftJs75JHZcHzgZ/Qi+8S6XSj3BLM00fNeHd/1+ufnCCHgz+fhXgm5JbR9zqPzKzmNCJgDqv"
+                               "Od2Fcg==",
+                               resp.getServerSignature());
+        QVERIFY(sig.isValid());
+
+        // binding data without a "p=" header, and the other way around
+        QVERIFY(!SCRAMResponse("sha512", "r=clientnonceSERVER,s=c2FsdHNhbHRzYWx0,i=4096", "pencil",
+                               "n,,n=user,r=clientnonce", "", cbind)
+                     .isValid());
+        QVERIFY(!SCRAMResponse("sha512", "r=clientnonceSERVER,s=c2FsdHNhbHRzYWx0,i=4096", "pencil",
+                               "p=tls-exporter,,n=user,r=clientnonce", "")
+                     .isValid());
+    }
+
+    void testKeyCache()
+    {
+        SCRAMResponse first("sha256", serverFirst256, "pencil", clientFirst256, "");
+        QVERIFY(!first.isCached());
+
+        // another login. new nonces, same salt and iterations
+        SCRAMResponse again("sha256", "r=abcdefXYZ,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096", "pencil", "n,,n=user,r=abcdef",
+                            "");
+        QVERIFY(again.isValid());
+        QVERIFY(again.isCached());
+        QCOMPARE(again.getSaltedPassword(), first.getSaltedPassword());
+
+        // anything else of those changed has to derive again
+        QVERIFY(!SCRAMResponse("sha256", "r=abcdefXYZ,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096", "pencil2",
+                               "n,,n=user,r=abcdef", "")
+                     .isCached());
+        QVERIFY(!SCRAMResponse("sha256", "r=abcdefXYZ,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4097", "pencil",
+                               "n,,n=user,r=abcdef", "")
+                     .isCached());
+        QVERIFY(!SCRAMResponse("sha512", "r=abcdefXYZ,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096", "pencil",
+                               "n,,n=user,r=abcdef", "")
+                     .isCached());
+
+        SCRAMResponse::setKeyCacheSize(0);
+        QVERIFY(!SCRAMResponse("sha256", serverFirst256, "pencil", clientFirst256, "").isCached());
+    }
+
+    void testStoredSaltedPassword()
+    {
+        QString salted = SCRAMResponse("sha256", serverFirst256, "pencil", clientFirst256, "").getSaltedPassword();
+        SCRAMResponse::setKeyCacheSize(0);
+
+        SCRAMResponse resp("sha256", serverFirst256, "wrong", clientFirst256, salted);
+        QVERIFY(resp.isCached());
+        QVERIFY(resp.getValue().endsWith(",p=dHzbZapWIk4jUhN+Ute9ytag9zjfMHgsqmmiz7AndVQ="));
+
+        // one of SHA-1 doesn't fit
+        SCRAMResponse other("sha256", serverFirst256, "pencil", clientFirst256,
+                            QString::fromLatin1(QByteArray(20, 'x').toBase64()));
+        QVERIFY(!other.isCached());
+        QVERIFY(other.getValue().endsWith(",p=dHzbZapWIk4jUhN+Ute9ytag9zjfMHgsqmmiz7AndVQ="));
+    }
+
+    void testBadServerNonce()
+    {
+        QVERIFY(!SCRAMResponse("sha256", "r=evil,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096", "pencil", clientFirst256, "")
+                     .isValid());
+        QVERIFY(!SCRAMResponse("sha256", "r=rOprNGfwEbeRWgbNEkqO,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096", "pencil",
+                               clientFirst256, "")
+                     .isValid());
+    }
+
+    void testMechanisms()
+    {
+        QCOMPARE(SCRAMResponse::hashForMechanism("SCRAM-SHA-256"), QString("sha256"));
+        QCOMPARE(SCRAMResponse::hashForMechanism("SCRAM-SHA-512-PLUS"), QString("sha512"));
+        QCOMPARE(SCRAMResponse::hashForMechanism("SCRAM-SHA3-512"), QString());
+        QCOMPARE(SCRAMResponse::hashForMechanism("DIGEST-MD5"), QString());
+    }
+
+    void benchmarkLogin_data()
+    {
+        QTest::addColumn<int>("cacheSize");
+        QTest::newRow("kdf") << 0;
+        QTest::newRow("cached") << 32;
+    }
+
+    void benchmarkLogin()
+    {
+        QFETCH(int, cacheSize);
+        SCRAMResponse::setKeyCacheSize(cacheSize);
+        QBENCHMARK
+        {
+            SCRAMResponse resp("sha256", "r=abcdefXYZ,s=W22ZaJ0SNY7soEsUEjb6gQ==,i=10000", "pencil",
+                               "n,,n=user,r=abcdef", "");
+            QVERIFY(resp.isValid());
+        }
+    }
+
+private:
+    QCA::Initializer initializer;
+};
+
+QTTESTUTIL_REGISTER_TEST(SCRAMResponseTest);
+#include "scramresponsetest.moc"
@@ -0,0 +1,238 @@
+/*
+ * compacttree.cpp - compact arena-backed representation of a parsed stanza
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "compacttree.h"
+
+namespace XMPP {
+
+//----------------------------------------------------------------------------
+// XmlNameTable
+//----------------------------------------------------------------------------
+XmlNameTable::XmlNameTable()
+{
+    // id 0 is always the empty string (no namespace / no prefix)
+    names_.emplace_back();
+    index_.insert(QString(), 0);
+}
+
+XmlNameTable::Id XmlNameTable::intern(const QString &s)
+{
+    if (s.isEmpty())
+        return 0;
+    auto it = index_.constFind(s);
+    if (it != index_.constEnd())
+        return it.value();
+    Id id = Id(names_.size());
+    names_.push_back(s);
+    index_.insert(s, id);
+    return id;
+}
+
+//----------------------------------------------------------------------------
+// CompactElementTree
+//----------------------------------------------------------------------------
+CompactElementTree::CompactElementTree(std::shared_ptr<XmlNameTable> names, int reserveNodes, int reserveText) :
+    names_(std::move(names))
+{
+    if (reserveNodes > 0) {
+        nodes_.reserve(size_t(reserveNodes));
+        attrs_.reserve(size_t(reserveNodes));
+    }
+    if (reserveText > 0)
+        text_.reserve(reserveText);
+}
+
+CompactElementTree::NodeId CompactElementTree::appendNode(const Node &n)
+{
+    NodeId id = NodeId(nodes_.size());
+    nodes_.push_back(n);
+    if (n.parent != NoNode) {
+        Node &p = nodes_[n.parent];
+        if (p.lastChild == NoNode)
+            p.firstChild = id;
+        else
+            nodes_[p.lastChild].nextSibling = id;
+        p.lastChild = id;
+    }
+    return id;
+}
+
+void CompactElementTree::startElement(const QString &namespaceURI, const QString &localName,
+                                      const QXmlStreamAttributes &attrs)
+{
+    Node n;
+    n.parent = stack_.empty() ? NoNode : stack_.back();
+    n.ns     = names_->intern(namespaceURI);
+    n.name   = names_->intern(localName);
+    n.first  = quint32(attrs_.size());
+    n.count  = quint32(attrs.size());
+    for (auto const &a : attrs) {
+        Attribute ca;
+        ca.ns          = names_->intern(a.namespaceUri().toString());
+        ca.prefix      = names_->intern(a.prefix().toString());
+        ca.name        = names_->intern(a.name().toString());
+        ca.valueOffset = quint32(text_.size());
+        ca.valueLength = quint32(a.value().size());
+        text_.append(a.value().constData(), a.value().size());
+        attrs_.push_back(ca);
+    }
+    stack_.push_back(appendNode(n));
+}
+
+void CompactElementTree::endElement()
+{
+    Q_ASSERT(!stack_.empty());
+    stack_.pop_back();
+}
+
+void CompactElementTree::appendText(const QChar *text, int length)
+{
+    Q_ASSERT(!stack_.empty());
+    NodeId parent = stack_.back();
+    NodeId last   = nodes_[parent].lastChild;
+    if (last != NoNode && nodes_[last].isText && nodes_[last].first + nodes_[last].count == quint32(text_.size())) {
+        // the reader may split character data. merge adjacent chunks into one text node
+        nodes_[last].count += quint32(length);
+    } else {
+        Node n;
+        n.parent = parent;
+        n.isText = true;
+        n.first  = quint32(text_.size());
+        n.count  = quint32(length);
+        appendNode(n);
+    }
+    text_.append(text, length);
+}
+
+QString CompactElementTree::namespaceURI(NodeId node) const { return names_->name(nodes_[node].ns); }
+
+QString CompactElementTree::localName(NodeId node) const { return names_->name(nodes_[node].name); }
+
+QString CompactElementTree::attribute(const QString &name, NodeId node) const
+{
+    const Node &n = nodes_[node];
+    for (quint32 i = n.first; i < n.first + n.count; ++i) {
+        const Attribute &a = attrs_[i];
+        if (a.ns == 0 && names_->name(a.name) == name)
+            return textAt(a.valueOffset, a.valueLength);
+    }
+    return QString();
+}
+
+bool CompactElementTree::hasAttribute(const QString &name, NodeId node) const
+{
+    const Node &n = nodes_[node];
+    for (quint32 i = n.first; i < n.first + n.count; ++i) {
+        const Attribute &a = attrs_[i];
+        if (a.ns == 0 && names_->name(a.name) == name)
+            return true;
+    }
+    return false;
+}
+
+QString CompactElementTree::text(NodeId node) const
+{
+    const Node &n = nodes_[node];
+    if (n.isText)
+        return textAt(n.first, n.count);
+    QString ret;
+    for (NodeId c = n.firstChild; c != NoNode; c = nodes_[c].nextSibling)
+        ret += text(c);
+    return ret;
+}
+
+bool CompactElementTree::matches(NodeId node, const QString &localName, const QString &namespaceURI) const
+{
+    const Node &n = nodes_[node];
+    if (n.isText)
+        return false;
+    if (!localName.isEmpty() && names_->name(n.name) != localName)
+        return false;
+    if (!namespaceURI.isEmpty() && names_->name(n.ns) != namespaceURI)
+        return false;
+    return true;
+}
+
+CompactElementTree::NodeId CompactElementTree::firstChildElement(NodeId node, const QString &localName,
+                                                                 const QString &namespaceURI) const
+{
+    for (NodeId c = nodes_[node].firstChild; c != NoNode; c = nodes_[c].nextSibling) {
+        if (matches(c, localName, namespaceURI))
+            return c;
+    }
+    return NoNode;
+}
+
+CompactElementTree::NodeId CompactElementTree::nextSiblingElement(NodeId node, const QString &localName,
+                                                                  const QString &namespaceURI) const
+{
+    for (NodeId c = nodes_[node].nextSibling; c != NoNode; c = nodes_[c].nextSibling) {
+        if (matches(c, localName, namespaceURI))
+            return c;
+    }
+    return NoNode;
+}
+
+QDomElement CompactElementTree::buildElement(QDomDocument &doc, NodeId node) const
+{
+    const Node    &n    = nodes_[node];
+    const QString &ns   = names_->name(n.ns);
+    const QString &name = names_->name(n.name);
+
+    QDomElement e = ns.isEmpty() ? doc.createElement(name) : doc.createElementNS(ns, name);
+    for (quint32 i = n.first; i < n.first + n.count; ++i) {
+        const Attribute &a      = attrs_[i];
+        const QString   &attrNs = names_->name(a.ns);
+        QDomAttr         da;
+        if (attrNs.isEmpty())
+            da = doc.createAttribute(names_->name(a.name));
+        else
+            da = doc.createAttributeNS(attrNs, names_->name(a.name));
+        da.setPrefix(names_->name(a.prefix));
+        da.setValue(textAt(a.valueOffset, a.valueLength));
+        if (attrNs.isEmpty())
+            e.setAttributeNode(da);
+        else
+            e.setAttributeNodeNS(da);
+    }
+
+    for (NodeId c = n.firstChild; c != NoNode; c = nodes_[c].nextSibling) {
+        const Node &cn = nodes_[c];
+        if (cn.isText)
+            e.appendChild(doc.createTextNode(textAt(cn.first, cn.count)));
+        else
+            e.appendChild(buildElement(doc, c));
+    }
+    return e;
+}
+
+QDomElement CompactElementTree::toDomElement(QDomDocument &doc) const
+{
+    if (nodes_.empty())
+        return QDomElement();
+    return buildElement(doc, Root);
+}
+
+size_t CompactElementTree::memoryUsage() const
+{
+    return sizeof(*this) + nodes_.capacity() * sizeof(Node) + attrs_.capacity() * sizeof(Attribute)
+        + stack_.capacity() * sizeof(NodeId) + size_t(text_.capacity()) * sizeof(QChar);
+}
+
+} // namespace XMPP
@@ -0,0 +1,126 @@
+/*
+ * compacttree.h - compact arena-backed representation of a parsed stanza
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef XMPP_COMPACTTREE_H
+#define XMPP_COMPACTTREE_H
+
+#include <QDomElement>
+#include <QHash>
+#include <QString>
+#include <QXmlStreamAttributes>
+
+#include <memory>
+#include <vector>
+
+namespace XMPP {
+
+// Interns element/attribute names and namespaces. A stream sees only a few
+// dozen distinct names, so every tree built by the same parser refers to them
+// by a small integer id instead of carrying its own copies.
+class XmlNameTable {
+public:
+    using Id = quint32;
+
+    // A peer may send arbitrary element names. Users of a table start a fresh one
+    // once it got that big; trees still referring to the old one keep it alive.
+    static constexpr int MaxNames = 4096;
+
+    XmlNameTable();
+
+    Id             intern(const QString &s);
+    const QString &name(Id id) const { return names_[id]; }
+    int            size() const { return int(names_.size()); }
+    bool           isFull() const { return size() > MaxNames; }
+
+private:
+    QHash<QString, Id>   index_;
+    std::vector<QString> names_;
+};
+
+// A stanza parsed without building a QDomDocument. All nodes, attributes and
+// character data of one top-level element are kept in flat arrays, and a
+// QDomElement is only materialized on demand with toDomElement().
+class CompactElementTree {
+public:
+    using NodeId                   = quint32;
+    static constexpr NodeId NoNode = NodeId(-1);
+    static constexpr NodeId Root   = 0;
+
+    explicit CompactElementTree(std::shared_ptr<XmlNameTable> names, int reserveNodes = 0, int reserveText = 0);
+
+    // building (used by the parser)
+    void startElement(const QString &namespaceURI, const QString &localName, const QXmlStreamAttributes &attrs);
+    void endElement();
+    void appendText(const QChar *text, int length);
+    int  depth() const { return int(stack_.size()); }
+    bool isComplete() const { return !nodes_.empty() && stack_.empty(); }
+
+    // read access
+    bool    isNull() const { return nodes_.empty(); }
+    int     nodeCount() const { return int(nodes_.size()); }
+    int     textSize() const { return int(text_.size()); }
+    bool    isElement(NodeId node) const { return !nodes_[node].isText; }
+    QString namespaceURI(NodeId node = Root) const;
+    QString localName(NodeId node = Root) const;
+    QString attribute(const QString &name, NodeId node = Root) const;
+    bool    hasAttribute(const QString &name, NodeId node = Root) const;
+    QString text(NodeId node = Root) const;
+    NodeId  firstChildElement(NodeId node = Root, const QString &localName = QString(),
+                              const QString &namespaceURI = QString()) const;
+    NodeId  nextSiblingElement(NodeId node, const QString &localName = QString(),
+                               const QString &namespaceURI = QString()) const;
+
+    QDomElement toDomElement(QDomDocument &doc) const;
+    size_t      memoryUsage() const;
+
+private:
+    struct Node {
+        NodeId           parent      = NoNode;
+        NodeId           firstChild  = NoNode;
+        NodeId           lastChild   = NoNode;
+        NodeId           nextSibling = NoNode;
+        XmlNameTable::Id ns          = 0;
+        XmlNameTable::Id name        = 0;
+        quint32          first       = 0; // first attribute, or text offset for text nodes
+        quint32          count       = 0; // attribute count, or text length for text nodes
+        bool             isText      = false;
+    };
+    struct Attribute {
+        XmlNameTable::Id ns;
+        XmlNameTable::Id prefix;
+        XmlNameTable::Id name;
+        quint32          valueOffset;
+        quint32          valueLength;
+    };
+
+    NodeId      appendNode(const Node &n);
+    bool        matches(NodeId node, const QString &localName, const QString &namespaceURI) const;
+    QDomElement buildElement(QDomDocument &doc, NodeId node) const;
+    QString     textAt(quint32 offset, quint32 length) const { return QString(text_.constData() + offset, int(length)); }
+
+    std::shared_ptr<XmlNameTable> names_;
+    std::vector<Node>             nodes_;
+    std::vector<Attribute>        attrs_;
+    std::vector<NodeId>           stack_;
+    QString                       text_; // attribute values and character data
+};
+
+} // namespace XMPP
+
+#endif // XMPP_COMPACTTREE_H
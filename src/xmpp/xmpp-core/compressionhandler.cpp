@@ -1,5 +1,4 @@
 #include "compressionhandler.h"
-#include "xmpp/zlib/zlibcompressor.h"
 #include "xmpp/zlib/zlibdecompressor.h"
 
 #include <QDebug>
@@ -9,6 +8,13 @@ CompressionHandler::CompressionHandler() : errorCode_(0)
 {
     outgoing_buffer_.open(QIODevice::ReadWrite);
     compressor_ = new ZLibCompressor(&outgoing_buffer_);
+    // the output is picked up on the next event loop turn anyway, so let the
+    // stanzas written during this turn share one deflate block
+    compressor_->setFlushPolicy(ZLibCompressor::FlushCoalesced);
+    connect(compressor_, &ZLibCompressor::flushed, this, [this](int plainBytes) {
+        outgoingPlain_ += plainBytes;
+        QTimer::singleShot(0, this, SIGNAL(readyReadOutgoing()));
+    });
 
     incoming_buffer_.open(QIODevice::ReadWrite);
     decompressor_ = new ZLibDecompressor(&incoming_buffer_);
@@ -35,9 +41,7 @@ void CompressionHandler::write(const QByteArray &a)
 {
     // qDebug() << QString("CompressionHandler::write(%1)").arg(a.size());
     errorCode_ = compressor_->write(a);
-    if (!errorCode_)
-        QTimer::singleShot(0, this, SIGNAL(readyReadOutgoing()));
-    else
+    if (errorCode_)
         QTimer::singleShot(0, this, SIGNAL(error()));
 }
 
@@ -57,8 +61,20 @@ QByteArray CompressionHandler::readOutgoing(int *i)
     QByteArray b = outgoing_buffer_.buffer();
     outgoing_buffer_.buffer().clear();
     outgoing_buffer_.reset();
-    *i = b.size();
+    // SecureLayer accounts written bytes in terms of what was passed to write()
+    *i             = outgoingPlain_;
+    outgoingPlain_ = 0;
     return b;
 }
 
 int CompressionHandler::errorCode() { return errorCode_; }
+
+void CompressionHandler::setFlushPolicy(int maxPendingBytes, int maxDelayMs)
+{
+    if (maxPendingBytes > 0)
+        compressor_->setFlushPolicy(ZLibCompressor::FlushCoalesced, maxPendingBytes, maxDelayMs);
+    else
+        compressor_->setFlushPolicy(ZLibCompressor::FlushEveryWrite);
+}
+
+ZLibCompressor::Stats CompressionHandler::stats() const { return compressor_->stats(); }
@@ -1,10 +1,11 @@
 #ifndef COMPRESSIONHANDLER_H
 #define COMPRESSIONHANDLER_H
 
+#include "xmpp/zlib/zlibcompressor.h"
+
 #include <QBuffer>
 #include <QObject>
 
-class ZLibCompressor;
 class ZLibDecompressor;
 
 class CompressionHandler : public QObject {
@@ -19,6 +20,9 @@ public:
     QByteArray readOutgoing(int *);
     int        errorCode();
 
+    void                  setFlushPolicy(int maxPendingBytes, int maxDelayMs);
+    ZLibCompressor::Stats stats() const;
+
 signals:
     void readyRead();
     void readyReadOutgoing();
@@ -29,6 +33,7 @@ private:
     ZLibDecompressor *decompressor_;
     QBuffer           outgoing_buffer_, incoming_buffer_;
     int               errorCode_;
+    int               outgoingPlain_ = 0; // plain bytes behind the compressed data in outgoing_buffer_
 };
 
 #endif // COMPRESSIONHANDLER_H
@@ -34,6 +34,8 @@ public:
     QDomElement          e;
     QString              str;
 
+    std::shared_ptr<const CompactElementTree> tree;
+
     QXmlStreamNamespaceDeclarations nsPrefixes;
 };
 
@@ -107,9 +109,29 @@ QString Parser::Event::actualString() const
 QDomElement Parser::Event::element() const
 {
     Q_ASSERT(d != nullptr);
+    if (d->e.isNull() && d->tree) {
+        QDomDocument doc;
+        d->e = d->tree->toDomElement(doc);
+    }
+    return d->e;
+}
+
+QDomElement Parser::Event::element(QDomDocument &doc) const
+{
+    Q_ASSERT(d != nullptr);
+    if (!d->tree)
+        return doc.importNode(d->e, true).toElement();
+    if (d->e.isNull() || d->e.ownerDocument() != doc)
+        d->e = d->tree->toDomElement(doc); // build straight into the target document, no import needed
     return d->e;
 }
 
+std::shared_ptr<const CompactElementTree> Parser::Event::compactElement() const
+{
+    Q_ASSERT(d != nullptr);
+    return d->tree;
+}
+
 void Parser::Event::setDocumentOpen(const QString &namespaceURI, const QString &localName, const QString &qName,
                                     const QXmlStreamAttributes &atts, const QXmlStreamNamespaceDeclarations &nsPrefixes)
 {
@@ -138,6 +160,14 @@ void Parser::Event::setElement(const QDomElement &elem)
     d->e    = elem;
 }
 
+void Parser::Event::setCompactElement(std::shared_ptr<const CompactElementTree> tree)
+{
+    ensureD();
+    d->type = Element;
+    d->e    = QDomElement();
+    d->tree = std::move(tree);
+}
+
 void Parser::Event::setError()
 {
     ensureD();
@@ -155,6 +185,14 @@ void Parser::Event::setActualString(const QString &str)
 //----------------------------------------------------------------------------
 class Parser::Private {
 public:
+    Private(Mode mode, std::shared_ptr<XmlNameTable> names) : mode(mode), names(std::move(names)) { }
+
+    Mode                                mode;
+    std::shared_ptr<XmlNameTable>       names;
+    std::shared_ptr<CompactElementTree> tree;
+    int                                 lastNodeCount = 0; // sizing hints for the next compact tree
+    int                                 lastTextSize  = 0;
+
     QDomDocument          doc;
     QDomElement           curElement;
     QDomElement           element; // root part
@@ -196,7 +234,14 @@ public:
     {
         auto    ns   = reader.namespaceUri().toString();
         QString name = reader.name().toString();
-        if (streamOpened) {
+        if (streamOpened && (tree || (mode == Mode::Compact && curElement.isNull()))) {
+            if (!tree) {
+                if (names->isFull())
+                    names = std::make_shared<XmlNameTable>();
+                tree = std::make_shared<CompactElementTree>(names, lastNodeCount, lastTextSize);
+            }
+            tree->startElement(ns, name, reader.attributes());
+        } else if (streamOpened) {
             QDomElement newEl;
             if (ns.isEmpty())
                 newEl = doc.createElement(name);
@@ -234,6 +279,17 @@ public:
 
     void handleEndElement()
     {
+        if (tree) {
+            tree->endElement();
+            if (tree->isComplete()) {
+                lastNodeCount = tree->nodeCount();
+                lastTextSize  = tree->textSize();
+                Event e;
+                e.setCompactElement(std::move(tree));
+                events.push(e);
+            }
+            return;
+        }
         if (curElement.isNull() && reader.qualifiedName() == streamQName) {
             Event e;
             e.setDocumentClose(reader.namespaceUri().toString(), reader.name().toString(), streamQName);
@@ -274,6 +330,11 @@ public:
 
     void handleText()
     {
+        if (tree) {
+            const auto text = reader.text();
+            tree->appendText(text.constData(), int(text.size()));
+            return;
+        }
         if (curElement.isNull()) {
             if (!reader.isWhitespace())
                 qWarning("Text node out of element (ignored): %s", qPrintable(reader.text().toString()));
@@ -328,33 +389,74 @@ Parser::Parser() { reset(); }
 
 Parser::~Parser() { }
 
-void Parser::reset() { d.reset(new Private); }
+// the reader state is allocated with the first data, idle parsers of unused streams are cheap this way
+Parser::Private *Parser::data()
+{
+    if (!d) {
+        if (!names_ || names_->isFull())
+            names_ = std::make_shared<XmlNameTable>();
+        d.reset(new Private(mode_, names_));
+    }
+    return d.get();
+}
+
+void Parser::reset() { d.reset(); }
+
+void Parser::setMode(Mode mode)
+{
+    mode_ = mode;
+    if (d)
+        d->mode = mode;
+}
+
+void Parser::setNameTable(std::shared_ptr<XmlNameTable> names)
+{
+    names_ = std::move(names);
+    // null is for a private table, and a live parser can't be without one
+    if (d)
+        d->names = names_ ? names_ : std::make_shared<XmlNameTable>();
+}
+
+Parser::Mode Parser::mode() const { return mode_; }
 
 void Parser::appendData(const QByteArray &a)
 {
     if (a.isEmpty())
         return;
-    d->in.push_back(a);
+    Private *p = data();
+    p->in.push_back(a);
     for (int i = a.size() - 1; i >= 0; --i) {
         if (a.at(i) == '>') { // this may happend in CDATA too, but let's hope Qt handles it properly
-            d->completeTag    = a.constData();
-            d->completeOffset = i;
+            p->completeTag    = a.constData();
+            p->completeOffset = i;
             break;
         }
     }
 }
 
-Parser::Event Parser::readNext() { return d->readNext(); }
+Parser::Event Parser::readNext() { return d ? d->readNext() : Event(); }
 
 QByteArray Parser::unprocessed() const
 {
     QByteArray ret;
+    if (!d)
+        return ret;
     for (auto const &a : d->in) {
         ret += a;
     }
     return ret;
 }
 
-QStringView Parser::encoding() const { return d->reader.documentEncoding(); }
+qsizetype Parser::bufferedSize() const
+{
+    qsizetype size = 0;
+    if (d) {
+        for (auto const &a : d->in)
+            size += a.size();
+    }
+    return size;
+}
+
+QStringView Parser::encoding() const { return d ? d->reader.documentEncoding() : QStringView(); }
 
 }
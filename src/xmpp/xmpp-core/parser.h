@@ -20,6 +20,8 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include "compacttree.h"
+
 #include <QDomElement>
 #include <QExplicitlySharedDataPointer>
 #include <QXmlStreamAttributes>
@@ -30,6 +32,11 @@ namespace XMPP {
 
 class Parser {
 public:
+    // Dom builds a QDomElement for every top-level element while parsing.
+    // Compact fills a CompactElementTree instead and defers DOM construction
+    // until somebody calls Event::element().
+    enum class Mode { Dom, Compact };
+
     struct NSPrefix {
         QString name;
         QString value;
@@ -56,7 +63,9 @@ public:
         QXmlStreamAttributes atts() const;
 
         // for element
-        QDomElement element() const;
+        QDomElement                               element() const;
+        QDomElement                               element(QDomDocument &doc) const;
+        std::shared_ptr<const CompactElementTree> compactElement() const;
 
         // for any
         QString actualString() const;
@@ -66,6 +75,7 @@ public:
                              const QXmlStreamAttributes &atts, const QXmlStreamNamespaceDeclarations &nsPrefixes);
         void setDocumentClose(const QString &namespaceURI, const QString &localName, const QString &qName);
         void setElement(const QDomElement &elem);
+        void setCompactElement(std::shared_ptr<const CompactElementTree> tree);
         void setError();
         void setActualString(const QString &);
 
@@ -79,14 +89,22 @@ public:
     ~Parser();
 
     void        reset();
+    void        setMode(Mode mode);
+    Mode        mode() const;
+    void        setNameTable(std::shared_ptr<XmlNameTable> names); // to share it with other parsers
     void        appendData(const QByteArray &a);
     Event       readNext();
     QByteArray  unprocessed() const;
+    qsizetype   bufferedSize() const; // size of unprocessed()
     QStringView encoding() const;
 
 private:
     class Private;
-    std::unique_ptr<Private> d;
+    Private *data();
+
+    std::unique_ptr<Private>      d;
+    Mode                          mode_ = Mode::Dom;
+    std::shared_ptr<XmlNameTable> names_;
 };
 
 } // namespace XMPP
@@ -90,6 +90,10 @@ StreamFeatures::StreamFeatures()
     sm_supported       = false;
     session_supported  = false;
     session_required   = false;
+    sasl2_supported    = false;
+    sasl2_sm_supported = false;
+    bind2_supported    = false;
+    bind2_sm_supported = false;
 }
 
 //----------------------------------------------------------------------------
@@ -173,10 +177,11 @@ void BasicProtocol::reset()
     sendList.clear();
 }
 
-void BasicProtocol::sendStanza(const QDomElement &e)
+void BasicProtocol::sendStanza(const QDomElement &e, const QByteArray &serialized)
 {
     SendItem i;
-    i.stanzaToSend = e;
+    i.stanzaToSend     = e;
+    i.serializedStanza = serialized;
     sendList += i;
 }
 
@@ -526,7 +531,10 @@ bool BasicProtocol::doStep(const QDomElement &e)
             // outgoing stanza?
             if (!i.stanzaToSend.isNull()) {
                 ++stanzasPending;
-                writeElement(i.stanzaToSend, TypeStanza, true);
+                if (i.serializedStanza.isEmpty())
+                    writeElement(i.stanzaToSend, TypeStanza, true);
+                else
+                    writeSerialized(i.stanzaToSend, i.serializedStanza, TypeStanza, true);
                 event = ESend;
             }
             // direct send?
@@ -615,6 +623,23 @@ void CoreProtocol::init()
     sasl_started     = false;
     compress_started = false;
 
+    // sasl2
+    allowSASL2 = true;
+    sasl2      = false;
+    fast_auth  = false;
+    fast_tried = false;
+    fastRequested.clear();
+    userAgentId.clear();
+    userAgentSoftware.clear();
+    userAgentDevice.clear();
+    sasl2Success = QDomElement();
+
+    fastMech.clear();
+    fastToken.clear();
+    fastExpiry       = QDateTime();
+    fastCount        = 0;
+    fastTokenChanged = false;
+
     sm.reset();
 }
 
@@ -633,13 +658,17 @@ void CoreProtocol::needTimer(int seconds)
 
 void CoreProtocol::sendStanza(const QDomElement &e)
 {
-    if (sm.isActive()) {
-        int len = sm.addUnacknowledgedStanza(e);
-        if (len > 5 && len % 4 == 0)
-            if (needSMRequest())
-                event = ESend;
+    if (!sm.isActive()) {
+        BasicProtocol::sendStanza(e);
+        return;
     }
-    BasicProtocol::sendStanza(e);
+    // serialize once, for the wire and for a possible resend after resumption
+    QByteArray data = serializeElement(e);
+    int        len  = sm.addUnacknowledgedStanza(data);
+    if ((len > 5 && len % 4 == 0) || sm.isAckRequestDue())
+        if (needSMRequest())
+            event = ESend;
+    BasicProtocol::sendStanza(e, data);
 }
 
 void CoreProtocol::startClientOut(const Jid &_jid, bool _oldOnly, bool tlsActive, bool _doAuth, bool _doCompress)
@@ -714,6 +743,19 @@ void CoreProtocol::setFrom(const QString &s) { from = s; }
 
 void CoreProtocol::setDialbackKey(const QString &s) { dialback_key = s; }
 
+void CoreProtocol::setAllowSASL2(bool b) { allowSASL2 = b; }
+
+void CoreProtocol::setUserAgent(const QString &id, const QString &software, const QString &device)
+{
+    userAgentId       = id;
+    userAgentSoftware = software;
+    userAgentDevice   = device;
+}
+
+bool CoreProtocol::isSASL2() const { return sasl2; }
+
+bool CoreProtocol::isFast() const { return fast_auth; }
+
 bool CoreProtocol::loginComplete()
 {
     setReady(true);
@@ -739,6 +781,331 @@ bool CoreProtocol::loginComplete()
     return true;
 }
 
+void CoreProtocol::handleSMEnabled(const QDomElement &e)
+{
+#ifdef IRIS_SM_DEBUG
+    qDebug() << "Stream Management: [INF] Enabled";
+#endif
+    QString rs = e.attribute("resume");
+    QString id = (rs == "true" || rs == "1") ? e.attribute("id") : QString();
+    sm.start(id);
+    if (!id.isEmpty()) {
+#ifdef IRIS_SM_DEBUG
+        qDebug() << "Stream Management: [INF] Resumption Supported";
+#endif
+        QString location = e.attribute("location").trimmed();
+        if (!location.isEmpty()) {
+            int         port_off = 0;
+            QStringView sm_host;
+            int         sm_port       = 0;
+            auto        location_view = QStringView { location };
+            if (location.startsWith('[')) { // ipv6
+                port_off = location.indexOf(']');
+                if (port_off != -1) { // looks valid
+                    sm_host = location_view.mid(1, port_off - 1);
+                    if (location.length() > port_off + 2 && location.at(port_off + 1) == ':')
+                        sm_port = location_view.mid(port_off + 2).toUInt();
+                }
+            }
+            if (port_off == 0) {
+                port_off = location.indexOf(':');
+                if (port_off != -1) {
+                    sm_host = location_view.left(port_off);
+                    sm_port = location_view.mid(port_off + 1).toUInt();
+                } else {
+                    sm_host = location_view.mid(0);
+                }
+            }
+            sm.setLocation(sm_host.toString(), sm_port);
+        }
+    } // else resumption is not supported on this server
+}
+
+void CoreProtocol::handleSMResumed(const QDomElement &e)
+{
+    sm.resume(e.attribute("h").toUInt());
+    while (true) {
+        QByteArray st = sm.getUnacknowledgedStanza();
+        if (st.isEmpty())
+            break;
+        writeSerialized(st, TypeElement, false);
+    }
+}
+
+void CoreProtocol::extractSASLFailure(const QDomElement &e, const QString &textNS)
+{
+    QDomElement t = firstChildElement(e);
+    if (t.isNull() || t.namespaceURI() != NS_SASL)
+        errCond = {};
+    else
+        errCond = stringToSASLCond(t.tagName());
+
+    // handle text elements
+    auto                  nodes = e.elementsByTagNameNS(textNS, QLatin1String("text"));
+    decltype(errLangText) lt;
+    for (int i = 0; i < nodes.count(); i++) {
+        auto    e    = nodes.item(i).toElement();
+        QString lang = e.attributeNS(NS_SASL, "lang", "");
+        lt.insert(lang, e.text());
+    }
+
+    errLangText = lt;
+}
+
+// XEP-0484 mechanisms without channel binding. HT-SHA-256-NONE => hmac(sha256)
+static QString fastHmacType(const QString &mech)
+{
+    if (!mech.startsWith(QLatin1String("HT-SHA-")) || !mech.endsWith(QLatin1String("-NONE")))
+        return QString();
+    const QString bits = mech.mid(7, mech.size() - 12);
+    if (bits != QLatin1String("256") && bits != QLatin1String("384") && bits != QLatin1String("512"))
+        return QString();
+    QString type = QLatin1String("hmac(sha") + bits + QLatin1Char(')');
+    return QCA::isSupported(type.toLatin1()) ? type : QString();
+}
+
+// what may be done along with the SASL2 authentication
+static void extractSASL2Inline(const QDomElement &e, StreamFeatures &f)
+{
+    for (QDomElement c = e.firstChildElement(); !c.isNull(); c = c.nextSiblingElement()) {
+        if (c.localName() == QLatin1String("bind") && c.namespaceURI() == NS_BIND2) {
+            f.bind2_supported = true;
+            QDomElement inl   = c.firstChildElement(QLatin1String("inline"));
+            for (QDomElement v = inl.firstChildElement(); !v.isNull(); v = v.nextSiblingElement()) {
+                if (v.localName() == QLatin1String("feature") && v.attribute("var") == NS_STREAM_MANAGEMENT)
+                    f.bind2_sm_supported = true;
+            }
+        } else if (c.localName() == QLatin1String("sm") && c.namespaceURI() == NS_STREAM_MANAGEMENT) {
+            f.sasl2_sm_supported = true;
+        } else if (c.localName() == QLatin1String("fast") && c.namespaceURI() == NS_FAST) {
+            for (QDomElement m = c.firstChildElement(); !m.isNull(); m = m.nextSiblingElement()) {
+                if (m.localName() == QLatin1String("mechanism"))
+                    f.fast_mechs += m.text();
+            }
+        }
+    }
+}
+
+static QDomElement childElement(const QDomElement &e, const char *ns, const QString &name)
+{
+    for (QDomElement c = e.firstChildElement(); !c.isNull(); c = c.nextSiblingElement()) {
+        if (c.localName() == name && c.namespaceURI() == QLatin1String(ns))
+            return c;
+    }
+    return QDomElement();
+}
+
+// doesn't stop at the first difference, so the time doesn't tell how much of a proof was right
+static bool constantTimeEquals(const QByteArray &a, const QByteArray &b)
+{
+    if (a.size() != b.size())
+        return false;
+    unsigned char diff = 0;
+    for (int i = 0; i < a.size(); ++i)
+        diff |= (unsigned char)(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+bool CoreProtocol::canUseSASL2() const
+{
+    if (!allowSASL2 || server || !features.sasl2_supported)
+        return false;
+    // there is no stream restart after SASL2, so no chance to bind the usual way
+    if (doBinding && !features.bind2_supported)
+        return false;
+    // Bind2 lets the server pick the resource, only the classic bind can ask for a particular one
+    if (doBinding && !jid_.resource().isEmpty())
+        return false;
+    if (sm.state().isEnabled() && sm.state().isResumption() && !features.sasl2_sm_supported)
+        return false;
+    return true;
+}
+
+bool CoreProtocol::canUseFast() const
+{
+    return !fastToken.isEmpty() && !userAgentId.isEmpty() && features.fast_mechs.contains(fastMech)
+        && !fastHmacType(fastMech).isEmpty();
+}
+
+QByteArray CoreProtocol::fastHash(const QByteArray &label) const
+{
+    // no channel binding data with the -NONE mechanisms
+    QCA::MessageAuthenticationCode mac(fastHmacType(fastMech), QCA::SymmetricKey(fastToken));
+    mac.update(label);
+    return mac.final().toByteArray();
+}
+
+QDomElement CoreProtocol::sasl2Authenticate()
+{
+    QDomElement e = doc.createElementNS(NS_SASL2, "authenticate");
+    e.setAttribute("mechanism", sasl_mech);
+    if (!sasl_step.isEmpty()) {
+        QDomElement r = doc.createElementNS(NS_SASL2, "initial-response");
+        r.appendChild(doc.createTextNode(QCA::Base64().arrayToString(sasl_step)));
+        e.appendChild(r);
+    }
+
+    if (!userAgentId.isEmpty()) {
+        QDomElement ua = doc.createElementNS(NS_SASL2, "user-agent");
+        ua.setAttribute("id", userAgentId);
+        if (!userAgentSoftware.isEmpty()) {
+            QDomElement sw = doc.createElementNS(NS_SASL2, "software");
+            sw.appendChild(doc.createTextNode(userAgentSoftware));
+            ua.appendChild(sw);
+        }
+        if (!userAgentDevice.isEmpty()) {
+            QDomElement dev = doc.createElementNS(NS_SASL2, "device");
+            dev.appendChild(doc.createTextNode(userAgentDevice));
+            ua.appendChild(dev);
+        }
+        e.appendChild(ua);
+    }
+
+    if (sm.state().isEnabled() && sm.state().isResumption()) {
+        QDomElement r = doc.createElementNS(NS_STREAM_MANAGEMENT, "resume");
+        r.setAttribute("previd", sm.state().resumption_id);
+        r.setAttribute("h", sm.state().received_count);
+        e.appendChild(r);
+    }
+
+    // the server ignores it if the session gets resumed, and binds a new resource otherwise
+    if (doBinding) {
+        QDomElement b = doc.createElementNS(NS_BIND2, "bind");
+        if (!userAgentSoftware.isEmpty()) {
+            QDomElement tag = doc.createElementNS(NS_BIND2, "tag");
+            tag.appendChild(doc.createTextNode(userAgentSoftware));
+            b.appendChild(tag);
+        }
+        if (sm.state().isEnabled() && features.bind2_sm_supported) {
+            QDomElement en = doc.createElementNS(NS_STREAM_MANAGEMENT, "enable");
+            en.setAttribute("resume", "true");
+            b.appendChild(en);
+        }
+        e.appendChild(b);
+    }
+
+    if (fast_auth) {
+        QDomElement f = doc.createElementNS(NS_FAST, "fast");
+        f.setAttribute("count", ++fastCount);
+        e.appendChild(f);
+        fastTokenChanged = true; // the count has to be remembered
+    } else if (!userAgentId.isEmpty()) {
+        static const QStringList preference { "HT-SHA-512-NONE", "HT-SHA-384-NONE", "HT-SHA-256-NONE" };
+        for (const QString &mech : preference) {
+            if (features.fast_mechs.contains(mech) && !fastHmacType(mech).isEmpty()) {
+                QDomElement r = doc.createElementNS(NS_FAST, "request-token");
+                r.setAttribute("mechanism", mech);
+                e.appendChild(r);
+                fastRequested = mech;
+                break;
+            }
+        }
+    }
+    return e;
+}
+
+bool CoreProtocol::sasl2Step(const QDomElement &e)
+{
+    if (e.localName() == QLatin1String("challenge")) {
+        if (fast_auth) { // the token mechanisms have no challenges
+            event     = EError;
+            errorCode = ErrProtocol;
+            return true;
+        }
+        sasl_step = QCA::Base64().stringToArray(e.text()).toByteArray();
+        need      = NSASLNext;
+        step      = GetSASLNext;
+        return false;
+    } else if (e.localName() == QLatin1String("success")) {
+        QString    additional = childElement(e, NS_SASL2, "additional-data").text();
+        QByteArray data       = QCA::Base64().stringToArray(additional).toByteArray();
+        sasl2Success          = e;
+        sasl_authed           = true;
+        if (fast_auth) {
+            // the server proves it knows the token too. without the proof anyone could claim success
+            if (data.isEmpty() || !constantTimeEquals(data, fastHash("Responder"))) {
+                event     = EError;
+                errorCode = ErrProtocol;
+                return true;
+            }
+        } else if (!data.isEmpty()) {
+            sasl_step = data;
+            need      = NSASLNext;
+            step      = GetSASLNext;
+            return false;
+        }
+        event = ESASLSuccess;
+        step  = HandleSASLSuccess;
+        return true;
+    } else if (e.localName() == QLatin1String("failure")) {
+        if (fast_auth) {
+            // expired or revoked. forget it and try again the usual way, SASL2 allows that
+            fastMech.clear();
+            fastToken.clear();
+            fastExpiry       = QDateTime();
+            fastCount        = 0;
+            fastTokenChanged = true;
+            fast_auth        = false;
+            sasl_mech.clear();
+            sasl_step.clear();
+            step = HandleFeatures;
+            return processStep();
+        }
+        extractSASLFailure(e, NS_SASL2);
+        event     = EError;
+        errorCode = ErrAuth;
+        return true;
+    }
+
+    // <continue/> with SASL2 tasks isn't supported
+    event     = EError;
+    errorCode = ErrProtocol;
+    return true;
+}
+
+bool CoreProtocol::sasl2Complete()
+{
+    Jid j = childElement(sasl2Success, NS_SASL2, "authorization-identifier").text();
+    if (j.isValid())
+        jid_ = j;
+
+    QDomElement token = childElement(sasl2Success, NS_FAST, "token");
+    if (!token.isNull()) {
+        if (!fast_auth)
+            fastMech = fastRequested;
+        fastToken        = token.attribute("token").toUtf8();
+        fastExpiry       = QDateTime::fromString(token.attribute("expiry"), Qt::ISODate);
+        fastCount        = 0;
+        fastTokenChanged = true;
+    }
+
+    QDomElement resumed = childElement(sasl2Success, NS_STREAM_MANAGEMENT, "resumed");
+    if (!resumed.isNull()) {
+        setReady(true);
+        handleSMResumed(resumed);
+        needTimer(SM_TIMER_INTERVAL_SECS);
+        event = EReady;
+        step  = Done;
+        return true;
+    }
+
+    // a new session. the old one is gone if we tried to resume
+    sm.state().resumption_id.clear();
+    features.session_required = false; // Bind2 has done all of it
+
+    QDomElement bound   = childElement(sasl2Success, NS_BIND2, "bound");
+    QDomElement enabled = childElement(bound, NS_STREAM_MANAGEMENT, "enabled");
+    if (!enabled.isNull()) {
+        setReady(true);
+        handleSMEnabled(enabled);
+        needTimer(SM_TIMER_INTERVAL_SECS);
+        event = EReady;
+        step  = Done;
+        return true;
+    }
+    return loginComplete(); // enables SM the old way, if the server has it but not inline
+}
+
 int CoreProtocol::getOldErrorCode(const QDomElement &e)
 {
     QDomElement err = e.elementsByTagNameNS(NS_CLIENT, "error").item(0).toElement();
@@ -1103,6 +1470,22 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 
         // deal with SASL?
         if (!sasl_authed) {
+            if (canUseSASL2()) {
+                sasl2 = true;
+                if (!fast_tried && canUseFast()) {
+                    // no password, no KDF, and only one round trip
+                    fast_tried = true;
+                    fast_auth  = true;
+                    sasl_mech  = fastMech;
+                    sasl_step  = jid_.node().toUtf8() + '\0' + fastHash("Initiator");
+                    step       = GetSASLFirst;
+                    return processStep();
+                }
+                need = NSASLFirst;
+                step = GetSASLFirst;
+                return false;
+            }
+
             if (!features.sasl_supported) {
                 // SASL MUST be supported
                 // event = EError;
@@ -1163,6 +1546,13 @@ bool CoreProtocol::normalStep(const QDomElement &e)
             return true;
         }
     } else if (step == GetSASLFirst) {
+        if (sasl2) {
+            send(sasl2Authenticate(), true);
+            event = ESend;
+            step  = GetSASLChallenge;
+            return true;
+        }
+
         QDomElement e = doc.createElementNS(NS_SASL, "auth");
         e.setAttribute("mechanism", sasl_mech);
         if (!sasl_step.isEmpty()) {
@@ -1209,7 +1599,7 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 #ifdef XMPP_TEST
             TD::msg(QString("SASL OUT: [%1]").arg(printArray(sasl_step)));
 #endif
-            QDomElement e = doc.createElementNS(NS_SASL, "response");
+            QDomElement e = doc.createElementNS(sasl2 ? NS_SASL2 : NS_SASL, "response");
             if (!stepData.isEmpty())
                 e.appendChild(doc.createTextNode(QCA::Base64().arrayToString(stepData)));
 
@@ -1219,6 +1609,9 @@ bool CoreProtocol::normalStep(const QDomElement &e)
             return true;
         }
     } else if (step == HandleSASLSuccess) {
+        if (sasl2) // no stream restart and no security layer
+            return sasl2Complete();
+
         need  = NSASLLayer;
         spare = resetStream();
         step  = Start;
@@ -1336,6 +1729,15 @@ bool CoreProtocol::normalStep(const QDomElement &e)
                     for (int n = 0; n < l.count(); ++n)
                         f.sasl_mechs += l.item(n).toElement().text();
 
+                } else if (c.localName() == QLatin1String("authentication") && c.namespaceURI() == NS_SASL2) {
+                    f.sasl2_supported = true;
+                    for (QDomElement m = c.firstChildElement(); !m.isNull(); m = m.nextSiblingElement()) {
+                        if (m.localName() == QLatin1String("mechanism"))
+                            f.sasl2_mechs += m.text();
+                        else if (m.localName() == QLatin1String("inline"))
+                            extractSASL2Inline(m, f);
+                    }
+
                 } else if (c.localName() == QLatin1String("compression") && c.namespaceURI() == NS_COMPRESS_FEATURE) {
                     f.compress_supported = true;
                     QDomNodeList l       = c.elementsByTagNameNS(NS_COMPRESS_FEATURE, QLatin1String("method"));
@@ -1446,6 +1848,9 @@ bool CoreProtocol::normalStep(const QDomElement &e)
         } else {
             // ignore
         }
+    } else if (step == GetSASLChallenge && sasl2) {
+        if (e.namespaceURI() == NS_SASL2)
+            return sasl2Step(e);
     } else if (step == GetSASLChallenge) {
         // waiting for sasl challenge/success/fail
         if (e.namespaceURI() == NS_SASL) {
@@ -1475,24 +1880,9 @@ bool CoreProtocol::normalStep(const QDomElement &e)
                 step        = HandleSASLSuccess;
                 return true;
             } else if (e.tagName() == "failure") {
-                QDomElement t = firstChildElement(e);
-                if (t.isNull() || t.namespaceURI() != NS_SASL)
-                    errCond = {};
-                else
-                    errCond = stringToSASLCond(t.tagName());
-
-                // handle text elements
-                auto                  nodes = e.elementsByTagNameNS(NS_SASL, QLatin1String("text"));
-                decltype(errLangText) lt;
-                for (int i = 0; i < nodes.count(); i++) {
-                    auto    e    = nodes.item(i).toElement();
-                    QString lang = e.attributeNS(NS_SASL, "lang", "");
-                    lt.insert(lang, e.text());
-                }
-
-                errLangText = lt;
-                event       = EError;
-                errorCode   = ErrAuth;
+                extractSASLFailure(e, NS_SASL);
+                event     = EError;
+                errorCode = ErrAuth;
                 return true;
             } else {
                 event     = EError;
@@ -1699,54 +2089,13 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 #endif
         if (e.namespaceURI() == NS_STREAM_MANAGEMENT) {
             if (e.localName() == "enabled") {
-#ifdef IRIS_SM_DEBUG
-                qDebug() << "Stream Management: [INF] Enabled";
-#endif
-                QString rs = e.attribute("resume");
-                QString id = (rs == "true" || rs == "1") ? e.attribute("id") : QString();
-                sm.start(id);
-                if (!id.isEmpty()) {
-#ifdef IRIS_SM_DEBUG
-                    qDebug() << "Stream Management: [INF] Resumption Supported";
-#endif
-                    QString location = e.attribute("location").trimmed();
-                    if (!location.isEmpty()) {
-                        int         port_off = 0;
-                        QStringView sm_host;
-                        int         sm_port       = 0;
-                        auto        location_view = QStringView { location };
-                        if (location.startsWith('[')) { // ipv6
-                            port_off = location.indexOf(']');
-                            if (port_off != -1) { // looks valid
-                                sm_host = location_view.mid(1, port_off - 1);
-                                if (location.length() > port_off + 2 && location.at(port_off + 1) == ':')
-                                    sm_port = location_view.mid(port_off + 2).toUInt();
-                            }
-                        }
-                        if (port_off == 0) {
-                            port_off = location.indexOf(':');
-                            if (port_off != -1) {
-                                sm_host = location_view.left(port_off);
-                                sm_port = location_view.mid(port_off + 1).toUInt();
-                            } else {
-                                sm_host = location_view.mid(0);
-                            }
-                        }
-                        sm.setLocation(sm_host.toString(), sm_port);
-                    }
-                } // else resumption is not supported on this server
+                handleSMEnabled(e);
                 needTimer(SM_TIMER_INTERVAL_SECS);
                 event = EReady;
                 step  = Done;
                 return true;
             } else if (e.localName() == "resumed") {
-                sm.resume(e.attribute("h").toUInt());
-                while (true) {
-                    QDomElement st = sm.getUnacknowledgedStanza();
-                    if (st.isNull())
-                        break;
-                    send(st);
-                }
+                handleSMResumed(e);
                 needTimer(SM_TIMER_INTERVAL_SECS);
                 event = EReady;
                 step  = Done;
@@ -24,6 +24,7 @@
 #include "xmlprotocol.h"
 #include "xmpp.h"
 
+#include <QDateTime>
 #include <QList>
 #include <QObject>
 #include <QPair>
@@ -38,9 +39,12 @@
 #define NS_STREAMS "urn:ietf:params:xml:ns:xmpp-streams"
 #define NS_TLS "urn:ietf:params:xml:ns:xmpp-tls"
 #define NS_SASL "urn:ietf:params:xml:ns:xmpp-sasl"
+#define NS_SASL2 "urn:xmpp:sasl:2"
 #define NS_SESSION "urn:ietf:params:xml:ns:xmpp-session"
 #define NS_STANZAS "urn:ietf:params:xml:ns:xmpp-stanzas"
 #define NS_BIND "urn:ietf:params:xml:ns:xmpp-bind"
+#define NS_BIND2 "urn:xmpp:bind:0"
+#define NS_FAST "urn:xmpp:fast:0"
 #define NS_CAPS "http://jabber.org/protocol/caps"
 #define NS_CAPS_OPTIMIZE "http://jabber.org/protocol/caps#optimize"
 #define NS_COMPRESS_FEATURE "http://jabber.org/features/compress"
@@ -67,6 +71,14 @@ public:
     QStringList sasl_mechs;
     QStringList compression_mechs;
     QStringList hosts;
+
+    // XEP-0388 SASL2 and what can be done inline with the authentication
+    bool        sasl2_supported;
+    bool        sasl2_sm_supported; // resumption
+    bool        bind2_supported;    // XEP-0386
+    bool        bind2_sm_supported; // enabling SM along with the bind
+    QStringList sasl2_mechs;
+    QStringList fast_mechs; // XEP-0484 token mechanisms
 };
 
 class BasicProtocol : public XmlProtocol {
@@ -159,7 +171,7 @@ public:
     void       setSASLAuthed();
 
     // send / recv
-    void        sendStanza(const QDomElement &e);
+    void        sendStanza(const QDomElement &e, const QByteArray &serialized = QByteArray());
     void        sendDirect(const QString &s);
     void        sendWhitespace();
     void        clearSendQueue();
@@ -240,6 +252,7 @@ private:
 
     struct SendItem {
         QDomElement stanzaToSend;
+        QByteArray  serializedStanza; // stanzaToSend as it goes on the wire, if known already
         QString     stringToSend;
         bool        doWhitespace;
     };
@@ -286,6 +299,14 @@ public:
     void setFrom(const QString &s);
     void setDialbackKey(const QString &s);
 
+    // SASL2 is used instead of SASL when the server offers it along with everything needed
+    //   to get ready without a stream restart (Bind2, and inline resumption if resuming)
+    void setAllowSASL2(bool b);
+    // the id has to be stable, FAST tokens are bound to it. No FAST without it
+    void setUserAgent(const QString &id, const QString &software, const QString &device);
+    bool isSASL2() const;
+    bool isFast() const;
+
     // input
     QString user, host;
 
@@ -300,6 +321,14 @@ public:
 
     StreamManagement sm;
 
+    // XEP-0484 token. Set before login to authenticate with it. Updated when the server hands
+    //   out a new one or rejects it, fastTokenChanged tells about that
+    QString    fastMech;
+    QByteArray fastToken;
+    QDateTime  fastExpiry;
+    int        fastCount;
+    bool       fastTokenChanged;
+
     class DBItem {
     public:
         enum { ResultRequest, ResultGrant, VerifyRequest, VerifyGrant, Validated };
@@ -351,9 +380,25 @@ private:
     QString dialback_id, dialback_key;
     QString self_from;
 
+    bool        allowSASL2;
+    bool        sasl2, fast_auth, fast_tried;
+    QString     fastRequested; // mechanism of the token asked for
+    QString     userAgentId, userAgentSoftware, userAgentDevice;
+    QDomElement sasl2Success;
+
     void       init();
     static int getOldErrorCode(const QDomElement &e);
     bool       loginComplete();
+    void       handleSMEnabled(const QDomElement &e);
+    void       handleSMResumed(const QDomElement &e);
+    void       extractSASLFailure(const QDomElement &e, const QString &textNS);
+
+    bool        canUseSASL2() const;
+    bool        canUseFast() const;
+    QByteArray  fastHash(const QByteArray &label) const;
+    QDomElement sasl2Authenticate();
+    bool        sasl2Step(const QDomElement &e);
+    bool        sasl2Complete();
 
     bool isValidStanza(const QDomElement &e) const;
     bool streamManagementHandleStanza(const QDomElement &e);
@@ -369,13 +369,15 @@ public:
         return false;
     }
 
-    bool haveCompress() const
+    bool haveCompress() const { return compressionHandler() != nullptr; }
+
+    CompressionHandler *compressionHandler() const
     {
         for (SecureLayer *s : layers) {
             if (s->type == SecureLayer::Compression)
-                return true;
+                return s->p.compressionHandler;
         }
-        return false;
+        return nullptr;
     }
 
     void deleteLayers()
@@ -451,12 +453,14 @@ void SecureStream::startTLSServer(QCA::TLS *t, const QByteArray &spare)
     insertData(spare);
 }
 
-void SecureStream::setLayerCompress(const QByteArray &spare)
+void SecureStream::setLayerCompress(const QByteArray &spare, int flushBytes, int flushDelayMs)
 {
     if (!d->active || d->topInProgress || d->haveCompress())
         return;
 
-    SecureLayer *s = new SecureLayer(new CompressionHandler());
+    auto handler = new CompressionHandler();
+    handler->setFlushPolicy(flushBytes, flushDelayMs);
+    SecureLayer *s = new SecureLayer(handler);
     s->prebytes    = calcPrebytes();
     linkLayer(s);
     d->layers.append(s);
@@ -530,6 +534,8 @@ void SecureStream::write(const QByteArray &a)
 
 qint64 SecureStream::bytesToWrite() const { return d->pending; }
 
+const CompressionHandler *SecureStream::compressionHandler() const { return d->compressionHandler(); }
+
 void SecureStream::bs_readyRead()
 {
     QByteArray a = d->bs->readAll();
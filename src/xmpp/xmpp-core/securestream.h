@@ -42,7 +42,7 @@ public:
 
     void startTLSClient(QCA::TLS *t, const QByteArray &spare = QByteArray());
     void startTLSServer(QCA::TLS *t, const QByteArray &spare = QByteArray());
-    void setLayerCompress(const QByteArray &spare = QByteArray());
+    void setLayerCompress(const QByteArray &spare = QByteArray(), int flushBytes = 16384, int flushDelayMs = 0);
     void setLayerSASL(QCA::SASL *s, const QByteArray &spare = QByteArray());
 #ifdef USE_TLSHANDLER
     void startTLSClient(XMPP::TLSHandler *t, const QString &server, const QByteArray &spare = QByteArray());
@@ -51,6 +51,8 @@ public:
     void closeTLS();
     int  errorCode() const;
 
+    const CompressionHandler *compressionHandler() const; // nullptr until the compression layer is set
+
     // reimplemented
     bool   isOpen() const;
     void   write(const QByteArray &);
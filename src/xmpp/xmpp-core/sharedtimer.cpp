@@ -0,0 +1,148 @@
+/*
+ * sharedtimer.cpp - coarse timers served by one QTimer per thread
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "sharedtimer.h"
+
+#include <QElapsedTimer>
+#include <QThreadStorage>
+#include <QTimer>
+
+namespace XMPP {
+class SharedTimerQueue {
+public:
+    SharedTimerQueue()
+    {
+        clock.start();
+        timer.setSingleShot(true);
+        timer.setTimerType(Qt::CoarseTimer);
+        QObject::connect(&timer, &QTimer::timeout, [this]() { fire(); });
+    }
+
+    static SharedTimerQueue *instance()
+    {
+        static QThreadStorage<SharedTimerQueue *> queues;
+        if (!queues.hasLocalData())
+            queues.setLocalData(new SharedTimerQueue);
+        return queues.localData();
+    }
+
+    void insert(SharedTimer *t, int msecs)
+    {
+        // rounded up, so timers started around the same time share the deadline
+        qint64 deadline = (clock.elapsed() + qMax(msecs, 0) + SharedTimer::Precision) / SharedTimer::Precision
+            * SharedTimer::Precision;
+        t->pos_   = entries.emplace(deadline, t);
+        t->queue_ = this;
+        if (t->pos_ == entries.begin())
+            schedule();
+    }
+
+    void remove(SharedTimer *t)
+    {
+        bool first = t->pos_ == entries.begin();
+        entries.erase(t->pos_);
+        t->queue_ = nullptr;
+        if (first)
+            schedule();
+    }
+
+    void schedule()
+    {
+        if (entries.empty()) {
+            timer.stop();
+            return;
+        }
+        timer.start(int(qMax(entries.begin()->first - clock.elapsed(), qint64(0))));
+    }
+
+    void fire()
+    {
+        const qint64 now = clock.elapsed();
+        // collect first, the callbacks may start and stop any timers
+        std::vector<SharedTimer *> due;
+        while (!entries.empty() && entries.begin()->first <= now) {
+            SharedTimer *t = entries.begin()->second;
+            entries.erase(entries.begin());
+            t->queue_ = nullptr;
+            due.push_back(t);
+        }
+        for (SharedTimer *t : due) {
+            t->firing_ = this;
+            if (!t->singleShot_)
+                insert(t, t->interval_);
+        }
+        schedule();
+
+        auto prev = current;
+        current   = &due;
+        for (size_t i = 0; i < due.size(); ++i) {
+            if (!due[i])
+                continue;
+            due[i]->firing_ = nullptr;
+            if (!due[i]->callback_)
+                continue;
+            auto callback = due[i]->callback_; // the callback may destroy the timer
+            callback();
+        }
+        current = prev;
+    }
+
+    // a timer stopped or destroyed by a callback must not be called later in the same round
+    void forget(SharedTimer *t)
+    {
+        t->firing_ = nullptr;
+        if (!current)
+            return;
+        for (auto &d : *current) {
+            if (d == t)
+                d = nullptr;
+        }
+    }
+
+    QElapsedTimer               clock;
+    QTimer                      timer;
+    SharedTimer::Queue          entries;
+    std::vector<SharedTimer *> *current = nullptr; // firing now
+};
+
+SharedTimer::SharedTimer(std::function<void()> callback) : callback_(std::move(callback)) { }
+
+SharedTimer::~SharedTimer() { stop(); }
+
+void SharedTimer::setCallback(std::function<void()> callback) { callback_ = std::move(callback); }
+
+void SharedTimer::start(int msecs)
+{
+    stop();
+    interval_ = msecs;
+    SharedTimerQueue::instance()->insert(this, msecs);
+}
+
+void SharedTimer::stop()
+{
+    // the queues the timer is in, not the one of the current thread. so a timer
+    // which was never started doesn't create a queue here either
+    if (queue_)
+        queue_->remove(this);
+    if (firing_)
+        firing_->forget(this);
+}
+
+qsizetype SharedTimer::activeCount() { return qsizetype(SharedTimerQueue::instance()->entries.size()); }
+} // namespace XMPP
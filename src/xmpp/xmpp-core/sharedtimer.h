@@ -0,0 +1,68 @@
+/*
+ * sharedtimer.h - coarse timers served by one QTimer per thread
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef XMPP_SHAREDTIMER_H
+#define XMPP_SHAREDTIMER_H
+
+#include <QtGlobal>
+
+#include <functional>
+#include <map>
+
+namespace XMPP {
+class SharedTimerQueue;
+
+// Replaces QTimer for the long and imprecise timeouts every stream has (keepalives,
+// stream management acks). All the timers of a thread sit in one queue served by a
+// single QTimer, and deadlines are rounded up to Precision, so the timers of many
+// streams fire in one go instead of waking the process up one by one.
+// Not a QObject and not thread safe: use it in the thread it was started in.
+class SharedTimer {
+public:
+    static constexpr int Precision = 100; // msecs
+
+    SharedTimer() = default;
+    explicit SharedTimer(std::function<void()> callback);
+    ~SharedTimer();
+
+    SharedTimer(const SharedTimer &)            = delete;
+    SharedTimer &operator=(const SharedTimer &) = delete;
+
+    void setCallback(std::function<void()> callback);
+    void setSingleShot(bool singleShot) { singleShot_ = singleShot; }
+    void start(int msecs);
+    void stop();
+    bool isActive() const { return queue_ != nullptr; }
+
+    static qsizetype activeCount(); // of the current thread
+
+private:
+    friend class SharedTimerQueue;
+    using Queue = std::multimap<qint64, SharedTimer *>;
+
+    std::function<void()> callback_;
+    int                   interval_   = 0;
+    bool                  singleShot_ = true;
+    SharedTimerQueue     *queue_      = nullptr; // while active
+    SharedTimerQueue     *firing_     = nullptr; // while due in a round of the queue
+    Queue::iterator       pos_;
+};
+} // namespace XMPP
+
+#endif // XMPP_SHAREDTIMER_H
@@ -21,8 +21,8 @@
 
 #include "xmpp/sasl/digestmd5response.h"
 #include "xmpp/sasl/plainmessage.h"
+#include "xmpp/sasl/scramresponse.h"
 #include "xmpp/sasl/scramsha1message.h"
-#include "xmpp/sasl/scramsha1response.h"
 #include "xmpp/sasl/scramsha1signature.h"
 
 #include <QByteArray>
@@ -83,6 +83,9 @@ public:
     // scram specific stuff
     QByteArray       client_first_message;
     QCA::SecureArray server_signature;
+    QString          cbind_type; // "tls-exporter" etc, set by the stream when TLS can tell it
+    QByteArray       cbind_data;
+    bool             cbind_offered = false; // some -PLUS mechanism
 
     SimpleSASLContext(QCA::Provider *p) : QCA::SASLContext(p) { reset(); }
 
@@ -115,6 +118,8 @@ public:
         authCondition_ = QCA::SASL::AuthFail;
     }
 
+    bool isSCRAM() const { return out_mech.startsWith("SCRAM-"); }
+
     virtual void setConstraints(QCA::SASL::AuthFlags flags, int ssfMin, int)
     {
         capable = !(
@@ -135,11 +140,25 @@ public:
     {
         Q_UNUSED(allowClientSendFirst);
 
-        mechanism_ = QString();
+        cbind_type = property("scram-channel-binding-type").toString();
+        cbind_data = property("scram-channel-binding-data").toByteArray();
+        if (cbind_type.isEmpty())
+            cbind_data.clear();
+
+        // the list is in order of preference already
+        mechanism_    = QString();
+        cbind_offered = false;
+        for (const QString &mech : mechlist)
+            cbind_offered = cbind_offered || mech.endsWith("-PLUS");
         for (const QString &mech : mechlist) {
-            if (mech == "SCRAM-SHA-1") {
-                mechanism_ = "SCRAM-SHA-1";
-                break;
+            if (mech.startsWith("SCRAM-")) {
+                if (mech.endsWith("-PLUS") && cbind_data.isEmpty())
+                    continue;
+                if (!SCRAMResponse::hashForMechanism(mech).isEmpty()) {
+                    mechanism_ = mech;
+                    break;
+                }
+                continue;
             }
             if (mech == "DIGEST-MD5") {
                 mechanism_ = "DIGEST-MD5";
@@ -180,7 +199,7 @@ public:
             out_mech = mechanism_;
 
             // PLAIN
-            if (out_mech == "PLAIN" || out_mech == "SCRAM-SHA-1") {
+            if (out_mech == "PLAIN" || isSCRAM()) {
                 // First, check if we have everything
                 if (need.user || need.pass) {
                     qWarning("simplesasl.cpp: Did not receive necessary auth parameters");
@@ -198,9 +217,14 @@ public:
             }
             if (out_mech == "PLAIN") {
                 out_buf = PLAINMessage(authz, user, pass.toByteArray()).getValue();
-            } else if (out_mech == "SCRAM-SHA-1") {
-                // send client-first-message
-                SCRAMSHA1Message msg(authz, user, QByteArray(0, ' '));
+            } else if (isSCRAM()) {
+                // send client-first-message. "y": we could bind, but the server offered no -PLUS
+                QByteArray cbind_flag = "n";
+                if (out_mech.endsWith("-PLUS"))
+                    cbind_flag = "p=" + cbind_type.toLatin1();
+                else if (!cbind_data.isEmpty() && !cbind_offered)
+                    cbind_flag = "y";
+                SCRAMSHA1Message msg(authz, user, QByteArray(0, ' '), cbind_flag);
                 if (msg.isValid()) {
                     out_buf              = msg.getValue();
                     client_first_message = out_buf;
@@ -246,7 +270,7 @@ public:
                 out_buf = response.getValue();
                 ++step;
                 result_ = Continue;
-            } else if (out_mech == "SCRAM-SHA-1") {
+            } else if (isSCRAM()) {
                 // if we still need params, then the app has failed us!
                 if (need.user || need.pass) {
                     qWarning("simplesasl.cpp: Did not receive necessary auth parameters");
@@ -271,7 +295,9 @@ public:
                 if (prop.isValid()) {
                     salted_password_base64 = prop.toString();
                 }
-                SCRAMSHA1Response response(in_buf, pass.toByteArray(), client_first_message, salted_password_base64);
+                SCRAMResponse response(SCRAMResponse::hashForMechanism(out_mech), in_buf, pass.toByteArray(),
+                                       client_first_message, salted_password_base64,
+                                       out_mech.endsWith("-PLUS") ? cbind_data : QByteArray());
                 if (!response.isValid()) {
                     authCondition_ = QCA::SASL::BadProtocol;
                     result_        = Error;
@@ -283,8 +309,8 @@ public:
                 ++step;
                 result_ = Continue;
             }
-        } else if (step == 2 && out_mech == "SCRAM-SHA-1") {
-            // verify the server's response on success, for SCRAM-SHA-1
+        } else if (step == 2 && isSCRAM()) {
+            // verify the server's response on success, for SCRAM
             SCRAMSHA1Signature sig(in_buf, server_signature);
             if (sig.isValid()) {
                 result_ = Success;
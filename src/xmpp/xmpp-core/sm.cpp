@@ -19,12 +19,66 @@
 
 #include "sm.h"
 
+#include <QDataStream>
 #ifdef IRIS_SM_DEBUG
 #include <QDebug>
 #endif
 
+#define SM_STATE_VERSION 1
+
 using namespace XMPP;
 
+QByteArray SMQueue::at(int index) const
+{
+    const Entry &e = entries_.at(size_t(index));
+    return data_.mid(int(e.start - base_), int(e.size));
+}
+
+void SMQueue::enqueue(const QByteArray &stanza)
+{
+    if (dropped_) {
+        entries_.push_back({ end_, 0 });
+        return;
+    }
+    data_.append(stanza);
+    entries_.push_back({ end_, quint32(stanza.size()) });
+    end_ += stanza.size();
+}
+
+void SMQueue::dequeue()
+{
+    entries_.pop_front();
+    if (entries_.empty()) {
+        data_.resize(0); // keeps the capacity for the next ones
+        base_ = head_ = end_;
+        return;
+    }
+    head_ = entries_.front().start;
+    // move the tail to the front only when it pays off
+    qint64 consumed = head_ - base_;
+    if (consumed > 65536 && consumed > data_.size() / 2) {
+        data_.remove(0, int(consumed));
+        base_ = head_;
+    }
+}
+
+void SMQueue::dropPayload()
+{
+    for (Entry &e : entries_)
+        e = { end_, 0 };
+    data_.clear();
+    base_ = head_ = end_;
+    dropped_      = true;
+}
+
+void SMQueue::clear()
+{
+    entries_.clear();
+    data_.clear();
+    base_ = head_ = end_ = 0;
+    dropped_             = false;
+}
+
 SMState::SMState()
 {
     enabled = false;
@@ -41,8 +95,49 @@ void SMState::resetCounters()
     send_queue.clear();
 }
 
+QByteArray SMState::exportState() const
+{
+    if (!isResumption() || send_queue.isPayloadDropped())
+        return QByteArray();
+
+    QByteArray  out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_12);
+    ds << quint8(SM_STATE_VERSION) << resumption_id << resumption_location.host << resumption_location.port
+       << received_count << server_last_handled << quint32(send_queue.size());
+    for (int i = 0; i < send_queue.size(); ++i)
+        ds << send_queue.at(i);
+    return out;
+}
+
+bool SMState::importState(const QByteArray &data)
+{
+    QDataStream ds(data);
+    ds.setVersion(QDataStream::Qt_5_12);
+    quint8  version = 0;
+    SMState s;
+    quint32 count;
+    ds >> version;
+    if (version != SM_STATE_VERSION)
+        return false;
+    ds >> s.resumption_id >> s.resumption_location.host >> s.resumption_location.port >> s.received_count
+        >> s.server_last_handled >> count;
+    for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        QByteArray stanza;
+        ds >> stanza;
+        s.send_queue.enqueue(stanza);
+    }
+    if (ds.status() != QDataStream::Ok || s.resumption_id.isEmpty())
+        return false;
+
+    s.enabled = enabled;
+    *this     = s;
+    return true;
+}
+
 StreamManagement::StreamManagement(QObject *parent) :
-    QObject(parent), sm_started(false), sm_resumed(false), sm_stanzas_notify(0), sm_resend_pos(0)
+    QObject(parent), sm_started(false), sm_resumed(false), sm_stanzas_notify(0), sm_resend_pos(0),
+    max_queue_bytes(8 * 1024 * 1024), request_queue_bytes(64 * 1024)
 {
 }
 
@@ -107,23 +202,42 @@ void StreamManagement::countInputRawData(int bytes)
     }
 }
 
-QDomElement StreamManagement::getUnacknowledgedStanza()
+QByteArray StreamManagement::getUnacknowledgedStanza()
 {
     if (sm_resend_pos < state_.send_queue.size())
         return state_.send_queue.at(sm_resend_pos++);
-    return QDomElement();
+    return QByteArray();
 }
 
-int StreamManagement::addUnacknowledgedStanza(const QDomElement &e)
+int StreamManagement::addUnacknowledgedStanza(const QByteArray &stanza)
 {
-    state_.send_queue.enqueue(e);
-    int len = state_.send_queue.length();
+    auto &queue = state_.send_queue;
+    if (!queue.isPayloadDropped() && queue.bytes() + stanza.size() > max_queue_bytes) {
+        // the server still counts these, so we do too. but they can't be resent anymore
+        qWarning("Stream Management: unacknowledged stanzas exceed %lld bytes. Session resumption is disabled",
+                 max_queue_bytes);
+        queue.dropPayload();
+        state_.resumption_id.clear();
+    }
+    queue.enqueue(stanza);
+    int len = queue.size();
 #ifdef IRIS_SM_DEBUG
     qDebug() << "Stream Management: [INF] Send queue length is changed: " << len;
 #endif
     return len;
 }
 
+bool StreamManagement::isAckRequestDue() const
+{
+    return !sm_timeout_data.waiting_answer && state_.send_queue.bytes() >= request_queue_bytes;
+}
+
+void StreamManagement::setQueueLimits(qint64 maxBytes, qint64 requestBytes)
+{
+    max_queue_bytes     = maxBytes;
+    request_queue_bytes = requestBytes;
+}
+
 void StreamManagement::processAcknowledgement(quint32 last_handled)
 {
     sm_timeout_data.waiting_answer = false;
@@ -141,7 +255,7 @@ void StreamManagement::processAcknowledgement(quint32 last_handled)
     }
 #ifdef IRIS_SM_DEBUG
     if (f) {
-        qDebug() << "Stream Management: [INF] Send queue length is changed: " << state_.send_queue.length();
+        qDebug() << "Stream Management: [INF] Send queue length is changed: " << state_.send_queue.size();
         if (state_.send_queue.isEmpty() && last_handled != state_.server_last_handled)
             qDebug() << "Stream Management: [ERR] Send queue is empty but last_handled != server_last_handled "
                      << last_handled << state_.server_last_handled;
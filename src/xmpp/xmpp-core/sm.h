@@ -20,10 +20,12 @@
 #ifndef XMPP_SM_H
 #define XMPP_SM_H
 
+#include <QByteArray>
 #include <QDomElement>
 #include <QElapsedTimer>
 #include <QObject>
-#include <QQueue>
+
+#include <deque>
 
 #define NS_STREAM_MANAGEMENT "urn:xmpp:sm:3"
 #define SM_TIMER_INTERVAL_SECS 40
@@ -31,6 +33,37 @@
 // #define IRIS_SM_DEBUG
 
 namespace XMPP {
+// Unacknowledged outgoing stanzas, kept as the UTF-8 bytes they were sent as.
+// All stanzas share one buffer which is consumed from the head as acks arrive,
+// so a queue of thousands of stanzas is a couple of allocations instead of
+// thousands of DOM trees. A stanza may be kept without payload (just counted),
+// once the queue is over its memory cap.
+class SMQueue {
+public:
+    int        size() const { return int(entries_.size()); }
+    bool       isEmpty() const { return entries_.empty(); }
+    qint64     bytes() const { return end_ - head_; }
+    bool       isPayloadDropped() const { return dropped_; }
+    QByteArray at(int index) const;
+    void       enqueue(const QByteArray &stanza);
+    void       dequeue();
+    void       dropPayload();
+    void       clear();
+
+private:
+    struct Entry {
+        qint64  start; // absolute stream position of the stanza
+        quint32 size;
+    };
+
+    QByteArray        data_;
+    qint64            base_ = 0; // absolute position of data_[0]
+    qint64            head_ = 0; // absolute position of the first unacknowledged byte
+    qint64            end_  = 0;
+    std::deque<Entry> entries_;
+    bool              dropped_ = false;
+};
+
 class SMState {
 public:
     SMState();
@@ -40,12 +73,16 @@ public:
     bool isLocationValid() { return !resumption_location.host.isEmpty() && resumption_location.port != 0; }
     void setEnabled(bool e) { enabled = e; }
 
+    // everything needed to resume the session from another process
+    QByteArray exportState() const;
+    bool       importState(const QByteArray &data);
+
 public:
-    bool                enabled;
-    quint32             received_count;
-    quint32             server_last_handled;
-    QQueue<QDomElement> send_queue;
-    QString             resumption_id;
+    bool    enabled;
+    quint32 received_count;
+    quint32 server_last_handled;
+    SMQueue send_queue;
+    QString resumption_id;
     struct {
         QString host;
         quint16 port;
@@ -66,8 +103,10 @@ public:
     int                  lastAckElapsed() const;
     int                  takeAckedCount();
     void                 countInputRawData(int bytes);
-    QDomElement          getUnacknowledgedStanza();
-    int                  addUnacknowledgedStanza(const QDomElement &e);
+    QByteArray           getUnacknowledgedStanza();
+    int                  addUnacknowledgedStanza(const QByteArray &stanza);
+    bool                 isAckRequestDue() const;
+    void                 setQueueLimits(qint64 maxBytes, qint64 requestBytes);
     void                 processAcknowledgement(quint32 last_handled);
     void                 markStanzaHandled();
     QDomElement          generateRequestStanza(QDomDocument &doc);
@@ -79,6 +118,8 @@ private:
     bool    sm_resumed;
     int     sm_stanzas_notify;
     int     sm_resend_pos;
+    qint64  max_queue_bytes;     // over this the payload is dropped and the session can't be resumed anymore
+    qint64  request_queue_bytes; // ask for an ack early once this much is unacknowledged
     struct {
         QElapsedTimer elapsed_timer;
         bool          waiting_answer = false;
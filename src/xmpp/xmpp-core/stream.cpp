@@ -42,18 +42,23 @@
 */
 
 #include "bytestream.h"
+#include "compressionhandler.h"
 #ifndef NO_IRISNET
 #include "irisnet/corelib/irisnetglobal_p.h"
 #endif
 #include "protocol.h"
 #include "securestream.h"
+#include "sharedtimer.h"
 #include "simplesasl.h"
 #ifdef XMPP_TEST
 #include "td.h"
 #endif
+#include "xmpp_traffictap.h"
 
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <QList>
+#include <QMetaMethod>
 #include <QPointer>
 #include <QTextStream>
 #include <QTimer>
@@ -179,6 +184,11 @@ public:
     bool doAuth;
     bool doCompress = false;
 
+    int compressFlushBytes = 16384;
+    int compressFlushDelay = 0;
+
+    TrafficTap *tap = nullptr;
+
     QStringList sasl_mechlist;
 
     int                     errCond;
@@ -188,10 +198,34 @@ public:
 
     QList<Stanza *> in;
 
-    QTimer timeout_timer;
-    QTimer noopTimer;
-    int    noop_time;
-    bool   quiet_reconnection = false;
+    SharedTimer timeout_timer; // thousands of streams must not mean thousands of QTimers
+    SharedTimer noopTimer;
+    int         noop_time;
+    bool        quiet_reconnection = false;
+
+    bool                    allowSASL2 = true;
+    QString                 userAgentId, userAgentSoftware, userAgentDevice;
+    ClientStream::FastToken fastToken;
+
+    QElapsedTimer              loginTimer;
+    qint64                     phaseEnd = 0;
+    ClientStream::LoginTimings timings;
+
+    void startLoginTimer()
+    {
+        timings  = ClientStream::LoginTimings();
+        phaseEnd = 0;
+        loginTimer.start();
+    }
+
+    // milliseconds since the previous phase ended
+    qint64 phaseDone()
+    {
+        qint64 now     = loginTimer.elapsed();
+        qint64 elapsed = now - phaseEnd;
+        phaseEnd       = now;
+        return elapsed;
+    }
 };
 
 ClientStream::ClientStream(Connector *conn, TLSHandler *tlsHandler, QObject *parent) : Stream(parent)
@@ -203,7 +237,8 @@ ClientStream::ClientStream(Connector *conn, TLSHandler *tlsHandler, QObject *par
     connect(d->conn, SIGNAL(error()), SLOT(cr_error()));
 
     d->noop_time = 0;
-    connect(&d->noopTimer, SIGNAL(timeout()), SLOT(doNoop()));
+    d->noopTimer.setSingleShot(false);
+    d->noopTimer.setCallback([this]() { doNoop(); });
 
     d->tlsHandler = tlsHandler;
 }
@@ -238,7 +273,7 @@ ClientStream::ClientStream(const QString &host, const QString &defRealm, ByteStr
     // d->jid = Jid();
     // d->server = QString();
 
-    connect(&(d->timeout_timer), SIGNAL(timeout()), SLOT(sm_timeout()));
+    d->timeout_timer.setCallback([this]() { sm_timeout(); });
 }
 
 ClientStream::~ClientStream()
@@ -317,6 +352,7 @@ void ClientStream::connectToServer(const Jid &jid, bool auth)
     d->doAuth = auth;
     d->server = d->jid.domain();
 
+    d->startLoginTimer();
     d->conn->connectToServer(d->server);
 }
 
@@ -430,6 +466,21 @@ const QString ClientStream::getSCRAMStoredSaltedHash()
     return QString();
 }
 
+void ClientStream::setSASL2Enabled(bool enable) { d->allowSASL2 = enable; }
+
+void ClientStream::setUserAgent(const QString &id, const QString &software, const QString &device)
+{
+    d->userAgentId       = id;
+    d->userAgentSoftware = software;
+    d->userAgentDevice   = device;
+}
+
+void ClientStream::setFastToken(const FastToken &token) { d->fastToken = token; }
+
+ClientStream::FastToken ClientStream::fastToken() const { return d->fastToken; }
+
+ClientStream::LoginTimings ClientStream::loginTimings() const { return d->timings; }
+
 void ClientStream::setResourceBinding(bool b) { d->doBinding = b; }
 
 void ClientStream::setLang(const QString &lang) { d->lang = lang; }
@@ -448,6 +499,34 @@ void ClientStream::setNoopTime(int mills)
     d->noopTimer.start(d->noop_time);
 }
 
+void ClientStream::setCompactParsing(bool enable)
+{
+    auto mode = enable ? Parser::Mode::Compact : Parser::Mode::Dom;
+    d->client.setParserMode(mode);
+    d->srv.setParserMode(mode);
+}
+
+void ClientStream::setLightweight(bool enable)
+{
+    setCompactParsing(enable);
+    d->client.setSharedResources(enable);
+    d->srv.setSharedResources(enable);
+    d->client.doc = enable ? XmlProtocol::sharedDocument() : QDomDocument();
+    d->srv.doc    = d->client.doc;
+}
+
+ClientStream::MemoryUsage ClientStream::memoryUsage() const
+{
+    MemoryUsage usage;
+    usage.protocol = d->client.bufferedBytes() + d->srv.bufferedBytes();
+    usage.socket   = d->ss ? d->ss->bytesToWrite() : 0;
+    usage.smQueue  = d->client.sm.state().send_queue.bytes();
+    usage.stanzas  = int(d->in.size());
+    return usage;
+}
+
+void ClientStream::setTrafficTap(TrafficTap *tap) { d->tap = tap; }
+
 QString ClientStream::saslMechanism() const { return d->client.saslMech(); }
 
 int ClientStream::saslSSF() const { return d->sasl_ssf; }
@@ -463,6 +542,26 @@ void ClientStream::setLocalAddr(const QHostAddress &addr, quint16 port)
 
 void ClientStream::setCompress(bool compress) { d->doCompress = compress; }
 
+void ClientStream::setCompressionFlushPolicy(int maxPendingBytes, int maxDelayMs)
+{
+    d->compressFlushBytes = maxPendingBytes;
+    d->compressFlushDelay = maxDelayMs;
+}
+
+ClientStream::CompressionStats ClientStream::compressionStats() const
+{
+    CompressionStats stats;
+    auto             handler = d->ss ? d->ss->compressionHandler() : nullptr;
+    if (!handler)
+        return stats;
+    auto s                = handler->stats();
+    stats.active          = true;
+    stats.plainBytes      = s.plainBytes;
+    stats.compressedBytes = s.compressedBytes;
+    stats.flushes         = s.flushes;
+    return stats;
+}
+
 int ClientStream::errorCondition() const { return d->errCond; }
 
 QString ClientStream::errorText() const { return d->errText; }
@@ -526,6 +625,8 @@ void ClientStream::clearSendQueue() { d->client.clearSendQueue(); }
 
 void ClientStream::cr_connected()
 {
+    d->timings.connect = d->phaseDone();
+
     d->connectHost = d->conn->host();
     d->bs          = d->conn->stream();
     connect(d->bs, SIGNAL(connectionClosed()), SLOT(bs_connectionClosed()));
@@ -548,6 +649,14 @@ void ClientStream::cr_connected()
     d->client.setAllowBind(d->doBinding);
     d->client.setAllowPlain(d->allowPlain == AllowPlain || (d->allowPlain == AllowPlainOverTLS && d->conn->useSSL()));
     d->client.setLang(d->lang);
+    d->client.setAllowSASL2(d->allowSASL2);
+    d->client.setUserAgent(d->userAgentId, d->userAgentSoftware, d->userAgentDevice);
+    if (d->fastToken.isValid()) {
+        d->client.fastMech   = d->fastToken.mechanism;
+        d->client.fastToken  = d->fastToken.token;
+        d->client.fastExpiry = d->fastToken.expiry;
+        d->client.fastCount  = d->fastToken.count;
+    }
 
     /*d->client.jid = d->jid;
     d->client.server = d->server;
@@ -635,6 +744,8 @@ void ClientStream::ss_bytesWritten(qint64 bytes)
 
 void ClientStream::ss_tlsHandshaken()
 {
+    d->timings.tls = d->phaseDone();
+
     QPointer<QObject> self = this;
     if (!d->quiet_reconnection)
         emit securityLayerActivated(LayerTLS);
@@ -734,7 +845,8 @@ void ClientStream::sasl_error()
 #endif
     // has to be auth error
     int x      = convertedSASLCond();
-    d->errText = tr("Offered mechanisms: ") + d->client.features.sasl_mechs.join(", ");
+    d->errText = tr("Offered mechanisms: ")
+        + (d->client.isSASL2() ? d->client.features.sasl2_mechs : d->client.features.sasl_mechs).join(", ");
     reset();
     d->errCond = x;
     emit error(ErrAuth);
@@ -881,24 +993,51 @@ void ClientStream::processNext()
         qDebug("Processing step...\n");
 #endif
         bool ok = d->client.processStep();
-        // deal with send/received items
+        // deal with send/received items. nothing is turned into text if nobody listens
+        const bool tapped     = d->tap && !d->tap->isEmpty();
+        const bool signalsIn  = isSignalConnected(QMetaMethod::fromSignal(&ClientStream::incomingXml));
+        const bool signalsOut = isSignalConnected(QMetaMethod::fromSignal(&ClientStream::outgoingXml));
         for (const XmlProtocol::TransferItem &i : std::as_const(d->client.transferItemList)) {
-            if (i.isExternal)
+            if (i.isExternal || !(tapped || signalsIn || signalsOut))
                 continue;
-            QString str;
+            const auto direction = i.isSent ? TrafficTap::Outgoing : TrafficTap::Incoming;
+            const bool signal    = i.isSent ? signalsOut : signalsIn;
+            QString    str;
             if (i.isString) {
                 // skip whitespace pings
                 if (i.str.trimmed().isEmpty())
                     continue;
                 str = i.str;
-            } else
-                str = d->client.elementToString(i.elem);
+                if (tapped)
+                    d->tap->deliver(direction, str);
+            } else {
+                if (tapped)
+                    d->tap->deliver(direction, i.elem, [&]() { return str = d->client.elementToString(i.elem); });
+                if (signal && str.isNull()) {
+                    str = d->client.elementToString(i.elem);
+                    if (d->tap)
+                        d->tap->countProduced(str);
+                }
+            }
+            if (!signal)
+                continue;
             if (i.isSent)
                 emit outgoingXml(str);
             else
                 emit incomingXml(str);
         }
 
+        if (d->client.fastTokenChanged) {
+            d->client.fastTokenChanged = false;
+            d->fastToken.mechanism     = d->client.fastMech;
+            d->fastToken.token         = d->client.fastToken;
+            d->fastToken.expiry        = d->client.fastExpiry;
+            d->fastToken.count         = d->client.fastCount;
+            emit fastTokenChanged();
+            if (!self)
+                return;
+        }
+
 #ifdef XMPP_DEBUG
         qDebug("\tNOTIFY: %d\n", d->client.notify);
 #endif
@@ -991,12 +1130,26 @@ void ClientStream::processNext()
 #ifdef XMPP_DEBUG
             qDebug("Break SASL Success\n");
 #endif
+            d->timings.auth  = d->phaseDone();
+            d->timings.sasl2 = d->client.isSASL2();
+            d->timings.fast  = d->client.isFast();
             break;
         }
         case CoreProtocol::EReady: {
 #ifdef XMPP_DEBUG
             qDebug("Done!\n");
 #endif
+            d->timings.bind    = d->phaseDone();
+            d->timings.total   = d->loginTimer.elapsed();
+            d->timings.resumed = d->client.sm.isResumed();
+            if (d->quiet_reconnection && !d->client.sm.isResumed()) {
+                // SASL2 bound a new session instead. the app has to know it lost the old one
+                reset();
+                d->quiet_reconnection = false;
+                emit error(ErrSmResume);
+                return;
+            }
+
             // grab the JID, in case it changed
             d->jid   = d->client.jid();
             d->state = Active;
@@ -1066,6 +1219,7 @@ void ClientStream::processNext()
                 if (d->client.sm.state().isLocationValid())
                     d->conn->setOptHostPort(d->client.sm.state().resumption_location.host,
                                             d->client.sm.state().resumption_location.port);
+                d->startLoginTimer();
                 d->conn->connectToServer(d->server);
             } else {
                 d->quiet_reconnection = false;
@@ -1114,7 +1268,7 @@ bool ClientStream::handleNeed()
 #ifdef XMPP_DEBUG
         qDebug("Need compress\n");
 #endif
-        d->ss->setLayerCompress(d->client.spare);
+        d->ss->setLayerCompress(d->client.spare, d->compressFlushBytes, d->compressFlushDelay);
         return true;
     }
     case CoreProtocol::NSASLFirst: {
@@ -1148,7 +1302,9 @@ bool ClientStream::handleNeed()
         else {
             QMap<int, QString> prefOrdered;
             QStringList        unpreferred;
-            for (auto const &m : std::as_const(d->client.features.sasl_mechs)) {
+
+            const auto &offered = d->client.isSASL2() ? d->client.features.sasl2_mechs : d->client.features.sasl_mechs;
+            for (auto const &m : offered) {
                 int i = preference.indexOf(m);
                 if (i != -1) {
                     prefOrdered.insert(i, m);
@@ -1198,14 +1354,20 @@ bool ClientStream::handleNeed()
         // QCA 3 exposes channel-binding APIs, but actual availability is a
         // runtime property of the selected TLS and SASL providers/session.
         // Keep SCRAM-*-PLUS only when both sides can supply usable binding data.
-        if (d->using_tls && d->tlsHandler && d->sasl->supportsChannelBinding()) {
+        // simplesasl takes it through properties, like the stored salted password.
+        const bool simpleSASL = d->sasl->provider() && d->sasl->provider()->name() == QLatin1String("simplesasl");
+        if (d->using_tls && d->tlsHandler && (simpleSASL || d->sasl->supportsChannelBinding())) {
             auto *qcaTlsHandler = qobject_cast<QCATLSHandler *>(d->tlsHandler);
             if (qcaTlsHandler && qcaTlsHandler->tls()) {
                 QCA::TLS     *tls         = qcaTlsHandler->tls();
                 const QString bindingType = tls->defaultChannelBindingType();
                 if (!bindingType.isEmpty()) {
                     const QByteArray bindingData = tls->channelBinding(bindingType);
-                    if (!bindingData.isEmpty())
+                    if (!bindingData.isEmpty() && simpleSASL) {
+                        d->sasl->context()->setProperty("scram-channel-binding-type", bindingType);
+                        d->sasl->context()->setProperty("scram-channel-binding-data", bindingData);
+                        channelBindingReady = true;
+                    } else if (!bindingData.isEmpty())
                         channelBindingReady = d->sasl->setChannelBinding(bindingType, bindingData, false);
                 }
             }
@@ -1537,9 +1699,17 @@ bool ClientStream::isResumed() const { return d->client.sm.isResumed(); }
 
 void ClientStream::setSMEnabled(bool e) { d->client.sm.state().setEnabled(e); }
 
+void ClientStream::setSMQueueLimits(qint64 maxBytes, qint64 requestBytes)
+{
+    d->client.sm.setQueueLimits(maxBytes, requestBytes);
+}
+
+QByteArray ClientStream::exportSMState() const { return d->client.sm.state().exportState(); }
+
+bool ClientStream::importSMState(const QByteArray &state) { return d->client.sm.state().importState(state); }
+
 void ClientStream::setTimer(int secs)
 {
-    d->timeout_timer.setSingleShot(true);
     d->timeout_timer.start(secs * 1000);
     d->client.notify &= ~CoreProtocol::NTimeout;
 }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/compressionhandler.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class CompressionHandlerTest : public QObject {
+    Q_OBJECT
+
+    static QByteArray stanza(int i) { return QString("<message to='a@b'><body>%1</body></message>").arg(i).toUtf8(); }
+
+private slots:
+    void testCoalescedRoundTrip()
+    {
+        CompressionHandler out, in;
+        QSignalSpy         readySpy(&out, SIGNAL(readyReadOutgoing()));
+        QByteArray         plain;
+        for (int i = 0; i < 100; ++i) {
+            plain += stanza(i);
+            out.write(stanza(i));
+        }
+        QTRY_VERIFY(readySpy.count() > 0);
+
+        int        plainBytes = 0;
+        QByteArray compressed = out.readOutgoing(&plainBytes);
+        QCOMPARE(plainBytes, int(plain.size()));
+        QCOMPARE(out.stats().flushes, quint64(1));
+
+        in.writeIncoming(compressed);
+        QCOMPARE(in.read(), plain);
+    }
+
+    void testByteBudget()
+    {
+        CompressionHandler out;
+        out.setFlushPolicy(256, 0);
+        int total = 0;
+        for (int i = 0; i < 100; ++i) {
+            total += int(stanza(i).size());
+            out.write(stanza(i));
+        }
+        // the budget is reached several times right away, the tail waits for the event loop
+        QVERIFY(out.stats().flushes > 5);
+        QTest::qWait(10);
+
+        int plainBytes = 0;
+        out.readOutgoing(&plainBytes);
+        QCOMPARE(plainBytes, total);
+    }
+
+    void testFlushEveryWrite()
+    {
+        CompressionHandler out;
+        out.setFlushPolicy(0, 0);
+        for (int i = 0; i < 10; ++i)
+            out.write(stanza(i));
+        QCOMPARE(out.stats().flushes, quint64(10));
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(CompressionHandlerTest);
+#include "compressionhandlertest.moc"
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/parser.h"
+
+#include <QFile>
+#include <QObject>
+#include <QTextStream>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+// A recorded stream can be supplied with IRIS_PARSER_BENCH_STREAM=<file>.
+// It must start with the <stream:stream> open tag, like a real capture.
+static QByteArray recordedStream()
+{
+    QByteArray path = qgetenv("IRIS_PARSER_BENCH_STREAM");
+    if (!path.isEmpty()) {
+        QFile f(QString::fromLocal8Bit(path));
+        if (f.open(QIODevice::ReadOnly))
+            return f.readAll();
+    }
+
+    QByteArray s = "<?xml version='1.0'?><stream:stream xmlns='jabber:client' "
+                   "xmlns:stream='http://etherx.jabber.org/streams' from='example.com' version='1.0'>";
+    for (int i = 0; i < 1000; ++i) {
+        QByteArray n = QByteArray::number(i);
+        s += "<presence from='user" + n + "@example.com/res' to='bot@example.com/x'><show>away</show>"
+             "<status>Out &amp; about</status><c xmlns='http://jabber.org/protocol/caps' hash='sha-1' "
+             "node='https://psi-im.org' ver='q07IKJEyjvHSyhy//CH0CxmKi8w='/>"
+             "<x xmlns='vcard-temp:x:update'><photo>aa0b6a9bdb6b2b6ba7f0a4f1b4c7c01a0f3d0f47</photo></x></presence>";
+        s += "<message from='room@muc.example.com/nick" + n + "' to='bot@example.com/x' type='groupchat' id='m" + n
+            + "'><body>Hello, world #" + n + "</body><stanza-id xmlns='urn:xmpp:sid:0' by='room@muc.example.com' id='"
+            + n + "'/></message>";
+    }
+    return s;
+}
+
+static QStringList parseAll(const QByteArray &data, Parser::Mode mode)
+{
+    Parser parser;
+    parser.setMode(mode);
+    parser.appendData(data);
+
+    QStringList  ret;
+    QDomDocument doc;
+    for (auto e = parser.readNext(); !e.isNull(); e = parser.readNext()) {
+        if (e.type() != Parser::Event::Element)
+            continue;
+        QString     s;
+        QTextStream ts(&s);
+        e.element(doc).save(ts, 0);
+        ret.append(s);
+    }
+    return ret;
+}
+
+// materialize=true mimics XmlProtocol, which needs the element in its own document
+static int parseElements(const QByteArray &data, Parser::Mode mode, bool materialize)
+{
+    Parser parser;
+    parser.setMode(mode);
+    parser.appendData(data);
+
+    int          n = 0;
+    QDomDocument doc;
+    for (auto e = parser.readNext(); !e.isNull(); e = parser.readNext()) {
+        if (e.type() != Parser::Event::Element)
+            continue;
+        if (materialize)
+            e.element(doc);
+        ++n;
+    }
+    return n;
+}
+
+class ParserTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testCompactTree()
+    {
+        Parser parser;
+        parser.setMode(Parser::Mode::Compact);
+        parser.appendData("<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>"
+                          "<iq type='result' id='a1'><query xmlns='jabber:iq:version'><name>iris</name>"
+                          "</query></iq>");
+
+        QCOMPARE(parser.readNext().type(), int(Parser::Event::DocumentOpen));
+        auto e = parser.readNext();
+        QCOMPARE(e.type(), int(Parser::Event::Element));
+
+        auto tree = e.compactElement();
+        QVERIFY(tree);
+        QCOMPARE(tree->localName(), QString("iq"));
+        QCOMPARE(tree->namespaceURI(), QString("jabber:client"));
+        QCOMPARE(tree->attribute("id"), QString("a1"));
+        auto query = tree->firstChildElement(CompactElementTree::Root, "query", "jabber:iq:version");
+        QVERIFY(query != CompactElementTree::NoNode);
+        QCOMPARE(tree->text(query), QString("iris"));
+
+        QDomElement de = e.element();
+        QCOMPARE(de.tagName(), QString("iq"));
+        QCOMPARE(de.firstChildElement("query").namespaceURI(), QString("jabber:iq:version"));
+    }
+
+    void testModesProduceSameDom()
+    {
+        QByteArray data = recordedStream();
+        QCOMPARE(parseAll(data, Parser::Mode::Compact), parseAll(data, Parser::Mode::Dom));
+    }
+
+    void testSharedNamesAndReset()
+    {
+        auto   names = std::make_shared<XmlNameTable>();
+        Parser p;
+        p.setMode(Parser::Mode::Compact);
+        p.setNameTable(names);
+        QVERIFY(p.readNext().isNull());
+        QCOMPARE(p.bufferedSize(), 0);
+        p.appendData("<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>");
+        QCOMPARE(p.readNext().type(), int(Parser::Event::DocumentOpen));
+        p.appendData("<message><body>hi</body></message><mess");
+        QCOMPARE(p.readNext().type(), int(Parser::Event::Element));
+        QVERIFY(names->size() > 1);
+        QVERIFY(p.bufferedSize() > 0);
+
+        // back to a private table in the middle of the stream
+        p.setNameTable(nullptr);
+        p.appendData("age><body>again</body></message><mess");
+        auto e = p.readNext();
+        QCOMPARE(e.type(), int(Parser::Event::Element));
+        QCOMPARE(e.element().firstChildElement("body").text(), QString("again"));
+        p.reset();
+        QCOMPARE(p.bufferedSize(), 0);
+        QVERIFY(p.unprocessed().isEmpty());
+    }
+
+    void benchmarkParse_data()
+    {
+        QTest::addColumn<int>("mode");
+        QTest::addColumn<bool>("materialize");
+        QTest::newRow("dom") << int(Parser::Mode::Dom) << false;
+        QTest::newRow("dom+import") << int(Parser::Mode::Dom) << true;
+        QTest::newRow("compact") << int(Parser::Mode::Compact) << false;
+        QTest::newRow("compact+materialize") << int(Parser::Mode::Compact) << true;
+    }
+
+    void benchmarkParse()
+    {
+        QFETCH(int, mode);
+        QFETCH(bool, materialize);
+        QByteArray data = recordedStream();
+        QBENCHMARK { parseElements(data, Parser::Mode(mode), materialize); }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(ParserTest);
+#include "parsertest.moc"
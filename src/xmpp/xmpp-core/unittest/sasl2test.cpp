@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/protocol.h"
+
+#include <QObject>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static const QByteArray streamOpen
+    = "<?xml version='1.0'?><stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams' "
+      "id='s1' from='example.com' version='1.0'>";
+
+static QByteArray features(bool bind2 = true)
+{
+    return QByteArray("<stream:features><authentication xmlns='urn:xmpp:sasl:2'>"
+                      "<mechanism>SCRAM-SHA-256</mechanism><inline>")
+        + (bind2 ? "<bind xmlns='urn:xmpp:bind:0'><inline><feature var='urn:xmpp:sm:3'/></inline></bind>" : "")
+        + "<sm xmlns='urn:xmpp:sm:3'/><fast xmlns='urn:xmpp:fast:0'><mechanism>HT-SHA-256-NONE</mechanism></fast>"
+          "</inline></authentication></stream:features>";
+}
+
+static QByteArray hmac(const QByteArray &key, const QByteArray &data)
+{
+    QCA::MessageAuthenticationCode mac("hmac(sha256)", QCA::SymmetricKey(key));
+    mac.update(data);
+    return mac.final().toByteArray();
+}
+
+class Sasl2Test : public QObject {
+    Q_OBJECT
+
+    QCA::Initializer initializer;
+
+    // what the protocol sent and which events it had while running out of work
+    QByteArray sent;
+    QList<int> events;
+
+    void run(CoreProtocol &p, const QByteArray &in = QByteArray())
+    {
+        sent.clear();
+        events.clear();
+        p.addIncomingData(in);
+        while (p.processStep()) {
+            events += p.event;
+            QByteArray out = p.takeOutgoingData();
+            p.outgoingDataWritten(int(out.size()));
+            sent += out;
+            if (p.event == CoreProtocol::EError)
+                return;
+        }
+        sent += p.takeOutgoingData();
+    }
+
+    void startFast(CoreProtocol &p)
+    {
+        p.startClientOut(Jid("user@example.com"), false, true, true, false);
+        p.setUserAgent("d7f8a7e6-uuid", "iris", "test");
+        p.fastMech  = "HT-SHA-256-NONE";
+        p.fastToken = "s3cr3t";
+        p.fastCount = 4;
+        run(p, streamOpen + features());
+    }
+
+private slots:
+    void init()
+    {
+        if (!QCA::isSupported("hmac(sha256)"))
+            QSKIP("hmac(sha256) not supported in QCA");
+    }
+
+    void testFastLogin()
+    {
+        CoreProtocol p;
+        p.sm.state().setEnabled(true);
+        startFast(p);
+
+        QVERIFY(p.isSASL2() && p.isFast());
+        QVERIFY(sent.contains("<authenticate xmlns=\"urn:xmpp:sasl:2\""));
+        QVERIFY(sent.contains("mechanism=\"HT-SHA-256-NONE\""));
+        QByteArray response = QByteArray("user") + '\0' + hmac("s3cr3t", "Initiator");
+        QVERIFY(sent.contains("<initial-response>" + response.toBase64() + "</initial-response>"));
+        QVERIFY(sent.contains("count=\"5\""));
+        QVERIFY(sent.contains("<tag>iris</tag>"));
+        QVERIFY(sent.contains("<enable xmlns=\"urn:xmpp:sm:3\""));
+        QVERIFY(!sent.contains("request-token"));
+
+        run(p,
+            "<success xmlns='urn:xmpp:sasl:2'><additional-data>" + hmac("s3cr3t", "Responder").toBase64()
+                + "</additional-data><authorization-identifier>user@example.com/iris.x1</authorization-identifier>"
+                  "<bound xmlns='urn:xmpp:bind:0'><enabled xmlns='urn:xmpp:sm:3' id='sm-1' resume='true'/></bound>"
+                  "<token xmlns='urn:xmpp:fast:0' expiry='2030-01-01T00:00:00Z' token='n3w'/></success>");
+        QCOMPARE(events, QList<int>({ CoreProtocol::ESASLSuccess, CoreProtocol::EReady }));
+        QVERIFY(p.isReady());
+        QCOMPARE(p.jid().full(), QString("user@example.com/iris.x1"));
+        QVERIFY(p.sm.isActive());
+        QCOMPARE(p.sm.state().resumption_id, QString("sm-1"));
+        QVERIFY(p.fastTokenChanged);
+        QCOMPARE(p.fastToken, QByteArray("n3w"));
+        QCOMPARE(p.fastMech, QString("HT-SHA-256-NONE"));
+        QCOMPARE(p.fastCount, 0);
+        QCOMPARE(p.fastExpiry.toSecsSinceEpoch(), 1893456000); // 2030-01-01
+    }
+
+    void testFastResume()
+    {
+        CoreProtocol p;
+        p.sm.state().setEnabled(true);
+        p.sm.state().resumption_id = "sm-1";
+        startFast(p);
+        QVERIFY(sent.contains("<resume xmlns=\"urn:xmpp:sm:3\""));
+        QVERIFY(sent.contains("previd=\"sm-1\""));
+
+        run(p,
+            "<success xmlns='urn:xmpp:sasl:2'><additional-data>" + hmac("s3cr3t", "Responder").toBase64()
+                + "</additional-data><authorization-identifier>user@example.com/iris.x1</authorization-identifier>"
+                  "<resumed xmlns='urn:xmpp:sm:3' h='0' previd='sm-1'/></success>");
+        QVERIFY(events.contains(CoreProtocol::EReady));
+        QVERIFY(p.sm.isResumed());
+    }
+
+    void testFastServerProof()
+    {
+        for (const QByteArray &proof : { QByteArray(), hmac("wrong", "Responder").toBase64() }) {
+            CoreProtocol p;
+            startFast(p);
+            run(p,
+                "<success xmlns='urn:xmpp:sasl:2'><additional-data>" + proof
+                    + "</additional-data><authorization-identifier>user@example.com/iris.x1"
+                      "</authorization-identifier></success>");
+            QCOMPARE(events, QList<int>({ CoreProtocol::EError }));
+            QCOMPARE(p.errorCode, int(CoreProtocol::ErrProtocol));
+            QVERIFY(!p.isReady());
+        }
+    }
+
+    void testRejectedToken()
+    {
+        CoreProtocol p;
+        startFast(p);
+        run(p,
+            "<failure xmlns='urn:xmpp:sasl:2'><not-authorized xmlns='urn:ietf:params:xml:ns:xmpp-sasl'/>"
+            "</failure>");
+        // forgotten, and the password is wanted now. still on SASL2
+        QVERIFY(p.fastTokenChanged);
+        QVERIFY(p.fastToken.isEmpty());
+        QVERIFY(!p.isFast());
+        QCOMPARE(p.need, int(CoreProtocol::NSASLFirst));
+        QVERIFY(p.isSASL2());
+
+        // a token is asked for along with the password login
+        p.setSASLFirst("SCRAM-SHA-256", "n,,n=user,r=abc");
+        run(p);
+        QVERIFY(sent.contains("mechanism=\"SCRAM-SHA-256\""));
+        QVERIFY(sent.contains("<request-token xmlns=\"urn:xmpp:fast:0\" mechanism=\"HT-SHA-256-NONE\"/>"));
+
+        // the rest of SCRAM goes in the SASL2 namespace too
+        run(p, "<challenge xmlns='urn:xmpp:sasl:2'>" + QByteArray("r=abcXYZ,s=c2FsdA==,i=4096").toBase64()
+                   + "</challenge>");
+        QCOMPARE(p.need, int(CoreProtocol::NSASLNext));
+        p.setSASLNext("c=biws,r=abcXYZ,p=cHJvb2Y=");
+        run(p);
+        QVERIFY(sent.contains("<response xmlns=\"urn:xmpp:sasl:2\">"
+                              + QByteArray("c=biws,r=abcXYZ,p=cHJvb2Y=").toBase64() + "</response>"));
+        QVERIFY(!sent.contains("urn:ietf:params:xml:ns:xmpp-sasl"));
+
+        run(p,
+            "<success xmlns='urn:xmpp:sasl:2'><additional-data>" + QByteArray("v=c2lnbmF0dXJl").toBase64()
+                + "</additional-data><authorization-identifier>user@example.com/iris.x2</authorization-identifier>"
+                  "<token xmlns='urn:xmpp:fast:0' expiry='2030-01-01T00:00:00Z' token='t0k'/></success>");
+        // the server signature is verified by the SASL provider before it's done
+        QCOMPARE(p.need, int(CoreProtocol::NSASLNext));
+        QVERIFY(sent.isEmpty());
+        p.setSASLNext(QByteArray());
+        run(p);
+        QVERIFY(events.contains(CoreProtocol::ESASLSuccess));
+        QCOMPARE(p.jid().full(), QString("user@example.com/iris.x2"));
+        QCOMPARE(p.fastToken, QByteArray("t0k"));
+        QCOMPARE(p.fastMech, QString("HT-SHA-256-NONE"));
+    }
+
+    void testNoBind2()
+    {
+        CoreProtocol p;
+        p.startClientOut(Jid("user@example.com"), false, true, true, false);
+        run(p, streamOpen + features(false));
+        // SASL2 without Bind2 would leave the stream without a resource
+        QVERIFY(!p.isSASL2());
+        QVERIFY(!sent.contains("authenticate"));
+    }
+
+    void testRequestedResource()
+    {
+        CoreProtocol p;
+        p.startClientOut(Jid("user@example.com/desk"), false, true, true, false);
+        run(p, streamOpen + features());
+        // Bind2 would give us whatever resource the server likes
+        QVERIFY(!p.isSASL2());
+        QVERIFY(!sent.contains("authenticate"));
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(Sasl2Test);
+#include "sasl2test.moc"
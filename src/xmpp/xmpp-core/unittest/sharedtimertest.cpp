@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/sharedtimer.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include <memory>
+
+using namespace XMPP;
+
+class SharedTimerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testSingleShotAndRepeat()
+    {
+        int         once = 0, repeated = 0;
+        SharedTimer a([&once]() { ++once; });
+        SharedTimer b([&repeated]() { ++repeated; });
+        b.setSingleShot(false);
+        a.start(10);
+        b.start(10);
+        QCOMPARE(SharedTimer::activeCount(), 2);
+
+        QTRY_COMPARE(repeated, 3);
+        QCOMPARE(once, 1);
+        QVERIFY(!a.isActive());
+        QVERIFY(b.isActive());
+        b.stop();
+        QCOMPARE(SharedTimer::activeCount(), 0);
+    }
+
+    void testStopAndDeleteFromCallback()
+    {
+        // both are due in the same round, whichever fires first kills the other
+        int                          fired = 0;
+        std::unique_ptr<SharedTimer> a, b;
+        a = std::make_unique<SharedTimer>([&]() {
+            ++fired;
+            b.reset();
+        });
+        b = std::make_unique<SharedTimer>([&]() {
+            ++fired;
+            a->stop();
+        });
+        a->start(0);
+        b->start(0);
+        QTest::qWait(3 * SharedTimer::Precision);
+        QCOMPARE(fired, 1);
+        QCOMPARE(SharedTimer::activeCount(), 0);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(SharedTimerTest);
+#include "sharedtimertest.moc"
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/sm.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static QByteArray stanza(int n)
+{
+    return QString("<message to=\"a@b\" id=\"%1\"><body>hi</body></message>").arg(n).toUtf8();
+}
+
+class SMQueueTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testQueue()
+    {
+        SMQueue q;
+        for (int i = 0; i < 10000; ++i)
+            q.enqueue(stanza(i));
+        QCOMPARE(q.size(), 10000);
+        for (int i = 0; i < 9000; ++i) {
+            QCOMPARE(q.at(0), stanza(i));
+            q.dequeue();
+        }
+        // the consumed head has been compacted away by now
+        for (int i = 10000; i < 10100; ++i)
+            q.enqueue(stanza(i));
+        for (int i = 0; i < q.size(); ++i)
+            QCOMPARE(q.at(i), stanza(9000 + i));
+        qint64 expected = 0;
+        for (int i = 9000; i < 10100; ++i)
+            expected += stanza(i).size();
+        QCOMPARE(q.bytes(), expected);
+
+        while (!q.isEmpty())
+            q.dequeue();
+        QCOMPARE(q.bytes(), 0);
+        q.enqueue(stanza(1));
+        QCOMPARE(q.at(0), stanza(1));
+    }
+
+    void testAckAndResend()
+    {
+        StreamManagement sm;
+        sm.start("abc");
+        for (int i = 0; i < 10; ++i)
+            QCOMPARE(sm.addUnacknowledgedStanza(stanza(i)), i + 1);
+        sm.processAcknowledgement(4);
+        QCOMPARE(sm.takeAckedCount(), 4);
+
+        sm.resume(6);
+        QCOMPARE(sm.takeAckedCount(), 2);
+        for (int i = 6; i < 10; ++i)
+            QCOMPARE(sm.getUnacknowledgedStanza(), stanza(i));
+        QVERIFY(sm.getUnacknowledgedStanza().isEmpty());
+    }
+
+    void testLimits()
+    {
+        StreamManagement sm;
+        int              size = stanza(0).size();
+        sm.setQueueLimits(size * 10, size * 3);
+        sm.start("abc");
+
+        sm.addUnacknowledgedStanza(stanza(0));
+        sm.addUnacknowledgedStanza(stanza(1));
+        QVERIFY(!sm.isAckRequestDue());
+        sm.addUnacknowledgedStanza(stanza(2));
+        QVERIFY(sm.isAckRequestDue());
+        QDomDocument doc;
+        QVERIFY(!sm.generateRequestStanza(doc).isNull());
+        QVERIFY(!sm.isAckRequestDue()); // already asked
+
+        for (int i = 3; i < 12; ++i)
+            sm.addUnacknowledgedStanza(stanza(i));
+        QVERIFY(!sm.state().isResumption());
+        QVERIFY(sm.state().send_queue.isPayloadDropped());
+        QCOMPARE(sm.state().send_queue.bytes(), 0);
+
+        // still counted, so acks are reported right
+        sm.processAcknowledgement(12);
+        QCOMPARE(sm.takeAckedCount(), 12);
+        QVERIFY(sm.state().exportState().isEmpty());
+    }
+
+    void testExportImport()
+    {
+        StreamManagement sm;
+        sm.start("abc");
+        sm.setLocation("xmpp.example.com", 5223);
+        for (int i = 0; i < 5; ++i)
+            sm.addUnacknowledgedStanza(stanza(i));
+        sm.processAcknowledgement(2);
+        sm.markStanzaHandled();
+        QByteArray exported = sm.state().exportState();
+        QVERIFY(!exported.isEmpty());
+
+        StreamManagement restored;
+        restored.state().setEnabled(true);
+        QVERIFY(!restored.state().importState(exported.left(exported.size() - 3)));
+        QVERIFY(!restored.state().isResumption());
+        QVERIFY(restored.state().importState(exported));
+        QVERIFY(restored.state().isEnabled());
+        QCOMPARE(restored.state().resumption_id, QString("abc"));
+        QCOMPARE(restored.state().resumption_location.host, QString("xmpp.example.com"));
+        QCOMPARE(restored.state().resumption_location.port, quint16(5223));
+        QCOMPARE(restored.state().received_count, quint32(1));
+
+        restored.resume(3);
+        QCOMPARE(restored.takeAckedCount(), 1);
+        QCOMPARE(restored.getUnacknowledgedStanza(), stanza(3));
+        QCOMPARE(restored.getUnacknowledgedStanza(), stanza(4));
+        QVERIFY(restored.getUnacknowledgedStanza().isEmpty());
+    }
+
+    // a burst of outgoing stanzas acknowledged in batches, like on a busy MUC
+    void benchmarkQueue()
+    {
+        QList<QByteArray> stanzas;
+        for (int i = 0; i < 1000; ++i)
+            stanzas += stanza(i);
+
+        QBENCHMARK
+        {
+            StreamManagement sm;
+            sm.start("abc");
+            quint32 h = 0;
+            for (int round = 0; round < 100; ++round) {
+                for (const QByteArray &s : std::as_const(stanzas))
+                    sm.addUnacknowledgedStanza(s);
+                h += quint32(stanzas.size());
+                sm.processAcknowledgement(h);
+            }
+        }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(SMQueueTest);
+#include "smqueuetest.moc"
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/xmpp_traffictap.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+class TrafficTapTest : public QObject {
+    Q_OBJECT
+
+    QDomDocument doc;
+
+    QDomElement jingleIq()
+    {
+        QDomElement iq = doc.createElementNS("jabber:client", "iq");
+        iq.appendChild(doc.createElementNS("urn:xmpp:jingle:1", "jingle"));
+        return iq;
+    }
+
+private slots:
+    void testNoSubscribersNoText()
+    {
+        TrafficTap tap;
+        int        made = 0;
+        tap.deliver(TrafficTap::Incoming, jingleIq(), [&]() {
+            ++made;
+            return QString("<iq/>");
+        });
+        QCOMPARE(made, 0);
+        QCOMPARE(tap.producedBytes(), quint64(0));
+    }
+
+    void testFilters()
+    {
+        TrafficTap  tap;
+        QStringList all, jingle, sm;
+        tap.subscribe(TrafficTap::Incoming | TrafficTap::Outgoing, {},
+                      [&](TrafficTap::Direction, const QString &xml) { all += xml; });
+        tap.subscribe(TrafficTap::Incoming, { "urn:xmpp:jingle:1" },
+                      [&](TrafficTap::Direction, const QString &xml) { jingle += xml; });
+        tap.subscribe(TrafficTap::Outgoing, { "urn:xmpp:sm:3" },
+                      [&](TrafficTap::Direction, const QString &xml) { sm += xml; });
+
+        int made = 0;
+        tap.deliver(TrafficTap::Incoming, jingleIq(), [&]() {
+            ++made;
+            return QString("<iq><jingle/></iq>");
+        });
+        tap.deliver(TrafficTap::Outgoing, jingleIq(), [] { return QString("<iq><jingle/></iq>"); });
+        tap.deliver(TrafficTap::Outgoing, doc.createElementNS("urn:xmpp:sm:3", "r"), [] { return QString("<r/>"); });
+        tap.deliver(TrafficTap::Outgoing, QString("<stream:stream>"));
+
+        QCOMPARE(made, 1); // once for everybody
+        QCOMPARE(all.size(), 4);
+        QCOMPARE(jingle, QStringList({ "<iq><jingle/></iq>" }));
+        QCOMPARE(sm, QStringList({ "<r/>" }));
+        QCOMPARE(tap.producedBytes(), quint64((18 + 18 + 4 + 15) * sizeof(QChar)));
+    }
+
+    void testWants()
+    {
+        TrafficTap tap;
+        tap.subscribe(TrafficTap::Incoming, { "urn:xmpp:jingle:1" }, [](TrafficTap::Direction, const QString &) { });
+        QVERIFY(tap.wants(TrafficTap::Incoming, jingleIq()));
+        QVERIFY(!tap.wants(TrafficTap::Outgoing, jingleIq()));
+        QVERIFY(!tap.wants(TrafficTap::Incoming, doc.createElementNS("jabber:client", "message")));
+        QVERIFY(!tap.wants(TrafficTap::Incoming)); // stream headers have no namespace to match
+    }
+
+    void testUnsubscribeFromCallback()
+    {
+        TrafficTap tap;
+        int        calls = 0, id = 0;
+        id = tap.subscribe(TrafficTap::Incoming, {}, [&](TrafficTap::Direction, const QString &) {
+            ++calls;
+            tap.unsubscribe(id);
+        });
+        tap.deliver(TrafficTap::Incoming, QString("<a/>"));
+        tap.deliver(TrafficTap::Incoming, QString("<b/>"));
+        QCOMPARE(calls, 1);
+        QVERIFY(tap.isEmpty());
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(TrafficTapTest);
+#include "traffictaptest.moc"
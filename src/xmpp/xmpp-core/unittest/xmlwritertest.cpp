@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/xmlwriter.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+class XmlWriterTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testNamespacesOnlyWhereTheyChange()
+    {
+        QDomDocument doc;
+        QDomElement  m = doc.createElementNS("jabber:client", "message");
+        m.setAttribute("to", "a@b");
+        QDomElement body = doc.createElementNS("jabber:client", "body");
+        body.appendChild(doc.createTextNode("hi"));
+        m.appendChild(body);
+        m.appendChild(doc.createElementNS("urn:xmpp:receipts", "request"));
+
+        QCOMPARE(XmlWriter::toUtf8(m, "jabber:client"),
+                 QByteArray("<message to=\"a@b\"><body>hi</body><request xmlns=\"urn:xmpp:receipts\"/></message>"));
+    }
+
+    void testEscaping()
+    {
+        QDomDocument doc;
+        QDomElement  e = doc.createElementNS("jabber:client", "body");
+        e.setAttribute("a", "\"x\" > y\n");
+        e.appendChild(doc.createTextNode(QString("a<b>&c") + QChar(0x1) + QString::fromUtf8("\xc3\xa9")));
+
+        QCOMPARE(XmlWriter::toUtf8(e, "jabber:client"),
+                 QByteArray("<body a=\"&quot;x&quot; &gt; y&#xA;\">a&lt;b&gt;&amp;c\xc3\xa9</body>"));
+    }
+
+    void testSurrogates()
+    {
+        QDomDocument doc;
+        QDomElement  e = doc.createElementNS("jabber:client", "body");
+        QString      s = QString::fromUtf8("\xf0\x9f\x98\x80"); // U+1F600
+        s += QChar(0xD800);                                       // lone high surrogate is dropped
+        e.appendChild(doc.createTextNode(s));
+
+        QCOMPARE(XmlWriter::toUtf8(e, "jabber:client"), QByteArray("<body>\xf0\x9f\x98\x80</body>"));
+    }
+
+    void testPrefixedRoot()
+    {
+        QDomDocument doc;
+        QDomElement  e = doc.createElementNS("http://etherx.jabber.org/streams", "stream:error");
+        e.appendChild(doc.createElementNS("urn:ietf:params:xml:ns:xmpp-streams", "conflict"));
+
+        QCOMPARE(XmlWriter::toUtf8(e, "http://etherx.jabber.org/streams"),
+                 QByteArray("<stream:error><conflict xmlns=\"urn:ietf:params:xml:ns:xmpp-streams\"/></stream:error>"));
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(XmlWriterTest);
+#include "xmlwritertest.moc"
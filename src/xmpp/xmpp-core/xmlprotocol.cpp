@@ -20,6 +20,7 @@
 #include "xmlprotocol.h"
 
 #include "bytestream.h"
+#include "xmlwriter.h"
 
 #include <QByteArray>
 #include <QList>
@@ -27,6 +28,26 @@
 
 using namespace XMPP;
 
+namespace {
+// see XmlProtocol::setSharedResources()
+struct ThreadResources {
+    // a null document would get its data on first use by a copy only
+    ThreadResources() { doc.createElement(QStringLiteral("x")); }
+
+    std::shared_ptr<XmlNameTable> nameTable()
+    {
+        if (!names || names->isFull())
+            names = std::make_shared<XmlNameTable>();
+        return names;
+    }
+
+    std::shared_ptr<XmlNameTable> names;
+    QDomDocument                  doc;
+};
+
+thread_local ThreadResources threadResources;
+} // namespace
+
 // stripExtraNS
 //
 // This function removes namespace information from various nodes for
@@ -261,10 +282,13 @@ void XmlProtocol::reset()
     init();
 
     elem     = QDomElement();
-    elemDoc  = QDomDocument();
+    elemDoc  = sharedResources ? threadResources.doc : QDomDocument();
     tagOpen  = QString();
     tagClose = QString();
+    rootNamespaces.clear();
     xml.reset();
+    if (sharedResources)
+        xml.setNameTable(threadResources.nameTable());
     outDataNormal.resize(0);
     outDataUrgent.resize(0);
     trackQueueNormal.clear();
@@ -274,6 +298,21 @@ void XmlProtocol::reset()
 
 void XmlProtocol::addIncomingData(const QByteArray &a) { xml.appendData(a); }
 
+void XmlProtocol::setSharedResources(bool shared)
+{
+    sharedResources = shared;
+    xml.setNameTable(shared ? threadResources.nameTable() : nullptr);
+    if (elem.isNull())
+        elemDoc = shared ? threadResources.doc : QDomDocument();
+}
+
+QDomDocument XmlProtocol::sharedDocument() { return threadResources.doc; }
+
+qsizetype XmlProtocol::bufferedBytes() const
+{
+    return xml.bufferedSize() + outDataNormal.size() + outDataUrgent.size();
+}
+
 QByteArray XmlProtocol::takeOutgoingData()
 {
     if (!outDataUrgent.isEmpty()) {
@@ -332,7 +371,11 @@ bool XmlProtocol::processStep()
                 return true;
             }
             case Parser::Event::Element: {
-                QDomElement e = elemDoc.importNode(pe.element(), true).toElement();
+                // in compact mode this is the only place the DOM gets built for the element. it isn't
+                // deferred any further: doStep() and everything after it up to the tasks work on
+                // QDomElement, so every element received needs it anyway. what the compact mode saves
+                // is the DOM of the parser's own document and the import into elemDoc
+                QDomElement e = pe.element(elemDoc);
                 transferItemList += TransferItem(e, false);
 
                 // elementRecv(pe.element());
@@ -366,21 +409,22 @@ bool XmlProtocol::processStep()
     return baseStep(pe);
 }
 
+void XmlProtocol::setParserMode(Parser::Mode mode) { xml.setMode(mode); }
+
 QString XmlProtocol::xmlEncoding() const { return xml.encoding().toString(); }
 
-QString XmlProtocol::elementToString(const QDomElement &e, bool clip)
+QString XmlProtocol::rootNamespaceFor(const QString &prefix)
 {
     if (elem.isNull())
         elem = elemDoc.importNode(docElement(), true).toElement();
 
-    // Determine the appropriate 'fakeNS' to use
-    QString ns;
+    auto it = rootNamespaces.constFind(prefix);
+    if (it != rootNamespaces.constEnd())
+        return it.value();
 
     // first, check root namespace
-    QString pre = e.prefix();
-    if (pre.isNull())
-        pre = "";
-    if (pre == elem.prefix()) {
+    QString ns;
+    if (prefix == elem.prefix()) {
         ns = elem.namespaceURI();
     } else {
         // scan the root attributes for 'xmlns' (oh joyous hacks)
@@ -394,7 +438,7 @@ QString XmlProtocol::elementToString(const QDomElement &e, bool clip)
                 s = s.mid(x + 1);
             else
                 s = "";
-            if (pre == s) {
+            if (prefix == s) {
                 ns = a.value();
                 break;
             }
@@ -404,6 +448,17 @@ QString XmlProtocol::elementToString(const QDomElement &e, bool clip)
             ns = elem.namespaceURI();
         }
     }
+    rootNamespaces.insert(prefix, ns);
+    return ns;
+}
+
+QString XmlProtocol::elementToString(const QDomElement &e, bool clip)
+{
+    // Determine the appropriate 'fakeNS' to use
+    QString pre = e.prefix();
+    if (pre.isNull())
+        pre = "";
+    QString ns = rootNamespaceFor(pre);
 
     // build qName
     QString qn;
@@ -479,8 +534,31 @@ int XmlProtocol::writeElement(const QDomElement &e, int id, bool external, bool
     transferItemList += TransferItem(e, true, external);
 
     // elementSend(e);
-    QString out = sanitizeForStream(elementToString(e, clip));
-    return internalWriteString(out, TrackItem::Custom, id, urgent);
+    // serialize straight into the outgoing buffer. 'clip' is meaningless here since
+    // XmlWriter never emits trailing whitespace
+    Q_UNUSED(clip)
+    QByteArray &out    = urgent ? outDataUrgent : outDataNormal;
+    int         before = out.size();
+    XmlWriter(out, rootNamespaceFor(e.prefix())).writeElement(e);
+    return trackWrittenData(out.size() - before, TrackItem::Custom, id, urgent);
+}
+
+QByteArray XmlProtocol::serializeElement(const QDomElement &e)
+{
+    return XmlWriter::toUtf8(e, rootNamespaceFor(e.prefix()));
+}
+
+// 'data' is 'e' already serialized with serializeElement(). 'e' is for the debug output only
+int XmlProtocol::writeSerialized(const QDomElement &e, const QByteArray &data, int id, bool external)
+{
+    transferItemList += TransferItem(e, true, external);
+    return internalWriteData(data, TrackItem::Custom, id);
+}
+
+int XmlProtocol::writeSerialized(const QByteArray &data, int id, bool external)
+{
+    transferItemList += TransferItem(QString::fromUtf8(data), true, external);
+    return internalWriteData(data, TrackItem::Custom, id);
 }
 
 QByteArray XmlProtocol::resetStream()
@@ -498,20 +576,26 @@ QByteArray XmlProtocol::resetStream()
 }
 
 int XmlProtocol::internalWriteData(const QByteArray &a, TrackItem::Type t, int id, bool urgent)
+{
+    if (urgent)
+        outDataUrgent += a;
+    else
+        outDataNormal += a;
+    return trackWrittenData(a.size(), t, id, urgent);
+}
+
+int XmlProtocol::trackWrittenData(int size, TrackItem::Type t, int id, bool urgent)
 {
     TrackItem i;
     i.type = t;
     i.id   = id;
-    i.size = a.size();
+    i.size = size;
 
-    if (urgent) {
+    if (urgent)
         trackQueueUrgent += i;
-        outDataUrgent += a;
-    } else {
+    else
         trackQueueNormal += i;
-        outDataNormal += a;
-    }
-    return a.size();
+    return size;
 }
 
 int XmlProtocol::internalWriteString(const QString &s, TrackItem::Type t, int id, bool urgent)
@@ -22,6 +22,7 @@
 
 #include "parser.h"
 
+#include <QHash>
 #include <QList>
 #include <QObject>
 #include <qdom.h>
@@ -73,9 +74,17 @@ public:
     int need = 0, event = 0, errorCode = 0, notify = 0, timeout_sec = 0;
 
     inline bool isIncoming() const { return incoming; }
+    void        setParserMode(Parser::Mode mode);
     QString     xmlEncoding() const;
     QString     elementToString(const QDomElement &e, bool clip = false);
 
+    // The parser name table and the document incoming elements are built in are shared
+    // with the other protocols of the thread having this on. Keeps processes with many
+    // thousands of streams smaller.
+    void                setSharedResources(bool shared);
+    static QDomDocument sharedDocument(); // of the current thread
+    qsizetype           bufferedBytes() const; // received but not parsed yet, and not taken for sending
+
     class TransferItem {
     public:
         TransferItem();
@@ -112,6 +121,9 @@ protected:
     bool       close();
     int        writeString(const QString &s, int id, bool external);
     int        writeElement(const QDomElement &e, int id, bool external, bool clip = false, bool urgent = false);
+    QByteArray serializeElement(const QDomElement &e); // exactly what writeElement() puts on the wire
+    int        writeSerialized(const QDomElement &e, const QByteArray &data, int id, bool external);
+    int        writeSerialized(const QByteArray &data, int id, bool external);
     QByteArray resetStream();
 
 private:
@@ -122,14 +134,16 @@ private:
         int type, id, size;
     };
 
-    bool         incoming;
-    QDomDocument elemDoc;
-    QDomElement  elem;
-    QString      tagOpen;
-    QString      tagClose;
-    int          state = 0;
-    bool         peerClosed;
-    bool         closeWritten;
+    bool                    incoming;
+    QDomDocument            elemDoc;
+    QDomElement             elem;
+    QHash<QString, QString> rootNamespaces; // prefix => namespace declared by the root element
+    QString                 tagOpen;
+    QString                 tagClose;
+    int                     state           = 0;
+    bool                    sharedResources = false;
+    bool                    peerClosed;
+    bool                    closeWritten;
 
     Parser           xml;
     QByteArray       outDataNormal;
@@ -137,13 +151,15 @@ private:
     QList<TrackItem> trackQueueNormal;
     QList<TrackItem> trackQueueUrgent;
 
-    void init();
-    int  internalWriteData(const QByteArray &a, TrackItem::Type t, int id = -1, bool urgent = false);
-    int  internalWriteString(const QString &s, TrackItem::Type t, int id = -1, bool urgent = false);
-    int  processTrackQueue(QList<TrackItem> &queue, int bytes);
-    void sendTagOpen();
-    void sendTagClose();
-    bool baseStep(const Parser::Event &pe);
+    void    init();
+    int     internalWriteData(const QByteArray &a, TrackItem::Type t, int id = -1, bool urgent = false);
+    int     internalWriteString(const QString &s, TrackItem::Type t, int id = -1, bool urgent = false);
+    int     trackWrittenData(int size, TrackItem::Type t, int id, bool urgent);
+    int     processTrackQueue(QList<TrackItem> &queue, int bytes);
+    void    sendTagOpen();
+    void    sendTagClose();
+    bool    baseStep(const Parser::Event &pe);
+    QString rootNamespaceFor(const QString &prefix);
 };
 } // namespace XMPP
 
@@ -0,0 +1,244 @@
+/*
+ * xmlwriter.cpp - single-pass serializer of outgoing stanzas
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmlwriter.h"
+
+#include <algorithm>
+
+namespace XMPP {
+
+static const QLatin1String xmlNS("http://www.w3.org/XML/1998/namespace");
+static const QLatin1String xmlnsAttr("xmlns");
+static const QLatin1String xmlnsPrefix("xmlns:");
+
+static inline bool highSurrogate(ushort ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
+
+static inline bool lowSurrogate(ushort ch) { return ch >= 0xDC00 && ch <= 0xDFFF; }
+
+XmlWriter::XmlWriter(QByteArray &out, const QString &scopeNS) : out_(out), scopeNS_(scopeNS) { }
+
+void XmlWriter::writeElement(const QDomElement &e)
+{
+    if (e.isNull())
+        return;
+    prefixes_.clear();
+    QString prefix = e.prefix();
+    if (prefix.isEmpty()) {
+        writeElementInternal(e, scopeNS_);
+    } else {
+        // the stream root has bound the prefix (usually "stream:"), but the default
+        // namespace is unknown here, so unprefixed children always get an xmlns
+        prefixes_.push_back({ prefix, scopeNS_ });
+        writeElementInternal(e, QString());
+    }
+}
+
+QByteArray XmlWriter::toUtf8(const QDomElement &e, const QString &scopeNS)
+{
+    QByteArray out;
+    XmlWriter(out, scopeNS).writeElement(e);
+    return out;
+}
+
+bool XmlWriter::prefixInScope(const QString &prefix, const QString &ns) const
+{
+    for (auto it = prefixes_.crbegin(); it != prefixes_.crend(); ++it) {
+        if (it->prefix == prefix)
+            return it->ns == ns;
+    }
+    return false;
+}
+
+void XmlWriter::writeElementInternal(const QDomElement &e, const QString &parentNS)
+{
+    const QString ns           = e.namespaceURI();
+    const QString prefix       = e.prefix();
+    const size_t  prefixesSize = prefixes_.size();
+    QString       childNS      = parentNS;
+    bool          wroteXmlns   = false;
+
+    // elements created without a namespace (createElement) keep whatever is in
+    // scope, like the old stripExtraNS did
+    QString qName = (prefix.isEmpty() || ns.isNull()) ? e.tagName() : prefix + QLatin1Char(':') + e.localName();
+    out_ += '<';
+    writeName(qName);
+    if (!ns.isNull()) {
+        if (prefix.isEmpty()) {
+            if (ns != parentNS) {
+                out_ += " xmlns=\"";
+                writeText(ns, true);
+                out_ += '"';
+                wroteXmlns = true;
+            }
+            childNS = ns;
+        } else if (!prefixInScope(prefix, ns)) {
+            out_ += " xmlns:";
+            writeName(prefix);
+            out_ += "=\"";
+            writeText(ns, true);
+            out_ += '"';
+            prefixes_.push_back({ prefix, ns });
+        }
+    }
+
+    const QDomNamedNodeMap attrs = e.attributes();
+    for (int i = 0; i < attrs.count(); ++i) {
+        const QDomAttr a      = attrs.item(i).toAttr();
+        const QString  attrNS = a.namespaceURI();
+        const QString  name   = a.name();
+        if (attrNS.isNull()) {
+            // somebody set namespace declarations by hand. don't duplicate ours
+            if (name == xmlnsAttr) {
+                if (wroteXmlns)
+                    continue;
+                childNS = a.value();
+            } else if (name.startsWith(xmlnsPrefix)) {
+                QString p  = name.mid(xmlnsPrefix.size());
+                auto    it = std::find_if(prefixes_.cbegin() + prefixesSize, prefixes_.cend(),
+                                          [&p](const Prefix &v) { return v.prefix == p; });
+                if (it != prefixes_.cend())
+                    continue;
+                prefixes_.push_back({ p, a.value() });
+            }
+            out_ += ' ';
+            writeName(name);
+        } else if (attrNS == xmlNS) {
+            out_ += " xml:";
+            writeName(name);
+        } else {
+            const QString attrPrefix = a.prefix();
+            out_ += ' ';
+            if (!attrPrefix.isEmpty()) {
+                writeName(attrPrefix);
+                out_ += ':';
+            }
+            writeName(name);
+            if (!attrPrefix.isEmpty() && !prefixInScope(attrPrefix, attrNS)) {
+                out_ += "=\"";
+                writeText(a.value(), true);
+                out_ += "\" xmlns:";
+                writeName(attrPrefix);
+                out_ += "=\"";
+                writeText(attrNS, true);
+                out_ += '"';
+                prefixes_.push_back({ attrPrefix, attrNS });
+                continue;
+            }
+        }
+        out_ += "=\"";
+        writeText(a.value(), true);
+        out_ += '"';
+    }
+
+    QDomNode n = e.firstChild();
+    if (n.isNull()) {
+        out_ += "/>";
+    } else {
+        out_ += '>';
+        // firstChild/nextSibling, because childNodes().item(x) is a linear lookup each time
+        for (; !n.isNull(); n = n.nextSibling()) {
+            if (n.isElement())
+                writeElementInternal(n.toElement(), childNS);
+            else if (n.isText()) // includes CDATA sections
+                writeText(n.toCharacterData().data(), false);
+        }
+        out_ += "</";
+        writeName(qName);
+        out_ += '>';
+    }
+    prefixes_.resize(prefixesSize);
+}
+
+void XmlWriter::writeName(const QString &s)
+{
+    const QChar *p   = s.constData();
+    const int    len = int(s.size());
+    for (int i = 0; i < len; ++i) {
+        ushort c = p[i].unicode();
+        if (c >= 0x80) {
+            out_ += QStringView(p + i, len - i).toUtf8();
+            return;
+        }
+        out_ += char(c);
+    }
+}
+
+// w3c xml spec:
+// [2] Char ::= #x9 | #xA | #xD | [#x20-#xD7FF] | [#xE000-#xFFFD] | [#x10000-#x10FFFF]
+// XMPP-Core additionally requires '>' to be escaped.
+void XmlWriter::writeText(const QString &s, bool attribute)
+{
+    const QChar *p   = s.constData();
+    const int    len = int(s.size());
+    for (int i = 0; i < len; ++i) {
+        ushort c = p[i].unicode();
+        if (c < 0x80) {
+            switch (c) {
+            case '&':
+                out_ += "&amp;";
+                break;
+            case '<':
+                out_ += "&lt;";
+                break;
+            case '>':
+                out_ += "&gt;";
+                break;
+            case '"':
+                out_ += attribute ? "&quot;" : "\"";
+                break;
+            case '\t':
+                out_ += attribute ? "&#x9;" : "\t";
+                break;
+            case '\n':
+                out_ += attribute ? "&#xA;" : "\n";
+                break;
+            case '\r':
+                out_ += "&#xD;"; // would be normalized to \n by the receiving parser otherwise
+                break;
+            default:
+                if (c >= 0x20)
+                    out_ += char(c);
+                else
+                    qDebug("Dropping invalid XML char U+%04x", c);
+            }
+        } else if (c < 0x800) {
+            out_ += char(0xC0 | (c >> 6));
+            out_ += char(0x80 | (c & 0x3F));
+        } else if (highSurrogate(c)) {
+            if (i + 1 < len && lowSurrogate(p[i + 1].unicode())) {
+                uint ucs = 0x10000 + ((uint(c & 0x3FF) << 10) | (p[i + 1].unicode() & 0x3FF));
+                out_ += char(0xF0 | (ucs >> 18));
+                out_ += char(0x80 | ((ucs >> 12) & 0x3F));
+                out_ += char(0x80 | ((ucs >> 6) & 0x3F));
+                out_ += char(0x80 | (ucs & 0x3F));
+                ++i;
+            } else {
+                qDebug("Dropping invalid XML char U+%04x", c);
+            }
+        } else if (lowSurrogate(c) || c == 0xFFFE || c == 0xFFFF) {
+            qDebug("Dropping invalid XML char U+%04x", c);
+        } else {
+            out_ += char(0xE0 | (c >> 12));
+            out_ += char(0x80 | ((c >> 6) & 0x3F));
+            out_ += char(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+} // namespace XMPP
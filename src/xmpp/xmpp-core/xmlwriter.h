@@ -0,0 +1,66 @@
+/*
+ * xmlwriter.h - single-pass serializer of outgoing stanzas
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef XMPP_XMLWRITER_H
+#define XMPP_XMLWRITER_H
+
+#include <QByteArray>
+#include <QDomElement>
+#include <QString>
+
+#include <vector>
+
+namespace XMPP {
+
+// Serializes a QDomElement straight into a UTF-8 buffer in one walk of the tree.
+//
+// Unlike QDomNode::save() it declares a namespace only when it differs from the
+// one in scope, always escapes '>' (XMPP-Core requires this) and silently drops
+// characters not allowed in XML, so the output is ready to go on the wire.
+// No indentation or newlines are added. Comments and processing instructions
+// are not allowed in XMPP streams and are skipped.
+class XmlWriter {
+public:
+    // 'out' is appended to. 'scopeNS' is the namespace already in effect for
+    // the element, usually the default namespace of the stream root.
+    XmlWriter(QByteArray &out, const QString &scopeNS);
+
+    void writeElement(const QDomElement &e);
+
+    static QByteArray toUtf8(const QDomElement &e, const QString &scopeNS);
+
+private:
+    struct Prefix {
+        QString prefix;
+        QString ns;
+    };
+
+    void writeElementInternal(const QDomElement &e, const QString &parentNS);
+    void writeText(const QString &s, bool attribute);
+    void writeName(const QString &s);
+    bool prefixInScope(const QString &prefix, const QString &ns) const;
+
+    QByteArray         &out_;
+    QString             scopeNS_;
+    std::vector<Prefix> prefixes_; // declared on the current element path
+};
+
+} // namespace XMPP
+
+#endif // XMPP_XMLWRITER_H
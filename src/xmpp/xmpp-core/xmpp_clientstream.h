@@ -21,6 +21,7 @@
 
 #include <iris/xmpp-core/xmpp_stream.h>
 
+#include <QDateTime>
 #include <QtCrypto>
 
 class ByteStream;
@@ -35,6 +36,7 @@ namespace XMPP {
 class Connector;
 class StreamFeatures;
 class TLSHandler;
+class TrafficTap;
 
 class ClientStream : public Stream {
     Q_OBJECT
@@ -115,6 +117,46 @@ public:
     void          setSCRAMStoredSaltedHash(const QString &s);
     const QString getSCRAMStoredSaltedHash();
 
+    // XEP-0388 SASL2, with the resource bound (XEP-0386) and SM enabled or resumed along with
+    // the authentication. Used when the server offers all of it, saves the stream restart and
+    // the round trips after it. On by default. The server picks the resource with Bind2, so a jid
+    // with a resource makes the stream go the classic way to bind the one asked for
+    void setSASL2Enabled(bool enable);
+    // Sent with SASL2. 'id' identifies the installation and has to stay the same, FAST tokens
+    // are bound to it. 'software' also serves as the Bind2 tag
+    void setUserAgent(const QString &id, const QString &software, const QString &device = QString());
+
+    // XEP-0484 FAST. With a user agent set, a token is requested on password logins. Later logins
+    // use it instead of the password: one round trip, and no key derivation. Store it whenever
+    // fastTokenChanged() is emitted (renewed, used or rejected) and set it before connecting.
+    struct FastToken {
+        QString    mechanism; // e.g. HT-SHA-256-NONE
+        QByteArray token;
+        QDateTime  expiry;
+        int        count = 0; // times used
+
+        bool isValid() const
+        {
+            return !token.isEmpty() && (!expiry.isValid() || expiry > QDateTime::currentDateTimeUtc());
+        }
+    };
+    void      setFastToken(const FastToken &token);
+    FastToken fastToken() const;
+
+    // Where the time of the last login went, in milliseconds. -1 for what didn't happen
+    struct LoginTimings {
+        qint64 connect = -1; // connectToServer() until connected
+        qint64 tls     = -1; // then until TLS is up, STARTTLS negotiation included
+        qint64 auth    = -1; // then until authenticated
+        qint64 bind    = -1; // then until ready: bind, session and SM
+        qint64 total   = -1;
+
+        bool sasl2   = false;
+        bool fast    = false; // logged in with a FAST token
+        bool resumed = false; // SM session resumed
+    };
+    LoginTimings loginTimings() const;
+
     // SASL information
     QString saslMechanism() const;
     int     saslSSF() const;
@@ -135,6 +177,20 @@ public:
 
     // Compression
     void setCompress(bool);
+    // stanzas are deflated together until 'maxPendingBytes' of them are pending or
+    // 'maxDelayMs' passes. maxPendingBytes <= 0 flushes after every stanza
+    void setCompressionFlushPolicy(int maxPendingBytes, int maxDelayMs = 0);
+
+    // What the outgoing compression did so far. All zeros while the stream isn't compressed
+    struct CompressionStats {
+        bool    active          = false;
+        quint64 plainBytes      = 0;
+        quint64 compressedBytes = 0;
+        quint64 flushes         = 0;
+
+        double ratio() const { return plainBytes ? double(compressedBytes) / double(plainBytes) : 1.0; }
+    };
+    CompressionStats compressionStats() const;
 
     // reimplemented
     QDomDocument &doc() const;
@@ -155,10 +211,34 @@ public:
     // extra
     void writeDirect(const QString &s);
     void setNoopTime(int mills);
+    void setCompactParsing(bool enable); // don't build a DOM tree while parsing, only when a stanza is handled
+    // For servers with very many streams: compact parsing, plus the XML name table and the
+    // documents are shared with the other lightweight streams of the thread. Set it before start.
+    void setLightweight(bool enable);
+    // also gets what is emitted with incomingXml/outgoingXml. Not owned
+    void setTrafficTap(TrafficTap *tap);
 
     // Stream management
     bool isResumed() const;
     void setSMEnabled(bool enable);
+    // Unacknowledged stanzas are kept for resending up to 'maxBytes'. Past that the session
+    // can't be resumed anymore. An ack is requested early once 'requestBytes' are pending.
+    void setSMQueueLimits(qint64 maxBytes, qint64 requestBytes);
+    // The state survives a process restart this way. Import it before connectToServer()
+    // to resume the session. Empty if there is nothing to resume.
+    QByteArray exportSMState() const;
+    bool       importSMState(const QByteArray &state);
+
+    // Data held by the stream at the moment. Fixed per stream overhead is not included
+    struct MemoryUsage {
+        qint64 protocol = 0; // received but not parsed yet, and serialized but not given to the socket
+        qint64 socket   = 0; // given to the socket (or TLS) but not written yet
+        qint64 smQueue  = 0; // unacknowledged stanzas kept for resending
+        int    stanzas  = 0; // parsed stanzas not read() yet
+
+        qint64 total() const { return protocol + socket + smQueue; }
+    };
+    MemoryUsage memoryUsage() const;
 
     // barracuda extension
     QStringList hosts() const;
@@ -176,6 +256,7 @@ signals:
     void incomingXml(const QString &s);
     void outgoingXml(const QString &s);
     void stanzasAcked(int);
+    void fastTokenChanged();
 
 public slots:
     void continueAfterWarning();
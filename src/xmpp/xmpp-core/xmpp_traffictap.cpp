@@ -0,0 +1,94 @@
+/*
+ * xmpp_traffictap.cpp - subscriptions to the XML going through a stream
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp_traffictap.h"
+
+#include <algorithm>
+
+namespace XMPP {
+
+int TrafficTap::subscribe(Directions directions, const QStringList &namespaces, Callback callback)
+{
+    int id = nextId_++;
+    subscriptions_.push_back({ id, directions, namespaces, std::move(callback) });
+    return id;
+}
+
+void TrafficTap::unsubscribe(int id)
+{
+    subscriptions_.erase(std::remove_if(subscriptions_.begin(), subscriptions_.end(),
+                                        [id](const Subscription &s) { return s.id == id; }),
+                         subscriptions_.end());
+}
+
+bool TrafficTap::matches(const Subscription &s, const QDomElement &e)
+{
+    if (s.namespaces.isEmpty())
+        return true;
+    if (e.isNull())
+        return false;
+    if (s.namespaces.contains(e.namespaceURI()))
+        return true;
+    for (QDomElement c = e.firstChildElement(); !c.isNull(); c = c.nextSiblingElement()) {
+        if (s.namespaces.contains(c.namespaceURI()))
+            return true;
+    }
+    return false;
+}
+
+bool TrafficTap::wants(Direction direction, const QDomElement &e) const
+{
+    return std::any_of(subscriptions_.cbegin(), subscriptions_.cend(), [&](const Subscription &s) {
+        return bool(s.directions & direction) && matches(s, e);
+    });
+}
+
+bool TrafficTap::wants(Direction direction) const { return wants(direction, QDomElement()); }
+
+void TrafficTap::deliver(Direction direction, const QDomElement &e, const std::function<QString()> &toString)
+{
+    // copies, since a callback may unsubscribe
+    std::vector<Callback> targets;
+    for (const auto &s : subscriptions_) {
+        if (bool(s.directions & direction) && matches(s, e))
+            targets.push_back(s.callback);
+    }
+    if (!targets.empty())
+        call(direction, targets, toString());
+}
+
+void TrafficTap::deliver(Direction direction, const QString &text)
+{
+    std::vector<Callback> targets;
+    for (const auto &s : subscriptions_) {
+        if (bool(s.directions & direction) && s.namespaces.isEmpty())
+            targets.push_back(s.callback);
+    }
+    if (!targets.empty())
+        call(direction, targets, text);
+}
+
+void TrafficTap::call(Direction direction, const std::vector<Callback> &targets, const QString &text)
+{
+    countProduced(text);
+    for (const auto &callback : targets)
+        callback(direction, text);
+}
+
+} // namespace XMPP
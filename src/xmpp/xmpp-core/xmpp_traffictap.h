@@ -0,0 +1,84 @@
+/*
+ * xmpp_traffictap.h - subscriptions to the XML going through a stream
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef XMPP_TRAFFICTAP_H
+#define XMPP_TRAFFICTAP_H
+
+#include <QDomElement>
+#include <QFlags>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <vector>
+
+namespace XMPP {
+
+// Subscriptions to the XML traffic of a client, for XML consoles and traffic logs.
+//
+// Turning elements into text is about as expensive as parsing them, so it's done
+// only when there is a subscriber for the element, and once for all of them.
+class TrafficTap {
+public:
+    enum Direction { Incoming = 0x01, Outgoing = 0x02 };
+    Q_DECLARE_FLAGS(Directions, Direction)
+
+    using Callback = std::function<void(Direction direction, const QString &xml)>;
+
+    // 'namespaces' limits the subscription to elements of one of these namespaces or
+    // having a direct child of one (e.g. "urn:xmpp:jingle:1" gets iqs with jingle in
+    // them). Text sent outside of elements, like the stream header, is delivered only
+    // to subscriptions without namespaces. Returns the id for unsubscribe().
+    int  subscribe(Directions directions, const QStringList &namespaces, Callback callback);
+    void unsubscribe(int id);
+
+    inline bool isEmpty() const { return subscriptions_.empty(); }
+    bool        wants(Direction direction, const QDomElement &e) const;
+    bool        wants(Direction direction) const; // raw text
+
+    // 'toString' is called only if somebody wants the element
+    void deliver(Direction direction, const QDomElement &e, const std::function<QString()> &toString);
+    void deliver(Direction direction, const QString &text);
+
+    // for text made for other consumers, like the old signals, to show up in producedBytes()
+    inline void countProduced(const QString &text) { producedBytes_ += quint64(text.size()) * sizeof(QChar); }
+    // size of all the debug text produced so far
+    inline quint64 producedBytes() const { return producedBytes_; }
+
+private:
+    struct Subscription {
+        int         id;
+        Directions  directions;
+        QStringList namespaces;
+        Callback    callback;
+    };
+
+    static bool matches(const Subscription &s, const QDomElement &e);
+    void        call(Direction direction, const std::vector<Callback> &targets, const QString &text);
+
+    std::vector<Subscription> subscriptions_;
+    int                       nextId_        = 1;
+    quint64                   producedBytes_ = 0;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(TrafficTap::Directions)
+
+} // namespace XMPP
+
+#endif // XMPP_TRAFFICTAP_H
@@ -89,12 +89,17 @@
 #include "xmpp_tasks.h"
 #include "xmpp_xmlcommon.h"
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QList>
 #include <QMap>
+#include <QMetaMethod>
 #include <QObject>
 #include <QPointer>
 #include <QTimer>
 
+#include <algorithm>
+
 #ifdef Q_OS_WIN
 #define vsnprintf _vsnprintf
 #endif
@@ -152,10 +157,18 @@ public:
     StunDiscoManager         *stunDiscoManager         = nullptr;
     HttpFileUploadManager    *httpFileUploadManager    = nullptr;
     Jingle::Manager          *jingleManager            = nullptr;
-    QList<GroupChat>          groupChatList;
+    QHash<QString, GroupChat> groupChats; // bare room jid => state
     EncryptionManager        *encryptionManager         = nullptr;
     const EncryptionMetadata *currentEncryptionMetadata = nullptr;
     JT_PushMessage           *pushMessage               = nullptr;
+
+    TrafficTap tap;
+    int        xmlSignalsTapId = 0; // subscription feeding xmlIncoming/xmlOutgoing
+
+    int             batchWindow = -1; // see setChangeBatching()
+    QTimer         *batchTimer  = nullptr;
+    QElapsedTimer   batchAge;
+    RosterChangeSet batch;
 };
 
 Client::Client(QObject *par) : QObject(par)
@@ -226,9 +239,8 @@ void Client::connectToServer(ClientStream *s, const Jid &j, bool auth)
     // connect(d->stream, SIGNAL(sslCertificateReady(QSSLCert)), SLOT(streamSSLCertificateReady(QSSLCert)));
     connect(d->stream, SIGNAL(readyRead()), SLOT(streamReadyRead()));
     // connect(d->stream, SIGNAL(closeFinished()), SLOT(streamCloseFinished()));
-    connect(d->stream, SIGNAL(incomingXml(QString)), SLOT(streamIncomingXml(QString)));
-    connect(d->stream, SIGNAL(outgoingXml(QString)), SLOT(streamOutgoingXml(QString)));
     connect(d->stream, SIGNAL(haveUnhandledFeatures()), SLOT(parseUnhandledStreamFeatures()));
+    d->stream->setTrafficTap(&d->tap);
 
     d->stream->connectToServer(j, auth);
 }
@@ -327,49 +339,38 @@ JT_PushMessage *Client::pushMessage() const { return d->pushMessage; }
 
 QString Client::groupChatPassword(const QString &host, const QString &room) const
 {
-    Jid jid(room + "@" + host);
-    for (const GroupChat &i : std::as_const(d->groupChatList)) {
-        if (i.j.compare(jid, false)) {
-            return i.password;
-        }
-    }
-    return QString();
+    Jid  jid(room + "@" + host);
+    auto it = d->groupChats.constFind(jid.bare());
+    return it == d->groupChats.constEnd() ? QString() : it->password;
 }
 
 void Client::groupChatChangeNick(const QString &host, const QString &room, const QString &nick, const Status &_s)
 {
-    Jid jid(room + "@" + host + "/" + nick);
-    for (QList<GroupChat>::Iterator it = d->groupChatList.begin(); it != d->groupChatList.end(); it++) {
-        GroupChat &i = *it;
-        if (i.j.compare(jid, false)) {
-            i.j = jid;
-
-            Status s = _s;
-            s.setIsAvailable(true);
+    Jid  jid(room + "@" + host + "/" + nick);
+    auto it = d->groupChats.find(jid.bare());
+    if (it == d->groupChats.end())
+        return;
+    it->j = jid;
 
-            JT_Presence *j = new JT_Presence(rootTask());
-            j->pres(jid, s);
-            j->go(true);
+    Status s = _s;
+    s.setIsAvailable(true);
 
-            break;
-        }
-    }
+    JT_Presence *j = new JT_Presence(rootTask());
+    j->pres(jid, s);
+    j->go(true);
 }
 
 bool Client::groupChatJoin(const QString &host, const QString &room, const QString &nick, const QString &password,
                            int maxchars, int maxstanzas, int seconds, const QDateTime &since, const Status &_s)
 {
-    Jid jid(room + "@" + host + "/" + nick);
-    for (QList<GroupChat>::Iterator it = d->groupChatList.begin(); it != d->groupChatList.end();) {
-        GroupChat &i = *it;
-        if (i.j.compare(jid, false)) {
-            // if this room is shutting down, then free it up
-            if (i.status == GroupChat::Closing)
-                it = d->groupChatList.erase(it);
-            else
-                return false;
-        } else
-            ++it;
+    Jid  jid(room + "@" + host + "/" + nick);
+    auto it = d->groupChats.find(jid.bare());
+    if (it != d->groupChats.end()) {
+        // if this room is shutting down, then free it up
+        if (it->status == GroupChat::Closing)
+            d->groupChats.erase(it);
+        else
+            return false;
     }
 
     debug(QString("Client: Joined: [%1]\n").arg(jid.full()));
@@ -377,7 +378,7 @@ bool Client::groupChatJoin(const QString &host, const QString &room, const QStri
     i.j        = jid;
     i.status   = GroupChat::Connecting;
     i.password = password;
-    d->groupChatList += i;
+    d->groupChats.insert(jid.bare(), i);
 
     JT_Presence *j = new JT_Presence(rootTask());
     Status       s = _s;
@@ -395,16 +396,10 @@ bool Client::groupChatJoin(const QString &host, const QString &room, const QStri
 void Client::groupChatSetStatus(const QString &host, const QString &room, const Status &_s)
 {
     Jid  jid(room + "@" + host);
-    bool found = false;
-    for (const GroupChat &i : std::as_const(d->groupChatList)) {
-        if (i.j.compare(jid, false)) {
-            found = true;
-            jid   = i.j;
-            break;
-        }
-    }
-    if (!found)
+    auto it = d->groupChats.constFind(jid.bare());
+    if (it == d->groupChats.constEnd())
         return;
+    jid = it->j;
 
     Status s = _s;
     s.setIsAvailable(true);
@@ -416,29 +411,27 @@ void Client::groupChatSetStatus(const QString &host, const QString &room, const
 
 void Client::groupChatLeave(const QString &host, const QString &room, const QString &statusStr)
 {
-    Jid jid(room + "@" + host);
-    for (QList<GroupChat>::Iterator it = d->groupChatList.begin(); it != d->groupChatList.end(); it++) {
-        GroupChat &i = *it;
-
-        if (!i.j.compare(jid, false))
-            continue;
+    Jid  jid(room + "@" + host);
+    auto it = d->groupChats.find(jid.bare());
+    if (it == d->groupChats.end())
+        return;
 
-        i.status = GroupChat::Closing;
-        debug(QString("Client: Leaving: [%1]\n").arg(i.j.full()));
+    GroupChat &i = *it;
+    i.status     = GroupChat::Closing;
+    debug(QString("Client: Leaving: [%1]\n").arg(i.j.full()));
 
-        JT_Presence *j = new JT_Presence(rootTask());
-        Status       s;
-        s.setIsAvailable(false);
-        s.setStatus(statusStr);
-        j->pres(i.j, s);
-        j->go(true);
-    }
+    JT_Presence *j = new JT_Presence(rootTask());
+    Status       s;
+    s.setIsAvailable(false);
+    s.setStatus(statusStr);
+    j->pres(i.j, s);
+    j->go(true);
 }
 
 void Client::groupChatLeaveAll(const QString &statusStr)
 {
     if (d->stream && d->active) {
-        for (QList<GroupChat>::Iterator it = d->groupChatList.begin(); it != d->groupChatList.end(); it++) {
+        for (auto it = d->groupChats.begin(); it != d->groupChats.end(); ++it) {
             GroupChat &i = *it;
             i.status     = GroupChat::Closing;
 
@@ -454,13 +447,9 @@ void Client::groupChatLeaveAll(const QString &statusStr)
 
 QString Client::groupChatNick(const QString &host, const QString &room) const
 {
-    Jid jid(room + "@" + host);
-    for (const GroupChat &gc : std::as_const(d->groupChatList)) {
-        if (gc.j.compare(jid, false)) {
-            return gc.j.resource();
-        }
-    }
-    return QString();
+    Jid  jid(room + "@" + host);
+    auto it = d->groupChats.constFind(jid.bare());
+    return it == d->groupChats.constEnd() ? QString() : it->j.resource();
 }
 
 /*void Client::start()
@@ -481,8 +470,10 @@ void Client::close(bool)
     // fprintf(stderr, "\tClient::close\n");
     // fflush(stderr);
 
+    flushChanges();
     if (d->stream) {
         d->stream->disconnect(this);
+        d->stream->setTrafficTap(nullptr);
         d->stream->close();
         d->stream = nullptr;
     }
@@ -494,7 +485,7 @@ void Client::cleanup()
 {
     d->active = false;
     // d->authed = false;
-    d->groupChatList.clear();
+    d->groupChats.clear();
 }
 
 /*void Client::continueAfterCert()
@@ -518,6 +509,7 @@ void Client::streamError(int)
     // error(e);
 
     // if(!e.isWarning()) {
+    flushChanges();
     emit disconnected();
     cleanup();
     //}
@@ -541,29 +533,68 @@ void Client::streamReadyRead()
     while (d->stream && d->stream->stanzaAvailable()) {
         Stanza s = d->stream->read();
 
-        QString out = s.toString();
-        debug(QString("Client: incoming: [\n%1]\n").arg(out));
-        emit xmlIncoming(out);
-
         QDomElement x = s.element();
+        traceStanza(TrafficTap::Incoming, s, x);
         distribute(x);
     }
 }
 
-void Client::streamIncomingXml(const QString &s)
+// stanza text is made only if the xml console or the debug log is looked at
+void Client::traceStanza(TrafficTap::Direction direction, const Stanza &s, const QDomElement &e)
+{
+    const bool debugging = isSignalConnected(QMetaMethod::fromSignal(&Client::debugText));
+    if (!debugging && !d->tap.wants(direction, e))
+        return;
+
+    QString out;
+    d->tap.deliver(direction, e, [&]() { return out = s.toString(); });
+    if (debugging) {
+        if (out.isNull())
+            out = s.toString();
+        QString line = QString(direction == TrafficTap::Incoming ? "Client: incoming: [\n%1]\n"
+                                                                 : "Client: outgoing: [\n%1]\n")
+                           .arg(out);
+        d->tap.countProduced(line);
+        debug(line);
+    }
+}
+
+void Client::connectNotify(const QMetaMethod &signal)
+{
+    if (signal == QMetaMethod::fromSignal(&Client::xmlIncoming)
+        || signal == QMetaMethod::fromSignal(&Client::xmlOutgoing))
+        updateXmlSignalsTap();
+}
+
+void Client::disconnectNotify(const QMetaMethod &signal)
 {
-    QString str = s;
-    if (str.at(str.length() - 1) != '\n')
-        str += '\n';
-    emit xmlIncoming(str);
+    // invalid on disconnect() of everything
+    if (!signal.isValid() || signal == QMetaMethod::fromSignal(&Client::xmlIncoming)
+        || signal == QMetaMethod::fromSignal(&Client::xmlOutgoing))
+        updateXmlSignalsTap();
 }
 
-void Client::streamOutgoingXml(const QString &s)
+void Client::updateXmlSignalsTap()
 {
-    QString str = s;
-    if (str.at(str.length() - 1) != '\n')
-        str += '\n';
-    emit xmlOutgoing(str);
+    const bool wanted = isSignalConnected(QMetaMethod::fromSignal(&Client::xmlIncoming))
+        || isSignalConnected(QMetaMethod::fromSignal(&Client::xmlOutgoing));
+    if (wanted == bool(d->xmlSignalsTapId))
+        return;
+    if (!wanted) {
+        d->tap.unsubscribe(d->xmlSignalsTapId);
+        d->xmlSignalsTapId = 0;
+        return;
+    }
+    auto emitXml = [this](TrafficTap::Direction direction, const QString &xml) {
+        QString str = xml;
+        if (!str.endsWith('\n'))
+            str += '\n';
+        if (direction == TrafficTap::Incoming)
+            emit xmlIncoming(str);
+        else
+            emit xmlOutgoing(str);
+    };
+    d->xmlSignalsTapId = d->tap.subscribe(TrafficTap::Incoming | TrafficTap::Outgoing, {}, emitXml);
 }
 
 void Client::parseUnhandledStreamFeatures()
@@ -581,6 +612,8 @@ void Client::parseUnhandledStreamFeatures()
 
 void Client::debug(const QString &str) { emit debugText(str); }
 
+TrafficTap &Client::trafficTap() { return d->tap; }
+
 QString Client::genUniqueId()
 {
 #if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
@@ -764,10 +797,7 @@ void Client::send(const QDomElement &x)
     if (e.isNull()) {              // so it was changed by signal above
         return;
     }
-    QString out = s.toString();
-    // qWarning() << "Out: " << out;
-    debug(QString("Client: outgoing: [\n%1]\n").arg(out));
-    emit xmlOutgoing(out);
+    traceStanza(TrafficTap::Outgoing, s, e);
 
     // printf("x[%s] x2[%s] s[%s]\n", Stream::xmlToString(x).toLatin1(), Stream::xmlToString(e).toLatin1(),
     // s.toString().toLatin1());
@@ -779,8 +809,12 @@ void Client::send(const QString &str)
     if (!d->stream)
         return;
 
-    debug(QString("Client: outgoing: [\n%1]\n").arg(str));
-    emit xmlOutgoing(str);
+    if (isSignalConnected(QMetaMethod::fromSignal(&Client::debugText))) {
+        QString line = QString("Client: outgoing: [\n%1]\n").arg(str);
+        d->tap.countProduced(line);
+        debug(line);
+    }
+    d->tap.deliver(TrafficTap::Outgoing, str);
     static_cast<ClientStream *>(d->stream)->writeDirect(str);
 }
 
@@ -883,44 +917,42 @@ void Client::ppPresence(const Jid &j, const Status &s)
     else
         debug(QString("Client: %1 is unavailable.\n").arg(j.full()));
 
-    for (QList<GroupChat>::Iterator it = d->groupChatList.begin(); it != d->groupChatList.end(); it++) {
-        GroupChat &i = *it;
-
-        if (i.j.compare(j, false)) {
-            bool us = i.j.resource() == j.resource() || j.resource().isEmpty();
-
-            debug(QString("for groupchat i=[%1] pres=[%2], [us=%3].\n").arg(i.j.full(), j.full()).arg(us));
-            switch (i.status) {
-            case GroupChat::Connecting:
-                if (us && s.hasError()) {
-                    Jid j = i.j;
-                    d->groupChatList.erase(it);
-                    emit groupChatError(j, s.errorCode(), s.errorString());
-                } else {
-                    // don't signal success unless it is a non-error presence
-                    if (!s.hasError()) {
-                        i.status = GroupChat::Connected;
-                        emit groupChatJoined(i.j);
-                    }
-                    emit groupChatPresence(j, s);
+    auto it = d->groupChats.find(j.bare());
+    if (it != d->groupChats.end() && it->j.compare(j, false)) {
+        GroupChat &i  = *it;
+        bool       us = i.j.resource() == j.resource() || j.resource().isEmpty();
+
+        debug(QString("for groupchat i=[%1] pres=[%2], [us=%3].\n").arg(i.j.full(), j.full()).arg(us));
+        switch (i.status) {
+        case GroupChat::Connecting:
+            if (us && s.hasError()) {
+                Jid j = i.j;
+                d->groupChats.erase(it);
+                emit groupChatError(j, s.errorCode(), s.errorString());
+            } else {
+                // don't signal success unless it is a non-error presence
+                if (!s.hasError()) {
+                    i.status = GroupChat::Connected;
+                    emit groupChatJoined(i.j);
                 }
-                break;
-            case GroupChat::Connected:
                 emit groupChatPresence(j, s);
-                break;
-            case GroupChat::Closing:
-                if (us && !s.isAvailable()) {
-                    Jid j = i.j;
-                    d->groupChatList.erase(it);
-                    emit groupChatLeft(j);
-                }
-                break;
-            default:
-                break;
             }
-
-            return;
+            break;
+        case GroupChat::Connected:
+            emit groupChatPresence(j, s);
+            break;
+        case GroupChat::Closing:
+            if (us && !s.isAvailable()) {
+                Jid j = i.j;
+                d->groupChats.erase(it);
+                emit groupChatLeft(j);
+            }
+            break;
+        default:
+            break;
         }
+
+        return;
     }
 
     if (s.hasError()) {
@@ -933,11 +965,9 @@ void Client::ppPresence(const Jid &j, const Status &s)
         updateSelfPresence(j, s);
     } else {
         // update all relavent roster entries
-        for (LiveRoster::Iterator it = d->roster.begin(); it != d->roster.end(); ++it) {
-            LiveRosterItem &i = *it;
-
-            if (!i.jid().compare(j, false))
-                continue;
+        const auto positions = d->roster.findAll(j, false);
+        for (qsizetype pos : positions) {
+            LiveRosterItem &i = d->roster[pos];
 
             // roster item has its own resource?
             if (!i.jid().resource().isEmpty()) {
@@ -960,7 +990,7 @@ void Client::updateSelfPresence(const Jid &j, const Status &s)
         if (found) {
             debug(QString("Client: Removing self resource: name=[%1]\n").arg(j.resource()));
             (*rit).setStatus(s);
-            emit resourceUnavailable(j, *rit);
+            notifyResource(false, j, *rit);
             d->resourceList.erase(rit);
         }
     }
@@ -977,7 +1007,7 @@ void Client::updateSelfPresence(const Jid &j, const Status &s)
             debug(QString("Client: Updating self resource: name=[%1]\n").arg(j.resource()));
         }
 
-        emit resourceAvailable(j, r);
+        notifyResource(true, j, r);
     }
 }
 
@@ -991,7 +1021,7 @@ void Client::updatePresence(LiveRosterItem *i, const Jid &j, const Status &s)
         if (found) {
             (*rit).setStatus(s);
             debug(QString("Client: Removing resource from [%1]: name=[%2]\n").arg(i->jid().full(), j.resource()));
-            emit resourceUnavailable(j, *rit);
+            notifyResource(false, j, *rit);
             i->resourceList().erase(rit);
             i->setLastUnavailableStatus(s);
         } else {
@@ -999,7 +1029,7 @@ void Client::updatePresence(LiveRosterItem *i, const Jid &j, const Status &s)
             Resource r = Resource(j.resource(), s);
             i->resourceList() += r;
             rit = i->resourceList().find(j.resource());
-            emit resourceUnavailable(j, *rit);
+            notifyResource(false, j, *rit);
             i->resourceList().erase(rit);
             i->setLastUnavailableStatus(s);
         }
@@ -1017,8 +1047,70 @@ void Client::updatePresence(LiveRosterItem *i, const Jid &j, const Status &s)
             debug(QString("Client: Updating resource to [%1]: name=[%2]\n").arg(i->jid().full(), j.resource()));
         }
 
-        emit resourceAvailable(j, r);
+        notifyResource(true, j, r);
+    }
+}
+
+void Client::notifyRosterItem(RosterChangeSet::Change::Type type, const RosterItem &item)
+{
+    if (d->batchWindow < 0) {
+        if (type == RosterChangeSet::Change::ItemAdded)
+            emit rosterItemAdded(item);
+        else if (type == RosterChangeSet::Change::ItemRemoved)
+            emit rosterItemRemoved(item);
+        else
+            emit rosterItemUpdated(item);
+        return;
+    }
+    if (d->batch.eventCount() == 0) {
+        d->batchAge.start();
+        d->batchTimer->start(d->batchWindow);
     }
+    d->batch.addItem(type, item);
+}
+
+void Client::notifyResource(bool available, const Jid &j, const Resource &r)
+{
+    if (d->batchWindow < 0) {
+        if (available)
+            emit resourceAvailable(j, r);
+        else
+            emit resourceUnavailable(j, r);
+        return;
+    }
+    if (d->batch.eventCount() == 0) {
+        d->batchAge.start();
+        d->batchTimer->start(d->batchWindow);
+    }
+    d->batch.addResource(available, j, r);
+}
+
+void Client::setChangeBatching(int windowMsecs)
+{
+    if (windowMsecs < 0) {
+        flushChanges();
+    } else if (!d->batchTimer) {
+        d->batchTimer = new QTimer(this);
+        d->batchTimer->setSingleShot(true);
+        connect(d->batchTimer, &QTimer::timeout, this, &Client::flushChanges);
+    }
+    d->batchWindow = windowMsecs;
+}
+
+int Client::changeBatching() const { return d->batchWindow; }
+
+void Client::flushChanges()
+{
+    if (d->batchTimer)
+        d->batchTimer->stop();
+    if (d->batch.eventCount() == 0)
+        return;
+
+    RosterChangeSet batch = std::move(d->batch);
+    d->batch.clear();
+    batch.setLatency(d->batchAge.elapsed());
+    if (!batch.isEmpty())
+        emit rosterChanges(batch);
 }
 
 void Client::pmMessage(const Message &m)
@@ -1036,15 +1128,9 @@ void Client::pmMessage(const Message &m)
     }
 
     if (m.type() == Message::Type::Groupchat) {
-        for (QList<GroupChat>::Iterator it = d->groupChatList.begin(); it != d->groupChatList.end(); it++) {
-            const GroupChat &i = *it;
-
-            if (!i.j.compare(m.from(), false))
-                continue;
-
-            if (i.status == GroupChat::Connected)
-                emit messageReceived(m);
-        }
+        auto it = d->groupChats.constFind(m.from().bare());
+        if (it != d->groupChats.constEnd() && it->j.compare(m.from(), false) && it->status == GroupChat::Connected)
+            emit messageReceived(m);
     } else
         emit messageReceived(m);
 }
@@ -1095,7 +1181,7 @@ void Client::slotRosterRequestFinished()
         for (LiveRoster::Iterator it = d->roster.begin(); it != d->roster.end();) {
             LiveRosterItem &i = *it;
             if (i.flagForDelete()) {
-                emit rosterItemRemoved(i);
+                notifyRosterItem(RosterChangeSet::Change::ItemRemoved, i);
                 it = d->roster.erase(it);
             } else
                 ++it;
@@ -1107,6 +1193,7 @@ void Client::slotRosterRequestFinished()
     }
 
     // report success / fail
+    flushChanges();
     emit rosterRequestFinished(r->success(), r->statusCode(), r->statusString());
 }
 
@@ -1150,7 +1237,7 @@ void Client::importRosterItem(const RosterItem &item)
     if (item.subscription().type() == Subscription::Remove) {
         LiveRoster::Iterator it = d->roster.find(item.jid());
         if (it != d->roster.end()) {
-            emit rosterItemRemoved(*it);
+            notifyRosterItem(RosterChangeSet::Change::ItemRemoved, *it);
             d->roster.erase(it);
         }
         dstr = "Client: (Removed) ";
@@ -1162,14 +1249,14 @@ void Client::importRosterItem(const RosterItem &item)
             LiveRosterItem &i = *it;
             i.setFlagForDelete(false);
             i.setRosterItem(item);
-            emit rosterItemUpdated(i);
+            notifyRosterItem(RosterChangeSet::Change::ItemUpdated, i);
             dstr = "Client: (Updated) ";
         } else {
             LiveRosterItem i(item);
             d->roster += i;
 
             // signal it
-            emit rosterItemAdded(i);
+            notifyRosterItem(RosterChangeSet::Change::ItemAdded, i);
             dstr = "Client: (Added)   ";
         }
     }
@@ -1495,12 +1582,18 @@ void LiveRosterItem::setFlagForDelete(bool b) { v_flagForDelete = b; }
 class LiveRoster::Private {
 public:
     QString groupsDelimiter;
+
+    // bare jid => positions. Several items may share a bare jid if some have a resource
+    QMultiHash<QString, qsizetype> index;
+    qsizetype                      indexedSize = -1; // size() the index was valid for, or -1
 };
 
 LiveRoster::LiveRoster() : QList<LiveRosterItem>(), d(new LiveRoster::Private) { }
 LiveRoster::LiveRoster(const LiveRoster &other) : QList<LiveRosterItem>(other), d(new LiveRoster::Private)
 {
     d->groupsDelimiter = other.d->groupsDelimiter;
+    d->index           = other.d->index;
+    d->indexedSize     = other.d->indexedSize;
 }
 
 LiveRoster::~LiveRoster() { delete d; }
@@ -1509,6 +1602,8 @@ LiveRoster &LiveRoster::operator=(const LiveRoster &other)
 {
     QList<LiveRosterItem>::operator=(other);
     d->groupsDelimiter = other.d->groupsDelimiter;
+    d->index           = other.d->index;
+    d->indexedSize     = other.d->indexedSize;
     return *this;
 }
 void LiveRoster::flagAllForDelete()
@@ -1517,24 +1612,100 @@ void LiveRoster::flagAllForDelete()
         (*it).setFlagForDelete(true);
 }
 
-LiveRoster::Iterator LiveRoster::find(const Jid &j, bool compareRes)
+void LiveRoster::rebuildIndex() const
+{
+    d->index.clear();
+    d->index.reserve(size());
+    for (qsizetype i = 0; i < size(); ++i)
+        d->index.insert(at(i).jid().bare(), i);
+    d->indexedSize = size();
+}
+
+QList<qsizetype> LiveRoster::findAll(const Jid &j, bool compareRes) const
 {
-    Iterator it;
-    for (it = begin(); it != end(); ++it) {
-        if ((*it).jid().compare(j, compareRes))
+    QList<qsizetype> ret;
+    const QString    bare = j.bare();
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (d->indexedSize != size())
+            rebuildIndex();
+
+        bool stale = false;
+        ret.clear();
+        auto range = d->index.equal_range(bare);
+        for (auto it = range.first; it != range.second; ++it) {
+            const qsizetype pos = it.value();
+            // the list could have been changed behind our back with a QList method
+            if (pos >= size() || at(pos).jid().bare() != bare) {
+                stale = true;
+                break;
+            }
+            if (at(pos).jid().compare(j, compareRes))
+                ret.append(pos);
+        }
+        if (!stale)
             break;
+        d->indexedSize = -1;
     }
-    return it;
+    if (ret.isEmpty()) {
+        // an item replaced in place through the QList base isn't in the index under its new jid
+        for (qsizetype i = 0; i < size(); ++i) {
+            if (at(i).jid().compare(j, compareRes))
+                ret.append(i);
+        }
+        if (!ret.isEmpty())
+            d->indexedSize = -1;
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+LiveRoster::Iterator LiveRoster::find(const Jid &j, bool compareRes)
+{
+    const auto found = findAll(j, compareRes);
+    return found.isEmpty() ? end() : begin() + found.first();
 }
 
 LiveRoster::ConstIterator LiveRoster::find(const Jid &j, bool compareRes) const
 {
-    ConstIterator it;
-    for (it = begin(); it != end(); ++it) {
-        if ((*it).jid().compare(j, compareRes))
-            break;
+    const auto found = findAll(j, compareRes);
+    return found.isEmpty() ? end() : begin() + found.first();
+}
+
+void LiveRoster::append(const LiveRosterItem &item)
+{
+    QList<LiveRosterItem>::append(item);
+    if (d->indexedSize == size() - 1) {
+        d->index.insert(item.jid().bare(), size() - 1);
+        d->indexedSize = size();
     }
-    return it;
+}
+
+LiveRoster &LiveRoster::operator+=(const LiveRosterItem &item)
+{
+    append(item);
+    return *this;
+}
+
+LiveRoster::Iterator LiveRoster::erase(LiveRoster::Iterator it)
+{
+    // positions after the removed item shift. dropping the last one is cheap though
+    if (ConstIterator(it) + 1 == constEnd() && d->indexedSize == size()) {
+        const qsizetype pos = size() - 1;
+        d->index.remove(it->jid().bare(), pos);
+        d->indexedSize = pos;
+    } else {
+        d->indexedSize = -1;
+    }
+    return QList<LiveRosterItem>::erase(it);
+}
+
+void LiveRoster::removeAt(qsizetype i) { erase(begin() + i); }
+
+void LiveRoster::clear()
+{
+    QList<LiveRosterItem>::clear();
+    d->index.clear();
+    d->indexedSize = 0;
 }
 
 void LiveRoster::setGroupsDelimiter(const QString &groupsDelimiter) { d->groupsDelimiter = groupsDelimiter; }
@@ -49,6 +49,7 @@
 #include <iris/xmpp-im/xmpp_resource.h>
 #include <iris/xmpp-im/xmpp_resourcelist.h>
 #include <iris/xmpp-im/xmpp_roster.h>
+#include <iris/xmpp-im/xmpp_rosterchanges.h>
 #include <iris/xmpp-im/xmpp_rosteritem.h>
 #include <iris/xmpp-im/xmpp_rosterx.h>
 #include <iris/xmpp-im/xmpp_status.h>
@@ -0,0 +1,174 @@
+/*
+ * jingle-ft-sender_p.cpp - windowed sending of Jingle file transfer data
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "jingle-ft-sender_p.h"
+
+#include "jingle-file.h"
+
+#include <QIODevice>
+#include <QTimer>
+
+namespace XMPP { namespace Jingle { namespace FileTransfer {
+
+    BlockSender::BlockSender(QIODevice *source, Connection::Ptr connection, std::optional<quint64> size,
+                             QObject *parent) :
+        QObject(parent), source_(source), connection_(connection), bytesLeft_(size)
+    {
+        // queued, so we never write from inside the transport's own write path
+        connect(
+            connection_.data(), &Connection::bytesWritten, this,
+            [this](qint64 bytes) {
+                inFlight_ = qMax(inFlight_ - bytes, qint64(0));
+                fill();
+            },
+            Qt::QueuedConnection);
+        if (source_->isSequential())
+            connect(source_, &QIODevice::readyRead, this, &BlockSender::fill);
+    }
+
+    void BlockSender::setHasher(FileHasher *hasher) { hasher_ = hasher; }
+
+    void BlockSender::setWindow(int blocks, qint64 bytes)
+    {
+        windowBlocks_ = qMax(blocks, 1);
+        windowBytes_  = bytes;
+    }
+
+    void BlockSender::start() { fill(); }
+
+    qint64 BlockSender::blockSize() const
+    {
+        auto sz = connection_->blockSize();
+        return sz ? qint64(sz) : 8192;
+    }
+
+    qint64 BlockSender::windowSize() const
+    {
+        qint64 window = blockSize() * windowBlocks_;
+        if (windowBytes_ > 0)
+            window = qMin(window, windowBytes_);
+        return qMax(window, qint64(1));
+    }
+
+    void BlockSender::fill()
+    {
+        if (done_)
+            return;
+
+        const qint64 window  = windowSize();
+        const bool   message = bool(connection_->features() & TransportFeature::MessageOriented);
+        // some transports (ICE/SCTP) always report 0 in bytesToWrite(), so we count what we wrote
+        // and was not yet confirmed by bytesWritten ourselves
+        for (int blocks = 0; blocks < windowBlocks_ && qMax(inFlight_, connection_->bytesToWrite()) < window;
+             ++blocks) {
+            if (queue_.isEmpty() && !readAhead(window))
+                return;
+            if (queue_.isEmpty())
+                break;
+
+            QByteArray block = queue_.takeFirst();
+            queued_ -= block.size();
+            if (message ? !connection_->writeDatagram(block) : connection_->write(block) == -1) {
+                fail(QString());
+                return;
+            }
+            inFlight_ += block.size();
+            sent_ += quint64(block.size());
+            emit progress(sent_);
+        }
+
+        if (queue_.isEmpty() && sourceDone_) {
+            done_ = true;
+            emit finished();
+            return;
+        }
+        scheduleReadAhead(window);
+    }
+
+    // reads blocks from the source until 'limit' bytes are queued.
+    // returns false if the transfer failed
+    bool BlockSender::readAhead(qint64 limit)
+    {
+        const qint64 bs = blockSize();
+        while (!sourceDone_ && queued_ < limit) {
+            quint64 sz = quint64(bs);
+            if (bytesLeft_) {
+                if (*bytesLeft_ == 0) {
+                    sourceDone_ = true;
+                    break;
+                }
+                sz = qMin(sz, *bytesLeft_);
+            }
+            if (source_->isSequential()) {
+                sz = qMin(sz, quint64(source_->bytesAvailable()));
+                if (!sz)
+                    break; // we will come back on readyRead
+            }
+
+            QByteArray block(int(sz), Qt::Uninitialized);
+            auto       readSz = source_->read(block.data(), qint64(sz));
+            if (readSz < 0) {
+                fail(QString::fromLatin1("source device failed"));
+                return false;
+            }
+            if (readSz == 0) {
+                if (bytesLeft_) { // shorter than promised
+                    fail(QString());
+                    return false;
+                }
+                sourceDone_ = true;
+                break;
+            }
+            block.resize(int(readSz));
+            if (hasher_)
+                hasher_->addData(block);
+            if (bytesLeft_)
+                *bytesLeft_ -= quint64(readSz);
+            queued_ += readSz;
+            queue_.append(block);
+        }
+        return true;
+    }
+
+    void BlockSender::scheduleReadAhead(qint64 limit)
+    {
+        if (readAheadPending_ || sourceDone_ || queued_ >= limit)
+            return;
+        if (source_->isSequential() && !source_->bytesAvailable())
+            return; // readyRead will bring us back
+
+        readAheadPending_ = true;
+        QTimer::singleShot(0, this, [this]() {
+            readAheadPending_ = false;
+            if (!done_ && readAhead(windowSize()))
+                fill();
+        });
+    }
+
+    void BlockSender::fail(const QString &reason)
+    {
+        done_ = true;
+        queue_.clear();
+        queued_ = 0;
+        emit failed(reason);
+    }
+
+} // namespace FileTransfer
+} // namespace Jingle
+} // namespace XMPP
@@ -0,0 +1,88 @@
+/*
+ * jingle-ft-sender_p.h - windowed sending of Jingle file transfer data
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "jingle-connection.h"
+
+#include <QList>
+
+#include <optional>
+
+class QIODevice;
+
+namespace XMPP { namespace Jingle { namespace FileTransfer {
+
+    class FileHasher;
+
+    // Pumps a source device into a connection.
+    //
+    // Up to a window of data is kept in flight (written, but bytesWritten not seen yet), so the
+    // transport has the next block at hand as soon as the previous one leaves its buffer. The next
+    // window is read from the source on a later event loop turn, while the transport is busy with
+    // the current one.
+    // The source is only touched from the thread it lives in since QIODevice isn't thread-safe.
+    class BlockSender : public QObject {
+        Q_OBJECT
+    public:
+        // 'size' is how much to read from the source. without it the source is read till the end
+        BlockSender(QIODevice *source, Connection::Ptr connection, std::optional<quint64> size,
+                    QObject *parent = nullptr);
+
+        // the hasher gets everything read from the source
+        void setHasher(FileHasher *hasher);
+
+        // no more than 'blocks' transport blocks and, if positive, 'bytes' in flight
+        void setWindow(int blocks, qint64 bytes);
+        void start();
+        void stop() { done_ = true; } // nothing is read, written or signalled after this
+
+        quint64 bytesSent() const { return sent_; }
+
+    signals:
+        void progress(quint64 bytesSent);
+        void finished(); // everything was read and handed over to the connection
+        void failed(const QString &reason);
+
+    private:
+        qint64 blockSize() const;
+        qint64 windowSize() const;
+        void   fill();
+        bool   readAhead(qint64 limit);
+        void   scheduleReadAhead(qint64 limit);
+        void   fail(const QString &reason);
+
+        QIODevice             *source_;
+        Connection::Ptr        connection_;
+        FileHasher            *hasher_ = nullptr;
+        std::optional<quint64> bytesLeft_; // not yet read from the source
+        QList<QByteArray>      queue_;     // read ahead, not yet written
+        qint64                 queued_           = 0;
+        qint64                 inFlight_         = 0; // written, bytesWritten not seen yet
+        quint64                sent_             = 0;
+        int                    windowBlocks_     = 16;
+        qint64                 windowBytes_      = 512 * 1024;
+        bool                   sourceDone_       = false;
+        bool                   readAheadPending_ = false;
+        bool                   done_             = false;
+    };
+
+} // namespace FileTransfer
+} // namespace Jingle
+} // namespace XMPP
@@ -18,6 +18,7 @@
  */
 
 #include "jingle-ft.h"
+#include "jingle-ft-sender_p.h"
 #include "jingle-nstransportslist.h"
 #include "jingle-session.h"
 
@@ -166,11 +167,18 @@ namespace XMPP { namespace Jingle { namespace FileTransfer {
         QList<Hash>                        incomingChecksum;
         QTimer                            *finalizeTimer = nullptr;
         FileHasher                        *hasher        = nullptr;
+        BlockSender                       *sender        = nullptr;
+
+        int    sendWindowBlocks = 16;
+        qint64 sendWindowBytes  = 512 * 1024;
 
         void setState(State s)
         {
             q->_state = s;
             if (s == State::Finished) {
+                if (sender) {
+                    sender->stop();
+                }
                 if (device && closeDeviceOnFinish) {
                     device->close();
                 }
@@ -240,84 +248,41 @@ namespace XMPP { namespace Jingle { namespace FileTransfer {
                 hasher = new FileHasher(file.hash().type());
             }
             if (q->senders() == q->pad()->session()->role()) {
-                writeNextBlockToTransport();
+                startSending();
             } else {
                 readNextBlockFromTransport();
             }
         }
 
-        inline std::size_t getBlockSize()
+        void startSending()
         {
-            auto sz = connection->blockSize();
-            return sz ? sz : 8192;
-        }
-
-        void writeNextBlockToTransport()
+            sender = new BlockSender(device, connection, bytesLeft, q);
+            sender->setHasher(hasher);
+            sender->setWindow(sendWindowBlocks, sendWindowBytes);
+            auto startPos = device->isSequential() ? 0 : quint64(device->pos());
+            q->connect(sender, &BlockSender::progress, q,
+                       [this, startPos](quint64 sent) { emit q->progress(startPos + sent); });
+            q->connect(sender, &BlockSender::failed, q, [this](const QString &reason) { handleStreamFail(reason); });
+            q->connect(sender, &BlockSender::finished, q, [this]() { onSendingFinished(); });
+            sender->start();
+        }
+
+        void onSendingFinished()
         {
-            if (bytesLeft && *bytesLeft == 0) {
-                if (hasher) {
-                    auto hash = hasher->result();
-                    if (hash.isValid()) {
-                        outgoingChecksum << hash;
-                        emit q->updated();
-                        return;
-                    }
-                }
-                expectReceived();
-                return; // everything is written
-            }
-            quint64 sz = getBlockSize();
-            if (bytesLeft && sz > *bytesLeft) {
-                sz = *bytesLeft;
-            }
-            QByteArray data;
-            if (device->isSequential()) {
-                sz = qMin(sz, quint64(device->bytesAvailable()));
-                if (!sz)
-                    return; // we will come back on readyRead
-            }
-            data.resize(sz);
-            auto readSz = device->read(data.data(), sz);
-            if (readSz < 0) {
-                handleStreamFail(QString::fromLatin1("source device failed"));
-                return;
-            }
-            data.resize(readSz);
-            if (readSz == 0) {
-                if (!bytesLeft) {
-                    lastReason = Reason(Reason::Condition::Success);
-                    if (hasher) {
-                        auto hash = hasher->result();
-                        if (hash.isValid()) {
-                            outgoingChecksum << hash;
-                            emit q->updated();
-                            return;
-                        }
-                    }
-                    setState(State::Finished);
-                } else {
-                    handleStreamFail();
-                }
-                return;
-            } else if (hasher) {
-                hasher->addData(data);
-            }
-
-            if (connection->features() & TransportFeature::MessageOriented) {
-                if (!connection->writeDatagram(data)) {
-                    handleStreamFail();
-                    return;
-                }
-            } else {
-                if (connection->write(data) == -1) {
-                    handleStreamFail();
+            if (!bytesLeft) // read till the end of the device
+                lastReason = Reason(Reason::Condition::Success);
+            if (hasher) {
+                auto hash = hasher->result();
+                if (hash.isValid()) {
+                    outgoingChecksum << hash;
+                    emit q->updated();
                     return;
                 }
             }
-            emit q->progress(device->pos());
-            if (bytesLeft) {
-                *bytesLeft -= data.size();
-            }
+            if (bytesLeft)
+                expectReceived();
+            else
+                setState(State::Finished);
         }
 
         void readNextBlockFromTransport()
@@ -386,8 +351,9 @@ namespace XMPP { namespace Jingle { namespace FileTransfer {
                 if (amIReceiver()) {
                     connection->setReadHook([this](char *buf, qint64 size) {
                         // in streaming mode we need this to compute hash sum and detect stream end is size was defined
+                        // the hasher works in its own thread while 'buf' belongs to the reader. so copy
                         if (hasher) {
-                            hasher->addData(QByteArray::fromRawData(buf, size));
+                            hasher->addData(QByteArray(buf, int(size)));
                         }
                         if (bytesLeft) {
                             *bytesLeft -= quint64(size);
@@ -414,20 +380,16 @@ namespace XMPP { namespace Jingle { namespace FileTransfer {
                     readNextBlockFromTransport();
                 }
             });
-            connect(
-                connection.data(), &Connection::bytesWritten, q,
-                [this](qint64 bytes) {
+            if (amISender()) {
+                // the data itself is pumped by BlockSender
+                connect(connection.data(), &Connection::bytesWritten, q, [this](qint64 bytes) {
                     if (!writeLoggingStarted) {
                         qDebug("jingle-ft: wrote first %lld bytes for %s.", bytes,
                                qUtf8Printable(q->pad()->session()->peer().full()));
                         writeLoggingStarted = true;
                     }
-                    auto bs = getBlockSize();
-                    if (q->pad()->session()->role() == q->senders() && quint64(connection->bytesToWrite()) < bs) {
-                        writeNextBlockToTransport();
-                    }
-                },
-                Qt::QueuedConnection);
+                });
+            }
 
             if (amIReceiver()) {
                 connect(connection.data(), &Connection::disconnected, q, [this]() { tryFinalizeIncoming(); });
@@ -759,6 +721,15 @@ namespace XMPP { namespace Jingle { namespace FileTransfer {
         d->setDevice(dev, closeOnFinish);
     }
 
+    void Application::setSendWindow(int blocks, qint64 bytes)
+    {
+        d->sendWindowBlocks = blocks;
+        d->sendWindowBytes  = bytes;
+        if (d->sender) {
+            d->sender->setWindow(blocks, bytes);
+        }
+    }
+
     Connection::Ptr Application::connection() const { return d->connection.staticCast<XMPP::Jingle::Connection>(); }
 
     Pad::Pad(Manager *manager, Session *session) : _manager(manager), _session(session) { }
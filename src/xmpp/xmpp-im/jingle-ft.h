@@ -93,6 +93,15 @@ namespace XMPP { namespace Jingle { namespace FileTransfer {
         void            setDevice(QIODevice *dev, bool closeOnFinish = true);
         Connection::Ptr connection() const;
 
+        /**
+         * @brief setSendWindow limits how much outgoing data is kept in flight.
+         *
+         * No more than \a blocks transport blocks and, if positive, \a bytes are queued
+         * in the connection. The same amount is read ahead from the device.
+         * The default is 16 blocks, but no more than 512KiB.
+         */
+        void setSendWindow(int blocks, qint64 bytes = 0);
+
         // next method are used by Jingle::Session and usually shouldn't be called manually
         XMPP::Jingle::Application::Update evaluateOutgoingUpdate() override;
         OutgoingUpdate                    takeOutgoingUpdate() override;
@@ -1057,11 +1057,11 @@ namespace XMPP { namespace Jingle {
 
     Origin Session::peerRole() const { return negateOrigin(d->role); }
 
-    Features Session::peerFeatures() const { return d->manager->client()->capsManager()->disco(peer()).features(); }
+    Features Session::peerFeatures() const { return d->manager->client()->capsManager()->features(peer()); }
 
     bool Session::checkPeerCaps(const QString &ns) const
     {
-        return d->manager->client()->capsManager()->disco(peer()).features().test(QStringList() << ns);
+        return d->manager->client()->capsManager()->features(peer()).test(ns);
     }
 
     bool Session::isGroupingAllowed() const { return d->groupingAllowed; }
@@ -30,6 +30,7 @@
 
 #include <QList>
 #include <QMap>
+#include <QReadWriteLock>
 
 #include <optional>
 
@@ -760,6 +761,27 @@ public:
     Forwarding                               forwarding;          // XEP-0297
     Message::Reactions                       reactions;           // XEP-0444
     QString                                  retraction;          // XEP-0424
+    QHash<QString, QVariant>                 extensionData;       // of registered parsers
+
+    // fromStanza() looks up the parser of each child element once by (namespace, local name)
+    class ParseState;
+    using ElementParser = void (*)(ParseState &state, const QDomElement &e);
+    struct BuiltinParser {
+        ElementParser parse;
+        quint64       once; // its bit in ParseState::seen if only the first element counts, else 0
+    };
+    static const QHash<QPair<QString, QString>, BuiltinParser> &builtinParsers();
+};
+
+// what the parsers of one stanza share
+class Message::Private::ParseState {
+public:
+    Message::Private *d;
+    quint64           seen            = 0;
+    bool              hasBodyOrThread = false;
+    bool              hasSubject      = false;
+    QDomElement       delay, legacyDelay; // XEP-0203 wins over XEP-0091
+    QDomElement       captcha, xdata;     // a form in a captcha wins over a bare one
 };
 
 #define MessageD() (d ? d : (d = new Private))
@@ -1632,6 +1654,354 @@ bool Message::fromStanza(const Stanza &s) { return fromStanza(s, false, 0); }
   This function exists to make transition between old and new style easier.
   */
 bool Message::fromStanza(const Stanza &s, bool useTimeZoneOffset, int timeZoneOffset)
+{
+    return fromStanza(s, {}, useTimeZoneOffset, timeZoneOffset);
+}
+
+namespace {
+    class ExtensionParsers {
+    public:
+        QReadWriteLock                                           lock;
+        QHash<QPair<QString, QString>, Message::ExtensionParser> parsers;
+    };
+
+    Q_GLOBAL_STATIC(ExtensionParsers, extensionParsers)
+
+    QString elementName(const QDomElement &e)
+    {
+        return e.localName().isEmpty() ? e.tagName().section(QLatin1Char(':'), -1) : e.localName();
+    }
+
+    // xml:lang of the element, empty if there is none and nothing if it's not valid
+    std::optional<QString> elementLang(const QDomElement &e)
+    {
+        QString lang = e.attributeNS(NS_XML, "lang", "");
+        if (!lang.isEmpty() && (lang = XMLHelper::sanitizedLang(lang)).isEmpty())
+            return {};
+        return lang;
+    }
+} // namespace
+
+void Message::registerExtensionParser(const QString &ns, const QString &name, const ExtensionParser &parser)
+{
+    QWriteLocker locker(&extensionParsers()->lock);
+    extensionParsers()->parsers.insert(qMakePair(ns, name), parser);
+}
+
+void Message::unregisterExtensionParser(const QString &ns, const QString &name)
+{
+    QWriteLocker locker(&extensionParsers()->lock);
+    extensionParsers()->parsers.remove(qMakePair(ns, name));
+}
+
+QVariant Message::extensionData(const QString &key) const { return d ? d->extensionData.value(key) : QVariant(); }
+
+void Message::setExtensionData(const QString &key, const QVariant &data) { MessageD()->extensionData[key] = data; }
+
+const QHash<QPair<QString, QString>, Message::Private::BuiltinParser> &Message::Private::builtinParsers()
+{
+    using State = ParseState;
+
+    struct Entry {
+        QString       ns;
+        QString       name;
+        bool          once;
+        ElementParser parse;
+    };
+
+    // clang-format off
+    static const QList<Entry> entries {
+        { QStringLiteral("http://jabber.org/protocol/pubsub#event"), QStringLiteral("event"), false,
+          [](State &st, const QDomElement &e) {
+              const QString pubSubEventNs = QStringLiteral("http://jabber.org/protocol/pubsub#event");
+              for (auto eventElement = e.firstChildElement(); !eventElement.isNull();
+                   eventElement      = eventElement.nextSiblingElement()) {
+                  if (!eventElement.namespaceURI().isEmpty() && eventElement.namespaceURI() != pubSubEventNs)
+                      continue;
+                  const QString localName = elementName(eventElement);
+
+                  PubSubEvent::Type eventType = PubSubEvent::Type::Unknown;
+                  if (localName == QLatin1String("items"))
+                      eventType = PubSubEvent::Type::Items;
+                  else if (localName == QLatin1String("collection"))
+                      eventType = PubSubEvent::Type::Collection;
+                  else if (localName == QLatin1String("configuration"))
+                      eventType = PubSubEvent::Type::Configuration;
+                  else if (localName == QLatin1String("delete"))
+                      eventType = PubSubEvent::Type::Delete;
+                  else if (localName == QLatin1String("purge"))
+                      eventType = PubSubEvent::Type::Purge;
+                  else if (localName == QLatin1String("subscription"))
+                      eventType = PubSubEvent::Type::Subscription;
+
+                  QList<PubSubItem>       items;
+                  QList<PubSubRetraction> retractions;
+                  if (eventType == PubSubEvent::Type::Items) {
+                      for (auto itemElement = eventElement.firstChildElement(); !itemElement.isNull();
+                           itemElement      = itemElement.nextSiblingElement()) {
+                          const QString itemName = elementName(itemElement);
+                          if (itemName == QLatin1String("item")) {
+                              items += PubSubItem(itemElement.attribute(QStringLiteral("id")),
+                                                  itemElement.firstChildElement());
+                          } else if (itemName == QLatin1String("retract")) {
+                              retractions += PubSubRetraction(itemElement.attribute(QStringLiteral("id")));
+                          }
+                      }
+                  }
+
+                  st.d->pubSubEvents += PubSubEvent(eventType, eventElement.attribute(QStringLiteral("node")),
+                                                    items, retractions, eventElement);
+              }
+          } },
+
+        // XEP-0334 processing hints
+        { QStringLiteral("urn:xmpp:hints"), QStringLiteral("no-permanent-store"), false,
+          [](State &st, const QDomElement &) { st.d->processingHints |= NoPermanentStore; } },
+        { QStringLiteral("urn:xmpp:hints"), QStringLiteral("no-store"), false,
+          [](State &st, const QDomElement &) { st.d->processingHints |= NoStore; } },
+        { QStringLiteral("urn:xmpp:hints"), QStringLiteral("no-copy"), false,
+          [](State &st, const QDomElement &) { st.d->processingHints |= NoCopy; } },
+        { QStringLiteral("urn:xmpp:hints"), QStringLiteral("store"), false,
+          [](State &st, const QDomElement &) { st.d->processingHints |= Store; } },
+
+        // XEP-0359
+        { QStringLiteral("urn:xmpp:sid:0"), QStringLiteral("origin-id"), false,
+          [](State &st, const QDomElement &e) { st.d->originId = e.attribute(QStringLiteral("id")); } },
+        { QStringLiteral("urn:xmpp:sid:0"), QStringLiteral("stanza-id"), false,
+          [](State &st, const QDomElement &e) {
+              st.d->stanzaId.id = e.attribute(QStringLiteral("id"));
+              st.d->stanzaId.by = Jid(e.attribute(QStringLiteral("by")));
+          } },
+
+        // Bits of Binary XEP-0231
+        { QStringLiteral("urn:xmpp:bob"), QStringLiteral("data"), false,
+          [](State &st, const QDomElement &e) { st.d->bobDataList += BoBData(e); } },
+
+        // xhtml-im
+        { QStringLiteral("http://jabber.org/protocol/xhtml-im"), QStringLiteral("html"), true,
+          [](State &st, const QDomElement &html) {
+              for (auto e = html.firstChildElement(); !e.isNull(); e = e.nextSiblingElement()) {
+                  if (e.tagName() != QLatin1String("body")
+                      || e.namespaceURI() != QLatin1String("http://www.w3.org/1999/xhtml"))
+                      continue;
+                  auto lang = elementLang(e);
+                  if (lang) {
+                      st.d->htmlElements[*lang] = e;
+                      st.d->htmlElements[*lang].filterOutUnwanted(false); // just clear iframes and js event handlers
+                  }
+              }
+          } },
+
+        // timestamp
+        { QStringLiteral("urn:xmpp:delay"), QStringLiteral("delay"), true,
+          [](State &st, const QDomElement &e) { st.delay = e; } },
+        { QStringLiteral("jabber:x:delay"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &e) { st.legacyDelay = e; } },
+
+        // urls
+        { QStringLiteral("jabber:x:oob"), QStringLiteral("x"), false,
+          [](State &st, const QDomElement &e) {
+              Url u;
+              u.setUrl(e.elementsByTagName("url").item(0).toElement().text());
+              u.setDesc(e.elementsByTagName("desc").item(0).toElement().text());
+              st.d->urlList += u;
+          } },
+
+        // events
+        { QStringLiteral("jabber:x:event"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &x) {
+              for (auto e = x.firstChildElement(); !e.isNull(); e = e.nextSiblingElement()) {
+                  QString evtag = e.tagName();
+                  if (evtag == "id")
+                      st.d->eventId = e.text();
+                  else if (evtag == "displayed")
+                      st.d->eventList += DisplayedEvent;
+                  else if (evtag == "composing")
+                      st.d->eventList += ComposingEvent;
+                  else if (evtag == "delivered")
+                      st.d->eventList += DeliveredEvent;
+              }
+              if (st.d->eventList.isEmpty())
+                  st.d->eventList += CancelEvent;
+          } },
+
+        // Chat states. if there are a few, the later of them in the enum wins
+        { QStringLiteral("http://jabber.org/protocol/chatstates"), QStringLiteral("active"), false,
+          [](State &st, const QDomElement &) { st.d->chatState = qMax(st.d->chatState, StateActive); } },
+        { QStringLiteral("http://jabber.org/protocol/chatstates"), QStringLiteral("composing"), false,
+          [](State &st, const QDomElement &) { st.d->chatState = qMax(st.d->chatState, StateComposing); } },
+        { QStringLiteral("http://jabber.org/protocol/chatstates"), QStringLiteral("paused"), false,
+          [](State &st, const QDomElement &) { st.d->chatState = qMax(st.d->chatState, StatePaused); } },
+        { QStringLiteral("http://jabber.org/protocol/chatstates"), QStringLiteral("inactive"), false,
+          [](State &st, const QDomElement &) { st.d->chatState = qMax(st.d->chatState, StateInactive); } },
+        { QStringLiteral("http://jabber.org/protocol/chatstates"), QStringLiteral("gone"), false,
+          [](State &st, const QDomElement &) { st.d->chatState = qMax(st.d->chatState, StateGone); } },
+
+        // message receipts. a receipt wins over a request
+        { QStringLiteral("urn:xmpp:receipts"), QStringLiteral("request"), true,
+          [](State &st, const QDomElement &) {
+              if (st.d->messageReceipt == ReceiptReceived)
+                  return;
+              st.d->messageReceipt = ReceiptRequest;
+              st.d->messageReceiptId.clear();
+          } },
+        { QStringLiteral("urn:xmpp:receipts"), QStringLiteral("received"), true,
+          [](State &st, const QDomElement &e) {
+              st.d->messageReceipt   = ReceiptReceived;
+              st.d->messageReceiptId = e.attribute("id");
+              if (st.d->messageReceiptId.isEmpty())
+                  st.d->messageReceiptId = st.d->id;
+          } },
+
+        // xsigned and xencrypted
+        { QStringLiteral("jabber:x:signed"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &e) { st.d->xsigned = e.text(); } },
+        { QStringLiteral("jabber:x:encrypted"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &e) { st.d->xencrypted = e.text(); } },
+
+        // addresses
+        { QStringLiteral("http://jabber.org/protocol/address"), QStringLiteral("addresses"), true,
+          [](State &st, const QDomElement &e) {
+              XDomNodeList nl = e.elementsByTagName("address");
+              for (int n = 0; n < nl.count(); ++n)
+                  st.d->addressList += Address(nl.item(n).toElement());
+          } },
+
+        // roster item exchange
+        { QStringLiteral("http://jabber.org/protocol/rosterx"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &e) {
+              XDomNodeList nl = e.elementsByTagName("item");
+              for (int n = 0; n < nl.count(); ++n) {
+                  RosterExchangeItem it = RosterExchangeItem(nl.item(n).toElement());
+                  if (!it.isNull())
+                      st.d->rosterExchangeItems += it;
+              }
+          } },
+
+        // invite, nick and sxe
+        { QStringLiteral("jabber:x:conference"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &e) { st.d->invite = e.attribute("jid"); } },
+        { QStringLiteral("http://jabber.org/protocol/nick"), QStringLiteral("nick"), true,
+          [](State &st, const QDomElement &e) { st.d->nick = e.text(); } },
+        { QStringLiteral("http://jabber.org/protocol/sxe"), QStringLiteral("sxe"), true,
+          [](State &st, const QDomElement &e) { st.d->sxe = e; } },
+
+        { QStringLiteral("http://jabber.org/protocol/muc#user"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &x) {
+              st.d->hasMUCUser = true;
+              for (auto muc_e = x.firstChildElement(); !muc_e.isNull(); muc_e = muc_e.nextSiblingElement()) {
+                  if (muc_e.tagName() == "status") {
+                      st.d->mucStatuses += muc_e.attribute("code").toInt();
+                  } else if (muc_e.tagName() == "invite") {
+                      MUCInvite inv(muc_e);
+                      if (!inv.isNull())
+                          st.d->mucInvites += inv;
+                  } else if (muc_e.tagName() == "decline") {
+                      st.d->mucDecline = MUCDecline(muc_e);
+                  } else if (muc_e.tagName() == "password") {
+                      st.d->mucPassword = muc_e.text();
+                  }
+              }
+          } },
+
+        // http auth
+        { QStringLiteral("http://jabber.org/protocol/http-auth"), QStringLiteral("confirm"), true,
+          [](State &st, const QDomElement &e) { st.d->httpAuthRequest = HttpAuthRequest(e); } },
+
+        // data form, maybe in a captcha
+        { QStringLiteral("urn:xmpp:captcha"), QStringLiteral("captcha"), true,
+          [](State &st, const QDomElement &e) { st.captcha = e; } },
+        { QStringLiteral("jabber:x:data"), QStringLiteral("x"), true,
+          [](State &st, const QDomElement &e) { st.xdata = e; } },
+
+        { IBBManager::ns(), QStringLiteral("data"), true,
+          [](State &st, const QDomElement &e) { st.d->ibbData.fromXml(e); } },
+        { QStringLiteral("urn:xmpp:message-correct:0"), QStringLiteral("replace"), true,
+          [](State &st, const QDomElement &e) { st.d->replaceId = e.attribute("id"); } },
+
+        // XEP-0385 SIMS and XEP-0372 Reference
+        { REFERENCE_NS, QStringLiteral("reference"), false,
+          [](State &st, const QDomElement &e) {
+              Reference r;
+              if (r.fromXml(e))
+                  st.d->references.append(r);
+          } },
+
+        // XEP-0447 Stateless File Sharing
+        { StatelessFileSharing::NS, QStringLiteral("file-sharing"), false,
+          [](State &st, const QDomElement &e) {
+              StatelessFileSharing::FileSharing sharing(e);
+              if (sharing.isValid())
+                  st.d->fileSharings.append(sharing);
+          } },
+
+        // XEP-0367 Message Attaching and XEP-0447 source attachments
+        { StatelessFileSharing::MESSAGE_ATTACHING_NS, QStringLiteral("attach-to"), true,
+          [](State &st, const QDomElement &e) { st.d->attachToId = e.attribute(QStringLiteral("id")); } },
+        { StatelessFileSharing::NS, QStringLiteral("sources"), false,
+          [](State &st, const QDomElement &e) {
+              StatelessFileSharing::Sources sources(e);
+              if (sources.isValid())
+                  st.d->attachedFileSources.append(sources);
+          } },
+
+        // XEP-0358 direct publication. If an old sender omitted the required from
+        // attribute, use the stanza sender as the session owner.
+        { Jingle::JINGLEPUB_NS, QStringLiteral("jinglepub"), false,
+          [](State &st, const QDomElement &e) {
+              auto element = e;
+              if (!element.hasAttribute(QStringLiteral("from")) && st.d->from.isValid())
+                  element.setAttribute(QStringLiteral("from"), st.d->from.full());
+              Jingle::JinglePub publication(element);
+              if (publication.isValid())
+                  st.d->jinglePublications.append(publication);
+          } },
+
+        // XEP-0444 message reactions
+        { QStringLiteral("urn:xmpp:reactions:0"), QStringLiteral("reactions"), true,
+          [](State &st, const QDomElement &reactions) {
+              st.d->reactions.targetId = reactions.attribute(QLatin1String("id"));
+              if (st.d->reactions.targetId.isEmpty())
+                  return;
+              auto reactionTag = QStringLiteral("reaction");
+              auto reaction    = reactions.firstChildElement(reactionTag);
+              while (!reaction.isNull()) {
+                  st.d->reactions.reactions.insert(reaction.text().trimmed());
+                  reaction = reaction.nextSiblingElement(reactionTag);
+              }
+              st.d->reactions.reactions.squeeze();
+          } },
+
+        // XEP-0424 message retraction
+        { QStringLiteral("urn:xmpp:message-retract:1"), QStringLiteral("retract"), true,
+          [](State &st, const QDomElement &e) { st.d->retraction = e.attribute(QLatin1String("id")); } },
+    };
+    // clang-format on
+
+    static const auto parsers = [] {
+        QHash<QPair<QString, QString>, BuiltinParser> ret;
+        quint64                                       bit = 1;
+        for (const auto &entry : entries) {
+            Q_ASSERT(bit);
+            ret.insert(qMakePair(entry.ns, entry.name), { entry.parse, entry.once ? bit : 0 });
+            if (entry.once)
+                bit <<= 1;
+        }
+        return ret;
+    }();
+    return parsers;
+}
+
+/**
+  \brief Create Message from Stanza \a s, parsing only the children in the \a extensions namespaces
+
+  Each child element is looked up once by its namespace and local name and handed to
+  its parser, built-in or registered with registerExtensionParser(). The children of
+  namespaces not in a non-empty \a extensions are skipped without being looked at.
+  See the other overloads for \a useTimeZoneOffset and \a timeZoneOffset.
+  */
+bool Message::fromStanza(const Stanza &s, const QSet<QString> &extensions, bool useTimeZoneOffset,
+                         int timeZoneOffset)
 {
     if (s.kind() != Stanza::Message)
         return false;
@@ -1655,140 +2025,73 @@ bool Message::fromStanza(const Stanza &s, bool useTimeZoneOffset, int timeZoneOf
         setType(Type::Normal); // everything unknown is normal by rfc6121
     }
 
-    d->subject.clear();
-    d->body.clear();
-    d->htmlElements.clear();
-    d->thread = QString();
-
-    QDomElement root = s.element();
+    // copied, so the parsers run without the lock
+    QHash<QPair<QString, QString>, ExtensionParser> custom;
+    {
+        QReadLocker locker(&extensionParsers()->lock);
+        custom = extensionParsers()->parsers;
+    }
 
-    XDomNodeList nl = root.childNodes();
-    int          n;
-    bool         hasBodyOrThread = false;
-    bool         hasSubject      = false;
+    const auto                                        &builtin = Private::builtinParsers();
+    const QString                                      baseNS  = s.baseNS();
+    Private::ParseState                                state { d.data() };
+    QList<QPair<const ExtensionParser *, QDomElement>> customFound;
+    QDomElement                                        root = s.element();
     for (QDomElement e = root.firstChildElement(); !e.isNull(); e = e.nextSiblingElement()) {
-        if (e.namespaceURI() == s.baseNS()) {
+        const QString ns = e.namespaceURI();
+        if (ns == baseNS) {
             if (e.tagName() == QLatin1String("subject")) {
-                hasSubject   = true;
-                QString lang = e.attributeNS(NS_XML, "lang", "");
-                if (lang.isEmpty() || !(lang = XMLHelper::sanitizedLang(lang)).isEmpty()) {
-                    d->subject[lang] = e.text();
-                }
+                state.hasSubject = true;
+                auto lang        = elementLang(e);
+                if (lang)
+                    d->subject[*lang] = e.text();
             } else if (e.tagName() == QLatin1String("body")) {
-                hasBodyOrThread = true;
-                QString lang    = e.attributeNS(NS_XML, "lang", "");
-                if (lang.isEmpty() || !(lang = XMLHelper::sanitizedLang(lang)).isEmpty()) {
-                    d->body[lang] = e.text();
-                }
+                state.hasBodyOrThread = true;
+                auto lang             = elementLang(e);
+                if (lang)
+                    d->body[*lang] = e.text();
             } else if (e.tagName() == QLatin1String("thread")) {
-                hasBodyOrThread = true;
-                d->thread       = e.text();
-            }
-        } else if (e.tagName() == QLatin1String("event")
-                   && e.namespaceURI() == QLatin1String("http://jabber.org/protocol/pubsub#event")) {
-            constexpr auto pubSubEventNs = "http://jabber.org/protocol/pubsub#event";
-            for (auto eventElement = e.firstChildElement(); !eventElement.isNull();
-                 eventElement      = eventElement.nextSiblingElement()) {
-                const QString localName = eventElement.localName().isEmpty()
-                    ? eventElement.tagName().section(QLatin1Char(':'), -1)
-                    : eventElement.localName();
-                if (!eventElement.namespaceURI().isEmpty()
-                    && eventElement.namespaceURI() != QLatin1String(pubSubEventNs))
-                    continue;
-
-                PubSubEvent::Type eventType = PubSubEvent::Type::Unknown;
-                if (localName == QLatin1String("items"))
-                    eventType = PubSubEvent::Type::Items;
-                else if (localName == QLatin1String("collection"))
-                    eventType = PubSubEvent::Type::Collection;
-                else if (localName == QLatin1String("configuration"))
-                    eventType = PubSubEvent::Type::Configuration;
-                else if (localName == QLatin1String("delete"))
-                    eventType = PubSubEvent::Type::Delete;
-                else if (localName == QLatin1String("purge"))
-                    eventType = PubSubEvent::Type::Purge;
-                else if (localName == QLatin1String("subscription"))
-                    eventType = PubSubEvent::Type::Subscription;
-
-                QList<PubSubItem>       items;
-                QList<PubSubRetraction> retractions;
-                if (eventType == PubSubEvent::Type::Items) {
-                    for (auto itemElement = eventElement.firstChildElement(); !itemElement.isNull();
-                         itemElement      = itemElement.nextSiblingElement()) {
-                        const QString itemName = itemElement.localName().isEmpty()
-                            ? itemElement.tagName().section(QLatin1Char(':'), -1)
-                            : itemElement.localName();
-                        if (itemName == QLatin1String("item")) {
-                            items += PubSubItem(itemElement.attribute(QStringLiteral("id")),
-                                                itemElement.firstChildElement());
-                        } else if (itemName == QLatin1String("retract")) {
-                            retractions += PubSubRetraction(itemElement.attribute(QStringLiteral("id")));
-                        }
-                    }
-                }
-
-                d->pubSubEvents += PubSubEvent(eventType, eventElement.attribute(QStringLiteral("node")), items,
-                                               retractions, eventElement);
+                state.hasBodyOrThread = true;
+                d->thread             = e.text();
             }
-        } else if (e.tagName() == QLatin1String("no-permanent-store")
-                   && e.namespaceURI() == QLatin1String("urn:xmpp:hints")) {
-            d->processingHints |= NoPermanentStore;
-        } else if (e.tagName() == QLatin1String("no-store") && e.namespaceURI() == QLatin1String("urn:xmpp:hints")) {
-            d->processingHints |= NoStore;
-        } else if (e.tagName() == QLatin1String("no-copy") && e.namespaceURI() == QLatin1String("urn:xmpp:hints")) {
-            d->processingHints |= NoCopy;
-        } else if (e.tagName() == QLatin1String("store") && e.namespaceURI() == QLatin1String("urn:xmpp:hints")) {
-            d->processingHints |= Store;
-        } else if (e.tagName() == QLatin1String("origin-id") && e.namespaceURI() == QLatin1String("urn:xmpp:sid:0")) {
-            d->originId = e.attribute(QStringLiteral("id"));
-        } else if (e.tagName() == QLatin1String("stanza-id") && e.namespaceURI() == QLatin1String("urn:xmpp:sid:0")) {
-            d->stanzaId.id = e.attribute(QStringLiteral("id"));
-            d->stanzaId.by = Jid(e.attribute(QStringLiteral("by")));
+            continue;
         }
+        if (!extensions.isEmpty() && !extensions.contains(ns))
+            continue;
 
-        else {
-            // printf("extension element: [%s]\n", e.tagName().latin1());
+        const auto key = qMakePair(ns, e.localName());
+        auto       it  = builtin.constFind(key);
+        if (it != builtin.constEnd() && !(state.seen & it->once)) {
+            state.seen |= it->once;
+            it->parse(state, e);
+        }
+        if (!custom.isEmpty()) {
+            auto cit = custom.constFind(key);
+            if (cit == custom.constEnd())
+                cit = custom.constFind(qMakePair(ns, QString()));
+            if (cit != custom.constEnd())
+                customFound += qMakePair(&cit.value(), e);
         }
     }
 
-    d->pureSubject = hasSubject && !hasBodyOrThread; // this is somewhat important for muc
+    d->pureSubject = state.hasSubject && !state.hasBodyOrThread; // this is somewhat important for muc
 
     if (s.type() == "error")
         d->error = s.error();
 
-    // Bits of Binary XEP-0231
-    nl = childElementsByTagNameNS(root, "urn:xmpp:bob", "data");
-    for (n = 0; n < nl.count(); ++n) {
-        addBoBData(BoBData(nl.item(n).toElement()));
-    }
-
-    // xhtml-im
-    nl = childElementsByTagNameNS(root, "http://jabber.org/protocol/xhtml-im", "html");
-    if (nl.count()) {
-        nl = nl.item(0).childNodes();
-        for (n = 0; n < nl.count(); ++n) {
-            QDomElement e = nl.item(n).toElement();
-            if (e.tagName() == "body" && e.namespaceURI() == "http://www.w3.org/1999/xhtml") {
-                QString lang = e.attributeNS(NS_XML, "lang", "");
-                if (lang.isEmpty() || !(lang = XMLHelper::sanitizedLang(lang)).isEmpty()) {
-                    d->htmlElements[lang] = e;
-                    d->htmlElements[lang].filterOutUnwanted(false); // just clear iframes and javascript event handlers
-                }
-            }
-        }
-    }
+    // data form
+    QDomElement xdata = state.xdata;
+    if (!state.captcha.isNull())
+        xdata = childElementsByTagNameNS(state.captcha, "jabber:x:data", "x").item(0).toElement();
+    if (!xdata.isNull())
+        d->xdata.fromXml(xdata);
 
     // timestamp
-    QDomElement t = childElementsByTagNameNS(root, "urn:xmpp:delay", "delay").item(0).toElement();
-    QDateTime   stamp;
-    if (!t.isNull()) {
-        stamp = QDateTime::fromString(t.attribute("stamp").left(19), Qt::ISODate);
-    } else {
-        t = childElementsByTagNameNS(root, "jabber:x:delay", "x").item(0).toElement();
-        if (!t.isNull()) {
-            stamp = stamp2TS(t.attribute("stamp"));
-        }
-    }
+    QDateTime stamp;
+    if (!state.delay.isNull())
+        stamp = QDateTime::fromString(state.delay.attribute("stamp").left(19), Qt::ISODate);
+    else if (!state.legacyDelay.isNull())
+        stamp = stamp2TS(state.legacyDelay.attribute("stamp"));
     if (!stamp.isNull()) {
         if (useTimeZoneOffset) {
             d->timeStamp = stamp.addSecs(timeZoneOffset * 3600);
@@ -1808,243 +2111,8 @@ bool Message::fromStanza(const Stanza &s, bool useTimeZoneOffset, int timeZoneOf
         d->spooled       = false;
     }
 
-    // urls
-    d->urlList.clear();
-    nl = childElementsByTagNameNS(root, "jabber:x:oob", "x");
-    for (n = 0; n < nl.count(); ++n) {
-        QDomElement t = nl.item(n).toElement();
-        Url         u;
-        u.setUrl(t.elementsByTagName("url").item(0).toElement().text());
-        u.setDesc(t.elementsByTagName("desc").item(0).toElement().text());
-        d->urlList += u;
-    }
-
-    // events
-    d->eventList.clear();
-    nl = childElementsByTagNameNS(root, "jabber:x:event", "x");
-    if (nl.count()) {
-        nl = nl.item(0).childNodes();
-        for (n = 0; n < nl.count(); ++n) {
-            QString evtag = nl.item(n).toElement().tagName();
-            if (evtag == "id") {
-                d->eventId = nl.item(n).toElement().text();
-            } else if (evtag == "displayed")
-                d->eventList += DisplayedEvent;
-            else if (evtag == "composing")
-                d->eventList += ComposingEvent;
-            else if (evtag == "delivered")
-                d->eventList += DeliveredEvent;
-        }
-        if (d->eventList.isEmpty())
-            d->eventList += CancelEvent;
-    }
-
-    // Chat states
-    QString chatStateNS = "http://jabber.org/protocol/chatstates";
-    t                   = childElementsByTagNameNS(root, chatStateNS, "active").item(0).toElement();
-    if (!t.isNull())
-        d->chatState = StateActive;
-    t = childElementsByTagNameNS(root, chatStateNS, "composing").item(0).toElement();
-    if (!t.isNull())
-        d->chatState = StateComposing;
-    t = childElementsByTagNameNS(root, chatStateNS, "paused").item(0).toElement();
-    if (!t.isNull())
-        d->chatState = StatePaused;
-    t = childElementsByTagNameNS(root, chatStateNS, "inactive").item(0).toElement();
-    if (!t.isNull())
-        d->chatState = StateInactive;
-    t = childElementsByTagNameNS(root, chatStateNS, "gone").item(0).toElement();
-    if (!t.isNull())
-        d->chatState = StateGone;
-
-    // message receipts
-    QString messageReceiptNS = "urn:xmpp:receipts";
-    t                        = childElementsByTagNameNS(root, messageReceiptNS, "request").item(0).toElement();
-    if (!t.isNull()) {
-        d->messageReceipt = ReceiptRequest;
-        d->messageReceiptId.clear();
-    }
-    t = childElementsByTagNameNS(root, messageReceiptNS, "received").item(0).toElement();
-    if (!t.isNull()) {
-        d->messageReceipt   = ReceiptReceived;
-        d->messageReceiptId = t.attribute("id");
-        if (d->messageReceiptId.isEmpty())
-            d->messageReceiptId = id();
-    }
-
-    // xsigned
-    t = childElementsByTagNameNS(root, "jabber:x:signed", "x").item(0).toElement();
-    if (!t.isNull())
-        d->xsigned = t.text();
-    else
-        d->xsigned = QString();
-
-    // xencrypted
-    t = childElementsByTagNameNS(root, "jabber:x:encrypted", "x").item(0).toElement();
-    if (!t.isNull())
-        d->xencrypted = t.text();
-    else
-        d->xencrypted = QString();
-
-    // addresses
-    d->addressList.clear();
-    nl = childElementsByTagNameNS(root, "http://jabber.org/protocol/address", "addresses");
-    if (nl.count()) {
-        QDomElement t = nl.item(0).toElement();
-        nl            = t.elementsByTagName("address");
-        for (n = 0; n < nl.count(); ++n) {
-            d->addressList += Address(nl.item(n).toElement());
-        }
-    }
-
-    // roster item exchange
-    d->rosterExchangeItems.clear();
-    nl = childElementsByTagNameNS(root, "http://jabber.org/protocol/rosterx", "x");
-    if (nl.count()) {
-        QDomElement t = nl.item(0).toElement();
-        nl            = t.elementsByTagName("item");
-        for (n = 0; n < nl.count(); ++n) {
-            RosterExchangeItem it = RosterExchangeItem(nl.item(n).toElement());
-            if (!it.isNull())
-                d->rosterExchangeItems += it;
-        }
-    }
-
-    // invite
-    t = childElementsByTagNameNS(root, "jabber:x:conference", "x").item(0).toElement();
-    if (!t.isNull())
-        d->invite = t.attribute("jid");
-    else
-        d->invite = QString();
-
-    // nick
-    t = childElementsByTagNameNS(root, "http://jabber.org/protocol/nick", "nick").item(0).toElement();
-    if (!t.isNull())
-        d->nick = t.text();
-    else
-        d->nick = QString();
-
-    // sxe
-    t = childElementsByTagNameNS(root, "http://jabber.org/protocol/sxe", "sxe").item(0).toElement();
-    if (!t.isNull())
-        d->sxe = t;
-    else
-        d->sxe = QDomElement();
-
-    t = childElementsByTagNameNS(root, "http://jabber.org/protocol/muc#user", "x").item(0).toElement();
-    if (!t.isNull()) {
-        d->hasMUCUser = true;
-        for (QDomNode muc_n = t.firstChild(); !muc_n.isNull(); muc_n = muc_n.nextSibling()) {
-            QDomElement muc_e = muc_n.toElement();
-            if (muc_e.isNull())
-                continue;
-            if (muc_e.tagName() == "status") {
-                addMUCStatus(muc_e.attribute("code").toInt());
-            } else if (muc_e.tagName() == "invite") {
-                MUCInvite inv(muc_e);
-                if (!inv.isNull())
-                    addMUCInvite(inv);
-            } else if (muc_e.tagName() == "decline") {
-                setMUCDecline(MUCDecline(muc_e));
-            } else if (muc_e.tagName() == "password") {
-                setMUCPassword(muc_e.text());
-            }
-        }
-    }
-
-    // http auth
-    t = childElementsByTagNameNS(root, "http://jabber.org/protocol/http-auth", "confirm").item(0).toElement();
-    if (!t.isNull()) {
-        d->httpAuthRequest = HttpAuthRequest(t);
-    } else {
-        d->httpAuthRequest = HttpAuthRequest();
-    }
-
-    QDomElement captcha   = childElementsByTagNameNS(root, "urn:xmpp:captcha", "captcha").item(0).toElement();
-    QDomElement xdataRoot = root;
-    if (!captcha.isNull()) {
-        xdataRoot = captcha;
-    }
-
-    // data form
-    t = childElementsByTagNameNS(xdataRoot, "jabber:x:data", "x").item(0).toElement();
-    if (!t.isNull()) {
-        d->xdata.fromXml(t);
-    }
-
-    t = childElementsByTagNameNS(root, IBBManager::ns(), "data").item(0).toElement();
-    if (!t.isNull()) {
-        d->ibbData.fromXml(t);
-    }
-    t = childElementsByTagNameNS(root, "urn:xmpp:message-correct:0", "replace").item(0).toElement();
-    if (!t.isNull()) {
-        d->replaceId = t.attribute("id");
-    }
-
-    // XEP-0385 SIMS and XEP-0372 Reference
-    auto references = childElementsByTagNameNS(root, REFERENCE_NS, QString::fromLatin1("reference"));
-    for (int i = 0; i < references.size(); i++) {
-        Reference r;
-        if (r.fromXml(references.at(i).toElement())) {
-            d->references.append(r);
-        }
-    }
-
-    // XEP-0447 Stateless File Sharing
-    auto fileSharings = childElementsByTagNameNS(root, StatelessFileSharing::NS, QStringLiteral("file-sharing"));
-    for (int i = 0; i < fileSharings.size(); ++i) {
-        StatelessFileSharing::FileSharing sharing(fileSharings.at(i).toElement());
-        if (sharing.isValid())
-            d->fileSharings.append(sharing);
-    }
-
-    // XEP-0367 Message Attaching and XEP-0447 source attachments
-    auto attach
-        = childElementsByTagNameNS(root, StatelessFileSharing::MESSAGE_ATTACHING_NS, QStringLiteral("attach-to"))
-              .item(0)
-              .toElement();
-    if (!attach.isNull())
-        d->attachToId = attach.attribute(QStringLiteral("id"));
-    auto attachedSources = childElementsByTagNameNS(root, StatelessFileSharing::NS, QStringLiteral("sources"));
-    for (int i = 0; i < attachedSources.size(); ++i) {
-        StatelessFileSharing::Sources sources(attachedSources.at(i).toElement());
-        if (sources.isValid())
-            d->attachedFileSources.append(sources);
-    }
-
-    // XEP-0358 direct publication. If an old sender omitted the required from
-    // attribute, use the stanza sender as the session owner.
-    auto publications = childElementsByTagNameNS(root, Jingle::JINGLEPUB_NS, QStringLiteral("jinglepub"));
-    for (int i = 0; i < publications.size(); ++i) {
-        auto element = publications.at(i).toElement();
-        if (!element.hasAttribute(QStringLiteral("from")) && d->from.isValid())
-            element.setAttribute(QStringLiteral("from"), d->from.full());
-        Jingle::JinglePub publication(element);
-        if (publication.isValid())
-            d->jinglePublications.append(publication);
-    }
-
-    // XEP-0444 message reactions
-    auto reactions
-        = childElementsByTagNameNS(root, "urn:xmpp:reactions:0", QStringLiteral("reactions")).item(0).toElement();
-    if (!reactions.isNull()) {
-        d->reactions.targetId = reactions.attribute(QLatin1String("id"));
-        if (!d->reactions.targetId.isEmpty()) {
-            auto reactionTag = QStringLiteral("reaction");
-            auto reaction    = reactions.firstChildElement(reactionTag);
-            while (!reaction.isNull()) {
-                d->reactions.reactions.insert(reaction.text().trimmed());
-                reaction = reaction.nextSiblingElement(reactionTag);
-            }
-            d->reactions.reactions.squeeze();
-        }
-    }
-
-    // XEP-0424 message retraction
-    d->retraction = childElementsByTagNameNS(root, "urn:xmpp:message-retract:1", QStringLiteral("retract"))
-                        .item(0)
-                        .toElement()
-                        .attribute(QLatin1String("id"));
+    for (const auto &found : std::as_const(customFound))
+        (*found.first)(*this, found.second);
     return true;
 }
 
@@ -2633,14 +2701,50 @@ ResourceList::ResourceList() : QList<Resource>() { }
 
 ResourceList::~ResourceList() { }
 
-ResourceList::Iterator ResourceList::find(const QString &_find)
+// resource lists are short as a rule, where comparing a few names beats hashing
+static const qsizetype ResourceIndexThreshold = 8;
+
+void ResourceList::rebuildIndex() const
 {
-    for (ResourceList::Iterator it = begin(); it != end(); ++it) {
-        if ((*it).name() == _find)
-            return it;
+    v_index.clear();
+    for (qsizetype i = size() - 1; i >= 0; --i) // the first of duplicates wins
+        v_index.insert(at(i).name(), i);
+    v_indexedSize = size();
+}
+
+qsizetype ResourceList::position(const QString &name) const
+{
+    if (size() <= ResourceIndexThreshold) {
+        for (qsizetype i = 0; i < size(); ++i) {
+            if (at(i).name() == name)
+                return i;
+        }
+        return -1;
+    }
+
+    if (v_indexedSize != size())
+        rebuildIndex();
+    qsizetype pos = v_index.value(name, -1);
+    if (pos >= 0 && at(pos).name() != name) { // changed with a QList method
+        rebuildIndex();
+        pos = v_index.value(name, -1);
+    }
+    if (pos < 0) {
+        // an item replaced in place through the QList base isn't in the index under its new name
+        for (qsizetype i = 0; i < size(); ++i) {
+            if (at(i).name() == name) {
+                v_indexedSize = -1;
+                return i;
+            }
+        }
     }
+    return pos;
+}
 
-    return end();
+ResourceList::Iterator ResourceList::find(const QString &_find)
+{
+    qsizetype pos = position(_find);
+    return pos < 0 ? end() : begin() + pos;
 }
 
 ResourceList::Iterator ResourceList::priority()
@@ -2657,12 +2761,8 @@ ResourceList::Iterator ResourceList::priority()
 
 ResourceList::ConstIterator ResourceList::find(const QString &_find) const
 {
-    for (ResourceList::ConstIterator it = begin(); it != end(); ++it) {
-        if ((*it).name() == _find)
-            return it;
-    }
-
-    return end();
+    qsizetype pos = position(_find);
+    return pos < 0 ? end() : begin() + pos;
 }
 
 ResourceList::ConstIterator ResourceList::priority() const
@@ -2677,6 +2777,37 @@ ResourceList::ConstIterator ResourceList::priority() const
     return highest;
 }
 
+void ResourceList::append(const Resource &r)
+{
+    QList<Resource>::append(r);
+    if (v_indexedSize == size() - 1) {
+        if (!v_index.contains(r.name()))
+            v_index.insert(r.name(), size() - 1);
+        v_indexedSize = size();
+    }
+}
+
+ResourceList &ResourceList::operator+=(const Resource &r)
+{
+    append(r);
+    return *this;
+}
+
+ResourceList::Iterator ResourceList::erase(ResourceList::Iterator it)
+{
+    v_indexedSize = -1;
+    return QList<Resource>::erase(it);
+}
+
+void ResourceList::removeAt(qsizetype i) { erase(begin() + i); }
+
+void ResourceList::clear()
+{
+    QList<Resource>::clear();
+    v_index.clear();
+    v_indexedSize = 0;
+}
+
 //---------------------------------------------------------------------------
 // RosterItem
 //---------------------------------------------------------------------------
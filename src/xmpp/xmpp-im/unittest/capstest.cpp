@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-im/xmpp_caps.h"
+#include "xmpp/xmpp-im/xmpp_discoitem.h"
+#include "xmpp/xmpp-im/xmpp_features.h"
+
+#include <QFile>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static DiscoItem makeDisco(const QStringList &features)
+{
+    DiscoItem item;
+    item.setIdentities(DiscoItem::Identity("client", "pc", QString(), "Test"));
+    item.setFeatures(features);
+    return item;
+}
+
+class CapsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testFeatureKeys()
+    {
+        Features f(QStringList { "urn:xmpp:jingle:1", "jabber:iq:version" });
+        QVERIFY(f.test(Features::Key("urn:xmpp:jingle:1")));
+        QVERIFY(f.test(Features::Key(QStringLiteral("jabber:iq:version"))));
+        QVERIFY(!f.test(Features::Key("urn:xmpp:caps:test-never-seen")));
+        QVERIFY(f.hasVersion());
+        QVERIFY(!f.hasVCard());
+
+        Features other;
+        other << "vcard-temp";
+        f += other;
+        QVERIFY(f.hasVCard());
+        f.addFeature("http://jabber.org/protocol/muc");
+        QVERIFY(f.hasGroupchat());
+        f.setList(QStringList { "vcard-temp" });
+        QVERIFY(!f.hasVersion());
+        QVERIFY(f.hasVCard());
+    }
+
+    void testRegistryIds()
+    {
+        CapsRegistry registry;
+        CapsSpec     spec("https://psi-im.org", QCryptographicHash::Sha1, "abc=");
+        int          id = registry.capsId(spec.flatten());
+        QCOMPARE(registry.capsId(spec.flatten()), id);
+        QVERIFY(registry.capsId("https://other.org#xyz=") != id);
+        QVERIFY(!registry.isRegistered(id));
+        QVERIFY(registry.features(id).isEmpty());
+
+        registry.registerCaps(spec, makeDisco({ "urn:xmpp:jingle:1", "urn:xmpp:receipts" }));
+        QVERIFY(registry.isRegistered(id));
+        QVERIFY(registry.features(id).test(Features::Key("urn:xmpp:receipts")));
+        QCOMPARE(registry.disco(id).identities().value(0).name, QString("Test"));
+
+        // registered before the id was asked for
+        CapsSpec spec2("https://psi-im.org", QCryptographicHash::Sha1, "def=");
+        registry.registerCaps(spec2, makeDisco({ "urn:xmpp:jingle:1" }));
+        QVERIFY(registry.isRegistered(registry.capsId(spec2.flatten())));
+        QVERIFY(!registry.isRegistered(-1));
+    }
+
+    void testStorageFile()
+    {
+        QTemporaryDir dir;
+        QString       fileName = dir.filePath("caps.bin");
+        CapsSpec      spec("https://psi-im.org", QCryptographicHash::Sha1, "abc=");
+        {
+            XData form;
+            form.setType(XData::Data_Result);
+            form.setRegistrarType("urn:xmpp:dataforms:softwareinfo");
+            DiscoItem item = makeDisco({ "urn:xmpp:jingle:1", "urn:xmpp:receipts" });
+            item.setExtensions({ form });
+
+            CapsRegistry registry;
+            QVERIFY(registry.setStorageFile(fileName));
+            registry.registerCaps(spec, item);
+        }
+
+        CapsRegistry registry;
+        QVERIFY(registry.setStorageFile(fileName));
+        QVERIFY(registry.isRegistered(spec.flatten()));
+        DiscoItem item = registry.disco(spec.flatten());
+        QCOMPARE(item.identities().value(0).name, QString("Test"));
+        QVERIFY(item.features().test(Features::Key("urn:xmpp:receipts")));
+        QCOMPARE(item.registeredExtension("urn:xmpp:dataforms:softwareinfo").type(), XData::Data_Result);
+        QVERIFY(registry.features(registry.capsId(spec.flatten())).test(Features::Key("urn:xmpp:jingle:1")));
+    }
+
+    void testStorageFileTornTail()
+    {
+        QTemporaryDir dir;
+        QString       fileName = dir.filePath("caps.bin");
+        CapsSpec      spec("https://psi-im.org", QCryptographicHash::Sha1, "abc=");
+        CapsSpec      spec2("https://psi-im.org", QCryptographicHash::Sha1, "def=");
+        {
+            CapsRegistry registry;
+            QVERIFY(registry.setStorageFile(fileName));
+            registry.registerCaps(spec, makeDisco({ "urn:xmpp:jingle:1" }));
+            registry.registerCaps(spec2, makeDisco({ "urn:xmpp:receipts" }));
+        }
+        QFile f(fileName);
+        QVERIFY(f.open(QIODevice::ReadWrite));
+        qint64 size = f.size();
+        QVERIFY(f.resize(size - 3));
+        f.close();
+
+        {
+            CapsRegistry registry;
+            QVERIFY(registry.setStorageFile(fileName));
+            QVERIFY(registry.isRegistered(spec.flatten()));
+            QVERIFY(!registry.isRegistered(spec2.flatten()));
+            registry.registerCaps(spec2, makeDisco({ "urn:xmpp:receipts" }));
+        }
+
+        CapsRegistry registry;
+        QVERIFY(registry.setStorageFile(fileName));
+        QVERIFY(registry.disco(spec2.flatten()).features().test(Features::Key("urn:xmpp:receipts")));
+    }
+
+    void testFeatureFlood()
+    {
+        // a peer making up features can't grow the dictionary past its cap
+        QStringList flood;
+        for (int i = 0; i < 5000; ++i)
+            flood += QString("urn:xmpp:flood:%1").arg(i);
+        flood += "urn:xmpp:jingle:1";
+        Features f(flood);
+        QVERIFY(f.test(Features::Key("urn:xmpp:flood:0")));
+        QVERIFY(f.test(Features::Key("urn:xmpp:flood:4999")));
+        QVERIFY(f.test(Features::Key("urn:xmpp:jingle:1")));
+        QVERIFY(!f.test(Features::Key("urn:xmpp:flood:5000")));
+
+        Features g(QStringList { "urn:xmpp:flood:4999" });
+        QVERIFY(g.test(Features::Key("urn:xmpp:flood:4999")));
+        QVERIFY(!g.test(Features::Key("urn:xmpp:flood:0")));
+    }
+
+    void benchmarkFeatureTest()
+    {
+        QStringList list;
+        for (int i = 0; i < 60; ++i)
+            list += QString("urn:xmpp:feature:%1").arg(i);
+        Features f(list);
+
+        static const Features::Key key("urn:xmpp:feature:42");
+        int                        hits = 0;
+        QBENCHMARK
+        {
+            for (int i = 0; i < 100000; ++i)
+                hits += f.test(key);
+        }
+        QVERIFY(hits > 0);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(CapsTest);
+#include "capstest.moc"
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-im/jingle-ft-sender_p.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <QtTest/QtTest>
+
+using namespace XMPP::Jingle;
+using namespace XMPP::Jingle::FileTransfer;
+
+// Loopback link: whatever is queued gets delivered one round trip later. That's how
+// the transports look to the sender: bytesWritten comes when the data left their buffers.
+class LoopbackConnection : public Connection {
+    Q_OBJECT
+public:
+    LoopbackConnection(size_t blockSize, int rttMs, bool messageOriented) :
+        _blockSize(blockSize), _rttMs(rttMs), _messageOriented(messageOriented)
+    {
+        setOpenMode(QIODevice::ReadWrite);
+    }
+
+    size_t            blockSize() const override { return _blockSize; }
+    TransportFeatures features() const override
+    {
+        return TransportFeature::Reliable | TransportFeature::Ordered | TransportFeature::DataOriented
+            | (_messageOriented ? TransportFeature::MessageOriented : TransportFeature::StreamOriented);
+    }
+
+    bool writeDatagram(const QNetworkDatagram &dg) override
+    {
+        queue(dg.data());
+        return true;
+    }
+
+    QByteArray received;
+
+protected:
+    qint64 writeData(const char *data, qint64 size) override
+    {
+        queue(QByteArray(data, int(size)));
+        return size;
+    }
+    qint64 readDataInternal(char *, qint64) override { return 0; }
+
+private:
+    void queue(const QByteArray &data)
+    {
+        appendWrite(data);
+        if (!_inFlight) {
+            _inFlight = true;
+            QTimer::singleShot(_rttMs, this, [this]() {
+                _inFlight    = false;
+                QByteArray d = takeWrite();
+                received += d;
+                emit bytesWritten(d.size());
+            });
+        }
+    }
+
+    size_t _blockSize;
+    int    _rttMs;
+    bool   _messageOriented;
+    bool   _inFlight = false;
+};
+
+// Like the ICE/SCTP datachannel: bytesToWrite() is always 0 and bytesWritten comes when the test says so
+class UnaccountedConnection : public Connection {
+    Q_OBJECT
+public:
+    UnaccountedConnection() { setOpenMode(QIODevice::ReadWrite); }
+
+    size_t            blockSize() const override { return 1024; }
+    qint64            bytesToWrite() const override { return 0; }
+    TransportFeatures features() const override
+    {
+        return TransportFeature::Reliable | TransportFeature::Ordered | TransportFeature::DataOriented
+            | TransportFeature::StreamOriented;
+    }
+
+    void acknowledge(qint64 bytes) { emit bytesWritten(bytes); }
+
+    qint64 written = 0;
+
+protected:
+    qint64 writeData(const char *, qint64 size) override
+    {
+        written += size;
+        return size;
+    }
+    qint64 readDataInternal(char *, qint64) override { return 0; }
+};
+
+class JingleFTSenderTest : public QObject {
+    Q_OBJECT
+
+    static QByteArray payload(int size)
+    {
+        QByteArray data(size, Qt::Uninitialized);
+        for (int i = 0; i < size; ++i)
+            data[i] = char(i * 7 + (i >> 8));
+        return data;
+    }
+
+private slots:
+    void testSizedSource()
+    {
+        QByteArray source = payload(100000);
+        QBuffer    buf(&source);
+        buf.open(QIODevice::ReadOnly);
+        buf.seek(1000);
+
+        auto        conn = QSharedPointer<LoopbackConnection>::create(4096, 1, false);
+        BlockSender sender(&buf, conn, quint64(50000));
+        QSignalSpy  finished(&sender, &BlockSender::finished);
+        sender.start();
+        QVERIFY(finished.wait());
+        QTRY_COMPARE(conn->received, source.mid(1000, 50000));
+        QCOMPARE(sender.bytesSent(), quint64(50000));
+    }
+
+    void testShortSource()
+    {
+        QByteArray source = payload(1000);
+        QBuffer    buf(&source);
+        buf.open(QIODevice::ReadOnly);
+
+        auto        conn = QSharedPointer<LoopbackConnection>::create(4096, 1, false);
+        BlockSender sender(&buf, conn, quint64(5000));
+        QSignalSpy  failed(&sender, &BlockSender::failed);
+        sender.start();
+        QVERIFY(failed.count() || failed.wait());
+    }
+
+    void testUnaccountedTransport()
+    {
+        QByteArray source = payload(100000);
+        QBuffer    buf(&source);
+        buf.open(QIODevice::ReadOnly);
+
+        auto        conn = QSharedPointer<UnaccountedConnection>::create();
+        BlockSender sender(&buf, conn, quint64(source.size()));
+        sender.setWindow(4, 0);
+        sender.start();
+        QCOMPARE(conn->written, qint64(4096));
+
+        // every acknowledged block lets exactly one more out, not another window
+        for (int i = 1; i <= 3; ++i) {
+            conn->acknowledge(1024);
+            QCoreApplication::processEvents();
+            QCoreApplication::processEvents();
+            QCOMPARE(conn->written, qint64(4096 + i * 1024));
+        }
+        QCoreApplication::processEvents();
+        QCOMPARE(conn->written, qint64(4096 + 3 * 1024));
+    }
+
+    void benchmarkThroughput_data()
+    {
+        QTest::addColumn<int>("blockSize");
+        QTest::addColumn<bool>("messageOriented");
+        QTest::addColumn<int>("window");
+
+        // block sizes are the defaults of the transports
+        QTest::newRow("IBB, 1 block") << 4096 << false << 1;
+        QTest::newRow("IBB, default window") << 4096 << false << 16;
+        QTest::newRow("S5B, 1 block") << 8192 << false << 1;
+        QTest::newRow("S5B, default window") << 8192 << false << 16;
+        QTest::newRow("SCTP, 1 block") << 16384 << true << 1;
+        QTest::newRow("SCTP, default window") << 16384 << true << 16;
+    }
+
+    void benchmarkThroughput()
+    {
+        QFETCH(int, blockSize);
+        QFETCH(bool, messageOriented);
+        QFETCH(int, window);
+
+        const int  size   = 2 * 1024 * 1024;
+        QByteArray source = payload(size);
+        QBuffer    buf(&source);
+        buf.open(QIODevice::ReadOnly);
+
+        auto        conn = QSharedPointer<LoopbackConnection>::create(size_t(blockSize), 2, messageOriented);
+        BlockSender sender(&buf, conn, quint64(size));
+        sender.setWindow(window, 0);
+        QSignalSpy finished(&sender, &BlockSender::finished);
+
+        QElapsedTimer timer;
+        timer.start();
+        sender.start();
+        QVERIFY(finished.wait(60000));
+        QTRY_COMPARE_WITH_TIMEOUT(conn->received.size(), source.size(), 10000);
+        qint64 ms = qMax(timer.elapsed(), qint64(1));
+        qInfo("%s: %.1f MB/s", QTest::currentDataTag(), double(size) / 1048576.0 / (double(ms) / 1000.0));
+        QCOMPARE(conn->received, source);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(JingleFTSenderTest);
+#include "jingleftsendertest.moc"
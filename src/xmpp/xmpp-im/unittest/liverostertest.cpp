@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/jid/jid.h"
+#include "xmpp/xmpp-im/xmpp_liveroster.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static LiveRoster makeRoster(int contacts)
+{
+    LiveRoster roster;
+    for (int i = 0; i < contacts; ++i)
+        roster += LiveRosterItem(Jid(QString("user%1@example.com").arg(i)));
+    return roster;
+}
+
+// what Client::ppPresence does for an available presence of a contact
+static void applyPresence(LiveRoster &roster, const Jid &j, const Status &s)
+{
+    const auto positions = roster.findAll(j, false);
+    for (qsizetype pos : positions) {
+        ResourceList &rl  = roster[pos].resourceList();
+        auto          rit = rl.find(j.resource());
+        if (rit == rl.end())
+            rl += Resource(j.resource(), s);
+        else
+            (*rit).setStatus(s);
+    }
+}
+
+class LiveRosterTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testFind()
+    {
+        LiveRoster roster = makeRoster(100);
+        roster += LiveRosterItem(Jid("user5@example.com/desk"));
+
+        QCOMPARE(roster.find(Jid("user42@example.com"))->jid().full(), QString("user42@example.com"));
+        QVERIFY(roster.find(Jid("user42@example.com/res")) == roster.end());
+        QCOMPARE(roster.find(Jid("user42@example.com/res"), false)->jid().full(), QString("user42@example.com"));
+        QCOMPARE(roster.find(Jid("user5@example.com/desk"))->jid().full(), QString("user5@example.com/desk"));
+        QCOMPARE(roster.findAll(Jid("user5@example.com"), false), QList<qsizetype>({ 5, 100 }));
+        QVERIFY(roster.find(Jid("nobody@example.com")) == roster.end());
+    }
+
+    void testIndexFollowsChanges()
+    {
+        LiveRoster roster = makeRoster(10);
+        roster.erase(roster.find(Jid("user3@example.com")));
+        QVERIFY(roster.find(Jid("user3@example.com")) == roster.end());
+        QCOMPARE(roster.find(Jid("user4@example.com")) - roster.begin(), 3);
+
+        roster.removeAt(roster.size() - 1);
+        QVERIFY(roster.find(Jid("user9@example.com")) == roster.end());
+
+        // changed through the QList base, the index has to notice
+        roster.QList<LiveRosterItem>::append(LiveRosterItem(Jid("late@example.com")));
+        QCOMPARE(roster.find(Jid("late@example.com"))->jid().full(), QString("late@example.com"));
+        roster.QList<LiveRosterItem>::removeFirst();
+        QCOMPARE(roster.find(Jid("user1@example.com")) - roster.begin(), 0);
+
+        // replaced in place, nothing about the size tells
+        roster[2] = LiveRosterItem(Jid("swapped@example.com"));
+        QCOMPARE(roster.find(Jid("swapped@example.com")) - roster.begin(), 2);
+        QVERIFY(roster.find(Jid("user4@example.com")) == roster.end());
+        roster.replace(4, LiveRosterItem(Jid("replaced@example.com")));
+        QCOMPARE(roster.findAll(Jid("replaced@example.com")), QList<qsizetype>({ 4 }));
+
+        LiveRoster copy = roster;
+        copy.clear();
+        QVERIFY(copy.find(Jid("user1@example.com")) == copy.end());
+        QVERIFY(roster.find(Jid("user1@example.com")) != roster.end());
+    }
+
+    void testResourceList()
+    {
+        ResourceList rl;
+        for (int i = 0; i < 20; ++i)
+            rl += Resource(QString("r%1").arg(i));
+        QCOMPARE(rl.find("r17") - rl.begin(), 17);
+        rl.erase(rl.find("r2"));
+        QCOMPARE(rl.find("r17") - rl.begin(), 16);
+        QVERIFY(rl.find("r2") == rl.end());
+        rl[5] = Resource("swapped");
+        QCOMPARE(rl.find("swapped") - rl.begin(), 5);
+        rl.replace(6, Resource("replaced"));
+        QCOMPARE(rl.find("replaced") - rl.begin(), 6);
+        rl.clear();
+        QVERIFY(rl.find("r17") == rl.end());
+    }
+
+    // initial presence burst after login: every contact comes online with two resources
+    void benchmarkPresenceBurst()
+    {
+        const int  contacts = 20000;
+        LiveRoster roster   = makeRoster(contacts);
+
+        QList<Jid> from;
+        from.reserve(contacts * 2);
+        for (int i = 0; i < contacts; ++i) {
+            from += Jid(QString("user%1@example.com/phone").arg(i));
+            from += Jid(QString("user%1@example.com/desktop").arg(i));
+        }
+        Status s(Status::Away, "brb");
+
+        QBENCHMARK
+        {
+            for (const Jid &j : std::as_const(from))
+                applyPresence(roster, j, s);
+        }
+        QCOMPARE(roster.find(Jid("user19999@example.com"))->resourceList().size(), 2);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(LiveRosterTest);
+#include "liverostertest.moc"
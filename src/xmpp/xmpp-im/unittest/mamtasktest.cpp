@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/xmpp.h"
+#include "xmpp/xmpp-im/xmpp_client.h"
+#include "xmpp/xmpp-im/xmpp_mamtask.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static const QLatin1String rsmNS("http://jabber.org/protocol/rsm");
+
+// never connects, so the stream takes the stanzas and drops them
+class NullConnector : public Connector {
+public:
+    void        setOptHostPort(const QString &, quint16) override { }
+    void        connectToServer(const QString &) override { }
+    ByteStream *stream() const override { return nullptr; }
+    void        done() override { }
+};
+
+// a page request as MAMTask sent it
+class Request {
+public:
+    QString id;
+    QString queryId;
+    QString start; // of the window
+    QString after; // RSM cursor
+};
+
+class MAMTaskTest : public QObject {
+    Q_OBJECT
+
+    NullConnector   connector;
+    ClientStream    stream { &connector };
+    Client          client;
+    QList<Request>  sent;
+    const QDateTime from = QDateTime::fromString("2026-03-01T00:00:00Z", Qt::ISODate);
+    const QDateTime to   = from.addSecs(2 * 3600);
+
+    MAMTask *makeTask(int parallel, int maxMessages = 0)
+    {
+        auto task = new MAMTask(client.rootTask());
+        task->get(Jid("juliet@capulet.lit"), from, to, true, 2, maxMessages, true, false);
+        task->setStreaming(true);
+        task->setParallel(parallel);
+        return task;
+    }
+
+    // the results of a page and then the end of it
+    void reply(MAMTask *task, const Request &r, const QStringList &ids, bool complete)
+    {
+        QDomDocument *doc = client.doc();
+        for (const auto &id : ids) {
+            QDomElement m      = doc->createElement("message");
+            QDomElement result = doc->createElementNS(XMPP_MAM_NAMESPACE, "result");
+            result.setAttribute("queryid", r.queryId);
+            result.setAttribute("id", id);
+            m.appendChild(result);
+            QVERIFY(task->take(m));
+        }
+
+        QDomElement iq = doc->createElement("iq");
+        iq.setAttribute("type", "result");
+        iq.setAttribute("id", r.id);
+        QDomElement fin = doc->createElementNS(XMPP_MAM_NAMESPACE, "fin");
+        if (complete)
+            fin.setAttribute("complete", "true");
+        if (!ids.isEmpty()) {
+            QDomElement set = doc->createElementNS(rsmNS, "set");
+            set.appendChild(XMLHelper::textTagNS(doc, rsmNS, "first", ids.first()));
+            set.appendChild(XMLHelper::textTagNS(doc, rsmNS, "last", ids.last()));
+            fin.appendChild(set);
+        }
+        iq.appendChild(fin);
+        QVERIFY(task->take(iq));
+    }
+
+    static QStringList ids(const QList<QDomElement> &results)
+    {
+        QStringList out;
+        for (const auto &r : results)
+            out += r.attribute("id");
+        return out;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        client.connectToServer(&stream, Jid("romeo@montague.lit/orchard"));
+        connect(&client, &Client::stanzaElementOutgoing, this, [this](QDomElement &iq) {
+            QDomElement query = iq.firstChildElement("query");
+            Request     r { iq.attribute("id"), query.attribute("queryid"), {}, {} };
+            for (auto f = query.firstChildElement("x").firstChildElement("field"); !f.isNull();
+                 f = f.nextSiblingElement("field")) {
+                if (f.attribute("var") == "start")
+                    r.start = f.firstChildElement("value").text();
+            }
+            r.after = query.firstChildElement("set").firstChildElement("after").text();
+            sent += r;
+        });
+    }
+
+    void init() { sent.clear(); }
+
+    void testInOrder()
+    {
+        auto        task = makeTask(2);
+        QStringList got;
+        connect(task, &MAMTask::resultsReady, this, [&got](const QList<QDomElement> &results) { got += ids(results); });
+        task->go();
+        QCOMPARE(sent.size(), 2);
+        QCOMPARE(sent[0].start, from.toString(Qt::ISODateWithMs));
+
+        // the later window is done first and waits
+        reply(task, sent[1], { "c", "d" }, true);
+        QVERIFY(got.isEmpty());
+        QVERIFY(!task->success());
+        reply(task, sent[0], { "a", "b" }, true);
+        QCOMPARE(got, QStringList({ "a", "b", "c", "d" }));
+        QVERIFY(task->success());
+    }
+
+    void testPauseResume()
+    {
+        auto        task = makeTask(1);
+        QStringList got;
+        connect(task, &MAMTask::resultsReady, this, [&got, task](const QList<QDomElement> &results) {
+            got += ids(results);
+            task->pause();
+            if (got.size() > 2)
+                task->resume(); // goes on when the handler returns
+        });
+        task->go();
+        QCOMPARE(sent.size(), 1);
+
+        reply(task, sent[0], { "a", "b" }, false);
+        QCOMPARE(got, QStringList({ "a", "b" }));
+        QCOMPARE(sent.size(), 1);
+        task->resume();
+        QCOMPARE(sent.size(), 2);
+        QCOMPARE(sent[1].after, QString("b"));
+
+        reply(task, sent[1], { "c", "d" }, false);
+        QCOMPARE(sent.size(), 3);
+        reply(task, sent[2], { "e" }, true);
+        QCOMPARE(got, QStringList({ "a", "b", "c", "d", "e" }));
+        QVERIFY(task->success());
+    }
+
+    void testBufferedPages()
+    {
+        auto        task = makeTask(2);
+        QStringList got;
+        connect(task, &MAMTask::resultsReady, this, [&got](const QList<QDomElement> &results) { got += ids(results); });
+        task->go();
+        QCOMPARE(sent.size(), 2);
+
+        // the second window runs ahead while the first one doesn't answer
+        QStringList later;
+        for (int page = 0; page < 4; ++page) {
+            QStringList pageIds { QString("w%1a").arg(page), QString("w%1b").arg(page) };
+            reply(task, sent.last(), pageIds, false);
+            later += pageIds;
+        }
+        QCOMPARE(sent.size(), 5);
+        QVERIFY(got.isEmpty());
+
+        reply(task, sent[0], { "a" }, true);
+        QCOMPARE(got, QStringList({ "a" }) + later);
+        QCOMPARE(sent.size(), 6);
+        QCOMPARE(sent.last().after, QString("w3b"));
+        reply(task, sent.last(), { "z" }, true);
+        QVERIFY(task->success());
+    }
+
+    void testCheckpoint()
+    {
+        auto       task = makeTask(1);
+        QByteArray checkpoint;
+        connect(task, &MAMTask::checkpointChanged, this, [&checkpoint, task]() {
+            checkpoint = task->exportCheckpoint();
+        });
+        task->go();
+        reply(task, sent[0], { "a", "b" }, false);
+        QVERIFY(!checkpoint.isEmpty());
+        delete task; // interrupted with the next page in flight
+
+        task = makeTask(1);
+        QVERIFY(task->importCheckpoint(checkpoint));
+        QStringList got;
+        connect(task, &MAMTask::resultsReady, this, [&got](const QList<QDomElement> &results) { got += ids(results); });
+        task->go();
+        QCOMPARE(sent.size(), 3);
+        QCOMPARE(sent[2].after, QString("b"));
+        reply(task, sent[2], { "c" }, true);
+        QCOMPARE(got, QStringList({ "c" }));
+        QVERIFY(task->success());
+    }
+
+    void testMaxMessages()
+    {
+        auto task = makeTask(2, 3);
+        task->setStreaming(false);
+        task->go();
+        reply(task, sent[1], { "c", "d" }, true);
+        reply(task, sent[0], { "a", "b" }, true);
+        QVERIFY(task->success());
+        QCOMPARE(ids(task->archive()), QStringList({ "a", "b", "c" }));
+    }
+
+    void testError()
+    {
+        for (const auto &condition : { QString(), QString("item-not-found") }) {
+            auto task = makeTask(1);
+            task->go();
+            QDomElement iq = client.doc()->createElement("iq");
+            iq.setAttribute("type", "error");
+            iq.setAttribute("id", sent.last().id);
+            if (!condition.isEmpty()) {
+                QDomElement error = client.doc()->createElement("error");
+                error.setAttribute("type", "cancel");
+                error.appendChild(client.doc()->createElementNS("urn:ietf:params:xml:ns:xmpp-stanzas", condition));
+                iq.appendChild(error);
+            }
+            QVERIFY(task->take(iq));
+            QVERIFY(!task->success());
+            QCOMPARE(task->statusCode(), condition.isEmpty() ? 1 : 2);
+        }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(MAMTaskTest);
+#include "mamtasktest.moc"
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/xmpp_stream.h"
+#include "xmpp/xmpp-im/xmpp_message.h"
+#include "xmpp/xmpp-im/xmpp_pubsubevent.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+// messages the way clients and servers send them nowadays
+static const QStringList corpus {
+    // chat message through a server with MAM
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' type='chat' id='m1'>"
+    "<body>Wherefore art thou, Romeo?</body><active xmlns='http://jabber.org/protocol/chatstates'/>"
+    "<request xmlns='urn:xmpp:receipts'/><markable xmlns='urn:xmpp:chat-markers:0'/>"
+    "<origin-id xmlns='urn:xmpp:sid:0' id='o1'/><stanza-id xmlns='urn:xmpp:sid:0' id='s1' by='romeo@montague.lit'/>"
+    "</message>",
+
+    // typing
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' type='chat' id='m2'>"
+    "<composing xmlns='http://jabber.org/protocol/chatstates'/><no-store xmlns='urn:xmpp:hints'/></message>",
+
+    // delivery receipt
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' id='m3'>"
+    "<received xmlns='urn:xmpp:receipts' id='m1'/><store xmlns='urn:xmpp:hints'/></message>",
+
+    // groupchat history
+    "<message xmlns='jabber:client' from='coven@chat.shakespeare.lit/thirdwitch' to='hecate@shakespeare.lit/broom' "
+    "type='groupchat' id='m4'><body>Thrice the brinded cat hath mew'd.</body>"
+    "<delay xmlns='urn:xmpp:delay' from='coven@chat.shakespeare.lit' stamp='2026-03-01T10:00:00Z'/>"
+    "<stanza-id xmlns='urn:xmpp:sid:0' id='s4' by='coven@chat.shakespeare.lit'/>"
+    "<occupant-id xmlns='urn:xmpp:occupant-id:0' id='dd72603deec90a38ba552f7c68cbcc61bca202cd'/></message>",
+
+    // OMEMO
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' type='chat' id='m5'>"
+    "<encrypted xmlns='eu.siacs.conversations.axolotl'><header sid='27183'><key rid='31415'>BASE64ENCODED</key>"
+    "<iv>BASE64ENCODED</iv></header><payload>BASE64ENCODED</payload></encrypted>"
+    "<encryption xmlns='urn:xmpp:eme:0' namespace='eu.siacs.conversations.axolotl' name='OMEMO'/>"
+    "<body>I sent you an OMEMO encrypted message but your client doesn't seem to support that.</body>"
+    "<store xmlns='urn:xmpp:hints'/></message>",
+
+    // PEP
+    "<message xmlns='jabber:client' from='juliet@capulet.lit' to='romeo@montague.lit/orchard' type='headline' "
+    "id='m6'><event xmlns='http://jabber.org/protocol/pubsub#event'><items node='urn:xmpp:avatar:metadata'>"
+    "<item id='111f4b3c50d7b0df729d299bc6f8e9ef9066971f'><metadata xmlns='urn:xmpp:avatar:metadata'>"
+    "<info bytes='12345' height='64' id='111f4b3c50d7b0df729d299bc6f8e9ef9066971f' type='image/png' width='64'/>"
+    "</metadata></item></items></event></message>",
+
+    // correction
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' type='chat' id='m7'>"
+    "<body>But soft, what light through yonder window breaks?</body>"
+    "<replace xmlns='urn:xmpp:message-correct:0' id='m1'/><origin-id xmlns='urn:xmpp:sid:0' id='o7'/></message>",
+
+    // reaction
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' type='chat' id='m8'>"
+    "<reactions xmlns='urn:xmpp:reactions:0' id='m7'><reaction>\xF0\x9F\x91\x8B</reaction>"
+    "<reaction>\xF0\x9F\x90\xA2</reaction></reactions><store xmlns='urn:xmpp:hints'/></message>",
+
+    // file upload
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' type='chat' id='m9'>"
+    "<body>https://upload.capulet.lit/4a771ac1/tr%C3%A8s%20cool.jpg</body><x xmlns='jabber:x:oob'>"
+    "<url>https://upload.capulet.lit/4a771ac1/tr%C3%A8s%20cool.jpg</url></x>"
+    "<request xmlns='urn:xmpp:receipts'/><active xmlns='http://jabber.org/protocol/chatstates'/></message>",
+
+    // mediated MUC invitation
+    "<message xmlns='jabber:client' from='coven@chat.shakespeare.lit' to='hecate@shakespeare.lit' id='m10'>"
+    "<x xmlns='http://jabber.org/protocol/muc#user'><invite from='crone1@shakespeare.lit/desktop'>"
+    "<reason>Hey Hecate, this is the place for all good witches!</reason></invite>"
+    "<password>cauldronburn</password></x><x xmlns='jabber:x:conference' jid='coven@chat.shakespeare.lit'/>"
+    "</message>",
+
+    // xhtml-im
+    "<message xmlns='jabber:client' from='juliet@capulet.lit/balcony' to='romeo@montague.lit' type='chat' id='m11'>"
+    "<body>Wow, I'm green with envy!</body><html xmlns='http://jabber.org/protocol/xhtml-im'>"
+    "<body xmlns='http://www.w3.org/1999/xhtml'><p style='font-size:large'><em>Wow</em>, I'm "
+    "<span style='color:green'>green</span> with <strong>envy</strong>!</p></body></html></message>",
+};
+
+class CorpusStream : public Stream {
+public:
+    mutable QDomDocument document;
+
+    QDomDocument &doc() const override { return document; }
+    QString       baseNS() const override { return QStringLiteral("jabber:client"); }
+    bool          old() const override { return false; }
+
+    void   close() override { }
+    bool   stanzaAvailable() const override { return false; }
+    Stanza read() override { return Stanza(); }
+    void   write(const Stanza &) override { }
+
+    int                     errorCondition() const override { return 0; }
+    QString                 errorText() const override { return QString(); }
+    QHash<QString, QString> errorLangText() const override { return {}; }
+    QDomElement             errorAppSpec() const override { return QDomElement(); }
+};
+
+class MessageParserTest : public QObject {
+    Q_OBJECT
+
+    CorpusStream  stream;
+    QList<Stanza> stanzas;
+
+    Message parse(int index, const QSet<QString> &extensions = {})
+    {
+        Message m;
+        if (!m.fromStanza(stanzas.value(index), extensions))
+            return Message();
+        return m;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        for (const auto &xml : corpus) {
+            QDomDocument doc;
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+            QVERIFY(doc.setContent(xml, true));
+#else
+            QVERIFY(doc.setContent(xml, QDomDocument::ParseOption::UseNamespaceProcessing));
+#endif
+            stanzas += stream.createStanza(stream.doc().importNode(doc.documentElement(), true).toElement());
+            QCOMPARE(stanzas.last().kind(), Stanza::Message);
+        }
+    }
+
+    void testCorpus()
+    {
+        Message m = parse(0);
+        QCOMPARE(m.body(), QString("Wherefore art thou, Romeo?"));
+        QCOMPARE(m.chatState(), StateActive);
+        QCOMPARE(m.messageReceipt(), ReceiptRequest);
+        QCOMPARE(m.originId(), QString("o1"));
+        QCOMPARE(m.stanzaId().id, QString("s1"));
+        QVERIFY(!m.spooled());
+
+        m = parse(1);
+        QVERIFY(m.body().isEmpty());
+        QCOMPARE(m.chatState(), StateComposing);
+        QCOMPARE(m.processingHints(), Message::ProcessingHints(Message::NoStore));
+
+        m = parse(2);
+        QCOMPARE(m.messageReceipt(), ReceiptReceived);
+        QCOMPARE(m.messageReceiptId(), QString("m1"));
+
+        m = parse(3);
+        QCOMPARE(m.type(), Message::Type::Groupchat);
+        QVERIFY(m.spooled());
+        QCOMPARE(m.timeStamp().toUTC(), QDateTime::fromString("2026-03-01T10:00:00Z", Qt::ISODate));
+        QCOMPARE(m.stanzaId().by.full(), QString("coven@chat.shakespeare.lit"));
+
+        m = parse(5);
+        QCOMPARE(m.pubSubEvents().size(), 1);
+        QCOMPARE(m.pubSubEvents().first().node(), QString("urn:xmpp:avatar:metadata"));
+
+        m = parse(6);
+        QCOMPARE(m.replaceId(), QString("m1"));
+
+        m = parse(7);
+        QCOMPARE(m.reactions().targetId, QString("m7"));
+        QCOMPARE(m.reactions().reactions.size(), 2);
+
+        m = parse(8);
+        QCOMPARE(m.urlList().size(), 1);
+
+        m = parse(9);
+        QVERIFY(m.hasMUCUser());
+        QCOMPARE(m.mucInvites().size(), 1);
+        QCOMPARE(m.mucPassword(), QString("cauldronburn"));
+        QCOMPARE(m.invite(), QString("coven@chat.shakespeare.lit"));
+
+        m = parse(10);
+        QVERIFY(m.containsHTML());
+    }
+
+    void testExtensionFilter()
+    {
+        Message m = parse(0, { "urn:xmpp:receipts" });
+        QCOMPARE(m.body(), QString("Wherefore art thou, Romeo?"));
+        QCOMPARE(m.messageReceipt(), ReceiptRequest);
+        QCOMPARE(m.chatState(), StateNone);
+        QVERIFY(m.originId().isEmpty());
+
+        m = parse(3, { "urn:xmpp:receipts" });
+        QVERIFY(!m.spooled());
+    }
+
+    void testFirstElementWins()
+    {
+        Stanza s = stream.createStanza(Stanza::Message, Jid("romeo@montague.lit"), "chat", "x1");
+        for (const auto &text : { "first", "second" }) {
+            auto e = stream.doc().createElementNS("http://jabber.org/protocol/nick", "nick");
+            e.appendChild(stream.doc().createTextNode(text));
+            s.appendChild(e);
+        }
+        // the original chain of checks let the later of the states win
+        s.appendChild(stream.doc().createElementNS("http://jabber.org/protocol/chatstates", "paused"));
+        s.appendChild(stream.doc().createElementNS("http://jabber.org/protocol/chatstates", "active"));
+
+        Message m;
+        QVERIFY(m.fromStanza(s));
+        QCOMPARE(m.nick(), QString("first"));
+        QCOMPARE(m.chatState(), StatePaused);
+    }
+
+    void testExtensionParser()
+    {
+        Message::registerExtensionParser("urn:xmpp:chat-markers:0", QString(), [](Message &m, const QDomElement &e) {
+            // runs after the built-in ones
+            m.setExtensionData("marker", e.localName() + ":" + m.originId());
+        });
+        Message::registerExtensionParser("urn:xmpp:occupant-id:0", "occupant-id",
+                                         [](Message &m, const QDomElement &e) {
+                                             m.setExtensionData("occupant-id", e.attribute("id"));
+                                         });
+
+        QCOMPARE(parse(0).extensionData("marker").toString(), QString("markable:o1"));
+        QCOMPARE(parse(3).extensionData("occupant-id").toString(),
+                 QString("dd72603deec90a38ba552f7c68cbcc61bca202cd"));
+        QVERIFY(!parse(0, { "urn:xmpp:receipts" }).extensionData("marker").isValid());
+
+        Message::unregisterExtensionParser("urn:xmpp:chat-markers:0");
+        Message::unregisterExtensionParser("urn:xmpp:occupant-id:0", "occupant-id");
+        QVERIFY(!parse(0).extensionData("marker").isValid());
+    }
+
+    void benchmarkCorpus_data()
+    {
+        QTest::addColumn<QStringList>("extensions");
+        QTest::newRow("all") << QStringList();
+        QTest::newRow("receipts-chatstates")
+            << QStringList { "urn:xmpp:receipts", "http://jabber.org/protocol/chatstates" };
+    }
+
+    void benchmarkCorpus()
+    {
+        QFETCH(QStringList, extensions);
+        const QSet<QString> filter(extensions.begin(), extensions.end());
+        QBENCHMARK
+        {
+            for (const auto &s : std::as_const(stanzas)) {
+                Message m;
+                m.fromStanza(s, filter);
+            }
+        }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(MessageParserTest);
+#include "messageparsertest.moc"
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-im/xmpp_omemostorage.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static OmemoStorage::Device makeDevice(int n)
+{
+    OmemoStorage::DeviceProtocolState state;
+    state.keyId                       = QByteArray(33, char(n));
+    state.session                     = QByteArray(2048, char(n + 1));
+    state.unrespondedSentStanzasCount = n;
+    OmemoStorage::Device device;
+    device.protocols.insert(OmemoProtocol::Omemo2, state);
+    return device;
+}
+
+static int sentCount(const std::optional<OmemoStorage::Device> &device)
+{
+    return device ? device->protocols.value(OmemoProtocol::Omemo2).unrespondedSentStanzasCount : -1;
+}
+
+class OmemoStorageTest : public QObject {
+    Q_OBJECT
+
+    QTemporaryDir dir;
+
+    QString logFile(const char *name) const { return dir.filePath(QLatin1String(name)); }
+
+private slots:
+    void testReopen()
+    {
+        const QString fileName = logFile("reopen.log");
+        {
+            FileOmemoStorage storage(fileName);
+            QVERIFY(storage.isOpen());
+            OmemoStorage::OwnDevice own;
+            own.id    = 42;
+            own.label = "desk";
+            QVERIFY(storage.setOwnDevice(own));
+            QVERIFY(storage.addPreKeyPairs({ { 1, "one" }, { 2, "two" } }));
+            QVERIFY(storage.removePreKeyPair(1));
+            QVERIFY(storage.addSignedPreKeyPair(7, { QDateTime::currentDateTimeUtc(), "signed" }));
+            QVERIFY(storage.addDevice("a@example.com", 1, makeDevice(1)));
+            QVERIFY(storage.addDevice("a@example.com", 2, makeDevice(2)));
+            QVERIFY(storage.addDevice("a@example.com", 1, makeDevice(3)));
+            QVERIFY(storage.addDevice("b@example.com", 5, makeDevice(5)));
+            QVERIFY(storage.removeDevice("a@example.com", 2));
+            QVERIFY(storage.removeDevices("b@example.com"));
+        }
+
+        FileOmemoStorage storage(fileName);
+        QVERIFY(storage.isOpen());
+        const auto own = storage.ownData();
+        QCOMPARE(own.ownDevice->id, 42u);
+        QCOMPARE(own.ownDevice->label, QString("desk"));
+        QCOMPARE(own.preKeyPairs.keys(), QList<uint32_t>({ 2 }));
+        QCOMPARE(own.signedPreKeyPairs.value(7).data, QByteArray("signed"));
+        QVERIFY(own.devices.isEmpty());
+        QCOMPARE(storage.deviceOwners(), QStringList({ "a@example.com" }));
+
+        const auto device = storage.device("a@example.com", 1);
+        QVERIFY(device.has_value());
+        const auto state = device->protocols.value(OmemoProtocol::Omemo2);
+        QCOMPARE(state.session, makeDevice(3).protocols.value(OmemoProtocol::Omemo2).session);
+        QCOMPARE(sentCount(device), 3);
+        QVERIFY(!storage.device("a@example.com", 2));
+        QCOMPARE(storage.allData().devices.value("a@example.com").size(), 1);
+    }
+
+    void testTornTail()
+    {
+        const QString fileName = logFile("torn.log");
+        {
+            FileOmemoStorage storage(fileName);
+            QVERIFY(storage.addDevice("a@example.com", 1, makeDevice(1)));
+            QVERIFY(storage.addDevice("a@example.com", 2, makeDevice(2)));
+        }
+        QFile f(fileName);
+        QVERIFY(f.open(QIODevice::ReadWrite));
+        QVERIFY(f.resize(f.size() - 100));
+        f.close();
+
+        FileOmemoStorage storage(fileName);
+        QVERIFY(storage.isOpen());
+        QVERIFY(storage.device("a@example.com", 1).has_value());
+        QVERIFY(!storage.device("a@example.com", 2).has_value());
+        // appends after the cut go where the damaged record was
+        QVERIFY(storage.addDevice("a@example.com", 3, makeDevice(3)));
+        QVERIFY(storage.device("a@example.com", 3).has_value());
+    }
+
+    void testDamagedRecord()
+    {
+        const QString first = logFile("damaged-first.log"), second = logFile("damaged-second.log");
+        {
+            FileOmemoStorage storage(first);
+            QVERIFY(storage.addDevice("a@example.com", 1, makeDevice(1)));
+        }
+        {
+            FileOmemoStorage storage(second);
+            QVERIFY(storage.addPreKeyPairs({ { 3, "three" } }));
+            QVERIFY(storage.addDevice("a@example.com", 2, makeDevice(2)));
+        }
+
+        // a signed pre-key record of the right length, but with a value no date can be read from
+        QByteArray  bad;
+        QDataStream s(&bad, QIODevice::WriteOnly);
+        s.setVersion(QDataStream::Qt_5_12);
+        s << quint8(2) << QString() << quint32(7) << quint32(3);
+        s.writeRawData("bad", 3);
+
+        QFile f(first), g(second);
+        QVERIFY(f.open(QIODevice::Append) && g.open(QIODevice::ReadOnly));
+        QVERIFY(g.seek(8)); // past the magic
+        QVERIFY(f.write(bad) == bad.size());
+        QVERIFY(f.write(g.readAll()) > 0);
+        f.close();
+        const qint64 size = QFileInfo(first).size();
+
+        FileOmemoStorage storage(first);
+        QVERIFY(storage.isOpen());
+        QCOMPARE(QFileInfo(first).size(), size);
+        QVERIFY(storage.ownData().signedPreKeyPairs.isEmpty());
+        QCOMPARE(storage.ownData().preKeyPairs.value(3), QByteArray("three"));
+        QCOMPARE(sentCount(storage.device("a@example.com", 1)), 1);
+        QCOMPARE(sentCount(storage.device("a@example.com", 2)), 2);
+    }
+
+    void testCompaction()
+    {
+        const QString    fileName = logFile("compact.log");
+        FileOmemoStorage storage(fileName);
+        // a chatty session rewrites its ratchet state on every message
+        for (int i = 0; i < 3000; ++i)
+            QVERIFY(storage.addDevice("a@example.com", 1 + i % 3, makeDevice(i)));
+        QVERIFY(QFileInfo(fileName).size() < 1024 * (2048 + 100) * 3);
+        QCOMPARE(sentCount(storage.device("a@example.com", 1)), 2997);
+
+        QVERIFY(storage.compact());
+        QCOMPARE(storage.devices("a@example.com").size(), 3);
+        FileOmemoStorage reopened(fileName);
+        QCOMPARE(sentCount(reopened.device("a@example.com", 3)), 2999);
+    }
+
+    void testPermissions()
+    {
+#ifndef Q_OS_UNIX
+        QSKIP("no owner-only permissions here");
+#endif
+        const QString    fileName = logFile("private.log");
+        const auto       others   = QFileDevice::ReadGroup | QFileDevice::WriteGroup | QFileDevice::ReadOther
+            | QFileDevice::WriteOther;
+        FileOmemoStorage storage(fileName);
+        QVERIFY(storage.isOpen());
+        QVERIFY(!(QFileInfo(fileName).permissions() & others));
+
+        QVERIFY(storage.addDevice("a@example.com", 1, makeDevice(1)));
+        QVERIFY(storage.compact());
+        QVERIFY(!(QFileInfo(fileName).permissions() & others));
+        QVERIFY(QFileInfo(fileName).permissions() & QFileDevice::ReadOwner);
+    }
+
+    void testNotALog()
+    {
+        const QString fileName = logFile("garbage.log");
+        QFile         f(fileName);
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write("definitely not an omemo log");
+        f.close();
+
+        FileOmemoStorage storage(fileName);
+        QVERIFY(!storage.isOpen());
+        QVERIFY(!storage.addDevice("a@example.com", 1, makeDevice(1)));
+    }
+
+    // thousands of contacts with a couple of devices each, but only the own state is needed to start
+    void benchmarkOpen()
+    {
+        const QString fileName = logFile("bench.log");
+        {
+            FileOmemoStorage storage(fileName);
+            for (int i = 0; i < 5000; ++i) {
+                const QString jid = QString("user%1@example.com").arg(i);
+                storage.addDevice(jid, 1, makeDevice(i));
+                storage.addDevice(jid, 2, makeDevice(i));
+            }
+        }
+
+        QBENCHMARK
+        {
+            FileOmemoStorage storage(fileName);
+            QVERIFY(storage.device("user42@example.com", 2).has_value());
+        }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(OmemoStorageTest);
+#include "omemostoragetest.moc"
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-im/xmpp_rosterchanges.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+using Change = RosterChangeSet::Change;
+
+class RosterChangesTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testResourcesMerge()
+    {
+        RosterChangeSet set;
+        Jid             phone("a@example.com/phone");
+        set.addResource(true, phone, Resource("phone", Status(Status::Online)));
+        set.addResource(true, Jid("b@example.com/pc"), Resource("pc"));
+        set.addResource(true, phone, Resource("phone", Status(Status::Away)));
+        set.addResource(false, Jid("b@example.com/pc"), Resource("pc", Status(Status::Offline)));
+
+        QCOMPARE(set.eventCount(), 4);
+        QCOMPARE(set.size(), 2);
+        QCOMPARE(set.changes()[0].jid.full(), phone.full());
+        QCOMPARE(set.changes()[0].type, Change::ResourceAvailable);
+        QCOMPARE(set.changes()[0].resource.status().type(), Status::Away);
+        QCOMPARE(set.changes()[1].type, Change::ResourceUnavailable);
+    }
+
+    void testItemsMerge()
+    {
+        RosterChangeSet set;
+        RosterItem      a(Jid("a@example.com"));
+        RosterItem      b(Jid("b@example.com"));
+        RosterItem      c(Jid("c@example.com"));
+        set.addItem(Change::ItemAdded, a);
+        set.addItem(Change::ItemUpdated, b);
+        set.addItem(Change::ItemRemoved, c);
+        set.addResource(true, Jid("c@example.com/pc"), Resource("pc"));
+
+        a.setName("Alice");
+        set.addItem(Change::ItemUpdated, a); // still new for the receiver
+        set.addItem(Change::ItemRemoved, b);
+        set.addItem(Change::ItemAdded, c); // was known before the batch
+        QCOMPARE(set.size(), 4);
+        QCOMPARE(set.changes()[0].type, Change::ItemAdded);
+        QCOMPARE(set.changes()[0].item.name(), QString("Alice"));
+        QCOMPARE(set.changes()[1].type, Change::ItemRemoved);
+        QCOMPARE(set.changes()[2].type, Change::ItemUpdated);
+
+        // added and removed within the batch - nothing to report
+        set.addItem(Change::ItemRemoved, a);
+        QCOMPARE(set.size(), 3);
+        QCOMPARE(set.changes()[0].item.jid().bare(), QString("b@example.com"));
+        set.addResource(false, Jid("c@example.com/pc"), Resource("pc"));
+        QCOMPARE(set.size(), 3);
+        QCOMPARE(set.changes()[2].type, Change::ResourceUnavailable);
+        QCOMPARE(set.eventCount(), 9);
+
+        set.clear();
+        QVERIFY(set.isEmpty());
+        QCOMPARE(set.eventCount(), 0);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(RosterChangesTest);
+#include "rosterchangestest.moc"
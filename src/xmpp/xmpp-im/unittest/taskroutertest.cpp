@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/xmpp.h"
+#include "xmpp/xmpp-im/xmpp_client.h"
+#include "xmpp/xmpp-im/xmpp_task.h"
+#include "xmpp/xmpp-im/xmpp_xmlcommon.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include <memory>
+
+using namespace XMPP;
+
+static const QLatin1String pushNS("urn:xmpp:test:push");
+
+// never connects, so the stream takes the stanzas and drops them
+class NullConnector : public Connector {
+public:
+    void        setOptHostPort(const QString &, quint16) override { }
+    void        connectToServer(const QString &) override { }
+    ByteStream *stream() const override { return nullptr; }
+    void        done() override { }
+};
+
+// sends an iq get and takes the reply from the one it was sent to
+class IqTask : public Task {
+public:
+    IqTask(Task *parent, const Jid &to) : Task(parent), to(to) { setIndexedRouting(); }
+
+    void onGo() override { send(createIQ(doc(), "get", to.full(), id())); }
+
+    bool take(const QDomElement &x) override
+    {
+        if (!iqVerify(x, to, id()))
+            return false;
+        ++taken;
+        return true;
+    }
+
+    Jid to;
+    int taken = 0;
+};
+
+// takes messages with a child in pushNS
+class PushTask : public Task {
+public:
+    PushTask(Task *parent) : Task(parent) { addPushFilter("message", pushNS); }
+
+    bool take(const QDomElement &x) override
+    {
+        if (x.tagName() != QLatin1String("message") || x.firstChildElement().namespaceURI() != pushNS)
+            return false;
+        ++taken;
+        return true;
+    }
+
+    int taken = 0;
+};
+
+// not indexed, so it's offered every stanza. takes whatever it has a tag for
+class LegacyTask : public Task {
+public:
+    LegacyTask(Task *parent, const QString &tag) : Task(parent), tag(tag) { }
+
+    bool take(const QDomElement &x) override
+    {
+        if (x.tagName() != tag)
+            return false;
+        ++taken;
+        return true;
+    }
+
+    QString tag;
+    int     taken = 0;
+};
+
+class TaskRouterTest : public QObject {
+    Q_OBJECT
+
+    NullConnector connector;
+    ClientStream  stream { &connector };
+    Client        client;
+    const Jid     juliet { "juliet@capulet.lit/balcony" };
+
+    Task *root() { return client.rootTask(); }
+
+    QDomElement reply(const QString &id, const Jid &from)
+    {
+        QDomElement iq = client.doc()->createElement("iq");
+        iq.setAttribute("type", "result");
+        iq.setAttribute("id", id);
+        iq.setAttribute("from", from.full());
+        return iq;
+    }
+
+    QDomElement push(const QString &ns)
+    {
+        QDomElement m = client.doc()->createElement("message");
+        m.setAttribute("from", juliet.full());
+        m.appendChild(client.doc()->createElementNS(ns, "x"));
+        return m;
+    }
+
+    // what the routing counters did since 'before'
+    Task::RoutingStats since(const Task::RoutingStats &before)
+    {
+        auto now = root()->routingStats();
+        return { now.byId - before.byId, now.byPush - before.byPush, now.byScan - before.byScan,
+                 now.unhandled - before.unhandled };
+    }
+
+private slots:
+    void initTestCase() { client.connectToServer(&stream, Jid("romeo@montague.lit/orchard")); }
+
+    void testIqResultById()
+    {
+        auto before = root()->routingStats();
+        auto task   = std::make_unique<IqTask>(root(), juliet);
+        task->go();
+
+        // the right id from someone else is no reply. nobody else wants it either
+        QVERIFY(!root()->take(reply(task->id(), Jid("tybalt@capulet.lit/sword"))));
+        QCOMPARE(task->taken, 0);
+        QVERIFY(root()->take(reply(task->id(), juliet)));
+        QCOMPARE(task->taken, 1);
+
+        auto stats = since(before);
+        QCOMPARE(stats.byId, quint64(1));
+        QCOMPARE(stats.unhandled, quint64(1));
+        QCOMPARE(stats.byScan, quint64(0));
+
+        // answered, so the id is forgotten
+        QVERIFY(!root()->take(reply(task->id(), juliet)));
+        QCOMPARE(task->taken, 1);
+    }
+
+    void testPushByNamespace()
+    {
+        auto before = root()->routingStats();
+        auto task   = std::make_unique<PushTask>(root());
+        QVERIFY(!root()->take(push("urn:xmpp:test:other")));
+        QVERIFY(root()->take(push(pushNS)));
+        QCOMPARE(task->taken, 1);
+
+        auto stats = since(before);
+        QCOMPARE(stats.byPush, quint64(1));
+        QCOMPARE(stats.byScan, quint64(0));
+        QCOMPARE(stats.unhandled, quint64(1));
+    }
+
+    void testLegacyScan()
+    {
+        auto before = root()->routingStats();
+        auto push   = std::make_unique<PushTask>(root());
+        auto legacy = std::make_unique<LegacyTask>(root(), "presence");
+
+        QDomElement p = client.doc()->createElement("presence");
+        QVERIFY(root()->take(p));
+        QCOMPARE(legacy->taken, 1);
+        QCOMPARE(push->taken, 0);
+
+        auto stats = since(before);
+        QCOMPARE(stats.byScan, quint64(1));
+        QCOMPARE(stats.byPush, quint64(0));
+
+        // gone from the scan with the task
+        legacy.reset();
+        QVERIFY(!root()->take(p));
+        QCOMPARE(since(before).unhandled, quint64(1));
+    }
+
+    void testCreationOrder()
+    {
+        // a push still goes to whoever was created first, indexed or not
+        {
+            auto legacy = std::make_unique<LegacyTask>(root(), "message");
+            auto task   = std::make_unique<PushTask>(root());
+            QVERIFY(root()->take(push(pushNS)));
+            QCOMPARE(legacy->taken, 1);
+            QCOMPARE(task->taken, 0);
+        }
+        {
+            auto task   = std::make_unique<PushTask>(root());
+            auto legacy = std::make_unique<LegacyTask>(root(), "message");
+            QVERIFY(root()->take(push(pushNS)));
+            QCOMPARE(legacy->taken, 0);
+            QCOMPARE(task->taken, 1);
+        }
+    }
+
+    void testIqResultBeforeLegacy()
+    {
+        // a reply goes straight to its task, legacy tasks created earlier don't see it
+        auto before = root()->routingStats();
+        auto legacy = std::make_unique<LegacyTask>(root(), "iq");
+        auto task   = std::make_unique<IqTask>(root(), juliet);
+        task->go();
+        QVERIFY(root()->take(reply(task->id(), juliet)));
+        QCOMPARE(task->taken, 1);
+        QCOMPARE(legacy->taken, 0);
+        QCOMPARE(since(before).byId, quint64(1));
+
+        // anything else still reaches them
+        QVERIFY(root()->take(reply("unknown", juliet)));
+        QCOMPARE(legacy->taken, 1);
+        QCOMPARE(since(before).byScan, quint64(1));
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(TaskRouterTest);
+#include "taskroutertest.moc"
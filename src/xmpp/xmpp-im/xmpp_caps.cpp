@@ -32,9 +32,14 @@
 #include "xmpp_xmlcommon.h"
 
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDebug>
 #include <QDomElement>
 #include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
 
 namespace XMPP {
 QDomElement CapsInfo::toXml(QDomDocument *doc) const
@@ -55,6 +60,224 @@ CapsInfo CapsInfo::fromXml(const QDomElement &caps)
     return CapsInfo(item, lastSeen);
 }
 
+// keep unseen info for last 3 month. adjust if required
+static QDateTime validSince() { return QDateTime::currentDateTime().addMonths(-3); }
+
+// -----------------------------------------------------------------------------
+
+/*
+ * Binary registry file. After the magic there is just a sequence of records:
+ *   quint32 size of the rest of the record
+ *   qint64  last seen, msecs since epoch
+ *   quint16 size of the node, the node in UTF-8
+ *   the disco item in QDataStream format
+ * Integers in the record headers are little endian. Records are only appended,
+ * expired ones are dropped when the file is compacted.
+ */
+#define CAPS_FILE_MAGIC "IRISCAP1"
+#define CAPS_FILE_MAGIC_SIZE 8
+#define CAPS_RECORD_HEADER_SIZE 14
+
+class CapsRegistry::FileStore {
+public:
+    struct Entry {
+        qint64 record; // start of the record
+        qint64 disco;  // start of the disco item
+        qint64 end;
+        qint64 lastSeen;
+    };
+
+    QFile                 file;
+    uchar                *map     = nullptr;
+    qint64                mapSize = 0;
+    QHash<QString, Entry> index;       // valid records of the mapped part
+    int                   records = 0; // all the records in the file, expired ones too
+
+    ~FileStore() { close(); }
+
+    bool remap()
+    {
+        if (map)
+            file.unmap(map);
+        mapSize = file.size();
+        map     = file.map(0, mapSize);
+        return map != nullptr;
+    }
+
+    void close()
+    {
+        if (map)
+            file.unmap(map);
+        map = nullptr;
+        file.close();
+        index.clear();
+        records = 0;
+    }
+
+    bool open(const QString &fileName, qint64 validSince)
+    {
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::ReadWrite))
+            return false;
+        if (file.size() < CAPS_FILE_MAGIC_SIZE) {
+            file.resize(0);
+            if (file.write(CAPS_FILE_MAGIC, CAPS_FILE_MAGIC_SIZE) != CAPS_FILE_MAGIC_SIZE || !file.flush())
+                return false;
+        }
+        if (!remap() || std::memcmp(map, CAPS_FILE_MAGIC, CAPS_FILE_MAGIC_SIZE) != 0)
+            return false;
+
+        // only the headers are read here
+        qint64 pos = CAPS_FILE_MAGIC_SIZE;
+        while (pos + CAPS_RECORD_HEADER_SIZE <= mapSize) {
+            const uchar *p        = map + pos;
+            qint64       end      = pos + 4 + qFromLittleEndian<quint32>(p);
+            qint64       lastSeen = qFromLittleEndian<qint64>(p + 4);
+            quint16      nodeSize = qFromLittleEndian<quint16>(p + 12);
+            qint64       disco    = pos + CAPS_RECORD_HEADER_SIZE + nodeSize;
+            if (disco > end || end > mapSize)
+                break;
+            ++records;
+            if (lastSeen > validSince)
+                index.insert(QString::fromUtf8(reinterpret_cast<const char *>(p) + CAPS_RECORD_HEADER_SIZE, nodeSize),
+                             { pos, disco, end, lastSeen });
+            pos = end;
+        }
+        if (pos != mapSize) { // torn write at the end
+            qWarning("caps.cpp: dropping %lld broken bytes at the end of %s", mapSize - pos, qPrintable(fileName));
+            file.unmap(map);
+            map = nullptr;
+            if (!file.resize(pos) || !remap())
+                return false;
+        }
+        return true;
+    }
+
+    CapsInfo read(const QString &node) const
+    {
+        auto it = index.constFind(node);
+        if (it == index.constEnd())
+            return CapsInfo();
+        auto data = QByteArray::fromRawData(reinterpret_cast<const char *>(map) + it->disco, int(it->end - it->disco));
+        return CapsInfo(decodeDisco(data), QDateTime::fromMSecsSinceEpoch(it->lastSeen));
+    }
+
+    bool append(const QString &node, const CapsInfo &info)
+    {
+        QByteArray record = encode(node, info);
+        if (record.isEmpty() || !file.seek(file.size()) || file.write(record) != record.size())
+            return false;
+        ++records;
+        return file.flush();
+    }
+
+    // rewrites the file without expired records when they take a noticeable part of it
+    bool compact(const QHash<QString, CapsInfo> &decoded, qint64 validSince)
+    {
+        int live = 0;
+        for (const auto &e : std::as_const(index))
+            live += e.lastSeen > validSince ? 1 : 0;
+        for (auto it = decoded.constBegin(); it != decoded.constEnd(); ++it)
+            live += index.contains(it.key()) ? 0 : 1;
+        if ((records - live) * 4 <= records)
+            return true;
+
+        QString   fileName = file.fileName();
+        QSaveFile out(fileName);
+        if (!out.open(QIODevice::WriteOnly))
+            return false;
+        // the old file stays as it is if anything goes wrong here
+        auto write = [&out](const char *data, qint64 size) {
+            if (out.write(data, size) == size)
+                return true;
+            out.cancelWriting();
+            return false;
+        };
+        if (!write(CAPS_FILE_MAGIC, CAPS_FILE_MAGIC_SIZE))
+            return false;
+        for (const auto &e : std::as_const(index)) {
+            if (e.lastSeen > validSince && !write(reinterpret_cast<const char *>(map) + e.record, e.end - e.record))
+                return false;
+        }
+        for (auto it = decoded.constBegin(); it != decoded.constEnd(); ++it) {
+            if (index.contains(it.key()))
+                continue;
+            QByteArray record = encode(it.key(), *it);
+            if (!write(record.constData(), record.size()))
+                return false;
+        }
+        close();
+        bool ok = out.commit();
+        return open(fileName, validSince) && ok;
+    }
+
+    static QByteArray encode(const QString &node, const CapsInfo &info)
+    {
+        QByteArray nodeUtf8 = node.toUtf8();
+        if (nodeUtf8.size() > 0xffff)
+            return QByteArray();
+
+        const DiscoItem  &disco = info.disco();
+        QList<QByteArray> forms;
+        for (const XData &x : disco.extensions()) {
+            QDomDocument doc;
+            doc.appendChild(x.toXml(&doc));
+            forms += doc.toByteArray(-1);
+        }
+
+        QByteArray record(CAPS_RECORD_HEADER_SIZE, 0);
+        record += nodeUtf8;
+        QDataStream ds(&record, QIODevice::Append);
+        ds.setVersion(QDataStream::Qt_5_12);
+        ds << disco.node() << quint32(disco.identities().size());
+        for (const auto &id : disco.identities())
+            ds << id.category << id.type << id.lang << id.name;
+        ds << disco.features().list() << forms;
+
+        qToLittleEndian<quint32>(quint32(record.size() - 4), record.data());
+        qToLittleEndian<qint64>(info.lastSeen().toMSecsSinceEpoch(), record.data() + 4);
+        qToLittleEndian<quint16>(quint16(nodeUtf8.size()), record.data() + 12);
+        return record;
+    }
+
+    static DiscoItem decodeDisco(const QByteArray &data)
+    {
+        QDataStream ds(data);
+        ds.setVersion(QDataStream::Qt_5_12);
+        QString               node;
+        quint32               count = 0;
+        DiscoItem::Identities identities;
+        ds >> node >> count;
+        for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+            DiscoItem::Identity id;
+            ds >> id.category >> id.type >> id.lang >> id.name;
+            identities += id;
+        }
+        QStringList       features;
+        QList<QByteArray> forms;
+        ds >> features >> forms;
+        if (ds.status() != QDataStream::Ok)
+            return DiscoItem();
+
+        QList<XData> extensions;
+        for (const auto &form : std::as_const(forms)) {
+            QDomDocument doc;
+            if (doc.setContent(form, true)) {
+                XData x;
+                x.fromXml(doc.documentElement());
+                extensions += x;
+            }
+        }
+
+        DiscoItem item;
+        item.setNode(node);
+        item.setIdentities(identities);
+        item.setFeatures(features);
+        item.setExtensions(extensions);
+        return item;
+    }
+};
+
 // -----------------------------------------------------------------------------
 
 /**
@@ -68,6 +291,8 @@ CapsRegistry *CapsRegistry::instance_ = nullptr;
  */
 CapsRegistry::CapsRegistry(QObject *parent) : QObject(parent) { }
 
+CapsRegistry::~CapsRegistry() { }
+
 CapsRegistry *CapsRegistry::instance()
 {
     if (!instance_) {
@@ -83,6 +308,13 @@ void CapsRegistry::setInstance(CapsRegistry *instance) { instance_ = instance; }
  */
 void CapsRegistry::save()
 {
+    if (file_) {
+        // everything is on disk already
+        if (!file_->compact(capsInfo_, validSince().toMSecsSinceEpoch()))
+            qWarning() << "CapsRegistry: failed to compact" << file_->file.fileName();
+        return;
+    }
+
     // Generate XML
     QDomDocument doc;
     QDomElement  capabilities = doc.createElement("capabilities");
@@ -110,11 +342,36 @@ QByteArray CapsRegistry::loadData() { return QByteArray(); }
  */
 void CapsRegistry::load()
 {
-    QByteArray data = loadData();
-    if (data.isEmpty()) {
+    if (file_ && file_->records)
         return;
+
+    // with a storage file the data just moves there
+    QByteArray data = loadData();
+    if (!data.isEmpty())
+        loadXml(data);
+}
+
+bool CapsRegistry::setStorageFile(const QString &fileName)
+{
+    auto store = std::make_unique<FileStore>();
+    if (!store->open(fileName, validSince().toMSecsSinceEpoch())) {
+        qWarning() << "CapsRegistry: failed to open" << fileName << store->file.errorString();
+        return false;
     }
+    file_ = std::move(store);
+    for (auto it = capsInfo_.constBegin(); it != capsInfo_.constEnd(); ++it) {
+        if (!file_->index.contains(it.key()))
+            file_->append(it.key(), *it);
+    }
+    for (auto it = capsIds_.constBegin(); it != capsIds_.constEnd(); ++it) {
+        if (!interned_[*it].registered && isRegistered(it.key()))
+            updateInterned(it.key(), info(it.key()));
+    }
+    return true;
+}
 
+void CapsRegistry::loadXml(const QByteArray &data)
+{
     // Load settings
     QDomDocument doc;
 
@@ -129,8 +386,7 @@ void CapsRegistry::load()
         return;
     }
 
-    // keep unseen info for last 3 month. adjust if required
-    QDateTime validTime = QDateTime::currentDateTime().addMonths(-3);
+    QDateTime validTime = validSince();
     for (QDomNode n = caps.firstChild(); !n.isNull(); n = n.nextSibling()) {
         QDomElement i = n.toElement();
         if (i.isNull()) {
@@ -143,8 +399,11 @@ void CapsRegistry::load()
             int     sep  = node.indexOf('#');
             if (sep > 0 && sep + 1 < node.length()) {
                 CapsInfo info = CapsInfo::fromXml(i);
-                if (info.isValid() && info.lastSeen() > validTime) {
-                    capsInfo_[node] = CapsInfo::fromXml(i);
+                if (info.isValid() && info.lastSeen() > validTime && !isRegistered(node)) {
+                    capsInfo_[node] = info;
+                    if (file_)
+                        file_->append(node, info);
+                    updateInterned(node, info);
                 }
                 // qDebug() << QString("Read %1 %2").arg(node).arg(ver);
             } else {
@@ -165,6 +424,9 @@ void CapsRegistry::registerCaps(const CapsSpec &spec, const DiscoItem &item)
     if (!isRegistered(dnode)) {
         CapsInfo info(item);
         capsInfo_[dnode] = info;
+        if (file_ && !file_->append(dnode, info))
+            qWarning() << "CapsRegistry: failed to write" << file_->file.fileName();
+        updateInterned(dnode, info);
         emit registered(spec);
     }
 }
@@ -172,12 +434,64 @@ void CapsRegistry::registerCaps(const CapsSpec &spec, const DiscoItem &item)
 /**
  * \brief Checks if capabilities have been registered.
  */
-bool CapsRegistry::isRegistered(const QString &spec) const { return capsInfo_.contains(spec); }
+bool CapsRegistry::isRegistered(const QString &spec) const
+{
+    return capsInfo_.contains(spec) || (file_ && file_->index.contains(spec));
+}
+
+DiscoItem CapsRegistry::disco(const QString &spec) const { return info(spec).disco(); }
+
+// decodes from the file on first use
+CapsInfo CapsRegistry::info(const QString &node) const
+{
+    auto it = capsInfo_.constFind(node);
+    if (it != capsInfo_.constEnd())
+        return *it;
+    if (!file_)
+        return CapsInfo();
+    CapsInfo ci = file_->read(node);
+    if (ci.isValid())
+        capsInfo_.insert(node, ci);
+    return ci;
+}
+
+int CapsRegistry::capsId(const QString &node)
+{
+    auto it = capsIds_.constFind(node);
+    if (it != capsIds_.constEnd())
+        return *it;
+
+    int id = int(interned_.size());
+    capsIds_.insert(node, id);
+    interned_.append(Interned { node, {}, false });
+    if (isRegistered(node))
+        updateInterned(node, info(node));
+    return id;
+}
+
+bool CapsRegistry::isRegistered(int capsId) const
+{
+    return capsId >= 0 && capsId < interned_.size() && interned_[capsId].registered;
+}
+
+DiscoItem CapsRegistry::disco(int capsId) const
+{
+    return isRegistered(capsId) ? info(interned_[capsId].node).disco() : DiscoItem();
+}
+
+Features CapsRegistry::features(int capsId) const
+{
+    return capsId >= 0 && capsId < interned_.size() ? interned_[capsId].features : Features();
+}
 
-DiscoItem CapsRegistry::disco(const QString &spec) const
+void CapsRegistry::updateInterned(const QString &node, const CapsInfo &info)
 {
-    CapsInfo ci = capsInfo_.value(spec);
-    return ci.disco();
+    auto it = capsIds_.constFind(node);
+    if (it == capsIds_.constEnd())
+        return;
+    Interned &i  = interned_[*it];
+    i.features   = info.disco().features();
+    i.registered = true;
 }
 
 /*--------------------------------------------------------------
@@ -230,47 +544,57 @@ void CapsManager::updateCaps(const Jid &jid, const CapsSpec &c)
     if (jid.compare(client_->jid(), false))
         return;
 
+    const QString full = jid.full();
+    auto          it   = capsSpecs_.find(full);
+    if (it != capsSpecs_.end()) {
+        if (it->spec == c)
+            return; // the same presence again
+        // Unregister from the old caps node
+        removeJid(it->capsId, full);
+    }
+
     QString fullNode = c.flatten();
-    if (capsSpecs_[jid.full()] != c) {
-        // qDebug() << QString("caps.cpp: Updating caps for %1
-        // (node=%2,ver=%3,ext=%4)").arg(QString(jid.full()).replace('%',"%%")).arg(node).arg(ver).arg(ext);
-
-        // Unregister from all old caps node
-        capsJids_[capsSpecs_[jid.full()].flatten()].removeAll(jid.full());
-
-        if (c.isValid()) {
-            // Register with all new caps nodes
-            capsSpecs_[jid.full()] = c;
-            if (!capsJids_[fullNode].contains(jid.full())) {
-                capsJids_[fullNode].push_back(jid.full());
-            }
+    if (!c.isValid()) {
+        // Remove all caps specifications
+        qWarning() << QString("caps.cpp: Illegal caps info from %1: node=%2, ver=%3")
+                          .arg(QString(full).replace('%', "%%"), fullNode, c.version());
+        if (it != capsSpecs_.end())
+            capsSpecs_.erase(it);
+        return;
+    }
 
-            emit capsChanged(jid);
-
-            // Register new caps and check if we need to discover features
-            if (isEnabled()) {
-                if (!CapsRegistry::instance()->isRegistered(fullNode) && capsJids_[fullNode].count() == 1) {
-                    // qDebug() << QString("caps.cpp: Sending disco request to %1,
-                    // node=%2").arg(QString(jid.full()).replace('%',"%%")).arg(node + "#" + s.extensions());
-                    JT_DiscoInfo *disco = new JT_DiscoInfo(client_->rootTask());
-                    disco->setAllowCache(false);
-                    connect(disco, SIGNAL(finished()), SLOT(discoFinished()));
-                    disco->get(jid, fullNode);
-                    disco->go(true);
-                }
-            }
-        } else {
-            // Remove all caps specifications
-            qWarning() << QString("caps.cpp: Illegal caps info from %1: node=%2, ver=%3")
-                              .arg(QString(jid.full()).replace('%', "%%"), fullNode, c.version());
-            capsSpecs_.remove(jid.full());
-        }
-    } else {
-        // Add to the list of jids
-        capsJids_[fullNode].push_back(jid.full());
+    // Register with the new caps node
+    auto registry = CapsRegistry::instance();
+    int  id       = registry->capsId(fullNode);
+    capsSpecs_.insert(full, { c, id });
+    auto &jids = capsJids_[id];
+    jids.insert(full);
+    bool firstJid = jids.size() == 1;
+
+    emit capsChanged(jid);
+
+    // Register new caps and check if we need to discover features
+    if (isEnabled() && firstJid && !registry->isRegistered(id)) {
+        // qDebug() << QString("caps.cpp: Sending disco request to %1,
+        // node=%2").arg(QString(jid.full()).replace('%',"%%")).arg(node + "#" + s.extensions());
+        JT_DiscoInfo *disco = new JT_DiscoInfo(client_->rootTask());
+        disco->setAllowCache(false);
+        connect(disco, SIGNAL(finished()), SLOT(discoFinished()));
+        disco->get(jid, fullNode);
+        disco->go(true);
     }
 }
 
+void CapsManager::removeJid(int capsId, const QString &jid)
+{
+    auto it = capsJids_.find(capsId);
+    if (it == capsJids_.end())
+        return;
+    it->remove(jid);
+    if (it->isEmpty())
+        capsJids_.erase(it);
+}
+
 /**
  * \brief Removes all feature information for a given JID.
  *
@@ -279,12 +603,10 @@ void CapsManager::updateCaps(const Jid &jid, const CapsSpec &c)
 void CapsManager::disableCaps(const Jid &jid)
 {
     // qDebug() << QString("caps.cpp: Disabling caps for %1.").arg(QString(jid.full()).replace('%',"%%"));
-    if (capsEnabled(jid)) {
-        QString node = capsSpecs_[jid.full()].flatten();
-        if (!node.isEmpty()) {
-            capsJids_[node].removeAll(jid.full());
-        }
-        capsSpecs_.remove(jid.full());
+    auto it = capsSpecs_.find(jid.full());
+    if (it != capsSpecs_.end()) {
+        removeJid(it->capsId, it.key());
+        capsSpecs_.erase(it);
         emit capsChanged(jid);
     }
 }
@@ -303,7 +625,7 @@ void CapsManager::discoFinished()
 
 void CapsManager::updateDisco(const Jid &jid, const DiscoItem &item)
 {
-    CapsSpec cs = capsSpecs_.value(jid.full());
+    CapsSpec cs = capsSpecs_.value(jid.full()).spec;
     if (!cs.isValid()) {
         return;
     }
@@ -319,8 +641,9 @@ void CapsManager::updateDisco(const Jid &jid, const DiscoItem &item)
  */
 void CapsManager::capsRegistered(const CapsSpec &cs)
 {
-    // Notify affected jids.
-    for (const QString &s : std::as_const(capsJids_[cs.flatten()])) {
+    // Notify affected jids. A copy, since the slots may change caps
+    const auto jids = capsJids_.value(CapsRegistry::instance()->capsId(cs.flatten()));
+    for (const QString &s : jids) {
         // qDebug() << QString("caps.cpp: Notifying %1.").arg(s.replace('%',"%%"));
         emit capsChanged(s);
     }
@@ -336,20 +659,19 @@ bool CapsManager::capsEnabled(const Jid &jid) const { return capsSpecs_.contains
  */
 XMPP::DiscoItem CapsManager::disco(const Jid &jid) const
 {
-    // qDebug() << "caps.cpp: Retrieving features of " << jid.full();
-    QStringList f;
-    if (!capsEnabled(jid)) {
-        return DiscoItem();
-    }
-    QString node = capsSpecs_[jid.full()].flatten();
-    // qDebug() << QString("    %1").arg(CapsRegistry::instance()->features(s).list().join("\n"));
-    return CapsRegistry::instance()->disco(node);
+    auto it = capsSpecs_.constFind(jid.full());
+    return it == capsSpecs_.constEnd() ? DiscoItem() : CapsRegistry::instance()->disco(it->capsId);
 }
 
 /**
  * \brief Requests the list of features of a given JID.
+ * The features are prepared when the caps are registered, so this is a couple of hash lookups.
  */
-XMPP::Features CapsManager::features(const Jid &jid) const { return disco(jid).features(); }
+XMPP::Features CapsManager::features(const Jid &jid) const
+{
+    auto it = capsSpecs_.constFind(jid.full());
+    return it == capsSpecs_.constEnd() ? Features() : CapsRegistry::instance()->features(it->capsId);
+}
 
 /**
  * \brief Returns the client name of a given jid.
@@ -357,13 +679,13 @@ XMPP::Features CapsManager::features(const Jid &jid) const { return disco(jid).f
  */
 QString CapsManager::clientName(const Jid &jid) const
 {
-    if (capsEnabled(jid)) {
-        CapsSpec cs = capsSpecs_[jid.full()];
-        QString  name;
+    auto it = capsSpecs_.constFind(jid.full());
+    if (it != capsSpecs_.constEnd()) {
+        const CapsSpec &cs = it->spec;
+        QString         name;
 
-        QString cs_str = cs.flatten();
-        if (CapsRegistry::instance()->isRegistered(cs_str)) {
-            DiscoItem disco = CapsRegistry::instance()->disco(cs_str);
+        if (CapsRegistry::instance()->isRegistered(it->capsId)) {
+            DiscoItem disco = CapsRegistry::instance()->disco(it->capsId);
             XData     si    = disco.registeredExtension(QLatin1String("urn:xmpp:dataforms:softwareinfo"));
             if (si.isValid()) {
                 name = si.getField("software").value().value(0);
@@ -405,15 +727,15 @@ QString CapsManager::clientName(const Jid &jid) const
  */
 QString CapsManager::clientVersion(const Jid &jid) const
 {
-    if (!capsEnabled(jid))
+    auto it = capsSpecs_.constFind(jid.full());
+    if (it == capsSpecs_.constEnd())
         return QString();
 
-    QString         version;
-    const CapsSpec &cs     = capsSpecs_[jid.full()];
-    QString         cs_str = cs.flatten();
-    if (CapsRegistry::instance()->isRegistered(cs_str)) {
-        XData form = CapsRegistry::instance()->disco(cs_str).registeredExtension("urn:xmpp:dataforms:softwareinfo");
-        version    = form.getField("software_version").value().value(0);
+    QString version;
+    if (CapsRegistry::instance()->isRegistered(it->capsId)) {
+        XData form
+            = CapsRegistry::instance()->disco(it->capsId).registeredExtension("urn:xmpp:dataforms:softwareinfo");
+        version = form.getField("software_version").value().value(0);
     }
 
     return version;
@@ -425,10 +747,11 @@ QString CapsManager::clientVersion(const Jid &jid) const
 QString CapsManager::osVersion(const Jid &jid) const
 {
     QString os_str;
-    if (capsEnabled(jid)) {
-        QString cs_str = capsSpecs_[jid.full()].flatten();
-        if (CapsRegistry::instance()->isRegistered(cs_str)) {
-            XData form = CapsRegistry::instance()->disco(cs_str).registeredExtension("urn:xmpp:dataforms:softwareinfo");
+    auto    it = capsSpecs_.constFind(jid.full());
+    if (it != capsSpecs_.constEnd()) {
+        if (CapsRegistry::instance()->isRegistered(it->capsId)) {
+            XData form
+                = CapsRegistry::instance()->disco(it->capsId).registeredExtension("urn:xmpp:dataforms:softwareinfo");
             os_str     = form.getField("os").value().value(0).trimmed();
             if (!os_str.isEmpty()) {
                 QString os_ver = form.getField("os_version").value().value(0).trimmed();
@@ -440,5 +763,5 @@ QString CapsManager::osVersion(const Jid &jid) const
     return os_str;
 }
 
-CapsSpec CapsManager::capsSpec(const Jid &jid) const { return capsSpecs_.value(jid.full()); }
+CapsSpec CapsManager::capsSpec(const Jid &jid) const { return capsSpecs_.value(jid.full()).spec; }
 } // namespace XMPP
@@ -25,6 +25,8 @@
 
 #include <QPointer>
 
+#include <memory>
+
 namespace XMPP {
 class CapsInfo {
 public:
@@ -49,6 +51,7 @@ class CapsRegistry : public QObject {
 
 public:
     CapsRegistry(QObject *parent = nullptr);
+    ~CapsRegistry();
 
     static CapsRegistry *instance();
     static void          setInstance(CapsRegistry *instance);
@@ -57,6 +60,18 @@ public:
     bool      isRegistered(const QString &) const;
     DiscoItem disco(const QString &) const;
 
+    // Each distinct caps node (CapsSpec::flatten()) gets a small number on first use.
+    // Lookups by the number are cheap and the features are prepared in advance.
+    int       capsId(const QString &node);
+    bool      isRegistered(int capsId) const;
+    DiscoItem disco(int capsId) const;
+    Features  features(int capsId) const;
+
+    // Keeps the registry in a binary file instead of saveData()/loadData(). At start only the
+    // index of the file is built, entries are decoded when first asked for, and registerCaps()
+    // appends to the file. load() then only imports the old data if the file is new.
+    bool setStorageFile(const QString &fileName);
+
 signals:
     void registered(const XMPP::CapsSpec &);
 
@@ -69,8 +84,24 @@ protected:
     virtual QByteArray loadData();                       // to have permanent cache
 
 private:
-    static CapsRegistry     *instance_;
-    QHash<QString, CapsInfo> capsInfo_;
+    class FileStore;
+
+    // the disco item stays in capsInfo_ only
+    struct Interned {
+        QString  node;
+        Features features;
+        bool     registered = false;
+    };
+
+    void     updateInterned(const QString &node, const CapsInfo &info);
+    CapsInfo info(const QString &node) const;
+    void     loadXml(const QByteArray &data);
+
+    static CapsRegistry             *instance_;
+    mutable QHash<QString, CapsInfo> capsInfo_; // also the decoded part of the file
+    QHash<QString, int>              capsIds_;
+    QList<Interned>                  interned_; // by caps id
+    std::unique_ptr<FileStore>       file_;
 };
 
 class CapsManager : public QObject {
@@ -107,10 +138,17 @@ protected slots:
     void capsRegistered(const CapsSpec &);
 
 private:
-    Client                       *client_;
-    bool                          isEnabled_;
-    QMap<QString, CapsSpec>       capsSpecs_;
-    QMap<QString, QList<QString>> capsJids_;
+    void removeJid(int capsId, const QString &jid);
+
+    struct JidCaps {
+        CapsSpec spec;
+        int      capsId = -1;
+    };
+
+    Client                   *client_;
+    bool                      isEnabled_;
+    QHash<QString, JidCaps>   capsSpecs_; // full jid => caps
+    QHash<int, QSet<QString>> capsJids_;  // caps id => full jids
 };
 } // namespace XMPP
 
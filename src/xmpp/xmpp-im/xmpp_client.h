@@ -22,6 +22,8 @@
 #include <iris/jid/jid.h>
 #include <iris/xmpp-im/xmpp_discoitem.h>
 #include <iris/xmpp-im/xmpp_encryption.h>
+#include <iris/xmpp-core/xmpp_traffictap.h>
+#include <iris/xmpp-im/xmpp_rosterchanges.h>
 #include <iris/xmpp-im/xmpp_status.h>
 
 #include <QCryptographicHash>
@@ -54,6 +56,7 @@ class Roster;
 class RosterItem;
 class S5BManager;
 class ServerInfoManager;
+class Stanza;
 class Stream;
 class Task;
 class TcpPortReserver;
@@ -115,7 +118,16 @@ public:
     void           sendSubscription(const Jid &, const QString &, const QString &nick = QString());
     void           setPresence(const Status &);
 
+    // Roster and presence changes are collected for 'windowMsecs' (0 - until control gets back
+    // to the event loop) and reported at once with rosterChanges() instead of rosterItemAdded(),
+    // rosterItemUpdated(), rosterItemRemoved(), resourceAvailable() and resourceUnavailable().
+    // Negative value (the default) turns batching off.
+    void setChangeBatching(int windowMsecs);
+    int  changeBatching() const;
+    void flushChanges(); // report collected changes right now
+
     void          debug(const QString &);
+    TrafficTap   &trafficTap(); // all the XML of the stream. xmlIncoming/xmlOutgoing are fed from it too
     QString       genUniqueId();
     Task         *rootTask();
     QDomDocument *doc() const;
@@ -191,6 +203,7 @@ signals:
     void rosterItemRemoved(const RosterItem &);
     void resourceAvailable(const Jid &, const Resource &);
     void resourceUnavailable(const Jid &, const Resource &);
+    void rosterChanges(const XMPP::RosterChangeSet &);
     void presenceError(const Jid &, int, const QString &);
     void subscription(const Jid &, const QString &, const QString &);
     void messageReceived(const Message &);
@@ -218,8 +231,6 @@ private slots:
     // void streamCloseFinished();
     void streamError(int);
     void streamReadyRead();
-    void streamIncomingXml(const QString &);
-    void streamOutgoingXml(const QString &);
 
     void slotRosterRequestFinished();
 
@@ -238,8 +249,14 @@ private slots:
 public:
     class GroupChat;
 
+protected:
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
+
 private:
     void cleanup();
+    void updateXmlSignalsTap();
+    void traceStanza(TrafficTap::Direction direction, const Stanza &s, const QDomElement &e);
     void distribute(const QDomElement &);
     bool distributeEncryptedCarbon(const QDomElement &);
     void distributeDecrypted(const QDomElement &, const EncryptionMetadata *metadata);
@@ -247,6 +264,8 @@ private:
     void importRosterItem(const RosterItem &);
     void updateSelfPresence(const Jid &, const Status &);
     void updatePresence(LiveRosterItem *, const Jid &, const Status &);
+    void notifyRosterItem(RosterChangeSet::Change::Type type, const RosterItem &);
+    void notifyResource(bool available, const Jid &, const Resource &);
     void handleIncoming(BSConnection *);
 
     void sendAckRequest();
@@ -40,7 +40,11 @@ public:
     DiscoItem           item;
 };
 
-DiscoInfoTask::DiscoInfoTask(Task *parent) : Task(parent) { d = new Private; }
+DiscoInfoTask::DiscoInfoTask(Task *parent) : Task(parent)
+{
+    setIndexedRouting();
+    d = new Private;
+}
 
 DiscoInfoTask::~DiscoInfoTask() { delete d; }
 
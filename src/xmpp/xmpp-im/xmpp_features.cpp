@@ -23,12 +23,52 @@
 #include "jingle.h"
 
 #include <QCoreApplication>
+#include <QHash>
 #include <QMap>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 
+#include <algorithm>
+
 using namespace XMPP;
 
+namespace {
+// feature namespaces get bit numbers as they are seen. clients use a few hundreds of them, but any
+// peer can send whatever it likes in disco#info. past the cap features are only found by name
+class FeatureDictionary {
+public:
+    static const int MaxFeatures = 4096;
+
+    // -1 if the feature has no bit and the dictionary is full
+    int index(const QString &feature)
+    {
+        auto it = ids.constFind(feature);
+        if (it != ids.constEnd())
+            return *it;
+        if (ids.size() >= MaxFeatures)
+            return -1;
+        int i = int(ids.size());
+        ids.insert(feature, i);
+        return i;
+    }
+
+    QMutex              mutex;
+    QHash<QString, int> ids;
+};
+
+Q_GLOBAL_STATIC(FeatureDictionary, featureDictionary)
+} // namespace
+
+Features::Key::Key(const QString &feature)
+{
+    auto         dict = featureDictionary();
+    QMutexLocker locker(&dict->mutex);
+    index_ = dict->index(feature);
+    if (index_ < 0)
+        feature_ = feature;
+}
+
 Features::Features() { }
 
 Features::Features(const QStringList &l) { setList(l); }
@@ -61,11 +101,34 @@ void Features::setList(const QStringList &l)
 #else
     _list = QSet<QString>::fromList(l);
 #endif
+    updateBits();
 }
 
-void Features::setList(const QSet<QString> &l) { _list = l; }
+void Features::setList(const QSet<QString> &l)
+{
+    _list = l;
+    updateBits();
+}
 
-void Features::addFeature(const QString &s) { _list += s; }
+void Features::addFeature(const QString &s) { *this << s; }
+
+void Features::updateBits()
+{
+    QList<int> indexes;
+    indexes.reserve(_list.size());
+    {
+        auto         dict = featureDictionary();
+        QMutexLocker locker(&dict->mutex);
+        for (const auto &f : std::as_const(_list)) {
+            int i = dict->index(f);
+            if (i >= 0)
+                indexes.append(i);
+        }
+    }
+    _bits.fill(false, indexes.isEmpty() ? 0 : *std::max_element(indexes.cbegin(), indexes.cend()) + 1);
+    for (int i : std::as_const(indexes))
+        _bits.setBit(i);
+}
 
 bool Features::test(const QStringList &ns) const
 {
@@ -84,149 +147,142 @@ bool Features::test(const QString &ns) const { return _list.contains(ns); }
 #define FID_MULTICAST "http://jabber.org/protocol/address"
 bool Features::hasMulticast() const
 {
-    QSet<QString> ns;
-    ns << FID_MULTICAST;
-
-    return test(ns);
+    static const Key key(FID_MULTICAST);
+    return test(key);
 }
 
 #define FID_AHCOMMAND "http://jabber.org/protocol/commands"
 bool Features::hasCommand() const
 {
-    QSet<QString> ns;
-    ns << FID_AHCOMMAND;
-
-    return test(ns);
+    static const Key key(FID_AHCOMMAND);
+    return test(key);
 }
 
 #define FID_REGISTER "jabber:iq:register"
 bool Features::hasRegister() const
 {
-    QSet<QString> ns;
-    ns << FID_REGISTER;
-
-    return test(ns);
+    static const Key key(FID_REGISTER);
+    return test(key);
 }
 
 #define FID_SEARCH "jabber:iq:search"
 bool Features::hasSearch() const
 {
-    QSet<QString> ns;
-    ns << FID_SEARCH;
-
-    return test(ns);
+    static const Key key(FID_SEARCH);
+    return test(key);
 }
 
 #define FID_GROUPCHAT "http://jabber.org/protocol/muc"
 bool Features::hasGroupchat() const
 {
-    QSet<QString> ns;
-    ns << FID_GROUPCHAT;
-
-    return test(ns);
+    static const Key key(FID_GROUPCHAT);
+    return test(key);
 }
 
 #define FID_VOICE "http://www.google.com/xmpp/protocol/voice/v1"
 bool Features::hasVoice() const
 {
-    QSet<QString> ns;
-    ns << FID_VOICE;
-
-    return test(ns);
+    static const Key key(FID_VOICE);
+    return test(key);
 }
 
 #define FID_GATEWAY "jabber:iq:gateway"
 bool Features::hasGateway() const
 {
-    QSet<QString> ns;
-    ns << FID_GATEWAY;
-
-    return test(ns);
+    static const Key key(FID_GATEWAY);
+    return test(key);
 }
 
 #define FID_QUERYVERSION "jabber:iq:version"
 bool Features::hasVersion() const
 {
-    QSet<QString> ns;
-    ns << FID_QUERYVERSION;
-
-    return test(ns);
+    static const Key key(FID_QUERYVERSION);
+    return test(key);
 }
 
 #define FID_DISCO "http://jabber.org/protocol/disco"
 bool Features::hasDisco() const
 {
-    QSet<QString> ns;
-    ns << FID_DISCO;
-    ns << "http://jabber.org/protocol/disco#info";
-    ns << "http://jabber.org/protocol/disco#items";
-
-    return test(ns);
+    static const Key disco(FID_DISCO);
+    static const Key info("http://jabber.org/protocol/disco#info");
+    static const Key items("http://jabber.org/protocol/disco#items");
+    return test(disco) && test(info) && test(items);
 }
 
 #define FID_CHATSTATE "http://jabber.org/protocol/chatstates"
 bool Features::hasChatState() const
 {
-    QSet<QString> ns;
-    ns << FID_CHATSTATE;
-
-    return test(ns);
+    static const Key key(FID_CHATSTATE);
+    return test(key);
 }
 
 #define FID_VCARD "vcard-temp"
 bool Features::hasVCard() const
 {
-    QSet<QString> ns;
-    ns << FID_VCARD;
-
-    return test(ns);
+    static const Key key(FID_VCARD);
+    return test(key);
 }
 
 #define FID_VCARD4 "urn:ietf:params:xml:ns:vcard-4.0"
 bool Features::hasVCard4() const
 {
-    QSet<QString> ns;
-    ns << FID_VCARD4;
-
-    return test(ns);
+    static const Key key(FID_VCARD4);
+    return test(key);
 }
 
 #define FID_MESSAGECARBONS "urn:xmpp:carbons:2"
 bool Features::hasMessageCarbons() const
 {
-    QStringList ns;
-    ns << FID_MESSAGECARBONS;
-
-    return test(ns);
+    static const Key key(FID_MESSAGECARBONS);
+    return test(key);
 }
 
 bool Features::hasJingleFT() const
 {
-    QStringList ns;
-    ns << Jingle::FileTransfer::NS;
-
-    return test(ns);
+    static const Key key(Jingle::FileTransfer::NS);
+    return test(key);
 }
 
 #define FID_JINGLEICEUDP "urn:xmpp:jingle:transports:ice-udp:1"
-bool Features::hasJingleIceUdp() const { return test(QStringList() << QLatin1String(FID_JINGLEICEUDP)); }
+bool Features::hasJingleIceUdp() const
+{
+    static const Key key(FID_JINGLEICEUDP);
+    return test(key);
+}
 
 #define FID_JINGLEICE "urn:xmpp:jingle:transports:ice:0"
-bool Features::hasJingleIce() const { return test(QStringList() << QLatin1String(FID_JINGLEICE)); }
+bool Features::hasJingleIce() const
+{
+    static const Key key(FID_JINGLEICE);
+    return test(key);
+}
 
 #define NS_CAPS "http://jabber.org/protocol/caps"
-bool Features::hasCaps() const { return test(QStringList() << QLatin1String(NS_CAPS)); }
+bool Features::hasCaps() const
+{
+    static const Key key(NS_CAPS);
+    return test(key);
+}
 
 #define NS_CAPS_OPTIMIZE "http://jabber.org/protocol/caps#optimize"
-bool Features::hasCapsOptimize() const { return test(QStringList() << QLatin1String(NS_CAPS_OPTIMIZE)); }
+bool Features::hasCapsOptimize() const
+{
+    static const Key key(NS_CAPS_OPTIMIZE);
+    return test(key);
+}
 
 #define NS_DIRECT_MUC_INVITE "jabber:x:conference"
-bool Features::hasDirectMucInvite() const { return test(QStringList() << QLatin1String(NS_DIRECT_MUC_INVITE)); }
+bool Features::hasDirectMucInvite() const
+{
+    static const Key key(NS_DIRECT_MUC_INVITE);
+    return test(key);
+}
 
 #define FID_AVATAR_TO_VCARD_CONVERSION "urn:xmpp:pep-vcard-conversion:0"
 bool Features::hasAvatarConversion() const
 {
-    return test(QStringList() << QLatin1String(FID_AVATAR_TO_VCARD_CONVERSION));
+    static const Key key(FID_AVATAR_TO_VCARD_CONVERSION);
+    return test(key);
 }
 
 // custom Psi actions
@@ -322,6 +378,10 @@ QString Features::feature(long id)
 Features &Features::operator<<(const QString &feature)
 {
     _list << feature;
+    Key key(feature);
+    if (key.index_ >= _bits.size())
+        _bits.resize(key.index_ + 1);
+    _bits.setBit(key.index_);
     return *this;
 }
 
@@ -20,6 +20,7 @@
 #ifndef XMPP_FEATURES_H
 #define XMPP_FEATURES_H
 
+#include <QBitArray>
 #include <QSet>
 #include <QStringList>
 
@@ -92,7 +93,27 @@ public:
         FID_Add
     };
 
+    // A feature interned in the process-wide feature dictionary. Testing a key is just a bit check,
+    // so frequently tested features are better kept as static keys. The dictionary is capped, so
+    // a key made after it filled up is tested by name.
+    class Key {
+    public:
+        explicit Key(const QString &feature);
+        inline explicit Key(const char *feature) : Key(QString::fromLatin1(feature)) { }
+
+    private:
+        friend class Features;
+        QString feature_;
+        int     index_;
+    };
+
     // useful functions
+    inline bool test(const Key &key) const
+    {
+        if (key.index_ < 0)
+            return _list.contains(key.feature_);
+        return key.index_ < _bits.size() && _bits.testBit(key.index_);
+    }
     inline bool test(const char *ns) const { return test(QLatin1String(ns)); }
     bool        test(const QString &) const;
     bool        test(const QStringList &) const;
@@ -111,13 +132,17 @@ public:
     Features   &operator+=(const Features &other)
     {
         _list += other._list;
+        _bits |= other._bits;
         return *this;
     }
 
     class FeatureName;
 
 private:
+    void updateBits();
+
     QSet<QString> _list;
+    QBitArray     _bits; // _list over the feature dictionary
 };
 } // namespace XMPP
 
@@ -53,18 +53,13 @@ static const std::array hashTypes {
     HashDesc { "sha3-256", Hash::Type::Sha3_256 },
 }; // HashDesc { "unknown", Hash::Type::Unknown },
 
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
 using HashVariant = std::variant<std::nullptr_t, QCryptographicHash, QCA::Hash, Blake2Hash>;
-#else
-using HashVariant = std::variant<std::nullptr_t, QCryptographicHash, QCA::Hash>;
-#endif
+
 HashVariant findHasher(Hash::Type hashType)
 {
     QString                       qcaType;
-    QCryptographicHash::Algorithm qtType = QCryptographicHash::Algorithm(-1);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    Blake2Hash::DigestSize blakeDS = Blake2Hash::DigestSize(-1);
-#endif
+    QCryptographicHash::Algorithm qtType  = QCryptographicHash::Algorithm(-1);
+    Blake2Hash::DigestSize        blakeDS = Blake2Hash::DigestSize(-1);
 
     switch (hashType) {
     case Hash::Type::Sha1:
@@ -100,10 +95,12 @@ HashVariant findHasher(Hash::Type hashType)
     case Hash::Type::Blake2b256:
         qtType  = QCryptographicHash::Blake2b_256;
         qcaType = "blake2b_256";
+        blakeDS = Blake2Hash::Digest256;
         break;
     case Hash::Type::Blake2b512:
         qtType  = QCryptographicHash::Blake2b_512;
         qcaType = "blake2b_512";
+        blakeDS = Blake2Hash::Digest512;
         break;
 #endif
     case Hash::Type::Unknown:
@@ -112,6 +109,14 @@ HashVariant findHasher(Hash::Type hashType)
         return nullptr;
     }
 
+    // the bundled code and libb2 pick SIMD code at runtime, so they go first
+    if (blakeDS != Blake2Hash::DigestSize(-1)) {
+        Blake2Hash bh(blakeDS);
+        if (bh.isValid()) {
+            return HashVariant { std::in_place_type<Blake2Hash>, std::move(bh) };
+        }
+    }
+
     if (!qcaType.isEmpty()) {
         QCA::Hash hashObj(qcaType);
         if (hashObj.context()) {
@@ -122,14 +127,6 @@ HashVariant findHasher(Hash::Type hashType)
     if (qtType != QCryptographicHash::Algorithm(-1)) {
         return HashVariant { std::in_place_type<QCryptographicHash>, qtType };
     }
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    else if (blakeDS != Blake2Hash::DigestSize(-1)) {
-        Blake2Hash bh(blakeDS);
-        if (bh.isValid()) {
-            return HashVariant { std::in_place_type<Blake2Hash>, std::move(bh) };
-        }
-    }
-#endif
     return nullptr;
 }
 
@@ -185,7 +182,6 @@ bool Hash::compute(const QByteArray &ba)
     std::visit(
         [&ba, this](auto &&arg) {
             using T = std::decay_t<decltype(arg)>;
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
             if constexpr (std::is_same_v<T, QCA::Hash>) {
                 arg.update(ba);
                 v_data = arg.final().toByteArray();
@@ -196,16 +192,6 @@ bool Hash::compute(const QByteArray &ba)
                 if (arg.addData(ba))
                     v_data = arg.final();
             }
-#else
-            // Qt6 claims to have openssl backend and it doesn't copy data (?)
-            if constexpr (std::is_same_v<T, QCryptographicHash>) {
-                arg.addData(ba);
-                v_data = arg.result();
-            } else if constexpr (std::is_same_v<T, QCA::Hash>) {
-                arg.update(ba);
-                v_data = arg.final().toByteArray();
-            }
-#endif
         },
         hasher);
 
@@ -223,7 +209,6 @@ bool Hash::compute(QIODevice *dev)
     std::visit(
         [dev, this](auto &&arg) {
             using T = std::decay_t<decltype(arg)>;
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
             if constexpr (std::is_same_v<T, QCA::Hash>) {
                 arg.update(dev);
                 v_data = arg.final().toByteArray();
@@ -234,15 +219,6 @@ bool Hash::compute(QIODevice *dev)
                 if (arg.addData(dev))
                     v_data = arg.final();
             }
-#else
-            if constexpr (std::is_same_v<T, QCryptographicHash>) {
-                arg.addData(dev);
-                v_data = arg.result();
-            } else if constexpr (std::is_same_v<T, QCA::Hash>) {
-                arg.update(dev);
-                v_data = arg.final().toByteArray();
-            }
-#endif
         },
         hasher);
 
@@ -347,7 +323,6 @@ bool StreamHash::addData(const QByteArray &data)
     std::visit(
         [&data, &ret](auto &&arg) {
             using T = std::decay_t<decltype(arg)>;
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
             if constexpr (std::is_same_v<T, QCA::Hash>) {
                 arg.update(data);
             } else if constexpr (std::is_same_v<T, QCryptographicHash>) {
@@ -355,13 +330,6 @@ bool StreamHash::addData(const QByteArray &data)
             } else if constexpr (std::is_same_v<T, Blake2Hash>) {
                 ret = arg.addData(data);
             }
-#else
-            if constexpr (std::is_same_v<T, QCryptographicHash>) {
-                arg.addData(data);
-            } else if constexpr (std::is_same_v<T, QCA::Hash>) {
-                arg.update(data);
-            }
-#endif
             else
                 ret = false;
         },
@@ -374,7 +342,6 @@ Hash StreamHash::final()
     auto data = std::visit(
         [](auto &&arg) {
             using T = std::decay_t<decltype(arg)>;
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
             if constexpr (std::is_same_v<T, QCA::Hash>) {
                 return arg.final().toByteArray();
             } else if constexpr (std::is_same_v<T, QCryptographicHash>) {
@@ -382,13 +349,6 @@ Hash StreamHash::final()
             } else if constexpr (std::is_same_v<T, Blake2Hash>) {
                 return arg.final();
             }
-#else
-            if constexpr (std::is_same_v<T, QCryptographicHash>) {
-                return arg.result();
-            } else if constexpr (std::is_same_v<T, QCA::Hash>) {
-                return arg.final().toByteArray();
-            }
-#endif
             return QByteArray();
         },
         d->hasher);
@@ -26,6 +26,10 @@
 namespace XMPP {
 class Jid;
 
+// Lookups by jid go through a bare jid => position index. Modify the roster with
+// the methods below rather than the QList ones, or the index is rebuilt on the next lookup.
+// Items replaced in place (operator[], replace()) are still found, but a jid missing from
+// the index costs a linear scan.
 class LiveRoster : public QList<LiveRosterItem> {
 public:
     LiveRoster();
@@ -37,11 +41,21 @@ public:
     void                      flagAllForDelete();
     LiveRoster::Iterator      find(const Jid &, bool compareRes = true);
     LiveRoster::ConstIterator find(const Jid &, bool compareRes = true) const;
+    QList<qsizetype>          findAll(const Jid &, bool compareRes = true) const; // positions, in list order
+
+    using QList<LiveRosterItem>::erase;
+    void                 append(const LiveRosterItem &);
+    LiveRoster          &operator+=(const LiveRosterItem &);
+    LiveRoster::Iterator erase(LiveRoster::Iterator);
+    void                 removeAt(qsizetype i);
+    void                 clear();
 
     void    setGroupsDelimiter(const QString &groupsDelimiter);
     QString groupsDelimiter() const;
 
 private:
+    void rebuildIndex() const;
+
     class Private;
     Private *d;
 };
@@ -18,15 +18,45 @@
  */
 
 #include "xmpp_mamtask.h"
-#if QT_VERSION >= QT_VERSION_CHECK(6, 9, 0)
-#include <QTimeZone>
-#endif
+
+#include <QDataStream>
+#include <QPointer>
+
+#include <algorithm>
+
+#define MAM_CHECKPOINT_VERSION 1
 
 using namespace XMLHelper;
 using namespace XMPP;
 
 class MAMTask::Private {
 public:
+    // a page fetched in streaming or parallel mode
+    class Page {
+    public:
+        QList<QDomElement> results;
+        QString            cursor; // RSM id to continue after this page from
+        bool               last = false;
+    };
+
+    // a time slice of the range fetched page by page on its own
+    class Window {
+    public:
+        QDateTime          start;
+        QDateTime          end;
+        QString            cursor;          // of the last page fetched
+        QString            savedCursor;     // of the last page handed out. what checkpoints keep
+        bool               fetched = false; // the server said there is no more
+        bool               done    = false; // and all of it is handed out
+        QString            queryID;
+        QString            iqID;     // of the page request in flight
+        QList<QDomElement> incoming; // results of that page so far
+        QList<Page>        pages;    // fetched, waiting for the windows before this one
+    };
+
+    // pages a window ahead of the one handed out may hold when streaming
+    static const int MaxBufferedPages = 4;
+
     int  mamPageSize;    // TODO: this is the max page size for MAM request. Should be made into a config option in Psi+
     int  mamMaxMessages; // maximum mam pages total, also should be config. zero means unlimited
     int  messagesFetched;
@@ -48,18 +78,38 @@ public:
     QDateTime          to;
     QList<QDomElement> archive;
 
+    bool          streaming  = false;
+    bool          paused     = false;
+    bool          delivering = false; // in pump(), handing out results
+    int           parallel   = 1;
+    int           delivered  = 0;
+    int           head       = 0; // the window results are handed out of
+    QList<Window> windows;
+
     void  getPage();
     void  getArchiveMetadata();
-    XData makeMAMFilter();
+    XData makeMAMFilter(QDateTime start, QDateTime end);
+
+    bool windowed() const { return streaming || parallel > 1 || !windows.isEmpty(); }
+    void splitRange();
+    void requestPage(Window &w);
+    void pump();
+    bool takeRange(const QDomElement &x);
+    bool takeWindowed(const QDomElement &x);
 };
 
-MAMTask::MAMTask(Task *parent) : Task(parent) { d = new Private; }
+MAMTask::MAMTask(Task *parent) : Task(parent)
+{
+    addPushFilter(QStringLiteral("message"), XMPP_MAM_NAMESPACE); // archived messages
+    d    = new Private;
+    d->q = this;
+}
 MAMTask::MAMTask(const MAMTask &x) : Task(x.parent()) { d = x.d; }
 MAMTask::~MAMTask() { delete d; }
 
 const QList<QDomElement> &MAMTask::archive() const { return d->archive; }
 
-XData MAMTask::Private::makeMAMFilter()
+XData MAMTask::Private::makeMAMFilter(QDateTime start, QDateTime end)
 {
     XData::FieldList fl;
 
@@ -75,30 +125,21 @@ XData MAMTask::Private::makeMAMFilter()
     includeGroupchat.setValue(QStringList(QLatin1String(allowMUCArchives ? "true" : "false")));
     fl.append(includeGroupchat);
 
-    if (from.isValid()) {
-        XData::Field start;
-        start.setType(XData::Field::Field_TextSingle);
-        start.setVar(QLatin1String("start"));
-#if QT_VERSION < QT_VERSION_CHECK(6, 9, 0)
-        from.setTimeSpec(Qt::UTC);
-#else
-        from.setTimeZone(QTimeZone::UTC);
-#endif
-        start.setValue(QStringList(from.toString()));
-        fl.append(start);
+    // XEP-0082 in UTC. milliseconds as the windows of a parallel fetch may need them
+    if (start.isValid()) {
+        XData::Field startField;
+        startField.setType(XData::Field::Field_TextSingle);
+        startField.setVar(QLatin1String("start"));
+        startField.setValue(QStringList(start.toUTC().toString(Qt::ISODateWithMs)));
+        fl.append(startField);
     }
 
-    if (to.isValid()) {
-        XData::Field end;
-        end.setType(XData::Field::Field_TextSingle);
-        end.setVar(QLatin1String("end"));
-#if QT_VERSION < QT_VERSION_CHECK(6, 9, 0)
-        to.setTimeSpec(Qt::UTC);
-#else
-        to.setTimeZone(QTimeZone::UTC);
-#endif
-        end.setValue(QStringList(to.toString()));
-        fl.append(end);
+    if (end.isValid()) {
+        XData::Field endField;
+        endField.setType(XData::Field::Field_TextSingle);
+        endField.setVar(QLatin1String("end"));
+        endField.setValue(QStringList(end.toUTC().toString(Qt::ISODateWithMs)));
+        fl.append(endField);
     }
 
     if (!fromID.isNull()) {
@@ -132,10 +173,10 @@ void MAMTask::Private::getPage()
     QDomElement query    = q->doc()->createElementNS(XMPP_MAM_NAMESPACE, QLatin1String("query"));
     currentPageQueryID   = q->genUniqueID();
     query.setAttribute(QLatin1String("queryid"), currentPageQueryID);
-    XData x = makeMAMFilter();
+    XData x = makeMAMFilter(from, to);
 
     SubsetsClientManager rsm;
-    rsm.setMax(mamMaxMessages);
+    rsm.setMax(mamPageSize);
 
     if (flipPages)
         query.appendChild(emptyTag(q->doc(), QLatin1String("flip-page")));
@@ -174,6 +215,198 @@ void MAMTask::Private::getArchiveMetadata()
     q->send(iq);
 }
 
+void MAMTask::Private::splitRange()
+{
+    qint64 span = from.isValid() && to.isValid() ? from.msecsTo(to) : 0;
+    int    n    = int(qBound(qint64(1), span, qint64(parallel)));
+    for (int i = 0; i < n; ++i) {
+        Window w;
+        w.start = i ? from.addMSecs(span * i / n) : from;
+        w.end   = i < n - 1 ? from.addMSecs(span * (i + 1) / n - 1) : to; // start and end are both inclusive
+        windows.append(w);
+    }
+    if (backwards)
+        std::reverse(windows.begin(), windows.end());
+}
+
+void MAMTask::Private::requestPage(Window &w)
+{
+    w.iqID            = q->genUniqueID();
+    w.queryID         = q->genUniqueID();
+    QDomElement iq    = createIQ(q->doc(), QLatin1String("set"), QLatin1String(), w.iqID);
+    QDomElement query = q->doc()->createElementNS(XMPP_MAM_NAMESPACE, QLatin1String("query"));
+    query.setAttribute(QLatin1String("queryid"), w.queryID);
+    query.appendChild(makeMAMFilter(w.start, w.end).toXml(q->doc()));
+
+    SubsetsClientManager rsm;
+    rsm.setMax(mamPageSize);
+    if (w.cursor.isEmpty()) {
+        if (backwards)
+            rsm.getLast();
+        else
+            rsm.getFirst();
+    } else if (backwards) {
+        rsm.setFirstID(w.cursor);
+        rsm.getPrevious();
+    } else {
+        rsm.setLastID(w.cursor);
+        rsm.getNext();
+    }
+    query.appendChild(rsm.makeQueryElement(q->doc()));
+    if (flipPages)
+        query.appendChild(emptyTag(q->doc(), QLatin1String("flip-page")));
+
+    iq.appendChild(query);
+    q->send(iq);
+}
+
+// hands out the pages which are next in order and asks for more
+void MAMTask::Private::pump()
+{
+    if (delivering) // resume() from a handler. the loop below will go on
+        return;
+
+    QPointer<MAMTask> self = q;
+    delivering             = true;
+    while (!paused && head < windows.size()) {
+        Window &w = windows[head];
+        if (w.done) {
+            ++head;
+            continue;
+        }
+        if (w.pages.isEmpty())
+            break;
+
+        Page page     = w.pages.takeFirst();
+        w.savedCursor = page.cursor;
+        w.done        = page.last;
+        // pages come whole and the windows fetch theirs at once, so the limit cuts into one
+        if (mamMaxMessages > 0 && page.results.size() > mamMaxMessages - delivered) {
+            page.results.erase(page.results.begin() + (mamMaxMessages - delivered), page.results.end());
+            w.done = false;
+            // in the order we go, a checkpoint goes on after the last one handed out
+            if (!page.results.isEmpty() && (flipPages || !backwards))
+                w.savedCursor = page.results.last().attribute(QLatin1String("id"));
+        }
+        delivered += int(page.results.size());
+        if (!streaming)
+            archive += page.results;
+        else if (!page.results.isEmpty()) {
+            emit q->resultsReady(page.results);
+            if (!self)
+                return;
+        }
+        emit q->checkpointChanged();
+        if (!self)
+            return;
+        if (mamMaxMessages > 0 && delivered >= mamMaxMessages)
+            break;
+    }
+    delivering = false;
+
+    if (head == windows.size() || (mamMaxMessages > 0 && delivered >= mamMaxMessages)) {
+        q->setSuccess();
+        return;
+    }
+    if (paused)
+        return;
+
+    for (int i = head; i < windows.size(); ++i) {
+        Window &w = windows[i];
+        if (w.fetched || !w.iqID.isEmpty())
+            continue;
+        // the window being handed out always goes on, the ones after it only up to a point
+        if (streaming && i != head && w.pages.size() >= MaxBufferedPages)
+            continue;
+        requestPage(w);
+    }
+}
+
+// the metadata reply, in streaming or parallel mode. it closes an open time range
+bool MAMTask::Private::takeRange(const QDomElement &x)
+{
+    mainQueryID.clear();
+    QDomElement metadata = x.firstChildElement(QLatin1String("metadata"));
+    if (x.attribute(QLatin1String("type")) != QLatin1String("result") || metadata.isNull()) {
+        q->setError(1, "Malformed server metadata response");
+        return true;
+    }
+    if (!metadata.hasChildNodes()) {
+        // No data in archive
+        q->setSuccess();
+        return true;
+    }
+
+    QDomElement start = metadata.firstChildElement(QLatin1String("start"));
+    QDomElement end   = metadata.firstChildElement(QLatin1String("end"));
+    if (start.isNull() || end.isNull()) {
+        q->setError(1, "Malformed server metadata response");
+        return true;
+    }
+    if (!from.isValid())
+        from = QDateTime::fromString(start.attribute(QLatin1String("timestamp")), Qt::ISODate);
+    if (!to.isValid())
+        to = QDateTime::fromString(end.attribute(QLatin1String("timestamp")), Qt::ISODate);
+    splitRange();
+    pump();
+    return true;
+}
+
+bool MAMTask::Private::takeWindowed(const QDomElement &x)
+{
+    if (x.tagName() == QLatin1String("message")) {
+        QDomElement result = x.firstChildElement(QLatin1String("result"));
+        if (result.isNull() || result.namespaceURI() != XMPP_MAM_NAMESPACE)
+            return false;
+        const QString queryID = result.attribute(QLatin1String("queryid"));
+        for (auto &w : windows) {
+            if (!w.iqID.isEmpty() && w.queryID == queryID) {
+                w.incoming.append(result);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (int i = head; i < windows.size(); ++i) {
+        Window &w = windows[i];
+        if (w.iqID.isEmpty() || !q->iqVerify(x, QString(), w.iqID))
+            continue;
+
+        w.iqID.clear();
+        if (x.attribute(QLatin1String("type")) == QLatin1String("error")) {
+            QDomElement error = x.firstChildElement(QLatin1String("error"));
+            if (!error.firstChildElement(QLatin1String("item-not-found")).isNull())
+                q->setError(2, "First or last stanza UID of filter was not found in the archive");
+            else if (!error.isNull())
+                q->setError(x);
+            else
+                q->setError(1, "Malformed server response");
+            return true;
+        }
+        QDomElement fin = x.firstChildElement(QLatin1String("fin"));
+        if (fin.namespaceURI() != XMPP_MAM_NAMESPACE) {
+            q->setError(1, "Malformed server response");
+            return true;
+        }
+
+        // the id to page on from is where the page ends in the direction we go
+        QDomElement set = SubsetsClientManager::findElement(fin, true);
+        Page        page;
+        page.results = std::move(w.incoming);
+        page.cursor  = set.firstChildElement(QLatin1String(backwards ? "first" : "last")).text();
+        page.last    = fin.attribute(QLatin1String("complete")) == QLatin1String("true") || page.results.isEmpty()
+            || page.cursor.isEmpty();
+        w.incoming.clear();
+        w.cursor  = page.cursor;
+        w.fetched = page.last;
+        w.pages.append(page);
+        pump();
+        return true;
+    }
+    return false;
+}
+
 // Note: Set `j` to a resource if you just want to query that resource
 // if you want to query all resources, set `j` to the bare JID
 
@@ -184,6 +417,9 @@ void MAMTask::get(const Jid &j, const QDateTime &from, const QDateTime &to, cons
     d->archive         = {};
     d->messagesFetched = 0;
     d->metadataFetched = false;
+    d->windows.clear();
+    d->head      = 0;
+    d->delivered = 0;
 
     d->j                = j;
     d->from             = from;
@@ -193,7 +429,6 @@ void MAMTask::get(const Jid &j, const QDateTime &from, const QDateTime &to, cons
     d->mamMaxMessages   = mamMaxMessages;
     d->flipPages        = flipPages;
     d->backwards        = backwards;
-    d->q                = this;
 }
 
 // Filter by id range
@@ -203,6 +438,9 @@ void MAMTask::get(const Jid &j, const QString &fromID, const QString &toID, cons
     d->archive         = {};
     d->messagesFetched = 0;
     d->metadataFetched = false;
+    d->windows.clear();
+    d->head      = 0;
+    d->delivered = 0;
 
     d->j                = j;
     d->fromID           = fromID;
@@ -214,18 +452,91 @@ void MAMTask::get(const Jid &j, const QString &fromID, const QString &toID, cons
     d->backwards        = backwards;
 }
 
-void MAMTask::onGo() { d->getArchiveMetadata(); }
+void MAMTask::setStreaming(bool streaming) { d->streaming = streaming; }
+
+void MAMTask::pause() { d->paused = true; }
+
+void MAMTask::resume()
+{
+    if (!d->paused)
+        return;
+    d->paused = false;
+    if (!d->windows.isEmpty())
+        d->pump();
+}
+
+void MAMTask::setParallel(int windows) { d->parallel = qMax(1, windows); }
+
+QByteArray MAMTask::exportCheckpoint() const
+{
+    QByteArray  out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_12);
+    ds << quint8(MAM_CHECKPOINT_VERSION) << quint32(d->windows.size());
+    for (const auto &w : std::as_const(d->windows))
+        ds << w.start << w.end << w.savedCursor << w.done;
+    return out;
+}
+
+bool MAMTask::importCheckpoint(const QByteArray &data)
+{
+    QDataStream ds(data);
+    ds.setVersion(QDataStream::Qt_5_12);
+    quint8  version = 0;
+    quint32 count   = 0;
+    ds >> version >> count;
+    if (version != MAM_CHECKPOINT_VERSION)
+        return false;
+
+    QList<Private::Window> windows;
+    for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        Private::Window w;
+        ds >> w.start >> w.end >> w.savedCursor >> w.done;
+        w.cursor  = w.savedCursor;
+        w.fetched = w.done;
+        windows.append(w);
+    }
+    if (ds.status() != QDataStream::Ok || windows.isEmpty())
+        return false;
+
+    d->windows   = windows;
+    d->head      = 0;
+    d->delivered = 0;
+    return true;
+}
+
+void MAMTask::onGo()
+{
+    if (!d->windowed()) {
+        d->getArchiveMetadata();
+        return;
+    }
+    if (d->windows.isEmpty()) {
+        if (d->parallel > 1 && (!d->from.isValid() || !d->to.isValid())) {
+            d->getArchiveMetadata();
+            return;
+        }
+        d->splitRange();
+    }
+    d->pump();
+}
 
 bool MAMTask::take(const QDomElement &x)
 {
+    if (d->windowed()) {
+        if (!d->mainQueryID.isEmpty() && iqVerify(x, QString(), d->mainQueryID))
+            return d->takeRange(x);
+        return d->takeWindowed(x);
+    }
+
     if (d->metadataFetched) {
         if (iqVerify(x, QString(), d->currentPageQueryIQID)) {
-            if (!x.elementsByTagNameNS(QLatin1String("urn:ietf:params:xml:ns:xmpp-stanzas"),
-                                       QLatin1String("item-not-found"))
-                     .isEmpty()) {
+            QDomElement error = x.firstChildElement(QLatin1String("error"));
+            QDomElement fin   = x.firstChildElement(QLatin1String("fin"));
+            if (!error.firstChildElement(QLatin1String("item-not-found")).isNull()) {
                 setError(2, "First or last stanza UID of filter was not found in the archive");
                 return true;
-            } else if (!x.elementsByTagNameNS(XMPP_MAM_NAMESPACE, QLatin1String("fin")).isEmpty()) {
+            } else if (!fin.isNull() && fin.namespaceURI() == XMPP_MAM_NAMESPACE) {
                 // We are done?
                 // setSuccess();
                 // return true;
@@ -244,7 +555,8 @@ bool MAMTask::take(const QDomElement &x)
             d->messagesFetched = d->messagesFetched + 1;
 
             // Check if we are done
-            if (result.attribute(QLatin1String("id")) == d->lastID || d->messagesFetched >= d->mamMaxMessages) {
+            if (result.attribute(QLatin1String("id")) == d->lastID
+                || (d->mamMaxMessages > 0 && d->messagesFetched >= d->mamMaxMessages)) {
                 setSuccess();
             } else if (d->messagesFetched % d->mamPageSize == 0) {
                 d->getPage();
@@ -45,6 +45,24 @@ public:
 
     const QList<QDomElement> &archive() const;
 
+    // Results are handed out with resultsReady() page by page instead of being
+    // collected in archive(). A handler may pause() the task to hold the next
+    // requests back until resume(), so a slow consumer keeps the memory bounded.
+    void setStreaming(bool streaming);
+    void pause();
+    void resume();
+
+    // Splits the time range in that many windows fetched at the same time. The
+    // results still come in order, the later windows wait meanwhile. A range open
+    // at either end is closed with the archive metadata first.
+    void setParallel(int windows);
+
+    // Where the fetch is, up to the results already handed out. Save it on
+    // checkpointChanged() and import into a new task after the same get() and
+    // options, before go(), to go on from there after an interruption.
+    QByteArray exportCheckpoint() const;
+    bool       importCheckpoint(const QByteArray &data);
+
     // Time filter
     void get(const Jid &j, const QDateTime &from = QDateTime(), const QDateTime &to = QDateTime(),
              const bool allowMUCArchives = true, int mamPageSize = 10, int mamMaxMessages = 0, bool flipPages = true,
@@ -58,6 +76,10 @@ public:
     void onGo();
     bool take(const QDomElement &);
 
+signals:
+    void resultsReady(const QList<QDomElement> &results);
+    void checkpointChanged();
+
 private:
     class Private;
     Private *d;
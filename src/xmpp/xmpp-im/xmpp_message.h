@@ -30,6 +30,9 @@
 
 #include <QExplicitlySharedDataPointer>
 #include <QSet>
+#include <QVariant>
+
+#include <functional>
 
 class QDateTime;
 class QString;
@@ -258,10 +261,26 @@ public:
     bool wasEncrypted() const;
     void setWasEncrypted(bool);
 
+    // Parser of an extension element fromStanza() doesn't know about. It runs once the
+    // built-in parsers are done and keeps what it finds in extensionData()
+    using ExtensionParser = std::function<void(Message &message, const QDomElement &element)>;
+
+    // An empty name takes all the elements of the namespace. One parser per pair,
+    // registering again replaces the previous one
+    static void registerExtensionParser(const QString &ns, const QString &name, const ExtensionParser &parser);
+    static void unregisterExtensionParser(const QString &ns, const QString &name = {});
+
+    QVariant extensionData(const QString &key) const;
+    void     setExtensionData(const QString &key, const QVariant &data);
+
     Stanza toStanza(Stream *stream) const;
     bool   fromStanza(const Stanza &s);
     bool   fromStanza(const Stanza &s, int tzoffset);
     bool   fromStanza(const Stanza &s, bool useTimeZoneOffset, int timeZoneOffset);
+    // Only the children in one of the extensions namespaces are parsed, an empty set
+    // means all of them. Subject, body and thread are always parsed
+    bool fromStanza(const Stanza &s, const QSet<QString> &extensions, bool useTimeZoneOffset = false,
+                    int timeZoneOffset = 0);
 
 private:
     class Private;
@@ -375,7 +375,7 @@ public:
     EncryptionTrustStorage                       *trustStorage = nullptr;
     std::unique_ptr<MemoryOmemoStorage>           ownedStorage;
     std::unique_ptr<MemoryEncryptionTrustStorage> ownedTrustStorage;
-    OmemoStorage::OmemoData                       data;
+    OmemoStorage::OmemoData                       data; // own device and key pairs, see deviceCache for the rest
     EncryptionTrustLevels                         acceptedTrust = EncryptionTrustLevel::AutomaticallyTrusted
         | EncryptionTrustLevel::ManuallyTrusted | EncryptionTrustLevel::Authenticated;
     EncryptionTrustLevel newIdentityTrust = EncryptionTrustLevel::AutomaticallyTrusted;
@@ -384,6 +384,9 @@ public:
     bool                 ready               = false;
     OmemoProtocols       supportedProtocols;
 
+    // bare jid => its devices, read from the storage on first use of the jid
+    mutable QHash<QString, QHash<uint32_t, OmemoStorage::Device>> deviceCache;
+
     struct SignalStore {
         Private                       *owner    = nullptr;
         OmemoProtocol                  protocol = OmemoProtocol::Omemo2;
@@ -405,7 +408,7 @@ public:
             ownedTrustStorage = std::make_unique<MemoryEncryptionTrustStorage>();
             trustStorage      = ownedTrustStorage.get();
         }
-        data = storage->allData();
+        data = storage->ownData();
         initSignal();
     }
 
@@ -436,6 +439,14 @@ public:
         return bare + QLatin1Char('\n') + protocolName(protocol);
     }
 
+    const QHash<uint32_t, OmemoStorage::Device> &devicesOf(const QString &bare) const
+    {
+        auto it = deviceCache.find(bare);
+        if (it == deviceCache.end())
+            it = deviceCache.insert(bare, storage->devices(bare));
+        return it.value();
+    }
+
     static OmemoStorage::DeviceProtocolState protocolState(const OmemoStorage::Device &device, OmemoProtocol protocol)
     {
         return device.protocols.value(protocol);
@@ -448,7 +459,8 @@ public:
             bare = owner;
         if (!storage->addDevice(bare, id, device))
             return false;
-        data.devices[bare][id] = device;
+        devicesOf(bare); // the other devices of the owner have to be loaded before we add one
+        deviceCache[bare][id] = device;
         emit q->deviceChanged(Jid(bare), id);
         return true;
     }
@@ -596,7 +608,7 @@ public:
         const auto protocol = storeProtocol(userData);
         const auto owner    = Jid(addressName(address)).bare();
         const auto state
-            = d->data.devices.value(owner).value(static_cast<uint32_t>(address->device_id)).protocols.value(protocol);
+            = d->devicesOf(owner).value(static_cast<uint32_t>(address->device_id)).protocols.value(protocol);
         if (state.session.isEmpty())
             return 0;
         *record = toSignalBuffer(state.session);
@@ -612,7 +624,7 @@ public:
             return SG_ERR_NOMEM;
         const auto owner   = Jid(QString::fromUtf8(name, static_cast<qsizetype>(nameLength))).bare();
         int        count   = 0;
-        const auto devices = d->data.devices.value(owner);
+        const auto devices = d->devicesOf(owner);
         for (auto it = devices.cbegin(); it != devices.cend(); ++it) {
             if (!it.value().protocols.value(protocol).session.isEmpty()) {
                 signal_int_list_push_back(list, static_cast<int>(it.key()));
@@ -630,7 +642,7 @@ public:
         const auto protocol = storeProtocol(userData);
         const auto owner    = Jid(addressName(address)).bare();
         const auto id       = static_cast<uint32_t>(address->device_id);
-        auto       device   = d->data.devices.value(owner).value(id);
+        auto       device   = d->devicesOf(owner).value(id);
         auto       state    = device.protocols.value(protocol);
         state.session       = bytes(record, recordLength);
         device.protocols.insert(protocol, state);
@@ -642,7 +654,7 @@ public:
         auto       d        = storeSelf(userData);
         const auto protocol = storeProtocol(userData);
         const auto owner    = Jid(addressName(address)).bare();
-        return !d->data.devices.value(owner)
+        return !d->devicesOf(owner)
                     .value(static_cast<uint32_t>(address->device_id))
                     .protocols.value(protocol)
                     .session.isEmpty();
@@ -654,7 +666,7 @@ public:
         const auto protocol = storeProtocol(userData);
         const auto owner    = Jid(addressName(address)).bare();
         const auto id       = static_cast<uint32_t>(address->device_id);
-        auto       device   = d->data.devices.value(owner).value(id);
+        auto       device   = d->devicesOf(owner).value(id);
         auto       state    = device.protocols.value(protocol);
         if (state.session.isEmpty())
             return 0;
@@ -669,7 +681,7 @@ public:
         const auto protocol = storeProtocol(userData);
         const auto owner    = Jid(QString::fromUtf8(name, static_cast<qsizetype>(nameLength))).bare();
         int        count    = 0;
-        auto       devices  = d->data.devices.value(owner);
+        auto       devices  = d->devicesOf(owner);
         for (auto it = devices.begin(); it != devices.end(); ++it) {
             auto state = it->protocols.value(protocol);
             if (!state.session.isEmpty()) {
@@ -796,7 +808,7 @@ public:
         const auto protocol = storeProtocol(userData);
         const auto owner    = Jid(addressName(address)).bare();
         const auto id       = static_cast<uint32_t>(address->device_id);
-        auto       device   = d->data.devices.value(owner).value(id);
+        auto       device   = d->devicesOf(owner).value(id);
         auto       state    = device.protocols.value(protocol);
         if (!keyData) {
             state.keyId.clear();
@@ -816,7 +828,7 @@ public:
         auto       d        = storeSelf(userData);
         const auto protocol = storeProtocol(userData);
         const auto owner    = Jid(addressName(address)).bare();
-        const auto existing = d->data.devices.value(owner)
+        const auto existing = d->devicesOf(owner)
                                   .value(static_cast<uint32_t>(address->device_id))
                                   .protocols.value(protocol)
                                   .keyId;
@@ -1393,7 +1405,7 @@ public:
                 *error = QStringLiteral("OMEMO device-list owner is invalid");
             return false;
         }
-        auto           previous = data.devices.value(bare);
+        auto           previous = devicesOf(bare);
         auto           next     = previous;
         QSet<uint32_t> activeIds;
 
@@ -1455,7 +1467,7 @@ public:
                 return false;
             }
         }
-        data.devices.insert(bare, next);
+        deviceCache.insert(bare, next);
         fetchedDeviceLists.insert(fetchedListKey(bare, protocol));
         for (const auto id : changedIds) {
             if (fullyRemovedIds.contains(id))
@@ -1478,7 +1490,7 @@ public:
             return document;
 
         const QString  ownBare = client->jid().bare();
-        const auto     known   = data.devices.value(ownBare);
+        const auto     known   = devicesOf(ownBare);
         QSet<uint32_t> ids;
         ids.insert(data.ownDevice->id);
         for (auto it = known.cbegin(); it != known.cend(); ++it) {
@@ -1517,7 +1529,7 @@ public:
     bool markOwnDeviceRetired(uint32_t deviceId, const QList<OmemoProtocol> &protocols, QString *error)
     {
         const auto ownBare = client->jid().bare();
-        auto       devices = data.devices.value(ownBare);
+        auto       devices = devicesOf(ownBare);
         auto       it      = devices.find(deviceId);
         if (it == devices.end()) {
             if (error)
@@ -1539,7 +1551,7 @@ public:
             return false;
         }
         it.value() = device;
-        data.devices.insert(ownBare, devices);
+        deviceCache.insert(ownBare, devices);
         if (wasActive && !deviceActive(device))
             emit q->deviceRemoved(Jid(ownBare), deviceId);
         else
@@ -1586,7 +1598,7 @@ public:
 
     bool hasSession(const QString &owner, uint32_t id, OmemoProtocol protocol) const
     {
-        const auto device = data.devices.value(Jid(owner).bare()).value(id);
+        const auto device = devicesOf(Jid(owner).bare()).value(id);
         return !device.protocols.value(protocol).session.isEmpty();
     }
 
@@ -1603,7 +1615,7 @@ public:
                 *error = QStringLiteral("Remote OMEMO identity key could not be decoded");
             return SG_ERR_INVALID_KEY;
         }
-        auto device = data.devices.value(bare).value(id);
+        auto device = devicesOf(bare).value(id);
         auto state  = device.protocols.value(protocol);
         if (!state.keyId.isEmpty() && state.keyId != storedIdentity) {
             if (error)
@@ -1866,7 +1878,7 @@ public:
     {
         OmemoProtocols result;
         const auto     bare    = Jid(owner).bare();
-        const auto     devices = data.devices.value(bare);
+        const auto     devices = devicesOf(bare);
         for (auto it = devices.cbegin(); it != devices.cend(); ++it) {
             if (supportedProtocols.testFlag(OmemoProtocol::Omemo2)
                 && protocolActive(it.value(), OmemoProtocol::Omemo2)) {
@@ -1894,7 +1906,7 @@ public:
     {
         QList<QPair<QString, uint32_t>> result;
         const auto                      bare    = Jid(owner).bare();
-        const auto                      devices = data.devices.value(bare);
+        const auto                      devices = devicesOf(bare);
         for (auto it = devices.cbegin(); it != devices.cend(); ++it) {
             if (!protocolActive(it.value(), protocol))
                 continue;
@@ -2044,7 +2056,7 @@ public:
                          QStringLiteral("Remote OMEMO identity key could not be decoded"));
                 return;
             }
-            auto device = data.devices.value(bare).value(id);
+            auto device = devicesOf(bare).value(id);
             auto state  = device.protocols.value(protocol);
             if (!state.keyId.isEmpty() && state.keyId != stored) {
                 callback(false, EncryptionJob::Error::AuthenticationFailed,
@@ -2139,7 +2151,7 @@ public:
                                 }
 
                                 auto       prepared = metadata;
-                                const auto device   = data.devices.value(sender.bare()).value(deviceId);
+                                const auto device   = devicesOf(sender.bare()).value(deviceId);
                                 const auto state    = device.protocols.value(protocol);
                                 const auto identity = wireIdentityFromStored(state.keyId, OmemoProtocol::Omemo2);
                                 if (identity.isEmpty()) {
@@ -2195,7 +2207,7 @@ public:
             return;
         }
         if (hasSession(target.first, target.second, protocol)) {
-            const auto device = data.devices.value(target.first).value(target.second);
+            const auto device = devicesOf(target.first).value(target.second);
             const auto state  = device.protocols.value(protocol);
             const auto wire   = wireIdentityFromStored(state.keyId, OmemoProtocol::Omemo2);
             if (!wire.isEmpty() && identityAccepted(target.first, wire)) {
@@ -2824,7 +2836,7 @@ public:
             restoredStanza   = restoredDocument.documentElement();
         }
 
-        auto       device          = d->data.devices.value(sender.bare()).value(senderDevice);
+        auto       device          = d->devicesOf(sender.bare()).value(senderDevice);
         auto       state           = device.protocols.value(protocol);
         const bool firstForRatchet = !ratchetKey.isEmpty() && state.lastReceivedRatchetKey != ratchetKey;
         bool       deviceChanged   = false;
@@ -2992,13 +3004,16 @@ OmemoProtocols OmemoEncryption::protocolsFor(const Jid &fullJid) const
     OmemoProtocols result;
     if (!d->client || !fullJid.isValid() || fullJid.resource().isEmpty())
         return result;
+    static const Features::Key omemo2(namespaceUri());
+    static const Features::Key omemo2Notify(devicesNode() + QStringLiteral("+notify"));
+    static const Features::Key legacyNotify(legacyDevicesNode() + QStringLiteral("+notify"));
+
     const auto features = d->client->capsManager()->features(fullJid);
     if (d->supportedProtocols.testFlag(OmemoProtocol::Omemo2)
-        && (features.test(namespaceUri()) || features.test(devicesNode() + QStringLiteral("+notify")))) {
+        && (features.test(omemo2) || features.test(omemo2Notify))) {
         result |= OmemoProtocol::Omemo2;
     }
-    if (d->supportedProtocols.testFlag(OmemoProtocol::Legacy)
-        && features.test(legacyDevicesNode() + QStringLiteral("+notify"))) {
+    if (d->supportedProtocols.testFlag(OmemoProtocol::Legacy) && features.test(legacyNotify)) {
         result |= OmemoProtocol::Legacy;
     }
     return result;
@@ -3042,10 +3057,11 @@ QList<OmemoDeviceInfo> OmemoEncryption::devices(const Jid &owner) const
     };
     if (owner.isValid()) {
         const auto bare = owner.bare();
-        appendOwner(bare, d->data.devices.value(bare));
+        appendOwner(bare, d->devicesOf(bare));
     } else {
-        for (auto it = d->data.devices.cbegin(); it != d->data.devices.cend(); ++it)
-            appendOwner(it.key(), it.value());
+        const auto owners = d->storage->deviceOwners();
+        for (const auto &bare : owners)
+            appendOwner(bare, d->devicesOf(bare));
     }
     return result;
 }
@@ -3128,7 +3144,7 @@ EncryptionJob *OmemoEncryption::setUp(const QString &deviceLabel)
                 guarded->fail(EncryptionJob::Error::StorageError, QStringLiteral("OMEMO local device is unavailable"));
                 return;
             }
-            const auto known    = d->data.devices.value(self);
+            const auto known    = d->devicesOf(self);
             const auto existing = known.constFind(d->data.ownDevice->id);
             bool collision = existing != known.cend() && Private::protocolActive(*existing, OmemoProtocol::Omemo2);
             if (d->supportedProtocols.testFlag(OmemoProtocol::Legacy))
@@ -3473,7 +3489,7 @@ EncryptionJob *OmemoEncryption::retireOwnDevice(uint32_t deviceId, OmemoProtocol
     }
 
     const auto ownBare = d->client->jid().bare();
-    const auto known   = d->data.devices.value(ownBare);
+    const auto known   = d->devicesOf(ownBare);
     const auto device  = known.constFind(deviceId);
     if (device == known.cend() || !Private::protocolActive(*device, protocol)) {
         job->fail(EncryptionJob::Error::InvalidInput,
@@ -3521,7 +3537,7 @@ EncryptionJob *OmemoEncryption::retireOwnDevice(uint32_t deviceId)
     }
 
     const auto ownBare = d->client->jid().bare();
-    const auto known   = d->data.devices.value(ownBare);
+    const auto known   = d->devicesOf(ownBare);
     const auto device  = known.constFind(deviceId);
     if (device == known.cend()) {
         job->fail(EncryptionJob::Error::InvalidInput, QStringLiteral("OMEMO device is not known for this account"));
@@ -3727,7 +3743,8 @@ bool OmemoEncryption::resetAllLocally()
 {
     if (!d->storage->resetAll())
         return false;
-    d->data = d->storage->allData();
+    d->data = d->storage->ownData();
+    d->deviceCache.clear();
     d->fetchedDeviceLists.clear();
     d->updateReady();
     return true;
@@ -10,10 +10,60 @@
 
 #include "xmpp_omemostorage.h"
 
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
 namespace XMPP {
 
+OmemoStorage::OmemoData OmemoStorage::ownData() const
+{
+    auto data = allData();
+    data.devices.clear();
+    return data;
+}
+
+QStringList OmemoStorage::deviceOwners() const { return allData().devices.keys(); }
+
+QHash<uint32_t, OmemoStorage::Device> OmemoStorage::devices(const QString &jid) const
+{
+    return allData().devices.value(jid);
+}
+
+std::optional<OmemoStorage::Device> OmemoStorage::device(const QString &jid, uint32_t deviceId) const
+{
+    const auto devs = devices(jid);
+    auto       it   = devs.constFind(deviceId);
+    if (it == devs.cend())
+        return std::nullopt;
+    return *it;
+}
+
 OmemoStorage::OmemoData MemoryOmemoStorage::allData() const { return data_; }
 
+OmemoStorage::OmemoData MemoryOmemoStorage::ownData() const
+{
+    return { data_.ownDevice, data_.signedPreKeyPairs, data_.preKeyPairs, {} };
+}
+
+QStringList MemoryOmemoStorage::deviceOwners() const { return data_.devices.keys(); }
+
+QHash<uint32_t, OmemoStorage::Device> MemoryOmemoStorage::devices(const QString &jid) const
+{
+    return data_.devices.value(jid);
+}
+
+std::optional<OmemoStorage::Device> MemoryOmemoStorage::device(const QString &jid, uint32_t deviceId) const
+{
+    auto owner = data_.devices.constFind(jid);
+    if (owner == data_.devices.cend())
+        return std::nullopt;
+    auto it = owner->constFind(deviceId);
+    if (it == owner->cend())
+        return std::nullopt;
+    return *it;
+}
+
 bool MemoryOmemoStorage::setOwnDevice(const std::optional<OwnDevice> &device)
 {
     data_.ownDevice = device;
@@ -74,4 +124,467 @@ bool MemoryOmemoStorage::resetAll()
     return true;
 }
 
+// FileOmemoStorage log: an 8 byte magic followed by records of
+//   quint8 type, QString jid, quint32 id, quint32 value size, value
+// jid and id are the key of the record and stay empty/0 where the type doesn't need them.
+// Values are QDataStream serializations too, except pre-keys which are stored as is.
+static const char          LogMagic[8]       = { 'I', 'R', 'I', 'S', 'O', 'M', 'L', '1' };
+static constexpr auto      LogVersion        = QDataStream::Qt_5_12;
+static constexpr int       CompactMinRecords = 1024;
+static constexpr qsizetype LogMagicSize      = qsizetype(sizeof(LogMagic));
+
+enum class LogRecord : quint8 {
+    OwnDevice = 1,
+    SignedPreKey,
+    RemoveSignedPreKey,
+    PreKey,
+    RemovePreKey,
+    Device,
+    RemoveDevice,
+    RemoveDevices,
+    Reset
+};
+
+// appends a record to 'buf' and returns the position of its value within 'buf'
+static qint64 writeRecord(QByteArray &buf, LogRecord type, const QString &jid, quint32 id, const QByteArray &value)
+{
+    QDataStream s(&buf, QIODevice::WriteOnly | QIODevice::Append);
+    s.setVersion(LogVersion);
+    s << quint8(type) << jid << id << quint32(value.size());
+    const qint64 pos = buf.size();
+    s.writeRawData(value.constData(), int(value.size()));
+    return pos;
+}
+
+static QByteArray serializeOwnDevice(const std::optional<OmemoStorage::OwnDevice> &device)
+{
+    QByteArray  value;
+    QDataStream s(&value, QIODevice::WriteOnly);
+    s.setVersion(LogVersion);
+    s << device.has_value();
+    if (device)
+        s << device->id << device->label << device->privateIdentityKey << device->publicIdentityKey
+          << device->latestSignedPreKeyId << device->latestPreKeyId;
+    return value;
+}
+
+static bool parseOwnDevice(const QByteArray &value, std::optional<OmemoStorage::OwnDevice> &device)
+{
+    QDataStream s(value);
+    s.setVersion(LogVersion);
+    bool present = false;
+    s >> present;
+    if (!present) {
+        device.reset();
+        return s.status() == QDataStream::Ok;
+    }
+    OmemoStorage::OwnDevice own;
+    s >> own.id >> own.label >> own.privateIdentityKey >> own.publicIdentityKey >> own.latestSignedPreKeyId
+        >> own.latestPreKeyId;
+    if (s.status() != QDataStream::Ok)
+        return false;
+    device = own;
+    return true;
+}
+
+static QByteArray serializeSignedPreKey(const OmemoStorage::SignedPreKeyPair &pair)
+{
+    QByteArray  value;
+    QDataStream s(&value, QIODevice::WriteOnly);
+    s.setVersion(LogVersion);
+    s << pair.creationDate << pair.data;
+    return value;
+}
+
+static bool parseSignedPreKey(const QByteArray &value, OmemoStorage::SignedPreKeyPair &pair)
+{
+    QDataStream s(value);
+    s.setVersion(LogVersion);
+    s >> pair.creationDate >> pair.data;
+    return s.status() == QDataStream::Ok;
+}
+
+static QByteArray serializeDevice(const OmemoStorage::Device &device)
+{
+    QByteArray  value;
+    QDataStream s(&value, QIODevice::WriteOnly);
+    s.setVersion(LogVersion);
+    s << quint32(device.protocols.size());
+    for (auto it = device.protocols.cbegin(); it != device.protocols.cend(); ++it) {
+        const auto &state = it.value();
+        s << quint8(it.key()) << state.label << state.labelSignature << state.labelVerified << state.keyId
+          << state.session << state.lastReceivedRatchetKey << qint32(state.unrespondedSentStanzasCount)
+          << qint32(state.unrespondedReceivedStanzasCount) << state.removalFromDeviceListDate;
+    }
+    return value;
+}
+
+static std::optional<OmemoStorage::Device> parseDevice(const QByteArray &value)
+{
+    QDataStream s(value);
+    s.setVersion(LogVersion);
+    quint32 count = 0;
+    s >> count;
+    OmemoStorage::Device device;
+    for (quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i) {
+        quint8                            protocol = 0;
+        qint32                            sent = 0, received = 0;
+        OmemoStorage::DeviceProtocolState state;
+        s >> protocol >> state.label >> state.labelSignature >> state.labelVerified >> state.keyId >> state.session
+            >> state.lastReceivedRatchetKey >> sent >> received >> state.removalFromDeviceListDate;
+        state.unrespondedSentStanzasCount     = sent;
+        state.unrespondedReceivedStanzasCount = received;
+        device.protocols.insert(OmemoProtocol(protocol), state);
+    }
+    if (s.status() != QDataStream::Ok)
+        return std::nullopt;
+    return device;
+}
+
+class FileOmemoStorage::Private {
+public:
+    // where the value of a device record is in the log
+    struct Position {
+        qint64  offset = 0;
+        quint32 size   = 0;
+    };
+    using Index = QHash<QString, QHash<uint32_t, Position>>;
+
+    QString   fileName;
+    QFile     file;
+    bool      open = false;
+    OmemoData own; // devices stay empty, see index
+    Index     index;
+    int       deviceCount = 0;
+    int       records     = 0; // in the log, superseded ones included
+
+    int liveRecords() const
+    {
+        return 1 + int(own.signedPreKeyPairs.size()) + int(own.preKeyPairs.size()) + deviceCount;
+    }
+
+    bool load()
+    {
+        if (!file.open(QIODevice::ReadWrite))
+            return false;
+        if (file.size() == 0) {
+            // it holds the private identity key
+            file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+            return file.write(LogMagic, LogMagicSize) == LogMagicSize && file.flush();
+        }
+        if (file.read(LogMagicSize) != QByteArray::fromRawData(LogMagic, LogMagicSize)) {
+            qWarning("FileOmemoStorage: %s is not an OMEMO log", qPrintable(fileName));
+            file.close();
+            return false;
+        }
+
+        QDataStream s(&file);
+        s.setVersion(LogVersion);
+        qint64 good = file.pos();
+        while (!s.atEnd()) {
+            quint8  type = 0;
+            QString jid;
+            quint32 id = 0, size = 0;
+            s >> type >> jid >> id >> size;
+            const qint64 valuePos = file.pos();
+            if (s.status() != QDataStream::Ok || valuePos + qint64(size) > file.size())
+                break;
+            QByteArray value;
+            if (LogRecord(type) == LogRecord::Device) {
+                // sessions are the bulk of the log. they are read when asked for
+                if (!file.seek(valuePos + size))
+                    break;
+                apply(LogRecord::Device, jid, id, value, { valuePos, size });
+            } else {
+                value.resize(int(size));
+                if (s.readRawData(value.data(), int(size)) != int(size))
+                    break;
+                // the length is fine, so the records after it are still reachable
+                if (!apply(LogRecord(type), jid, id, value, {}))
+                    qWarning("FileOmemoStorage: skipping a damaged record at %lld of %s", valuePos,
+                             qPrintable(fileName));
+            }
+            good = file.pos();
+            ++records;
+        }
+        if (good != file.size()) {
+            qWarning("FileOmemoStorage: dropping an incomplete record at the end of %s", qPrintable(fileName));
+            file.resize(good);
+        }
+        return true;
+    }
+
+    // updates the in-memory state with a record already in the log
+    bool apply(LogRecord type, const QString &jid, quint32 id, const QByteArray &value, Position position)
+    {
+        switch (type) {
+        case LogRecord::OwnDevice:
+            return parseOwnDevice(value, own.ownDevice);
+        case LogRecord::SignedPreKey: {
+            SignedPreKeyPair pair;
+            if (!parseSignedPreKey(value, pair))
+                return false;
+            own.signedPreKeyPairs.insert(id, pair);
+            return true;
+        }
+        case LogRecord::RemoveSignedPreKey:
+            own.signedPreKeyPairs.remove(id);
+            return true;
+        case LogRecord::PreKey:
+            own.preKeyPairs.insert(id, value);
+            return true;
+        case LogRecord::RemovePreKey:
+            own.preKeyPairs.remove(id);
+            return true;
+        case LogRecord::Device: {
+            auto &devices = index[jid];
+            if (!devices.contains(id))
+                ++deviceCount;
+            devices.insert(id, position);
+            return true;
+        }
+        case LogRecord::RemoveDevice: {
+            auto it = index.find(jid);
+            if (it != index.end() && it->remove(id)) {
+                --deviceCount;
+                if (it->isEmpty())
+                    index.erase(it);
+            }
+            return true;
+        }
+        case LogRecord::RemoveDevices: {
+            auto it = index.find(jid);
+            if (it != index.end()) {
+                deviceCount -= int(it->size());
+                index.erase(it);
+            }
+            return true;
+        }
+        case LogRecord::Reset:
+            own         = {};
+            index       = {};
+            deviceCount = 0;
+            return true;
+        }
+        return true; // written by a newer version. ignore
+    }
+
+    bool append(const QByteArray &buf)
+    {
+        const qint64 end = file.size();
+        if (!file.seek(end) || file.write(buf) != buf.size() || !file.flush()) {
+            file.resize(end);
+            return false;
+        }
+        return true;
+    }
+
+    bool write(LogRecord type, const QString &jid, quint32 id, const QByteArray &value)
+    {
+        if (!open)
+            return false;
+        QByteArray   buf;
+        const qint64 valuePos = writeRecord(buf, type, jid, id, value);
+        const qint64 base     = file.size();
+        if (!append(buf))
+            return false;
+        apply(type, jid, id, value, { base + valuePos, quint32(value.size()) });
+        ++records;
+        maybeCompact();
+        return true;
+    }
+
+    void maybeCompact()
+    {
+        if (records > CompactMinRecords && records > 2 * liveRecords())
+            compact();
+    }
+
+    QByteArray readValue(Position position)
+    {
+        if (!file.seek(position.offset))
+            return {};
+        QByteArray value = file.read(position.size);
+        if (value.size() != qsizetype(position.size))
+            return {};
+        return value;
+    }
+
+    std::optional<Device> readDevice(const QString &jid, uint32_t id, Position position)
+    {
+        auto device = parseDevice(readValue(position));
+        if (!device)
+            qWarning("FileOmemoStorage: can't read device %u of %s", id, qPrintable(jid));
+        return device;
+    }
+
+    bool compact()
+    {
+        QSaveFile out(fileName);
+        if (!out.open(QIODevice::WriteOnly) || out.write(LogMagic, LogMagicSize) != LogMagicSize)
+            return false;
+        out.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+        QByteArray buf;
+        int        count = 0;
+        auto       flush = [&]() {
+            bool ok = out.write(buf) == buf.size();
+            buf.clear();
+            return ok;
+        };
+        if (own.ownDevice) {
+            writeRecord(buf, LogRecord::OwnDevice, {}, 0, serializeOwnDevice(own.ownDevice));
+            ++count;
+        }
+        for (auto it = own.signedPreKeyPairs.cbegin(); it != own.signedPreKeyPairs.cend(); ++it, ++count)
+            writeRecord(buf, LogRecord::SignedPreKey, {}, it.key(), serializeSignedPreKey(it.value()));
+        for (auto it = own.preKeyPairs.cbegin(); it != own.preKeyPairs.cend(); ++it, ++count)
+            writeRecord(buf, LogRecord::PreKey, {}, it.key(), it.value());
+        if (!flush())
+            return false;
+
+        Index compacted;
+        for (auto owner = index.cbegin(); owner != index.cend(); ++owner) {
+            auto &devices = compacted[owner.key()];
+            for (auto it = owner->cbegin(); it != owner->cend(); ++it, ++count) {
+                const auto value = readValue(it.value());
+                if (value.size() != qsizetype(it->size))
+                    return false;
+                const qint64 base = out.pos();
+                devices.insert(it.key(),
+                               { base + writeRecord(buf, LogRecord::Device, owner.key(), it.key(), value), it->size });
+                if (!flush())
+                    return false;
+            }
+        }
+        if (!out.commit())
+            return false;
+
+        file.close();
+        if (!file.open(QIODevice::ReadWrite)) {
+            qWarning("FileOmemoStorage: can't reopen %s after compaction", qPrintable(fileName));
+            open = false;
+            return false;
+        }
+        index   = compacted;
+        records = count;
+        return true;
+    }
+};
+
+FileOmemoStorage::FileOmemoStorage(const QString &fileName) : d(std::make_unique<Private>())
+{
+    d->fileName = fileName;
+    d->file.setFileName(fileName);
+    d->open = d->load();
+}
+
+FileOmemoStorage::~FileOmemoStorage() = default;
+
+bool FileOmemoStorage::isOpen() const { return d->open; }
+
+bool FileOmemoStorage::compact() { return d->open && d->compact(); }
+
+OmemoStorage::OmemoData FileOmemoStorage::allData() const
+{
+    OmemoData data = d->own;
+    for (auto owner = d->index.cbegin(); owner != d->index.cend(); ++owner) {
+        for (auto it = owner->cbegin(); it != owner->cend(); ++it) {
+            auto device = d->readDevice(owner.key(), it.key(), it.value());
+            if (device)
+                data.devices[owner.key()].insert(it.key(), *device);
+        }
+    }
+    return data;
+}
+
+OmemoStorage::OmemoData FileOmemoStorage::ownData() const { return d->own; }
+
+QStringList FileOmemoStorage::deviceOwners() const { return d->index.keys(); }
+
+QHash<uint32_t, OmemoStorage::Device> FileOmemoStorage::devices(const QString &jid) const
+{
+    QHash<uint32_t, Device> result;
+    const auto              positions = d->index.value(jid);
+    for (auto it = positions.cbegin(); it != positions.cend(); ++it) {
+        auto device = d->readDevice(jid, it.key(), it.value());
+        if (device)
+            result.insert(it.key(), *device);
+    }
+    return result;
+}
+
+std::optional<OmemoStorage::Device> FileOmemoStorage::device(const QString &jid, uint32_t deviceId) const
+{
+    auto owner = d->index.constFind(jid);
+    if (owner == d->index.cend())
+        return std::nullopt;
+    auto it = owner->constFind(deviceId);
+    if (it == owner->cend())
+        return std::nullopt;
+    return d->readDevice(jid, deviceId, it.value());
+}
+
+bool FileOmemoStorage::setOwnDevice(const std::optional<OwnDevice> &device)
+{
+    return d->write(LogRecord::OwnDevice, {}, 0, serializeOwnDevice(device));
+}
+
+bool FileOmemoStorage::addSignedPreKeyPair(uint32_t keyId, const SignedPreKeyPair &keyPair)
+{
+    return d->write(LogRecord::SignedPreKey, {}, keyId, serializeSignedPreKey(keyPair));
+}
+
+bool FileOmemoStorage::removeSignedPreKeyPair(uint32_t keyId)
+{
+    if (!d->own.signedPreKeyPairs.contains(keyId))
+        return d->open;
+    return d->write(LogRecord::RemoveSignedPreKey, {}, keyId, {});
+}
+
+bool FileOmemoStorage::addPreKeyPairs(const QHash<uint32_t, QByteArray> &keyPairs)
+{
+    if (!d->open)
+        return false;
+    // one write for the whole batch, so it's stored completely or not at all
+    QByteArray buf;
+    for (auto it = keyPairs.cbegin(); it != keyPairs.cend(); ++it)
+        writeRecord(buf, LogRecord::PreKey, {}, it.key(), it.value());
+    if (!d->append(buf))
+        return false;
+    for (auto it = keyPairs.cbegin(); it != keyPairs.cend(); ++it)
+        d->own.preKeyPairs.insert(it.key(), it.value());
+    d->records += int(keyPairs.size());
+    d->maybeCompact();
+    return true;
+}
+
+bool FileOmemoStorage::removePreKeyPair(uint32_t keyId)
+{
+    if (!d->own.preKeyPairs.contains(keyId))
+        return d->open;
+    return d->write(LogRecord::RemovePreKey, {}, keyId, {});
+}
+
+bool FileOmemoStorage::addDevice(const QString &jid, uint32_t deviceId, const Device &device)
+{
+    return d->write(LogRecord::Device, jid, deviceId, serializeDevice(device));
+}
+
+bool FileOmemoStorage::removeDevice(const QString &jid, uint32_t deviceId)
+{
+    if (!d->index.value(jid).contains(deviceId))
+        return d->open;
+    return d->write(LogRecord::RemoveDevice, jid, deviceId, {});
+}
+
+bool FileOmemoStorage::removeDevices(const QString &jid)
+{
+    if (!d->index.contains(jid))
+        return d->open;
+    return d->write(LogRecord::RemoveDevices, jid, 0, {});
+}
+
+bool FileOmemoStorage::resetAll() { return d->write(LogRecord::Reset, {}, 0, {}); }
+
 } // namespace XMPP
@@ -17,8 +17,10 @@
 #include <QHash>
 #include <QMap>
 #include <QString>
+#include <QStringList>
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 
 namespace XMPP {
@@ -41,6 +43,10 @@ Q_DECLARE_OPERATORS_FOR_FLAGS(OmemoProtocols)
  * synchronous as well. Implementations should normally keep an in-memory
  * authoritative copy and persist mutations atomically, as AnyKeep already does
  * for its QXmpp-backed OMEMO storage.
+ *
+ * The engine reads the own device and key pairs once and remote devices per
+ * bare jid on first use, so a backend with a lot of state should override the
+ * incremental getters below. Their defaults go through allData().
  */
 class OmemoStorage {
 public:
@@ -103,6 +109,12 @@ public:
     virtual OmemoData allData() const                                      = 0;
     virtual bool      setOwnDevice(const std::optional<OwnDevice> &device) = 0;
 
+    // own device and key pairs only, 'devices' is left empty
+    virtual OmemoData               ownData() const;
+    virtual QStringList             deviceOwners() const;
+    virtual QHash<uint32_t, Device> devices(const QString &jid) const;
+    virtual std::optional<Device>   device(const QString &jid, uint32_t deviceId) const;
+
     virtual bool addSignedPreKeyPair(uint32_t keyId, const SignedPreKeyPair &keyPair) = 0;
     virtual bool removeSignedPreKeyPair(uint32_t keyId)                               = 0;
 
@@ -118,21 +130,66 @@ public:
 /** Volatile storage implementation suitable for tests and ephemeral clients. */
 class MemoryOmemoStorage final : public OmemoStorage {
 public:
-    OmemoData allData() const override;
-    bool      setOwnDevice(const std::optional<OwnDevice> &device) override;
-    bool      addSignedPreKeyPair(uint32_t keyId, const SignedPreKeyPair &keyPair) override;
-    bool      removeSignedPreKeyPair(uint32_t keyId) override;
-    bool      addPreKeyPairs(const QHash<uint32_t, QByteArray> &keyPairs) override;
-    bool      removePreKeyPair(uint32_t keyId) override;
-    bool      addDevice(const QString &jid, uint32_t deviceId, const Device &device) override;
-    bool      removeDevice(const QString &jid, uint32_t deviceId) override;
-    bool      removeDevices(const QString &jid) override;
-    bool      resetAll() override;
+    OmemoData               allData() const override;
+    OmemoData               ownData() const override;
+    QStringList             deviceOwners() const override;
+    QHash<uint32_t, Device> devices(const QString &jid) const override;
+    std::optional<Device>   device(const QString &jid, uint32_t deviceId) const override;
+    bool                    setOwnDevice(const std::optional<OwnDevice> &device) override;
+    bool                    addSignedPreKeyPair(uint32_t keyId, const SignedPreKeyPair &keyPair) override;
+    bool                    removeSignedPreKeyPair(uint32_t keyId) override;
+    bool                    addPreKeyPairs(const QHash<uint32_t, QByteArray> &keyPairs) override;
+    bool                    removePreKeyPair(uint32_t keyId) override;
+    bool                    addDevice(const QString &jid, uint32_t deviceId, const Device &device) override;
+    bool                    removeDevice(const QString &jid, uint32_t deviceId) override;
+    bool                    removeDevices(const QString &jid) override;
+    bool                    resetAll() override;
 
 private:
     OmemoData data_;
 };
 
+/**
+ * Storage kept in an append-only log file.
+ *
+ * Every mutation is appended and flushed before it becomes visible, so a crash
+ * loses at most the record being written; a torn record at the end of the log
+ * is cut off on the next open. Opening reads the own device and key pairs only.
+ * Remote devices are indexed by their position in the log and read from disk
+ * when asked for, so startup does not depend on the number of sessions.
+ *
+ * Once superseded records make up most of the log it is rewritten with the
+ * live ones (see compact()).
+ */
+class FileOmemoStorage final : public OmemoStorage {
+public:
+    explicit FileOmemoStorage(const QString &fileName);
+    ~FileOmemoStorage() override;
+
+    // false if the file can't be opened or isn't an OMEMO log
+    bool isOpen() const;
+    bool compact();
+
+    OmemoData               allData() const override;
+    OmemoData               ownData() const override;
+    QStringList             deviceOwners() const override;
+    QHash<uint32_t, Device> devices(const QString &jid) const override;
+    std::optional<Device>   device(const QString &jid, uint32_t deviceId) const override;
+    bool                    setOwnDevice(const std::optional<OwnDevice> &device) override;
+    bool                    addSignedPreKeyPair(uint32_t keyId, const SignedPreKeyPair &keyPair) override;
+    bool                    removeSignedPreKeyPair(uint32_t keyId) override;
+    bool                    addPreKeyPairs(const QHash<uint32_t, QByteArray> &keyPairs) override;
+    bool                    removePreKeyPair(uint32_t keyId) override;
+    bool                    addDevice(const QString &jid, uint32_t deviceId, const Device &device) override;
+    bool                    removeDevice(const QString &jid, uint32_t deviceId) override;
+    bool                    removeDevices(const QString &jid) override;
+    bool                    resetAll() override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
 } // namespace XMPP
 
 #endif // XMPP_OMEMOSTORAGE_H
@@ -73,7 +73,10 @@ public:
     QList<PubSubItem>   items;
 };
 
-PubSubItemsTask::PubSubItemsTask(Task *parent) : Task(parent), d(std::make_unique<Private>()) { }
+PubSubItemsTask::PubSubItemsTask(Task *parent) : Task(parent), d(std::make_unique<Private>())
+{
+    setIndexedRouting();
+}
 PubSubItemsTask::~PubSubItemsTask() = default;
 
 void PubSubItemsTask::get(const Jid &service, const QString &node, const QStringList &itemIds, int maxItems)
@@ -143,7 +146,10 @@ public:
     QString       publishedId;
 };
 
-PubSubPublishTask::PubSubPublishTask(Task *parent) : Task(parent), d(std::make_unique<Private>()) { }
+PubSubPublishTask::PubSubPublishTask(Task *parent) : Task(parent), d(std::make_unique<Private>())
+{
+    setIndexedRouting();
+}
 PubSubPublishTask::~PubSubPublishTask() = default;
 
 void PubSubPublishTask::publish(const Jid &service, const QString &node, const PubSubItem &item,
@@ -208,7 +214,10 @@ public:
     PubSubOptions options;
 };
 
-PubSubCreateTask::PubSubCreateTask(Task *parent) : Task(parent), d(std::make_unique<Private>()) { }
+PubSubCreateTask::PubSubCreateTask(Task *parent) : Task(parent), d(std::make_unique<Private>())
+{
+    setIndexedRouting();
+}
 PubSubCreateTask::~PubSubCreateTask() = default;
 
 void PubSubCreateTask::create(const Jid &service, const QString &node, const PubSubOptions &nodeOptions)
@@ -259,7 +268,10 @@ public:
     PubSubOptions options;
 };
 
-PubSubNodeConfigTask::PubSubNodeConfigTask(Task *parent) : Task(parent), d(std::make_unique<Private>()) { }
+PubSubNodeConfigTask::PubSubNodeConfigTask(Task *parent) : Task(parent), d(std::make_unique<Private>())
+{
+    setIndexedRouting();
+}
 PubSubNodeConfigTask::~PubSubNodeConfigTask() = default;
 
 void PubSubNodeConfigTask::get(const Jid &service, const QString &node)
@@ -315,7 +327,10 @@ bool PubSubNodeConfigTask::take(const QDomElement &stanza)
     return true;
 }
 
-PubSubConfigureTask::PubSubConfigureTask(Task *parent) : Task(parent), d(std::make_unique<Private>()) { }
+PubSubConfigureTask::PubSubConfigureTask(Task *parent) : Task(parent), d(std::make_unique<Private>())
+{
+    setIndexedRouting();
+}
 PubSubConfigureTask::~PubSubConfigureTask() = default;
 
 void PubSubConfigureTask::configure(const Jid &service, const QString &node, const PubSubOptions &nodeOptions)
@@ -356,7 +371,10 @@ public:
     bool    notify = true;
 };
 
-PubSubRetractTask::PubSubRetractTask(Task *parent) : Task(parent), d(std::make_unique<Private>()) { }
+PubSubRetractTask::PubSubRetractTask(Task *parent) : Task(parent), d(std::make_unique<Private>())
+{
+    setIndexedRouting();
+}
 PubSubRetractTask::~PubSubRetractTask() = default;
 
 void PubSubRetractTask::retract(const Jid &service, const QString &node, const QString &itemId, bool notify)
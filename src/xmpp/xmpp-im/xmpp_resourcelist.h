@@ -21,11 +21,15 @@
 
 #include <iris/xmpp-im/xmpp_resource.h>
 
+#include <QHash>
 #include <QList>
 
 class QString;
 
 namespace XMPP {
+// Longer lists get a name => position index. Modify the list with the methods
+// below rather than the QList ones, or the index is rebuilt on the next lookup.
+// Items replaced in place are still found, but a name missing from the index costs a linear scan.
 class ResourceList : public QList<Resource> {
 public:
     ResourceList();
@@ -36,6 +40,20 @@ public:
 
     ResourceList::ConstIterator find(const QString &) const;
     ResourceList::ConstIterator priority() const;
+
+    using QList<Resource>::erase;
+    void                   append(const Resource &);
+    ResourceList          &operator+=(const Resource &);
+    ResourceList::Iterator erase(ResourceList::Iterator);
+    void                   removeAt(qsizetype i);
+    void                   clear();
+
+private:
+    qsizetype position(const QString &name) const;
+    void      rebuildIndex() const;
+
+    mutable QHash<QString, qsizetype> v_index;
+    mutable qsizetype                 v_indexedSize = -1; // size() the index was valid for, or -1
 };
 } // namespace XMPP
 
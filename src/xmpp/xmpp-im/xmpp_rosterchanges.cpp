@@ -0,0 +1,89 @@
+/*
+ * xmpp_rosterchanges.cpp - batched roster and presence changes
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp_rosterchanges.h"
+
+namespace XMPP {
+void RosterChangeSet::addItem(Change::Type type, const RosterItem &item)
+{
+    ++events_;
+    QString key = QLatin1Char('i') + item.jid().bare();
+    auto    it  = index_.constFind(key);
+    if (it == index_.constEnd()) {
+        append(key, { type, item, {}, {} });
+        return;
+    }
+
+    Change &c = changes_[*it];
+    if (c.type == Change::ItemAdded) {
+        if (type == Change::ItemRemoved)
+            removeAt(*it); // nobody has seen it
+        else
+            c.item = item;
+        return;
+    }
+    c.type = type == Change::ItemAdded ? Change::ItemUpdated : type; // the receiver knows it already
+    c.item = item;
+}
+
+void RosterChangeSet::addResource(bool available, const Jid &j, const Resource &r)
+{
+    ++events_;
+    QString key  = QLatin1Char('r') + j.full();
+    auto    type = available ? Change::ResourceAvailable : Change::ResourceUnavailable;
+    auto    it   = index_.constFind(key);
+    if (it == index_.constEnd()) {
+        append(key, { type, {}, j, r });
+        return;
+    }
+
+    // the receiver may know the resource from an earlier batch, so it's the last state what matters
+    Change &c  = changes_[*it];
+    c.type     = type;
+    c.resource = r;
+}
+
+void RosterChangeSet::clear()
+{
+    changes_.clear();
+    index_.clear();
+    events_  = 0;
+    latency_ = 0;
+}
+
+void RosterChangeSet::append(const QString &key, const Change &c)
+{
+    index_.insert(key, changes_.size());
+    changes_.append(c);
+}
+
+void RosterChangeSet::removeAt(qsizetype i)
+{
+    changes_.removeAt(i);
+    for (auto it = index_.begin(); it != index_.end();) {
+        if (*it == i)
+            it = index_.erase(it);
+        else {
+            if (*it > i)
+                --*it;
+            ++it;
+        }
+    }
+}
+} // namespace XMPP
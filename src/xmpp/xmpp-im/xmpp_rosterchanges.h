@@ -0,0 +1,73 @@
+/*
+ * xmpp_rosterchanges.h - batched roster and presence changes
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef XMPP_ROSTERCHANGES_H
+#define XMPP_ROSTERCHANGES_H
+
+#include <iris/jid/jid.h>
+#include <iris/xmpp-im/xmpp_resource.h>
+#include <iris/xmpp-im/xmpp_rosteritem.h>
+
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+
+namespace XMPP {
+// Roster and presence changes collected by Client while change batching is on
+// (see Client::setChangeBatching()). Repeated changes of the same roster item or
+// resource are merged, so each of them is reported once, in its final state and
+// at the position of its first change.
+class RosterChangeSet {
+public:
+    struct Change {
+        enum Type { ItemAdded, ItemUpdated, ItemRemoved, ResourceAvailable, ResourceUnavailable };
+
+        Type       type = ItemUpdated;
+        RosterItem item;     // Item*
+        Jid        jid;      // Resource*, full jid of the resource
+        Resource   resource; // Resource*
+    };
+
+    void addItem(Change::Type type, const RosterItem &item);
+    void addResource(bool available, const Jid &j, const Resource &r);
+    void clear();
+
+    inline bool                 isEmpty() const { return changes_.isEmpty(); }
+    inline qsizetype            size() const { return changes_.size(); }
+    inline const QList<Change> &changes() const { return changes_; }
+
+    // metrics of the batch
+    inline int    eventCount() const { return events_; } // changes before merging
+    inline qint64 latency() const { return latency_; }   // msecs from the first change to delivery
+    inline void   setLatency(qint64 msecs) { latency_ = msecs; }
+
+private:
+    void append(const QString &key, const Change &c);
+    void removeAt(qsizetype i);
+
+    QList<Change>             changes_;
+    QHash<QString, qsizetype> index_; // "i"+bare jid for items, "r"+full jid for resources
+    int                       events_  = 0;
+    qint64                    latency_ = 0;
+};
+} // namespace XMPP
+
+Q_DECLARE_METATYPE(XMPP::RosterChangeSet)
+
+#endif // XMPP_ROSTERCHANGES_H
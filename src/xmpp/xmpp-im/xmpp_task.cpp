@@ -22,12 +22,35 @@
 #include "xmpp_stanza.h"
 #include "xmpp_xmlcommon.h"
 
+#include <QHash>
 #include <QTimer>
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
 #define DEFAULT_TIMEOUT 120
 
 using namespace XMPP;
 
+namespace {
+// Owned by the root task. Tasks are ordered by creation, so stanzas are still
+// offered in the same order as the plain walk over children() did.
+class TaskRouter {
+public:
+    using Ordered = std::map<quint64, Task *>;
+
+    quint64                 nextSeq = 0;
+    Ordered                 legacy;    // root children offered every stanza
+    QHash<QString, Ordered> pushes;    // pushKey() => root children with such a filter
+    QHash<QString, Task *>  iqWaiters; // id of a sent iq get/set => task waiting for the reply
+    Task::RoutingStats      stats;
+
+    static QString pushKey(const QString &tagName, const QString &ns) { return tagName + QLatin1Char(' ') + ns; }
+};
+} // namespace
+
 class Task::TaskPrivate {
 public:
     TaskPrivate() = default;
@@ -43,14 +66,28 @@ public:
     bool                autoDelete = false;
     bool                done       = false;
     int                 timeout    = 0;
+
+    std::shared_ptr<TaskRouter> router; // root task only
+    std::weak_ptr<TaskRouter>   rootRouter;
+    quint64                     seq       = 0;
+    bool                        rootChild = false;
+    bool                        indexed   = false;
+    QStringList                 pushKeys;
+    QStringList                 iqIds; // awaiting replies
 };
 
 Task::Task(Task *parent) : QObject(parent)
 {
     init();
 
-    d->client = parent->client();
-    d->id     = client()->genUniqueId();
+    d->client     = parent->client();
+    d->id         = client()->genUniqueId();
+    d->rootRouter = parent->d->rootRouter;
+    if (parent->d->router) {
+        d->rootChild = true;
+        d->seq       = parent->d->router->nextSeq++;
+        parent->d->router->legacy.emplace(d->seq, this);
+    }
     connect(d->client, SIGNAL(disconnected()), SLOT(clientDisconnected()));
 }
 
@@ -58,11 +95,36 @@ Task::Task(Client *parent, bool) : QObject(nullptr)
 {
     init();
 
-    d->client = parent;
+    d->client     = parent;
+    d->router     = std::make_shared<TaskRouter>();
+    d->rootRouter = d->router;
     connect(d->client, SIGNAL(disconnected()), SLOT(clientDisconnected()));
 }
 
-Task::~Task() { delete d; }
+Task::~Task()
+{
+    // the root task is destroyed before its children, so the router may be gone already
+    auto router = d->router ? nullptr : d->rootRouter.lock();
+    if (router) {
+        if (d->rootChild) {
+            router->legacy.erase(d->seq);
+            for (const auto &key : std::as_const(d->pushKeys)) {
+                auto it = router->pushes.find(key);
+                if (it == router->pushes.end())
+                    continue;
+                it->erase(d->seq);
+                if (it->empty())
+                    router->pushes.erase(it);
+            }
+        }
+        for (const auto &id : std::as_const(d->iqIds)) {
+            auto it = router->iqWaiters.find(id);
+            if (it != router->iqWaiters.end() && it.value() == this)
+                router->iqWaiters.erase(it);
+        }
+    }
+    delete d;
+}
 
 void Task::init()
 {
@@ -118,6 +180,9 @@ void Task::go(bool autoDelete)
 
 bool Task::take(const QDomElement &x)
 {
+    if (d->router)
+        return dispatch(x);
+
     const QObjectList p = children();
 
     // pass along the xml
@@ -134,6 +199,73 @@ bool Task::take(const QDomElement &x)
     return false;
 }
 
+bool Task::dispatch(const QDomElement &x)
+{
+    auto         &r   = *d->router;
+    const QString tag = x.tagName();
+
+    if (tag == QLatin1String("iq")) {
+        const QString type = x.attribute(QStringLiteral("type"));
+        if (type == QLatin1String("result") || type == QLatin1String("error")) {
+            const QString id = x.attribute(QStringLiteral("id"));
+            Task         *t  = r.iqWaiters.value(id);
+            if (t && t->take(x)) {
+                // the task may have sent a new request with the same id or got deleted meanwhile
+                auto it = r.iqWaiters.find(id);
+                if (it != r.iqWaiters.end() && it.value() == t) {
+                    r.iqWaiters.erase(it);
+                    t->d->iqIds.removeOne(id);
+                }
+                ++r.stats.byId;
+                return true;
+            }
+        }
+    }
+
+    struct Candidate {
+        quint64 seq;
+        Task   *task;
+        bool    indexed;
+    };
+    std::vector<Candidate> candidates;
+    auto                   collect = [&](const QString &ns) {
+        auto it = r.pushes.constFind(TaskRouter::pushKey(tag, ns));
+        if (it == r.pushes.constEnd())
+            return;
+        for (const auto &[seq, task] : *it)
+            candidates.push_back({ seq, task, true });
+    };
+    collect(QString());
+    for (QDomElement c = x.firstChildElement(); !c.isNull(); c = c.nextSiblingElement())
+        collect(c.namespaceURI());
+    auto byCreation = [](const Candidate &a, const Candidate &b) { return a.seq < b.seq; };
+    std::sort(candidates.begin(), candidates.end(), byCreation);
+    candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                 [](const Candidate &a, const Candidate &b) { return a.seq == b.seq; }),
+                     candidates.end());
+
+    // legacy tasks keep their place in the creation order
+    const auto indexedEnd = candidates.size();
+    for (const auto &[seq, task] : r.legacy)
+        candidates.push_back({ seq, task, false });
+    std::inplace_merge(candidates.begin(), candidates.begin() + indexedEnd, candidates.end(), byCreation);
+
+    for (const auto &c : candidates) {
+        if (c.task->take(x)) { // don't check for done here. it will hurt server tasks
+            ++(c.indexed ? r.stats.byPush : r.stats.byScan);
+            return true;
+        }
+    }
+    ++r.stats.unhandled;
+    return false;
+}
+
+Task::RoutingStats Task::routingStats() const
+{
+    auto router = d->rootRouter.lock();
+    return router ? router->stats : RoutingStats();
+}
+
 void Task::safeDelete()
 {
     if (d->deleteme)
@@ -170,7 +302,42 @@ void Task::onTimeout()
     }
 }
 
-void Task::send(const QDomElement &x) { client()->send(x); }
+void Task::send(const QDomElement &x)
+{
+    if (d->indexed && x.tagName() == QLatin1String("iq")) {
+        const QString type   = x.attribute(QStringLiteral("type"));
+        const QString id     = x.attribute(QStringLiteral("id"));
+        auto          router = d->rootRouter.lock();
+        if (router && !id.isEmpty() && (type == QLatin1String("get") || type == QLatin1String("set"))) {
+            router->iqWaiters.insert(id, this);
+            if (!d->iqIds.contains(id))
+                d->iqIds.append(id);
+        }
+    }
+    client()->send(x);
+}
+
+void Task::setIndexedRouting()
+{
+    if (d->indexed)
+        return;
+    d->indexed = true;
+    auto router = d->rootRouter.lock();
+    if (router && d->rootChild)
+        router->legacy.erase(d->seq);
+}
+
+void Task::addPushFilter(const QString &tagName, const QString &childNS)
+{
+    setIndexedRouting();
+    const QString key = TaskRouter::pushKey(tagName, childNS);
+    if (d->pushKeys.contains(key))
+        return;
+    d->pushKeys.append(key);
+    auto router = d->rootRouter.lock();
+    if (router && d->rootChild)
+        router->pushes[key].emplace(d->seq, this);
+}
 
 void Task::setSuccess(int code, const QString &str)
 {
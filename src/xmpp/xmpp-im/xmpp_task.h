@@ -37,6 +37,15 @@ class Task : public QObject {
     Q_OBJECT
 public:
     enum { ErrDisc, ErrTimeout };
+
+    // How incoming stanzas were delivered by the root task. See setIndexedRouting()
+    struct RoutingStats {
+        quint64 byId      = 0; // iq replies handed straight to the task which sent the request
+        quint64 byPush    = 0; // taken by a task found through its push filter
+        quint64 byScan    = 0; // taken by a legacy task offered every stanza
+        quint64 unhandled = 0;
+    };
+
     Task(Task *parent);
     Task(Client *, bool isRoot);
     virtual ~Task();
@@ -59,6 +68,7 @@ public:
     void         go(bool autoDelete = false);
     virtual bool take(const QDomElement &);
     void         safeDelete();
+    RoutingStats routingStats() const; // meaningful for the root task only
 
 signals:
     void finished();
@@ -76,6 +86,12 @@ protected:
     bool         iqVerify(const QDomElement &x, const Jid &to, const QString &id, const QString &xmlns = "");
     QString      encryptionProtocol(const QDomElement &) const;
 
+    // By default a child of the root task is offered every incoming stanza.
+    // An indexed task is offered only replies to the iq get/set it sent with
+    // send() and the pushes matching its filters. Call these from the constructor.
+    void setIndexedRouting();
+    void addPushFilter(const QString &tagName, const QString &childNS = QString());
+
 private slots:
     void clientDisconnected();
     void timeoutFinished();
@@ -83,6 +99,7 @@ private slots:
 
 private:
     void init();
+    bool dispatch(const QDomElement &x);
 
     class TaskPrivate;
     TaskPrivate *d;
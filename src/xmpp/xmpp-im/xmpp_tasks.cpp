@@ -150,6 +150,7 @@ public:
 
 JT_Register::JT_Register(Task *parent) : Task(parent)
 {
+    setIndexedRouting();
     d             = new Private;
     d->type       = -1;
     d->hasXData   = false;
@@ -358,6 +359,7 @@ public:
 
 JT_Roster::JT_Roster(Task *parent) : Task(parent)
 {
+    setIndexedRouting();
     type = Unknown;
     d    = new Private;
 }
@@ -535,7 +537,7 @@ bool JT_Roster::take(const QDomElement &x)
 //----------------------------------------------------------------------------
 // JT_PushRoster
 //----------------------------------------------------------------------------
-JT_PushRoster::JT_PushRoster(Task *parent) : Task(parent) { }
+JT_PushRoster::JT_PushRoster(Task *parent) : Task(parent) { addPushFilter(QStringLiteral("iq"), "jabber:iq:roster"); }
 
 JT_PushRoster::~JT_PushRoster() { }
 
@@ -670,7 +672,7 @@ void JT_Presence::onGo()
 //----------------------------------------------------------------------------
 // JT_PushPresence
 //----------------------------------------------------------------------------
-JT_PushPresence::JT_PushPresence(Task *parent) : Task(parent) { }
+JT_PushPresence::JT_PushPresence(Task *parent) : Task(parent) { addPushFilter(QStringLiteral("presence")); }
 
 JT_PushPresence::~JT_PushPresence() { }
 
@@ -885,7 +887,7 @@ bool JT_PushMessage::Subscriber::messageEvent(Message &msg, int userData, bool n
     return false;
 }
 
-JT_PushMessage::JT_PushMessage(Task *parent) : Task(parent), d(new Private) { }
+JT_PushMessage::JT_PushMessage(Task *parent) : Task(parent), d(new Private) { addPushFilter(QStringLiteral("message")); }
 
 JT_PushMessage::~JT_PushMessage() { }
 
@@ -1000,6 +1002,7 @@ public:
 
 JT_VCard::JT_VCard(Task *parent) : Task(parent)
 {
+    setIndexedRouting();
     type = -1;
     d    = new Private;
 }
@@ -1093,6 +1096,7 @@ public:
 
 JT_Search::JT_Search(Task *parent) : Task(parent)
 {
+    setIndexedRouting();
     d    = new Private;
     type = -1;
 }
@@ -1229,7 +1233,7 @@ bool JT_Search::take(const QDomElement &x)
 //----------------------------------------------------------------------------
 // JT_ClientVersion
 //----------------------------------------------------------------------------
-JT_ClientVersion::JT_ClientVersion(Task *parent) : Task(parent) { }
+JT_ClientVersion::JT_ClientVersion(Task *parent) : Task(parent) { setIndexedRouting(); }
 
 void JT_ClientVersion::get(const Jid &jid)
 {
@@ -1278,7 +1282,7 @@ const QString &JT_ClientVersion::os() const { return v_os; }
 //----------------------------------------------------------------------------
 // JT_EntityTime
 //----------------------------------------------------------------------------
-JT_EntityTime::JT_EntityTime(Task *parent) : Task(parent) { }
+JT_EntityTime::JT_EntityTime(Task *parent) : Task(parent) { setIndexedRouting(); }
 
 /**
  * \brief Queried entity's JID.
@@ -1338,7 +1342,12 @@ int JT_EntityTime::timezoneOffset() const { return tzo; }
 //----------------------------------------------------------------------------
 // JT_ServInfo
 //----------------------------------------------------------------------------
-JT_ServInfo::JT_ServInfo(Task *parent) : Task(parent) { }
+JT_ServInfo::JT_ServInfo(Task *parent) : Task(parent)
+{
+    addPushFilter(QStringLiteral("iq"), "jabber:iq:version");
+    addPushFilter(QStringLiteral("iq"), "http://jabber.org/protocol/disco#info");
+    addPushFilter(QStringLiteral("iq"), "urn:xmpp:time");
+}
 
 JT_ServInfo::~JT_ServInfo() { }
 
@@ -1420,7 +1429,11 @@ bool JT_ServInfo::take(const QDomElement &e)
 //----------------------------------------------------------------------------
 // JT_Gateway
 //----------------------------------------------------------------------------
-JT_Gateway::JT_Gateway(Task *parent) : Task(parent) { type = -1; }
+JT_Gateway::JT_Gateway(Task *parent) : Task(parent)
+{
+    setIndexedRouting();
+    type = -1;
+}
 
 void JT_Gateway::get(const Jid &jid)
 {
@@ -1505,7 +1518,11 @@ public:
     QDomElement subsetsEl;
 };
 
-JT_DiscoItems::JT_DiscoItems(Task *parent) : Task(parent) { d = new Private; }
+JT_DiscoItems::JT_DiscoItems(Task *parent) : Task(parent)
+{
+    setIndexedRouting();
+    d = new Private;
+}
 
 JT_DiscoItems::~JT_DiscoItems() { delete d; }
 
@@ -1591,7 +1608,11 @@ public:
     DiscoList   list;
 };
 
-JT_DiscoPublish::JT_DiscoPublish(Task *parent) : Task(parent) { d = new Private; }
+JT_DiscoPublish::JT_DiscoPublish(Task *parent) : Task(parent)
+{
+    setIndexedRouting();
+    d = new Private;
+}
 
 JT_DiscoPublish::~JT_DiscoPublish() { delete d; }
 
@@ -1680,7 +1701,11 @@ public:
     BoBData     data;
 };
 
-JT_BitsOfBinary::JT_BitsOfBinary(Task *parent) : Task(parent) { d = new Private; }
+JT_BitsOfBinary::JT_BitsOfBinary(Task *parent) : Task(parent)
+{
+    setIndexedRouting();
+    d = new Private;
+}
 
 JT_BitsOfBinary::~JT_BitsOfBinary() { delete d; }
 
@@ -1739,7 +1764,7 @@ BoBData &JT_BitsOfBinary::data() { return d->data; }
  * \brief Answers XMPP Pings
  */
 
-JT_PongServer::JT_PongServer(Task *parent) : Task(parent) { }
+JT_PongServer::JT_PongServer(Task *parent) : Task(parent) { addPushFilter(QStringLiteral("iq"), "urn:xmpp:ping"); }
 
 bool JT_PongServer::take(const QDomElement &e)
 {
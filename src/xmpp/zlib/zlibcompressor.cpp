@@ -5,8 +5,11 @@
 
 #include <QIODevice>
 #include <QObject>
+#include <QTimer>
 #include <QtDebug>
 
+#include <algorithm>
+
 ZLibCompressor::ZLibCompressor(QIODevice *device, int compression) : device_(device)
 {
     zlib_stream_ = (z_stream *)malloc(sizeof(z_stream));
@@ -16,6 +19,11 @@ ZLibCompressor::ZLibCompressor(QIODevice *device, int compression) : device_(dev
     Q_UNUSED(result);
     connect(device, SIGNAL(aboutToClose()), this, SLOT(flush()));
     flushed_ = false;
+
+    flushTimer_ = new QTimer(this);
+    flushTimer_->setSingleShot(true);
+    flushTimer_->setInterval(0);
+    connect(flushTimer_, &QTimer::timeout, this, &ZLibCompressor::syncFlush);
 }
 
 ZLibCompressor::~ZLibCompressor()
@@ -24,12 +32,24 @@ ZLibCompressor::~ZLibCompressor()
     free(zlib_stream_);
 }
 
+void ZLibCompressor::setFlushPolicy(FlushPolicy policy, int maxPendingBytes, int maxDelayMs)
+{
+    policy_     = policy;
+    maxPending_ = maxPendingBytes;
+    flushTimer_->setInterval(maxDelayMs);
+    if (policy_ == FlushEveryWrite && pendingPlain_)
+        flushPending();
+}
+
+ZLibCompressor::Stats ZLibCompressor::stats() const { return stats_; }
+
 void ZLibCompressor::flush()
 {
     if (flushed_)
         return;
 
     // Flush
+    flushTimer_->stop();
     write(QByteArray(), true);
     int result = deflateEnd(zlib_stream_);
     if (result != Z_OK)
@@ -38,51 +58,76 @@ void ZLibCompressor::flush()
     flushed_ = true;
 }
 
+void ZLibCompressor::syncFlush()
+{
+    if (!flushed_)
+        flushPending();
+}
+
 int ZLibCompressor::write(const QByteArray &input) { return write(input, false); }
 
 int ZLibCompressor::write(const QByteArray &input, bool flush)
 {
-    int result;
-    zlib_stream_->avail_in = uInt(input.size());
-    zlib_stream_->next_in  = (Bytef *)input.data();
-    QByteArray output;
+    int result = deflateInput(input.constData(), int(input.size()), flush ? Z_FINISH : Z_NO_FLUSH);
+    if (result != Z_OK)
+        return result;
+    stats_.plainBytes += quint64(input.size());
+    pendingPlain_ += int(input.size());
 
-    // Write the data
-    int output_position = 0;
+    if (flush) {
+        // end of the stream. nobody is going to read the buffer after this anyway
+        stats_.compressedBytes += quint64(outputSize_);
+        device_->write(output_.constData(), outputSize_);
+        outputSize_   = 0;
+        pendingPlain_ = 0;
+        return 0;
+    }
+
+    if (policy_ == FlushEveryWrite || pendingPlain_ >= maxPending_)
+        return flushPending();
+    if (!flushTimer_->isActive())
+        flushTimer_->start();
+    return 0;
+}
+
+int ZLibCompressor::flushPending()
+{
+    flushTimer_->stop();
+    int result = deflateInput(nullptr, 0, Z_SYNC_FLUSH);
+    if (result != Z_OK)
+        return result;
+
+    // Write the compressed data
+    device_->write(output_.constData(), outputSize_);
+    stats_.compressedBytes += quint64(outputSize_);
+    stats_.flushes++;
+    int plainBytes = pendingPlain_;
+    outputSize_    = 0;
+    pendingPlain_  = 0;
+    emit flushed(plainBytes);
+    return 0;
+}
+
+// Deflates 'data' appending whatever zlib produces to output_ at outputSize_.
+// The buffer only grows, so a long lived stream stops allocating after a while.
+int ZLibCompressor::deflateInput(const char *data, int size, int mode)
+{
+    zlib_stream_->avail_in = uInt(size);
+    zlib_stream_->next_in  = (Bytef *)data;
     do {
-        output.resize(output_position + CHUNK_SIZE);
-        zlib_stream_->avail_out = CHUNK_SIZE;
-        zlib_stream_->next_out  = (Bytef *)(output.data() + output_position);
-        result                  = deflate(zlib_stream_, (flush ? Z_FINISH : Z_NO_FLUSH));
+        if (output_.size() - outputSize_ < CHUNK_SIZE)
+            output_.resize(std::max<qsizetype>(outputSize_ + CHUNK_SIZE, output_.size() * 2));
+        zlib_stream_->avail_out = uInt(output_.size() - outputSize_);
+        zlib_stream_->next_out  = (Bytef *)(output_.data() + outputSize_);
+        int result              = deflate(zlib_stream_, mode);
+        outputSize_             = int(output_.size()) - int(zlib_stream_->avail_out);
         if (result == Z_STREAM_ERROR) {
             qWarning() << QString("compressor.cpp: Error ('%1')").arg(zlib_stream_->msg);
             return result;
         }
-        output_position += CHUNK_SIZE;
     } while (zlib_stream_->avail_out == 0);
     if (zlib_stream_->avail_in != 0) {
         qWarning("ZLibCompressor: avail_in != 0");
     }
-    output_position -= zlib_stream_->avail_out;
-
-    // Flush the data
-    if (!flush) {
-        do {
-            output.resize(output_position + CHUNK_SIZE);
-            zlib_stream_->avail_out = CHUNK_SIZE;
-            zlib_stream_->next_out  = (Bytef *)(output.data() + output_position);
-            result                  = deflate(zlib_stream_, Z_SYNC_FLUSH);
-            if (result == Z_STREAM_ERROR) {
-                qWarning() << QString("compressor.cpp: Error ('%1')").arg(zlib_stream_->msg);
-                return result;
-            }
-            output_position += CHUNK_SIZE;
-        } while (zlib_stream_->avail_out == 0);
-        output_position -= zlib_stream_->avail_out;
-    }
-    output.resize(output_position);
-
-    // Write the compressed data
-    device_->write(output);
-    return 0;
+    return Z_OK;
 }
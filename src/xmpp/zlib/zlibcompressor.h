@@ -3,29 +3,64 @@
 
 #include "zlib.h"
 
+#include <QByteArray>
 #include <QObject>
 
 class QIODevice;
+class QTimer;
 
 class ZLibCompressor : public QObject {
     Q_OBJECT
 
 public:
+    // FlushEveryWrite emits a sync flush after each write. FlushCoalesced compresses
+    // writes into the same deflate block until the pending input reaches the byte
+    // budget or the delay expires (0 means the end of the current event loop turn).
+    enum FlushPolicy { FlushEveryWrite, FlushCoalesced };
+
+    struct Stats {
+        quint64 plainBytes      = 0;
+        quint64 compressedBytes = 0;
+        quint64 flushes         = 0;
+
+        double ratio() const { return plainBytes ? double(compressedBytes) / double(plainBytes) : 1.0; }
+    };
+
     ZLibCompressor(QIODevice *device, int compression = Z_DEFAULT_COMPRESSION);
     ~ZLibCompressor();
 
+    void  setFlushPolicy(FlushPolicy policy, int maxPendingBytes = 16384, int maxDelayMs = 0);
+    Stats stats() const;
+
     int write(const QByteArray &);
 
+signals:
+    // compressed data for 'plainBytes' of input was written to the device
+    void flushed(int plainBytes);
+
 protected slots:
     void flush();
 
 protected:
     int write(const QByteArray &, bool flush);
 
+private slots:
+    void syncFlush();
+
 private:
-    QIODevice *device_;
-    z_stream  *zlib_stream_;
-    bool       flushed_;
+    int deflateInput(const char *data, int size, int mode);
+    int flushPending();
+
+    QIODevice  *device_;
+    z_stream   *zlib_stream_;
+    bool        flushed_;
+    QByteArray  output_; // kept between flushes to reuse the allocation
+    int         outputSize_   = 0;
+    FlushPolicy policy_       = FlushEveryWrite;
+    int         maxPending_   = 16384;
+    int         pendingPlain_ = 0;
+    QTimer     *flushTimer_   = nullptr;
+    Stats       stats_;
 };
 
 #endif // ZLIBCOMPRESSOR_H
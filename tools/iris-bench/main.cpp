@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stubserver.h"
+#include "xmpp/sasl/scramresponse.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTimer>
+
+#include <QtCrypto>
+#ifdef QCA_STATIC
+#include <QtPlugin>
+Q_IMPORT_PLUGIN(qca_ossl)
+#endif
+
+#include <iris/xmpp.h>
+#include <iris/xmpp_client.h>
+#include <iris/xmpp_message.h>
+#include <iris/xmpp_task.h>
+#include <iris/xmpp_xmlcommon.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdio.h>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+using namespace XMPP;
+
+// resident set size of the process in bytes, 0 if unknown
+static qint64 residentSize()
+{
+#ifdef Q_OS_LINUX
+    QFile f(QStringLiteral("/proc/self/statm"));
+    if (f.open(QIODevice::ReadOnly)) {
+        QList<QByteArray> fields = f.readAll().split(' ');
+        if (fields.size() > 1)
+            return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return 0;
+}
+
+static double percentile(QList<qint64> &values, double p)
+{
+    if (values.isEmpty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    qsizetype i = qMin(values.size() - 1, qsizetype(p * values.size()));
+    return values[i] / 1000.0; // usecs => msecs
+}
+
+class PingTask : public Task {
+public:
+    PingTask(Task *parent, const Jid &to) : Task(parent), to_(to) { }
+
+    void onGo() override
+    {
+        QDomElement iq = createIQ(doc(), "get", to_.full(), id());
+        iq.appendChild(doc()->createElementNS("urn:xmpp:ping", "ping"));
+        send(iq);
+    }
+
+    bool take(const QDomElement &x) override
+    {
+        if (!iqVerify(x, to_, id()))
+            return false;
+        if (x.attribute("type") == "result")
+            setSuccess();
+        else
+            setError(x);
+        return true;
+    }
+
+private:
+    Jid to_;
+};
+
+// one benchmarked connection
+class BenchClient : public QObject {
+    Q_OBJECT
+
+public:
+    AdvancedConnector connector;
+    Client            client;
+    ClientStream     *stream = nullptr;
+    Jid               jid;
+    QElapsedTimer     timer;
+    qint64            loginUsecs = -1;
+    int               received   = 0;
+
+    BenchClient(const Jid &j, quint16 port) : jid(j)
+    {
+        connector.setOptHostPort(QStringLiteral("127.0.0.1"), port);
+        stream = new ClientStream(&connector, nullptr, this);
+        stream->setAllowPlain(ClientStream::AllowPlain);
+        connect(stream, &ClientStream::needAuthParams, this, [this](bool user, bool pass, bool) {
+            if (user)
+                stream->setUsername(jid.node());
+            if (pass)
+                stream->setPassword(QStringLiteral("bench"));
+            stream->continueAfterParams();
+        });
+        connect(stream, &ClientStream::warning, stream, &ClientStream::continueAfterWarning);
+        connect(stream, &ClientStream::authenticated, this, [this]() {
+            loginUsecs = timer.nsecsElapsed() / 1000;
+            client.start(jid.domain(), jid.node(), QString(), jid.resource());
+            emit loggedIn();
+        });
+        connect(&client, &Client::disconnected, this, &BenchClient::failed);
+        connect(&client, &Client::messageReceived, this, [this](const Message &) {
+            ++received;
+            emit messageReceived();
+        });
+    }
+
+    ~BenchClient()
+    {
+        client.close(true);
+        delete stream; // before the connector
+    }
+
+    void login()
+    {
+        timer.start();
+        client.connectToServer(stream, jid);
+    }
+
+signals:
+    void loggedIn();
+    void failed();
+    void messageReceived();
+};
+
+class App : public QObject {
+    Q_OBJECT
+
+public:
+    int opt_clients    = 100;
+    int opt_pings      = 50;
+    int opt_messages   = 100;
+    int opt_logins     = 0;
+    int opt_scram      = 0;
+    int opt_iterations = 10000;
+
+    StubServer          server { QStringLiteral("bench.local") };
+    QList<BenchClient *> clients;
+    QElapsedTimer        phase;
+    qint64               rssBefore  = 0;
+    int                  pending    = 0;
+    QList<qint64>        pingUsecs;
+    int                  messagesIn = 0;
+    QList<qint64>        loginUsecs; // of the sequential logins
+    bool                 failed     = false;
+
+    ~App() { qDeleteAll(clients); }
+
+public slots:
+    void start()
+    {
+        QString mech = opt_scram ? QString("SCRAM-SHA-%1").arg(opt_scram) : QString("PLAIN");
+        if (opt_scram) {
+            if (SCRAMResponse::hashForMechanism(mech).isEmpty()) {
+                fprintf(stderr, "Error: %s is not supported.\n", qPrintable(mech));
+                failed = true;
+                emit quit();
+                return;
+            }
+            server.setSCRAM(mech, QStringLiteral("bench"), opt_iterations);
+        }
+        if (!server.listen()) {
+            fprintf(stderr, "Error: unable to listen.\n");
+            failed = true;
+            emit quit();
+            return;
+        }
+        printf("Stub server on 127.0.0.1:%d, %d clients, %s\n", server.port(), opt_clients, qPrintable(mech));
+
+        if (opt_logins)
+            nextLogin();
+        else
+            startClients();
+    }
+
+signals:
+    void quit();
+
+private:
+    // one account logging in again and again, as a bot reconnecting does
+    void nextLogin()
+    {
+        if (loginUsecs.size() == opt_logins) {
+            qint64 elapsed = phase.elapsed();
+            qint64 first   = loginUsecs.first();
+            printf("logins:    %d sequential in %lld ms, first %.2f ms, p50 %.2f ms, p99 %.2f ms\n", opt_logins,
+                   elapsed, first / 1000.0, percentile(loginUsecs, 0.5), percentile(loginUsecs, 0.99));
+            startClients();
+            return;
+        }
+        if (loginUsecs.isEmpty())
+            phase.start();
+
+        auto c = new BenchClient(Jid(QStringLiteral("seq@bench.local/bench")), server.port());
+        connect(c, &BenchClient::loggedIn, this, [this, c]() {
+            loginUsecs += c->loginUsecs;
+            c->disconnect(this);
+            c->client.disconnect(c);
+            c->deleteLater();
+            QTimer::singleShot(0, this, &App::nextLogin);
+        });
+        connect(c, &BenchClient::failed, this, [this]() {
+            fprintf(stderr, "Error: a sequential login failed.\n");
+            failed = true;
+            emit quit();
+        });
+        c->login();
+    }
+
+    void startClients()
+    {
+        rssBefore = residentSize();
+        pending   = opt_clients;
+        phase.start();
+        for (int n = 0; n < opt_clients; ++n) {
+            auto c = new BenchClient(Jid(QString("user%1@bench.local/bench").arg(n)), server.port());
+            clients += c;
+            connect(c, &BenchClient::loggedIn, this, &App::clientLoggedIn);
+            connect(c, &BenchClient::failed, this, [this]() {
+                fprintf(stderr, "Error: a client got disconnected.\n");
+                failed = true;
+                emit quit();
+            });
+            c->login();
+        }
+    }
+
+    void clientLoggedIn()
+    {
+        if (--pending)
+            return;
+
+        qint64        elapsed = phase.elapsed();
+        QList<qint64> login;
+        for (auto c : std::as_const(clients))
+            login += c->loginUsecs;
+        qint64 rss = residentSize();
+        printf("login:     %d clients in %lld ms, p50 %.2f ms, p99 %.2f ms\n", opt_clients, elapsed,
+               percentile(login, 0.5), percentile(login, 0.99));
+        if (rss && rssBefore)
+            printf("memory:    %.1f KiB per connection (client and server side)\n",
+                   double(rss - rssBefore) / opt_clients / 1024);
+        startPings();
+    }
+
+    void startPings()
+    {
+        pending = opt_clients;
+        phase.start();
+        for (auto c : std::as_const(clients))
+            ping(c, opt_pings);
+    }
+
+    void ping(BenchClient *c, int left)
+    {
+        if (!left) {
+            if (!--pending)
+                pingsFinished();
+            return;
+        }
+        auto task = new PingTask(c->client.rootTask(), Jid(server.domain()));
+        auto sent = std::make_shared<QElapsedTimer>();
+        connect(task, &Task::finished, this, [this, c, task, sent, left]() {
+            pingUsecs += sent->nsecsElapsed() / 1000;
+            if (!task->success()) {
+                fprintf(stderr, "Error: ping failed.\n");
+                failed = true;
+                emit quit();
+                return;
+            }
+            ping(c, left - 1);
+        });
+        sent->start();
+        task->go(true);
+    }
+
+    void pingsFinished()
+    {
+        qint64 elapsed = phase.elapsed();
+        printf("iq ping:   %lld round trips in %lld ms, p50 %.3f ms, p99 %.3f ms\n", qint64(pingUsecs.size()), elapsed,
+               percentile(pingUsecs, 0.5), percentile(pingUsecs, 0.99));
+        startMessages();
+    }
+
+    // every client sends messages to itself through the server at once
+    void startMessages()
+    {
+        pending = opt_clients * opt_messages;
+        if (!pending) {
+            finish();
+            return;
+        }
+        for (auto c : std::as_const(clients)) {
+            connect(c, &BenchClient::messageReceived, this, [this]() {
+                if (!--pending) {
+                    qint64 elapsed = qMax(qint64(1), phase.elapsed());
+                    qint64 total   = qint64(opt_clients) * opt_messages;
+                    printf("messages:  %lld in %lld ms, %.0f stanzas/s\n", total, elapsed,
+                           total * 2 * 1000.0 / elapsed);
+                    finish();
+                }
+            });
+        }
+        phase.start();
+        for (int n = 0; n < opt_messages; ++n) {
+            for (auto c : std::as_const(clients)) {
+                Message m(c->jid);
+                m.setType(Message::Type::Chat);
+                m.setBody(QString("message %1").arg(n));
+                c->client.sendMessage(m);
+            }
+        }
+    }
+
+    void finish()
+    {
+        printf("server:    %llu stanzas received\n", server.stanzaCount());
+        for (auto c : std::as_const(clients)) {
+            c->disconnect(this);
+            c->client.disconnect(c);
+            c->client.close();
+        }
+        emit quit();
+    }
+};
+
+void usage()
+{
+    printf("iris-bench: XMPP client benchmark against an in-process stub server\n");
+    printf("usage: iris-bench [options]\n");
+    printf("\n");
+    printf(" --clients=[n]      number of connections (default=100)\n");
+    printf(" --pings=[n]        iq pings per connection, one at a time (default=50)\n");
+    printf(" --messages=[n]     messages per connection, all at once (default=100)\n");
+    printf(" --logins=[n]       sequential logins of one account before the rest (default=0)\n");
+    printf(" --scram=[n]        log in with SCRAM-SHA-n instead of PLAIN, 1, 256 or 512\n");
+    printf(" --iterations=[n]   SCRAM iteration count (default=10000)\n");
+    printf(" --scram-cache=[n]  SCRAM keys kept by the client, 0 to derive at every login (default=32)\n");
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    QCA::Initializer qcaInit;
+    QCoreApplication qapp(argc, argv);
+
+    QStringList args = qapp.arguments();
+    args.removeFirst();
+
+    App app;
+    for (const QString &s : std::as_const(args)) {
+        int     x   = s.indexOf('=');
+        QString var = s.mid(2, x - 2);
+        int     val = s.mid(x + 1).toInt();
+        if (!s.startsWith("--") || x == -1 || val < 0) {
+            usage();
+            return 1;
+        }
+
+        if (var == "clients" && val > 0)
+            app.opt_clients = val;
+        else if (var == "pings")
+            app.opt_pings = val;
+        else if (var == "messages")
+            app.opt_messages = val;
+        else if (var == "logins")
+            app.opt_logins = val;
+        else if (var == "scram")
+            app.opt_scram = val;
+        else if (var == "iterations" && val > 0)
+            app.opt_iterations = val;
+        else if (var == "scram-cache")
+            SCRAMResponse::setKeyCacheSize(val);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    QObject::connect(&app, SIGNAL(quit()), &qapp, SLOT(quit()));
+    QTimer::singleShot(0, &app, SLOT(start()));
+    qapp.exec();
+
+    return app.failed ? 1 : 0;
+}
+
+#include "main.moc"
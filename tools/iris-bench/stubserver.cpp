@@ -0,0 +1,319 @@
+/*
+ * stubserver.cpp - minimal in-process XMPP server for benchmarks
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stubserver.h"
+
+#include "xmpp/sasl/scramresponse.h"
+#include "xmpp/xmpp-core/parser.h"
+#include "xmpp/xmpp-core/xmlwriter.h"
+
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtCrypto>
+
+#define NS_CLIENT "jabber:client"
+#define NS_SASL "urn:ietf:params:xml:ns:xmpp-sasl"
+#define NS_BIND "urn:ietf:params:xml:ns:xmpp-bind"
+#define NS_SESSION "urn:ietf:params:xml:ns:xmpp-session"
+#define NS_PING "urn:xmpp:ping"
+
+namespace XMPP {
+static QByteArray hmac(const QString &hash, const QByteArray &key, const QByteArray &data)
+{
+    QCA::MessageAuthenticationCode mac(QLatin1String("hmac(") + hash + QLatin1Char(')'), QCA::SymmetricKey(key));
+    mac.update(data);
+    return mac.final().toByteArray();
+}
+
+static QByteArray scramAttribute(const QByteArray &message, char name)
+{
+    const auto attrs = message.split(',');
+    for (const QByteArray &attr : attrs) {
+        if (attr.size() > 1 && attr[0] == name && attr[1] == '=')
+            return attr.mid(2);
+    }
+    return QByteArray();
+}
+
+// One client connection. The incoming side goes through the same Parser the
+// client uses, replies are written as plain strings.
+class StubSession : public QObject {
+public:
+    StubSession(StubServer *server, QTcpSocket *socket, const QString &id) :
+        QObject(server), server_(server), socket_(socket), id_(id)
+    {
+        socket_->setParent(this);
+        connect(socket_, &QTcpSocket::readyRead, this, &StubSession::readData);
+        connect(socket_, &QTcpSocket::disconnected, this, [this]() {
+            server_->closed(this);
+            deleteLater();
+        });
+    }
+
+    const QString &jid() const { return jid_; }
+
+    void deliver(QDomElement e, const QString &from)
+    {
+        e.setAttribute(QStringLiteral("from"), from);
+        socket_->write(XmlWriter::toUtf8(e, QStringLiteral(NS_CLIENT)));
+    }
+
+private:
+    void readData()
+    {
+        parser_.appendData(socket_->readAll());
+        for (Parser::Event pe = parser_.readNext(); !pe.isNull(); pe = parser_.readNext()) {
+            switch (pe.type()) {
+            case Parser::Event::DocumentOpen:
+                streamOpened();
+                break;
+            case Parser::Event::DocumentClose:
+                socket_->write("</stream:stream>");
+                socket_->disconnectFromHost();
+                return;
+            case Parser::Event::Element:
+                ++server_->stanzas_;
+                if (!handleElement(pe.element()))
+                    return;
+                break;
+            default: // Error
+                socket_->disconnectFromHost();
+                return;
+            }
+        }
+    }
+
+    void streamOpened()
+    {
+        QByteArray out = "<?xml version='1.0'?><stream:stream xmlns='" NS_CLIENT "'"
+                         " xmlns:stream='http://etherx.jabber.org/streams' version='1.0' from='";
+        out += server_->domain().toUtf8() + "' id='" + id_.toUtf8() + "'><stream:features>";
+        if (authenticated_)
+            out += "<bind xmlns='" NS_BIND "'/>";
+        else {
+            QByteArray mech = server_->scramMechanism_.isEmpty() ? "PLAIN" : server_->scramMechanism_.toLatin1();
+            out += "<mechanisms xmlns='" NS_SASL "'><mechanism>" + mech + "</mechanism></mechanisms>";
+        }
+        out += "</stream:features>";
+        socket_->write(out);
+    }
+
+    // false if the parser was reset
+    bool handleElement(const QDomElement &e)
+    {
+        if (e.namespaceURI() == QLatin1String(NS_SASL)) {
+            QByteArray in = QByteArray::fromBase64(e.text().toLatin1());
+            if (e.tagName() == QLatin1String("response"))
+                return scramFinal(in);
+            if (e.tagName() != QLatin1String("auth"))
+                return true;
+            if (!server_->scramMechanism_.isEmpty()) {
+                scramFirst(in);
+                return true;
+            }
+            // any password is fine. PLAIN is "authzid\0authcid\0password"
+            QList<QByteArray> parts = in.split('\0');
+            user_                   = parts.size() == 3 ? QString::fromUtf8(parts[1]) : QString("user") + id_;
+            return authenticated();
+        }
+
+        const QString to = e.attribute(QStringLiteral("to"));
+        if (!to.isEmpty() && to != server_->domain()) {
+            StubSession *peer = jid_.isEmpty() ? nullptr : server_->route(to);
+            if (peer)
+                peer->deliver(e, jid_);
+            return true;
+        }
+        if (e.tagName() == QLatin1String("iq"))
+            handleIq(e);
+        return true;
+    }
+
+    // false as the parser was reset
+    bool authenticated(const QByteArray &data = QByteArray())
+    {
+        if (data.isEmpty())
+            socket_->write("<success xmlns='" NS_SASL "'/>");
+        else
+            socket_->write("<success xmlns='" NS_SASL "'>" + data.toBase64() + "</success>");
+        authenticated_  = true;
+        QByteArray rest = parser_.unprocessed();
+        parser_.reset();
+        parser_.appendData(rest);
+        return false;
+    }
+
+    void authFailed() { socket_->write("<failure xmlns='" NS_SASL "'><not-authorized/></failure>"); }
+
+    // client-first-message in, server-first-message out
+    void scramFirst(const QByteArray &in)
+    {
+        // the gs2 header ends at the second comma. no channel binding here
+        int gs2_end = in.indexOf(',', in.indexOf(',') + 1);
+        if (gs2_end == -1 || in.startsWith("p=")) {
+            authFailed();
+            return;
+        }
+        scramBare_   = in.mid(gs2_end + 1);
+        user_        = QString::fromUtf8(scramAttribute(scramBare_, 'n'));
+        QByteArray r = scramAttribute(scramBare_, 'r') + QByteArray::number(QRandomGenerator::global()->generate64());
+
+        const auto &keys  = server_->scramKeys(user_);
+        scramServerFirst_ = "r=" + r + ",s=" + keys.salt.toBase64() + ",i="
+            + QByteArray::number(server_->scramIterations_);
+        socket_->write("<challenge xmlns='" NS_SASL "'>" + scramServerFirst_.toBase64() + "</challenge>");
+    }
+
+    // client-final-message in, success with the server signature out
+    bool scramFinal(const QByteArray &in)
+    {
+        int proofAt = in.lastIndexOf(",p=");
+        if (scramServerFirst_.isEmpty() || proofAt == -1) {
+            authFailed();
+            return true;
+        }
+        const QString &hash        = server_->scramHash_;
+        const auto    &keys        = server_->scramKeys(user_);
+        QByteArray     proof       = QByteArray::fromBase64(in.mid(proofAt + 3));
+        QByteArray     authMessage = scramBare_ + ',' + scramServerFirst_ + ',' + in.left(proofAt);
+
+        // ClientKey = ClientProof XOR HMAC(StoredKey, AuthMessage), and StoredKey = H(ClientKey)
+        QByteArray clientKey = hmac(hash, keys.storedKey, authMessage);
+        for (int i = 0; i < qMin(clientKey.size(), proof.size()); ++i)
+            clientKey[i] = clientKey[i] ^ proof[i];
+        scramServerFirst_.clear();
+        if (proof.size() != clientKey.size()
+            || QCA::Hash(hash).process(clientKey).toByteArray() != keys.storedKey) {
+            authFailed();
+            return true;
+        }
+        return authenticated("v=" + hmac(hash, keys.serverKey, authMessage).toBase64());
+    }
+
+    void handleIq(const QDomElement &e)
+    {
+        const QString type = e.attribute(QStringLiteral("type"));
+        if (type != QLatin1String("get") && type != QLatin1String("set"))
+            return;
+
+        const QString     id    = e.attribute(QStringLiteral("id"));
+        const QDomElement query = e.firstChildElement();
+        QByteArray        out   = "<iq type='result' id='" + id.toUtf8() + "' from='" + server_->domain().toUtf8();
+        out += '\'';
+        if (query.namespaceURI() == QLatin1String(NS_BIND)) {
+            QString resource = query.firstChildElement(QStringLiteral("resource")).text();
+            if (resource.isEmpty())
+                resource = id_;
+            jid_ = QStringLiteral("%1@%2/%3").arg(user_, server_->domain(), resource);
+            server_->bound(this);
+            out += "><bind xmlns='" NS_BIND "'><jid>" + jid_.toUtf8() + "</jid></bind></iq>";
+        } else if (query.namespaceURI() == QLatin1String(NS_PING)
+                   || query.namespaceURI() == QLatin1String(NS_SESSION)) {
+            out += "/>";
+        } else {
+            out.replace("type='result'", "type='error'");
+            out += "><error type='cancel'><service-unavailable xmlns='urn:ietf:params:xml:ns:xmpp-stanzas'/>"
+                   "</error></iq>";
+        }
+        socket_->write(out);
+    }
+
+    StubServer *server_;
+    QTcpSocket *socket_;
+    QString     id_;
+    QString     user_;
+    QString     jid_;
+    Parser      parser_;
+    bool        authenticated_ = false;
+    QByteArray  scramBare_; // client-first-message-bare
+    QByteArray  scramServerFirst_;
+};
+
+StubServer::StubServer(const QString &domain, QObject *parent) : QObject(parent), domain_(domain) { }
+
+StubServer::~StubServer() { }
+
+void StubServer::setSCRAM(const QString &mechanism, const QString &password, int iterations)
+{
+    scramMechanism_  = mechanism;
+    scramHash_       = SCRAMResponse::hashForMechanism(mechanism);
+    scramPassword_   = password.toUtf8();
+    scramIterations_ = iterations;
+    scramKeys_.clear();
+}
+
+const StubServer::SCRAMKeys &StubServer::scramKeys(const QString &user)
+{
+    auto it = scramKeys_.find(user);
+    if (it != scramKeys_.end())
+        return *it;
+
+    // SaltedPassword is PBKDF2 of a single block
+    SCRAMKeys keys;
+    keys.salt         = QCA::Hash(scramHash_).hashToString(user.toUtf8()).toLatin1().left(16);
+    QByteArray u      = hmac(scramHash_, scramPassword_, keys.salt + QByteArray("\0\0\0\1", 4));
+    QByteArray salted = u;
+    for (int n = 1; n < scramIterations_; ++n) {
+        u = hmac(scramHash_, scramPassword_, u);
+        for (int i = 0; i < salted.size(); ++i)
+            salted[i] = salted[i] ^ u[i];
+    }
+    keys.storedKey = QCA::Hash(scramHash_).process(hmac(scramHash_, salted, "Client Key")).toByteArray();
+    keys.serverKey = hmac(scramHash_, salted, "Server Key");
+    return *scramKeys_.insert(user, keys);
+}
+
+bool StubServer::listen(const QHostAddress &address, quint16 port)
+{
+    server_ = new QTcpServer(this);
+    connect(server_, &QTcpServer::newConnection, this, [this]() {
+        while (server_->hasPendingConnections()) {
+            QTcpSocket *socket = server_->nextPendingConnection();
+            socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            new StubSession(this, socket, QString::number(++nextId_));
+        }
+    });
+    return server_->listen(address, port);
+}
+
+quint16 StubServer::port() const { return server_ ? server_->serverPort() : 0; }
+
+void StubServer::bound(StubSession *session) { sessions_.insert(session->jid(), session); }
+
+void StubServer::closed(StubSession *session)
+{
+    if (!session->jid().isEmpty())
+        sessions_.remove(session->jid());
+}
+
+StubSession *StubServer::route(const QString &to) const
+{
+    auto it = sessions_.constFind(to);
+    if (it != sessions_.constEnd())
+        return *it;
+    // bare jid. any resource will do
+    QString bare = to.section(QLatin1Char('/'), 0, 0);
+    for (auto s : std::as_const(sessions_)) {
+        if (s->jid().section(QLatin1Char('/'), 0, 0) == bare)
+            return s;
+    }
+    return nullptr;
+}
+} // namespace XMPP
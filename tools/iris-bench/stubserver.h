@@ -0,0 +1,82 @@
+/*
+ * stubserver.h - minimal in-process XMPP server for benchmarks
+ * Copyright (C) 2026  Sergey Ilinykh
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STUBSERVER_H
+#define STUBSERVER_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QObject>
+
+class QTcpServer;
+class QTcpSocket;
+
+namespace XMPP {
+class StubSession;
+
+// Accepts any user with SASL PLAIN over plain TCP, or with SCRAM and the one
+// password every user has if setSCRAM() was called. Binds the requested resource,
+// answers pings and routes stanzas between the connected sessions. There is no
+// roster, presence broadcast, TLS or anything else a real server does, so that
+// the client side dominates what is measured.
+class StubServer : public QObject {
+    Q_OBJECT
+public:
+    explicit StubServer(const QString &domain, QObject *parent = nullptr);
+    ~StubServer();
+
+    // offer a SCRAM mechanism, like "SCRAM-SHA-256", instead of PLAIN. The server
+    // derives the keys of a user once, so it costs only at the first login.
+    void      setSCRAM(const QString &mechanism, const QString &password, int iterations);
+    bool      listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+    quint16   port() const;
+    QString   domain() const { return domain_; }
+    quint64   stanzaCount() const { return stanzas_; } // received from all the sessions
+    qsizetype sessionCount() const { return sessions_.size(); }
+
+private:
+    friend class StubSession;
+
+    class SCRAMKeys {
+    public:
+        QByteArray salt;
+        QByteArray storedKey;
+        QByteArray serverKey;
+    };
+
+    const SCRAMKeys &scramKeys(const QString &user);
+    void             bound(StubSession *session);
+    void             closed(StubSession *session);
+    StubSession     *route(const QString &to) const;
+
+    QString                       domain_;
+    QTcpServer                   *server_ = nullptr;
+    QHash<QString, StubSession *> sessions_; // full jid => bound session
+    quint64                       stanzas_ = 0;
+    int                           nextId_  = 0;
+
+    QString                   scramMechanism_;
+    QString                   scramHash_; // QCA name
+    QByteArray                scramPassword_;
+    int                       scramIterations_ = 0;
+    QHash<QString, SCRAMKeys> scramKeys_; // user => keys
+};
+} // namespace XMPP
+
+#endif // STUBSERVER_H